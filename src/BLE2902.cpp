@@ -38,6 +38,7 @@ bool BLE2902::getIndications() {
 
 /**
  * @brief Set the indications flag.
+ * This is the local default, used for the peers that have not written the descriptor themselves.
  * @param [in] flag The indications flag.
  */
 void BLE2902::setIndications(bool flag) {
@@ -49,6 +50,7 @@ void BLE2902::setIndications(bool flag) {
 
 /**
  * @brief Set the notifications flag.
+ * This is the local default, used for the peers that have not written the descriptor themselves.
  * @param [in] flag The notifications flag.
  */
 void BLE2902::setNotifications(bool flag) {
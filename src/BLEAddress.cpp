@@ -86,3 +86,50 @@ std::string BLEAddress::toString() {
 	return ret;
 } // toString
 
+
+
+/**
+ * @brief Pack the address and its type into a single integer.
+ *
+ * The six address octets occupy the low 48 bits and the address type the next 8 bits.  The key
+ * can be compared and hashed directly, which avoids formatting the address as a string.
+ *
+ * @param [in] addressType The address type (public, random ...).
+ * @return The packed key.
+ */
+uint64_t BLEAddress::toKey(uint8_t addressType) {
+	return toKey(m_address, addressType);
+} // toKey
+
+
+/**
+ * @brief Pack a native address and its type into a single integer.
+ * @param [in] address The native representation of the address.
+ * @param [in] addressType The address type.
+ * @return The packed key.
+ */
+uint64_t BLEAddress::toKey(const uint8_t* address, uint8_t addressType) {
+	uint64_t key = addressType;
+	for (int i = BD_ADDR_LEN - 1; i >= 0; i--) {
+		key = (key << 8) | address[i];
+	}
+	return key;
+} // toKey
+
+
+/**
+ * @brief Hash a packed address key.
+ *
+ * Only the 48 address bits take part in the hash so that the same address seen with a different
+ * address type lands in the same probe sequence.
+ *
+ * @param [in] key A key returned by toKey().
+ * @return A 32 bit hash of the address.
+ */
+uint32_t BLEAddress::hashKey(uint64_t key) {
+	uint32_t h = (uint32_t)key ^ ((uint32_t)((key >> 32) & 0xffff) * 0x9e3779b1);
+	h ^= h >> 15;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	return h;
+} // hashKey
@@ -28,6 +28,10 @@ public:
 	bool           equals(BLEAddress otherAddress);
 	bd_addr_t*     getNative();
 	std::string    toString();
+	uint64_t       toKey(uint8_t addressType = 0);
+
+	static uint64_t toKey(const uint8_t* address, uint8_t addressType);
+	static uint32_t hashKey(uint64_t key);
 
 private:
 	bd_addr_t m_address;    
@@ -0,0 +1,153 @@
+/*
+ * BLEAdvPayload.h
+ *
+ *  Builds legacy advertising payloads at compile time.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVPAYLOAD_H_
+#define COMPONENTS_CPP_UTILS_BLEADVPAYLOAD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include "rtl_ble/ble_unified.h"
+
+/// Size of a legacy advertising or scan response payload.
+#define BLE_ADV_PAYLOAD_MAX 31
+
+template <size_t... I> struct BLEAdvIndices {};
+template <size_t N, size_t... I> struct BLEAdvMakeIndices : BLEAdvMakeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct BLEAdvMakeIndices<0, I...> { typedef BLEAdvIndices<I...> type; };
+
+/// A single octet.
+struct BLEAdvField8 {
+	static constexpr size_t size = 1;
+	uint8_t value;
+	constexpr uint8_t at(size_t) const { return value; }
+};
+
+/// A 16 bit value, little endian.
+struct BLEAdvField16 {
+	static constexpr size_t size = 2;
+	uint16_t value;
+	constexpr uint8_t at(size_t i) const { return (uint8_t)(i == 0 ? value : value >> 8); }
+};
+
+/// The characters of a string literal, without the terminator.
+template <size_t M>
+struct BLEAdvFieldString {
+	static constexpr size_t size = M - 1;
+	const char (&value)[M];
+	constexpr uint8_t at(size_t i) const { return (uint8_t)value[i]; }
+};
+
+/// The octets of an array with static storage.
+template <size_t M>
+struct BLEAdvFieldBytes {
+	static constexpr size_t size = M;
+	const uint8_t (&value)[M];
+	constexpr uint8_t at(size_t i) const { return value[i]; }
+};
+
+/// A 16 bit identifier followed by octets, as in manufacturer specific and service data.
+template <size_t M>
+struct BLEAdvFieldTagged {
+	static constexpr size_t size = M + 2;
+	uint16_t tag;
+	const uint8_t (&value)[M];
+	constexpr uint8_t at(size_t i) const { return (uint8_t)(i == 0 ? tag : i == 1 ? tag >> 8 : value[i - 2]); }
+};
+
+/**
+ * @brief An advertising payload of N bytes, built at compile time.
+ *
+ * Every builder call returns a new payload type with the AD structure appended, so the whole chain can
+ * be evaluated by the compiler and a payload that would not fit in 31 bytes fails to compile:
+ *
+ *     static constexpr uint8_t kData[] = { 0x01, 0x02 };
+ *     static constexpr auto kAdvert = BLEAdvPayload<>().flags(0x06).name("Sensor").service16(0x180F)
+ *                                                      .manufacturerData(0x02E5, kData);
+ *     pAdvertising->setAdvertisementData(kAdvert);
+ *
+ * Payloads declared static constexpr live in flash and cost no start up code.  Byte arrays passed to
+ * the builder must have static storage so the payload can refer to them during evaluation.
+ */
+template <size_t N = 0>
+class BLEAdvPayload {
+	static_assert(N <= BLE_ADV_PAYLOAD_MAX, "Advertising payload does not fit in 31 bytes");
+public:
+	constexpr BLEAdvPayload() : m_data{} {}
+
+	constexpr BLEAdvPayload<N + 3> flags(uint8_t flags) const {
+		return append(GAP_ADTYPE_FLAGS, BLEAdvField8{flags});
+	}
+	template <size_t M>
+	constexpr BLEAdvPayload<N + 1 + M> name(const char (&name)[M]) const {
+		return append(GAP_ADTYPE_LOCAL_NAME_COMPLETE, BLEAdvFieldString<M>{name});
+	}
+	template <size_t M>
+	constexpr BLEAdvPayload<N + 1 + M> shortName(const char (&name)[M]) const {
+		return append(GAP_ADTYPE_LOCAL_NAME_SHORT, BLEAdvFieldString<M>{name});
+	}
+	constexpr BLEAdvPayload<N + 3> txPower(int8_t power) const {
+		return append(GAP_ADTYPE_POWER_LEVEL, BLEAdvField8{(uint8_t)power});
+	}
+	constexpr BLEAdvPayload<N + 4> appearance(uint16_t appearance) const {
+		return append(GAP_ADTYPE_APPEARANCE, BLEAdvField16{appearance});
+	}
+	constexpr BLEAdvPayload<N + 4> service16(uint16_t uuid) const {
+		return append(GAP_ADTYPE_16BIT_COMPLETE, BLEAdvField16{uuid});
+	}
+	/// The UUID is given least significant octet first, as it is sent.
+	constexpr BLEAdvPayload<N + 18> service128(const uint8_t (&uuid)[16]) const {
+		return append(GAP_ADTYPE_128BIT_COMPLETE, BLEAdvFieldBytes<16>{uuid});
+	}
+	template <size_t M>
+	constexpr BLEAdvPayload<N + 4 + M> serviceData16(uint16_t uuid, const uint8_t (&data)[M]) const {
+		return append(GAP_ADTYPE_SERVICE_DATA, BLEAdvFieldTagged<M>{uuid, data});
+	}
+	template <size_t M>
+	constexpr BLEAdvPayload<N + 4 + M> manufacturerData(uint16_t companyId, const uint8_t (&data)[M]) const {
+		return append(GAP_ADTYPE_MANUFACTURER_SPECIFIC, BLEAdvFieldTagged<M>{companyId, data});
+	}
+	template <size_t M>
+	constexpr BLEAdvPayload<N + 2 + M> field(uint8_t type, const uint8_t (&data)[M]) const {
+		return append(type, BLEAdvFieldBytes<M>{data});
+	}
+
+	constexpr const uint8_t* getData() const { return m_data; }
+	constexpr size_t         getLength() const { return N; }
+	constexpr std::array<uint8_t, BLE_ADV_PAYLOAD_MAX> toArray() const {
+		return toArray(typename BLEAdvMakeIndices<BLE_ADV_PAYLOAD_MAX>::type());
+	}
+
+private:
+	template <size_t> friend class BLEAdvPayload;
+
+	// Copy the previous payload and append one AD structure, octet by octet.
+	template <size_t P, class Field, size_t... I>
+	constexpr BLEAdvPayload(const BLEAdvPayload<P>& previous, uint8_t type, Field field, BLEAdvIndices<I...>)
+		: m_data{ byteAt(previous, type, field, I)... } {}
+
+	template <size_t P, class Field>
+	static constexpr uint8_t byteAt(const BLEAdvPayload<P>& previous, uint8_t type, Field field, size_t i) {
+		return i < P ? previous.m_data[i] :
+			i == P ? (uint8_t)(Field::size + 1) :
+			i == P + 1 ? type :
+			i < P + 2 + Field::size ? field.at(i - P - 2) : 0;
+	}
+
+	template <class Field>
+	constexpr BLEAdvPayload<N + 2 + Field::size> append(uint8_t type, Field field) const {
+		return BLEAdvPayload<N + 2 + Field::size>(*this, type, field, typename BLEAdvMakeIndices<BLE_ADV_PAYLOAD_MAX>::type());
+	}
+
+	template <size_t... I>
+	constexpr std::array<uint8_t, BLE_ADV_PAYLOAD_MAX> toArray(BLEAdvIndices<I...>) const {
+		return std::array<uint8_t, BLE_ADV_PAYLOAD_MAX>{{ m_data[I]... }};
+	}
+
+	uint8_t m_data[BLE_ADV_PAYLOAD_MAX];
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEADVPAYLOAD_H_ */
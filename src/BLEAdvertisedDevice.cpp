@@ -19,25 +19,15 @@
 
 BLEAdvertisedDevice::BLEAdvertisedDevice() {
 
-	m_adFlag           = 0;
-	m_appearance       = 0;
 	m_deviceType       = 0;
-	m_name             = "";
 	m_rssi             = -9999;
-	m_txPower          = 0;
 	m_pScan            = nullptr;
-	m_haveAppearance       = false;
-	m_haveManufacturerData = false;
-	m_haveName             = false;
-	m_haveRSSI             = false;
-	m_haveServiceData      = false;
-	m_haveServiceUUID      = false;
-	m_haveTXPower          = false;
+	m_haveRSSI         = false;
 
 } // BLEAdvertisedDevice
 
 
-T_GAP_REMOTE_ADDR_TYPE BLEAdvertisedDevice::getAddressType() {
+T_GAP_REMOTE_ADDR_TYPE BLEAdvertisedDevice::getAddressType() const {
 	return m_addressType;
 }
 
@@ -45,47 +35,101 @@ T_GAP_REMOTE_ADDR_TYPE BLEAdvertisedDevice::getAddressType() {
  * @brief Check advertised serviced for existence required UUID
  * @return Return true if service is advertised
  */
-bool BLEAdvertisedDevice::isAdvertisingService(BLEUUID uuid){
-	for (size_t i = 0; i < m_serviceUUIDs.size(); i++) {
-		if (m_serviceUUIDs[i].equals(uuid)) return true;
+bool BLEAdvertisedDevice::isAdvertisingService(BLEUUID uuid) const {
+	for (int i = 0; i < getServiceUUIDCount(); i++) {
+		if (getServiceUUID(i).equals(uuid)) return true;
 	}
-	return false;   
+	return false;
 }
 
 /**
  * @brief Get the Service UUID.
  * @return The Service UUID of the advertised device.
  */
-BLEUUID BLEAdvertisedDevice::getServiceUUID() {
-	return m_serviceUUIDs[0];
+BLEUUID BLEAdvertisedDevice::getServiceUUID() const {
+	return getServiceUUID(0);
 } // getServiceUUID
 
 /**
  * @brief Get the Service UUID.
  * @return The Service UUID of the advertised device.
  */
-BLEUUID BLEAdvertisedDevice::getServiceUUID(int i) {
-	return m_serviceUUIDs[i];
+BLEUUID BLEAdvertisedDevice::getServiceUUID(int i) const {
+	BLEAdStructure structure;
+	uint8_t offset;
+	uint8_t size;
+	if (!findServiceUUID(i, &structure, &offset, &size)) {
+		return BLEUUID();
+	}
+	return BLEUUID((uint8_t*)structure.data + offset, size);
 } // getServiceUUID
 
-
+/**
+ * @brief Get the number of service UUIDs in the advertisement.
+ * @return The number of 16, 32 and 128 bit service UUIDs advertised.
+ */
+int BLEAdvertisedDevice::getServiceUUIDCount() const {
+	BLEAdStructure structure;
+	uint8_t offset;
+	uint8_t size;
+	int count = 0;
+	while (findServiceUUID(count, &structure, &offset, &size)) {
+		count++;
+	}
+	return count;
+} // getServiceUUIDCount
 
 /**
- * @brief Set the Service UUID for this device.
- * @param [in] serviceUUID The discovered serviceUUID
+ * @brief Locate a service UUID in the payload.
+ * @param [in] i The index of the UUID across every service UUID list.
+ * @param [out] pStructure The AD structure holding the UUID.
+ * @param [out] pOffset The offset of the UUID within the structure data.
+ * @param [out] pSize The size of the UUID in bytes.
+ * @return True if there is a UUID with that index.
  */
-void BLEAdvertisedDevice::setServiceUUID(BLEUUID serviceUUID) {
-	m_serviceUUIDs.push_back(serviceUUID);
-	m_haveServiceUUID = true;
-} // setServiceUUID
+bool BLEAdvertisedDevice::findServiceUUID(int i, BLEAdStructure* pStructure, uint8_t* pOffset, uint8_t* pSize) const {
+	if (i < 0) {
+		return false;
+	}
+	BLEAdvertisementView view = getPayload();
+	for (BLEAdvertisementView::iterator it = view.begin(); it != view.end(); ++it) {
+		BLEAdStructure structure = *it;
+		uint8_t size;
+		switch (structure.type) {
+			case GAP_ADTYPE_16BIT_MORE:
+			case GAP_ADTYPE_16BIT_COMPLETE:
+				size = 2;
+				break;
+			case GAP_ADTYPE_32BIT_MORE:
+			case GAP_ADTYPE_32BIT_COMPLETE:
+				size = 4;
+				break;
+			case GAP_ADTYPE_128BIT_MORE:
+			case GAP_ADTYPE_128BIT_COMPLETE:
+				size = 16;
+				break;
+			default:
+				continue;
+		}
+		int count = structure.length / size;
+		if (i < count) {
+			*pStructure = structure;
+			*pOffset    = i * size;
+			*pSize      = size;
+			return true;
+		}
+		i -= count;
+	}
+	return false;
+} // findServiceUUID
 
 
 /**
  * @brief Does this advertisement have a service UUID value?
  * @return True if there is a service UUID value present.
  */
-bool BLEAdvertisedDevice::haveServiceUUID() {
-	return m_haveServiceUUID;
+bool BLEAdvertisedDevice::haveServiceUUID() const {
+	return getServiceUUIDCount() > 0;
 } // haveServiceUUID
 
 /**
@@ -96,49 +140,84 @@ bool BLEAdvertisedDevice::haveServiceUUID() {
  *
  * @return The appearance of the advertised device.
  */
-uint16_t BLEAdvertisedDevice::getAppearance() {
-	return m_appearance;
+uint16_t BLEAdvertisedDevice::getAppearance() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_APPEARANCE, &structure) || structure.length < 2) {
+		return 0;
+	}
+	return ((uint16_t)structure.data[1] << 8) | structure.data[0];
 } // getAppearance
 
+/**
+ * @brief Get the company identifier of the manufacturer data.
+ * @return The company identifier, or 0 if there is no manufacturer data.
+ */
+uint16_t BLEAdvertisedDevice::getManufacturerId() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_MANUFACTURER_SPECIFIC, &structure) || structure.length < 2) {
+		return 0;
+	}
+	return ((uint16_t)structure.data[1] << 8) | structure.data[0];
+} // getManufacturerId
+
 /**
  * @brief Get the manufacturer data.
- * @return The manufacturer data of the advertised device.
+ * The data follows the company identifier and points into the raw payload.
+ * @return The manufacturer data of the advertised device, or nullptr if there is none.
  */
-uint8_t* BLEAdvertisedDevice::getManufacturerData() {
-	return m_manufacturerData;
+uint8_t* BLEAdvertisedDevice::getManufacturerData() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_MANUFACTURER_SPECIFIC, &structure) || structure.length < 2) {
+		return nullptr;
+	}
+	return (uint8_t*)structure.data + 2;
 } // getManufacturerData
 
 /**
  * @brief Get the manufacturer data.
  * @return The manufacturer data of the advertised device.
  */
-uint8_t BLEAdvertisedDevice::getManufacturerDataLength() {
-	return m_manufacturerDataLength;
-} // getManufacturerData
+uint8_t BLEAdvertisedDevice::getManufacturerDataLength() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_MANUFACTURER_SPECIFIC, &structure) || structure.length < 2) {
+		return 0;
+	}
+	return structure.length - 2;
+} // getManufacturerDataLength
 
 /**
  * @brief Get the service data.
- * @return The service data of the advertised device.
+ * The data starts with the 16 bit service UUID and points into the raw payload.
+ * @return The service data of the advertised device, or nullptr if there is none.
  */
-uint8_t* BLEAdvertisedDevice::getServiceData() {
-	return m_serviceData;
+uint8_t* BLEAdvertisedDevice::getServiceData() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_SERVICE_DATA, &structure)) {
+		return nullptr;
+	}
+	return (uint8_t*)structure.data;
 } // getServiceData
 
 /**
  * @brief Get the service data.
  * @return The service data of the advertised device.
  */
-uint8_t BLEAdvertisedDevice::getServiceDataLength() {
-	return m_serviceDataLength;
-} // getServiceData
+uint8_t BLEAdvertisedDevice::getServiceDataLength() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_SERVICE_DATA, &structure)) {
+		return 0;
+	}
+	return structure.length;
+} // getServiceDataLength
 
 
 /**
  * @brief Does this advertisement have an appearance value?
  * @return True if there is an appearance value present.
  */
-bool BLEAdvertisedDevice::haveAppearance() {
-	return m_haveAppearance;
+bool BLEAdvertisedDevice::haveAppearance() const {
+	BLEAdStructure structure;
+	return getPayload().find(GAP_ADTYPE_APPEARANCE, &structure);
 } // haveAppearance
 
 /**
@@ -149,7 +228,7 @@ bool BLEAdvertisedDevice::haveAppearance() {
  *
  * @return The address of the advertised device.
  */
-BLEAddress BLEAdvertisedDevice::getAddress() {
+BLEAddress BLEAdvertisedDevice::getAddress() const {
 	return m_address;
 } // getAddress
 
@@ -157,15 +236,30 @@ BLEAddress BLEAdvertisedDevice::getAddress() {
  * @brief Get the name.
  * @return The name of the advertised device.
  */
-std::string BLEAdvertisedDevice::getName() {
-	return m_name;
+std::string BLEAdvertisedDevice::getName() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_LOCAL_NAME_COMPLETE, &structure) &&
+		!getPayload().find(GAP_ADTYPE_LOCAL_NAME_SHORT, &structure)) {
+		return "";
+	}
+	return std::string((const char*)structure.data, structure.length);
 } // getName
 
+/**
+ * @brief Does this advertisement have a name value?
+ * @return True if there is a complete or shortened local name present.
+ */
+bool BLEAdvertisedDevice::haveName() const {
+	BLEAdStructure structure;
+	return getPayload().find(GAP_ADTYPE_LOCAL_NAME_COMPLETE, &structure) ||
+		getPayload().find(GAP_ADTYPE_LOCAL_NAME_SHORT, &structure);
+} // haveName
+
 /**
  * @brief Get the RSSI.
  * @return The RSSI of the advertised device.
  */
-int BLEAdvertisedDevice::getRSSI() {
+int BLEAdvertisedDevice::getRSSI() const {
 	return m_rssi;
 } // getRSSI
 
@@ -173,7 +267,7 @@ int BLEAdvertisedDevice::getRSSI() {
  * @brief Get the scan object that created this advertisement.
  * @return The scan object.
  */
-BLEScan* BLEAdvertisedDevice::getScan() {
+BLEScan* BLEAdvertisedDevice::getScan() const {
 	return m_pScan;
 } // getScan
 
@@ -182,7 +276,7 @@ BLEScan* BLEAdvertisedDevice::getScan() {
  * @brief Create a string representation of this device.
  * @return A string representation of this device.
  */
-std::string BLEAdvertisedDevice::toString() {
+std::string BLEAdvertisedDevice::toString() const {
 	std::string res = "Name: " + getName() + ", Address: " + getAddress().toString();
 	// if (haveAppearance()) {
 	// 	char val[6];
@@ -227,8 +321,9 @@ std::string BLEAdvertisedDevice::toString() {
  * @brief Does this advertisement have a transmission power value?
  * @return True if there is a transmission power value present.
  */
-bool BLEAdvertisedDevice::haveTXPower() {
-	return m_haveTXPower;
+bool BLEAdvertisedDevice::haveTXPower() const {
+	BLEAdStructure structure;
+	return getPayload().find(GAP_ADTYPE_POWER_LEVEL, &structure) && structure.length >= 1;
 } // haveTXPower
 
 
@@ -236,23 +331,25 @@ bool BLEAdvertisedDevice::haveTXPower() {
  * @brief Does this advertisement have manufacturer data?
  * @return True if there is manufacturer data present.
  */
-bool BLEAdvertisedDevice::haveManufacturerData() {
-	return m_haveManufacturerData;
+bool BLEAdvertisedDevice::haveManufacturerData() const {
+	BLEAdStructure structure;
+	return getPayload().find(GAP_ADTYPE_MANUFACTURER_SPECIFIC, &structure) && structure.length >= 2;
 } // haveManufacturerData
 
 /**
  * @brief Does this advertisement have service data?
  * @return True if there is service data present.
  */
-bool BLEAdvertisedDevice::haveServiceData() {
-	return m_haveServiceData;
+bool BLEAdvertisedDevice::haveServiceData() const {
+	BLEAdStructure structure;
+	return getPayload().find(GAP_ADTYPE_SERVICE_DATA, &structure);
 } // haveServiceData
 
 /**
  * @brief Does this advertisement have a signal strength value?
  * @return True if there is a signal strength value present.
  */
-bool BLEAdvertisedDevice::haveRSSI() {
+bool BLEAdvertisedDevice::haveRSSI() const {
 	return m_haveRSSI;
 } // haveRSSI
 
@@ -260,11 +357,63 @@ bool BLEAdvertisedDevice::haveRSSI() {
  * @brief Get the TX Power.
  * @return The TX Power of the advertised device.
  */
-int8_t BLEAdvertisedDevice::getTXPower() {
-	return m_txPower;
+int8_t BLEAdvertisedDevice::getTXPower() const {
+	BLEAdStructure structure;
+	if (!getPayload().find(GAP_ADTYPE_POWER_LEVEL, &structure) || structure.length < 1) {
+		return 0;
+	}
+	return (int8_t)structure.data[0];
 } // getTXPower
 
 
+/**
+ * @brief Get a view over the raw advertising payload.
+ * The primary advertisement and the scan response, when one was received, are walked as one payload.
+ * The view walks the AD structures on demand and is only valid while this device is.
+ * @return The payload view.
+ */
+BLEAdvertisementView BLEAdvertisedDevice::getPayload() const {
+	return BLEAdvertisementView(getPayloadData(), m_advDataSize + m_scanResponseSize);
+} // getPayload
+
+/**
+ * @brief Get a view over the primary advertisement only.
+ * @return The payload view.
+ */
+BLEAdvertisementView BLEAdvertisedDevice::getAdvertisementPayload() const {
+	return BLEAdvertisementView(getPayloadData(), m_advDataSize);
+} // getAdvertisementPayload
+
+/**
+ * @brief Get a view over the scan response only.
+ * @return The payload view, empty if no scan response was received.
+ */
+BLEAdvertisementView BLEAdvertisedDevice::getScanResponsePayload() const {
+	return BLEAdvertisementView(getPayloadData() + m_advDataSize, m_scanResponseSize);
+} // getScanResponsePayload
+
+/**
+ * @brief Has a scan response been received for this device?
+ */
+bool BLEAdvertisedDevice::haveScanResponse() const {
+	return m_haveScanResponse;
+} // haveScanResponse
+
+/**
+ * @brief Was this device received through extended advertising?
+ */
+bool BLEAdvertisedDevice::isExtended() const {
+	return m_extended;
+} // isExtended
+
+/**
+ * @brief Get the storage holding the payload.
+ */
+const uint8_t* BLEAdvertisedDevice::getPayloadData() const {
+	return m_payloadBlock.isValid() ? m_payloadBlock.getData() : m_data;
+} // getPayloadData
+
+
 /**
  * @brief Set the address of the advertised device.
  * @param [in] address The address of the advertised device.
@@ -296,138 +445,108 @@ void BLEAdvertisedDevice::setAddressType(T_GAP_REMOTE_ADDR_TYPE type) {
 	m_addressType = type;
 }
 
+/**
+ * @brief Record a scan report.
+ * Only the raw payload is kept, the AD structures are looked up when a getter asks for them.
+ * @param [in] p_data The GAP_MSG_LE_SCAN_INFO callback data.
+ */
 void BLEAdvertisedDevice::parseAdvertisement(T_LE_CB_DATA *p_data) {
 	RPC_DEBUG("Entry parseAdvertisement\n\r");
     T_LE_SCAN_INFO *scan_info = p_data->p_le_scan_info;
+    BLEScanReport report;
+    report.address     = scan_info->bd_addr;
+    report.addressType = scan_info->remote_addr_type;
+    report.advType     = scan_info->adv_type;
+    report.rssi        = scan_info->rssi;
+    report.txPower     = BLE_SCAN_TX_POWER_NONE;
+    report.extended    = false;
+    report.sid         = 0;
+    report.dataLength  = (scan_info->data_len <= sizeof(scan_info->data)) ? scan_info->data_len : sizeof(scan_info->data);
+    report.data        = scan_info->data;
     clear();
-    _advType = (scan_info->adv_type);
-    _addrType = (scan_info->remote_addr_type);
-	//set m_address
-    BLEAddress advertisedAddress(scan_info->bd_addr);
-	m_address = advertisedAddress;
-	
-    m_rssi = (scan_info->rssi);
-    memcpy(m_data, scan_info->data, scan_info->data_len);
-    m_dataSize = scan_info->data_len;
-
-    uint8_t buffer[32];
-    uint8_t pos = 0;
-    while (pos < scan_info->data_len) {
-        // Length of the AD structure.
-        uint8_t length = scan_info->data[pos++];    // length of following data field = length of advert data field + 1 (adtype)
-        uint8_t type;
-
-        if ((length > 0x01) && ((pos + length) <= 31)) {
-            // Copy the AD Data to buffer.
-            memcpy(buffer, scan_info->data + pos + 1, length - 1);
-            // AD Type, one octet.
-            type = scan_info->data[pos];
-            switch (type) {
-                case GAP_ADTYPE_FLAGS: {
-                    // (0x01) -- LE Limited Discoverable Mode
-                    // (0x02) -- LE General Discoverable Mode
-                    // (0x04) -- BR/EDR Not Supported
-                    // (0x08) -- Simultaneous LE and BR/EDR to Same Device Capable (Controller)
-                    // (0x10) -- Simultaneous LE and BR/EDR to Same Device Capable (Host)
-                    m_adFlag = (scan_info->data[(pos + 1)]);
-                    break;
-                }
-
-                case GAP_ADTYPE_16BIT_MORE:
-                case GAP_ADTYPE_16BIT_COMPLETE: {
-					RPC_DEBUG("GAP_ADTYPE_16BIT_COMPLETE\n\r");
-                    uint8_t *p_uuid = buffer;
-                    uint8_t i = length - 1;
-
-                    while (i >= 2) {
-                        _serviceList[_serviceCount++] = (BLEUUID(p_uuid, 2));
-						setServiceUUID(BLEUUID(p_uuid, 2));
-                        p_uuid += 2;
-                        i -= 2;
-                    }
-                    break;
-                }
-
-                case GAP_ADTYPE_32BIT_MORE:
-                case GAP_ADTYPE_32BIT_COMPLETE: {
-                    uint8_t *p_uuid = buffer;
-                    uint8_t i = length - 1;
-					RPC_DEBUG("GAP_ADTYPE_32BIT_COMPLETE\n\r");
-                    while (i >= 4) {
-                        _serviceList[_serviceCount++] = (BLEUUID(p_uuid, 4));
-						setServiceUUID(BLEUUID(p_uuid, 4));
-                        p_uuid += 4;
-                        i -= 4;
-                    }
-                    break;
-                }
-
-                case GAP_ADTYPE_128BIT_MORE:
-                case GAP_ADTYPE_128BIT_COMPLETE: {
-					RPC_DEBUG("GAP_ADTYPE_128BIT_COMPLETE\n\r");
-                    uint8_t *p_uuid = buffer;
-                    _serviceList[_serviceCount++] = (BLEUUID(p_uuid, 16));
-					setServiceUUID(BLEUUID(p_uuid, 16));
-                    break;
-                }
-
-                case GAP_ADTYPE_LOCAL_NAME_SHORT:
-                case GAP_ADTYPE_LOCAL_NAME_COMPLETE: {
-                    buffer[length - 1] = '\0';
-                    m_name = (std::string((char*)buffer));
-                    break;
-                }
-
-                case GAP_ADTYPE_POWER_LEVEL: {
-                    m_txPower = (scan_info->data[(pos + 1)]);
-                    break;
-                }
-
-                case GAP_ADTYPE_APPEARANCE: {
-                    m_appearance = (((uint16_t)buffer[1] << 8)|(buffer[0]));
-                    break;
-                }
-
-                case GAP_ADTYPE_MANUFACTURER_SPECIFIC: {
-                    uint8_t data_len = length - 3;      // adtype (-1), manufacturerID (-2)
-                    m_manufacturer = (((uint16_t)buffer[1] << 8)|(buffer[0]));
-                    memcpy(m_manufacturerData, (buffer + 2), data_len);
-                    m_manufacturerDataLength = data_len;
-                    m_haveManufacturerData = true;
-                    break;
-                }
-
-                case GAP_ADTYPE_SERVICE_DATA: {
-                    memcpy(m_serviceData, buffer, length);
-                    m_serviceDataLength = length;
-                    m_haveServiceData = true;
-                    break;
-                }
-
-                default: {
-                    uint8_t i = 0;
-                    for (i = 0; i < (length - 1); i++) {
-                    }
-                    break;
-                }
+    mergeReport(&report);
+} // parseAdvertisement
+
+/**
+ * @brief Add a scan report to the device.
+ * A primary advertisement replaces the primary payload and a scan response replaces the scan response,
+ * the other payload is kept.
+ * @param [in] pReport The report.
+ */
+void BLEAdvertisedDevice::mergeReport(const BLEScanReport* pReport) {
+    bool scanResponse = (pReport->advType == GAP_ADV_EVT_TYPE_SCAN_RSP);
+    if (!scanResponse || !m_haveAdvData) {
+        _advType = (T_GAP_ADV_EVT_TYPE)pReport->advType;
+    }
+    _addrType = (T_GAP_REMOTE_ADDR_TYPE)pReport->addressType;
+    m_address = BLEAddress((uint8_t*)pReport->address);
+    m_rssi = pReport->rssi;
+    m_extended = pReport->extended;
+    setPayload(scanResponse, pReport->data, pReport->dataLength);
+} // mergeReport
+
+/**
+ * @brief Replace the primary payload or the scan response.
+ * Payloads that fit are kept in the record.  Larger ones move to a block of the scan's payload pool, and
+ * a block shared with a copy of the device is copied before it is changed.  When no block is free the
+ * payload is truncated to what fits in the record.
+ * @param [in] scanResponse True to replace the scan response.
+ * @param [in] pData The payload.
+ * @param [in] length The length of the payload.
+ */
+void BLEAdvertisedDevice::setPayload(bool scanResponse, const uint8_t* pData, uint16_t length) {
+    if (length > BLE_SCAN_EXT_MAX_DATA) {
+        length = BLE_SCAN_EXT_MAX_DATA;
+    }
+    const uint8_t* current = getPayloadData();
+    uint16_t keepOffset = scanResponse ? 0 : m_advDataSize;             // The half that stays.
+    uint16_t keepLength = scanResponse ? m_advDataSize : m_scanResponseSize;
+    uint16_t capacity = m_payloadBlock.isValid() ? BLE_SCAN_PAYLOAD_BLOCK : sizeof(m_data);
+    bool     move = (keepLength + length > capacity || m_payloadBlock.isShared());
+
+    BLEScanPayloadRef block = m_payloadBlock;
+    uint8_t* dest = (uint8_t*)current;
+    if (move) {  // Move to storage of our own that fits.
+        block.release();
+        BLEScanPayloadPool* pPool = (m_pScan != nullptr) ? m_pScan->getPayloadPool() : nullptr;
+        if (keepLength + length > sizeof(m_data) && (pPool == nullptr || !block.acquire(pPool))) {
+            if (keepLength > sizeof(m_data)) {
+                keepLength = sizeof(m_data);
+            }
+            if (keepLength + length > sizeof(m_data)) {
+                length = sizeof(m_data) - keepLength;
             }
         }
-        pos += length;
-    }			
-} // parseAdvertisement
+        dest = block.isValid() ? block.getData() : m_data;
+    }
+    if (scanResponse) {
+        if (dest != current) {
+            memcpy(dest, current, keepLength);
+        }
+        memcpy(dest + keepLength, pData, length);
+        m_advDataSize = keepLength;
+        m_scanResponseSize = length;
+        m_haveScanResponse = true;
+    } else {
+        memmove(dest + length, current + keepOffset, keepLength);
+        memcpy(dest, pData, length);
+        m_advDataSize = length;
+        m_scanResponseSize = keepLength;
+        m_haveAdvData = true;
+    }
+    m_payloadBlock = block;
+} // setPayload
 
+/**
+ * @brief Reset the device so that the record can be reused.
+ */
 void BLEAdvertisedDevice::clear() {
-    memset(m_data, 0, sizeof(m_data));
-    m_dataSize = 0;
+    m_payloadBlock.release();
+    m_advDataSize = 0;
+    m_scanResponseSize = 0;
+    m_haveAdvData = false;
+    m_haveScanResponse = false;
+    m_delivered = false;
     m_rssi = 0;
-    m_adFlag = 0;
-    m_serviceCount = 0;
-    m_name = std::string("");
-    m_txPower = 0;
-    m_appearance = 0;
-    m_manufacturer = 0;
-    m_manufacturerDataLength = 0;
-}
-
-
-
+    m_haveRSSI = false;
+} // clear
@@ -12,6 +12,11 @@
 #include "BLEScan.h"
 #include "BLEAddress.h"
 #include "BLEUUID.h"
+#include "BLEAdvertisementView.h"
+#include "BLEScanRecord.h"
+#include "BLEBeaconDecoder.h"
+#include "BLEScanReport.h"
+#include "BLEScanPayloadPool.h"
 #include <vector>
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
@@ -27,67 +32,67 @@ class BLEScan;
 class BLEAdvertisedDevice {
 public:
     BLEAdvertisedDevice();
-    BLEAddress  getAddress();
-    std::string getName();
-	BLEUUID     getServiceUUID();
-	BLEUUID     getServiceUUID(int i);
-	uint16_t    getAppearance();
-	int8_t      getTXPower();
-	uint8_t*    getManufacturerData();
-	uint8_t     getManufacturerDataLength();
-	uint8_t*    getServiceData();
-	uint8_t     getServiceDataLength();
-	int         getRSSI();
-	BLEScan*    getScan();
-	std::string toString();
-	bool        haveServiceUUID();
-	bool        haveTXPower();
-	bool        haveName();
-    bool        haveAppearance();
-	bool        haveRSSI();
+    BLEAddress  getAddress() const;
+    std::string getName() const;
+	BLEUUID     getServiceUUID() const;
+	BLEUUID     getServiceUUID(int i) const;
+	int         getServiceUUIDCount() const;
+	uint16_t    getAppearance() const;
+	int8_t      getTXPower() const;
+	uint16_t    getManufacturerId() const;
+	uint8_t*    getManufacturerData() const;
+	uint8_t     getManufacturerDataLength() const;
+	uint8_t*    getServiceData() const;
+	uint8_t     getServiceDataLength() const;
+	int         getRSSI() const;
+	BLEScan*    getScan() const;
+	std::string toString() const;
+	bool        haveServiceUUID() const;
+	bool        haveTXPower() const;
+	bool        haveName() const;
+    bool        haveAppearance() const;
+	bool        haveRSSI() const;
 	void        setAddressType(T_GAP_REMOTE_ADDR_TYPE type);
-	bool		isAdvertisingService(BLEUUID uuid);
-	T_GAP_REMOTE_ADDR_TYPE getAddressType();
-	bool        haveManufacturerData();
-	bool        haveServiceData();
+	bool		isAdvertisingService(BLEUUID uuid) const;
+	T_GAP_REMOTE_ADDR_TYPE getAddressType() const;
+	bool        haveManufacturerData() const;
+	bool        haveServiceData() const;
+	BLEAdvertisementView getPayload() const;
+	BLEAdvertisementView getAdvertisementPayload() const;
+	BLEAdvertisementView getScanResponsePayload() const;
+	bool        haveScanResponse() const;
+	bool        isExtended() const;
 private:
 	friend class BLEScan;
+	friend class BLEAdvertisedDevicePool;
+	friend class BLEScanResultStore;
 	void clear(void);
-    bool m_haveAppearance;
-	bool m_haveServiceUUID;
-	bool m_haveTXPower;
-	bool m_haveManufacturerData;
-	bool m_haveName;
 	bool m_haveRSSI;
-	bool m_haveServiceData;
-	std::vector<BLEUUID> m_serviceUUIDs;
 
 	T_GAP_ADV_EVT_TYPE _advType;
 	T_GAP_REMOTE_ADDR_TYPE _addrType;
 	BLEAddress  m_address = BLEAddress((uint8_t*)"\0\0\0\0\0\0");
 	
-	uint8_t m_data[31] ={0}; // array for storing formatted advertising data for receiving and sending
-    uint8_t m_dataSize = 0;
+	uint8_t m_data[62] ={0}; // raw advertising payload followed by the scan response, every AD field is looked up from here on demand
+	BLEScanPayloadRef m_payloadBlock;  // Holds the payload instead of m_data when it does not fit.
+	uint16_t m_advDataSize = 0;
+	uint16_t m_scanResponseSize = 0;
+	bool    m_extended = false;
+	bool    m_haveAdvData = false;
+	bool    m_haveScanResponse = false;
+	bool    m_delivered = false;     // Passed to onResult(), while scan responses are merged.
+	uint32_t m_published = 0;        // Snapshots taken before the record was recorded, see BLEScanResultStore::isShared().
     int         m_rssi;
 	BLEScan*    m_pScan;
-	uint8_t     m_adFlag;
-	uint8_t     m_serviceCount = 0;
-	std::string m_name;
-	int8_t      m_txPower = 0;
-	uint16_t    m_appearance = 0;
-    uint16_t    m_manufacturer = 0;
-    uint8_t     m_manufacturerData[27] = {0};
-    uint8_t     m_manufacturerDataLength = 0;
-    uint8_t     m_serviceData[27] = {0};
-    uint8_t     m_serviceDataLength = 0;
-	BLEUUID     _serviceList[7];        // A 31byte advert can only fit a maximum of 7 service UUIDs of 16bit length
-	uint8_t     _serviceCount = 0;	
 	int         m_deviceType;	
 	void parseAdvertisement(T_LE_CB_DATA *p_data);
+	void mergeReport(const BLEScanReport* pReport);
+	void setPayload(bool scanResponse, const uint8_t* pData, uint16_t length);
+	const uint8_t* getPayloadData() const;
 	void setAddress(BLEAddress address);
 	void setRSSI(int rssi);
 	void setScan(BLEScan* pScan);
-	void setServiceUUID(BLEUUID serviceUUID);
+	bool findServiceUUID(int i, BLEAdStructure* pStructure, uint8_t* pOffset, uint8_t* pSize) const;
 	T_GAP_REMOTE_ADDR_TYPE m_addressType;	
 };
 /**
@@ -107,5 +112,31 @@ public:
 	 * device that was found.  During any individual scan, a device will only be detected one time.
 	 */
 	virtual void onResult(BLEAdvertisedDevice advertisedDevice) = 0;
+
+	/**
+	 * @brief Called when a device is evicted from the scan results in cache mode.
+	 *
+	 * The device is returned to the scan's pool as soon as this call back returns.
+	 */
+	virtual void onEvict(const BLEAdvertisedDevice& /*advertisedDevice*/) {}
+
+	/**
+	 * @brief Called with a batch of scan reports when batched delivery is enabled.
+	 *
+	 * Replaces onResult() while BLEScan::setBatchDelivery() is in effect.  The records are only valid
+	 * until this call back returns.  Called from the BLE task, or from the batch task for batches
+	 * flushed by their delay or by BLEScan::stop(); reports wait while it runs, so keep it short.
+	 */
+	virtual void onResults(const BLEScanRecord* /*pRecords*/, size_t /*count*/) {}
+
+	/**
+	 * @brief Called with every beacon frame received when BLEScan::setBeaconDecoding() is enabled.
+	 *
+	 * Invoked for each report, duplicates included, before the report is recorded.
+	 * @param [in] frame The decoded frame.
+	 * @param [in] addressKey The packed address and address type of the sender, see BLEAddress::toKey().
+	 * @param [in] rssi The RSSI of the report.
+	 */
+	virtual void onBeacon(const BLEBeaconFrame& /*frame*/, uint64_t /*addressKey*/, int8_t /*rssi*/) {}
 };
 #endif /* COMPONENTS_CPP_UTILS_BLEADVERTISEDDEVICE_H_ */
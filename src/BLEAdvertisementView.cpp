@@ -0,0 +1,137 @@
+/*
+ * BLEAdvertisementView.cpp
+ *
+ *  Walks the AD structures of a raw advertising payload without copying them.
+ */
+
+#include "BLEAdvertisementView.h"
+#include "seeed_rpcUnified.h"
+#include "rtl_ble/ble_unified.h"
+
+/**
+ * @brief Create an iterator positioned at the length octet of a structure.
+ * @param [in] pPayload The payload being walked.
+ * @param [in] length The length of the payload.
+ * @param [in] pos The offset of the structure.
+ */
+BLEAdvertisementView::iterator::iterator(const uint8_t* pPayload, size_t length, size_t pos) {
+	m_pPayload = pPayload;
+	m_length   = length;
+	m_pos      = pos;
+	validate();
+} // iterator
+
+/**
+ * @brief Move to the end if the current structure is empty or truncated.
+ */
+void BLEAdvertisementView::iterator::validate() {
+	if (m_pos >= m_length) {
+		m_pos = m_length;
+		return;
+	}
+	uint8_t length = m_pPayload[m_pos];
+	if (length == 0 || m_pos + 1 + length > m_length) {
+		m_pos = m_length;
+	}
+} // validate
+
+/**
+ * @brief Get the structure the iterator points at.
+ * @return The type and a span over the structure data.
+ */
+BLEAdStructure BLEAdvertisementView::iterator::operator*() const {
+	BLEAdStructure structure;
+	structure.type   = m_pPayload[m_pos + 1];
+	structure.data   = m_pPayload + m_pos + 2;
+	structure.length = m_pPayload[m_pos] - 1;
+	return structure;
+} // operator*
+
+/**
+ * @brief Advance to the next structure.
+ */
+BLEAdvertisementView::iterator& BLEAdvertisementView::iterator::operator++() {
+	m_pos += 1 + m_pPayload[m_pos];
+	validate();
+	return *this;
+} // operator++
+
+bool BLEAdvertisementView::iterator::operator!=(const iterator& other) const {
+	return m_pos != other.m_pos;
+} // operator!=
+
+
+/**
+ * @brief Create a view over a payload.
+ * The payload is not copied and must outlive the view.
+ * @param [in] pPayload The raw payload.
+ * @param [in] length The number of bytes in the payload.
+ */
+BLEAdvertisementView::BLEAdvertisementView(const uint8_t* pPayload, size_t length) {
+	m_pPayload = pPayload;
+	m_length   = length;
+} // BLEAdvertisementView
+
+BLEAdvertisementView::iterator BLEAdvertisementView::begin() const {
+	return iterator(m_pPayload, m_length, 0);
+} // begin
+
+BLEAdvertisementView::iterator BLEAdvertisementView::end() const {
+	return iterator(m_pPayload, m_length, m_length);
+} // end
+
+/**
+ * @brief Find a structure of the given type.
+ * @param [in] type The AD type to look for.
+ * @param [out] pStructure Receives the structure when found.
+ * @param [in] pAfter Continue the search after this previously found structure, or nullptr to start at the beginning.
+ * @return True if a structure was found.
+ */
+bool BLEAdvertisementView::find(uint8_t type, BLEAdStructure* pStructure, const BLEAdStructure* pAfter) const {
+	for (iterator it = begin(); it != end(); ++it) {
+		BLEAdStructure structure = *it;
+		if (pAfter != nullptr) {
+			if (structure.data == pAfter->data) {
+				pAfter = nullptr;
+			}
+			continue;
+		}
+		if (structure.type == type) {
+			*pStructure = structure;
+			return true;
+		}
+	}
+	return false;
+} // find
+
+/**
+ * @brief Find the manufacturer specific data of a given company.
+ * @param [in] companyId The Bluetooth SIG company identifier.
+ * @param [out] pStructure Receives the structure, the data still starts with the company identifier.
+ * @return True if a matching structure was found.
+ */
+bool BLEAdvertisementView::findManufacturerData(uint16_t companyId, BLEAdStructure* pStructure) const {
+	for (iterator it = begin(); it != end(); ++it) {
+		BLEAdStructure structure = *it;
+		if (structure.type == GAP_ADTYPE_MANUFACTURER_SPECIFIC && structure.length >= 2 &&
+			(uint16_t)(structure.data[0] | (structure.data[1] << 8)) == companyId) {
+			*pStructure = structure;
+			return true;
+		}
+	}
+	return false;
+} // findManufacturerData
+
+/**
+ * @brief Get the number of bytes in the payload.
+ */
+size_t BLEAdvertisementView::getLength() const {
+	return m_length;
+} // getLength
+
+/**
+ * @brief Get the raw payload.
+ */
+const uint8_t* BLEAdvertisementView::getPayload() const {
+	return m_pPayload;
+} // getPayload
@@ -0,0 +1,60 @@
+/*
+ * BLEAdvertisementView.h
+ *
+ *  Walks the AD structures of a raw advertising payload without copying them.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_
+#define COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief A single AD structure inside an advertising payload.
+ *
+ * The data pointer refers into the payload the structure was found in and does not include the
+ * length and type octets.
+ */
+struct BLEAdStructure {
+	uint8_t        type;
+	const uint8_t* data;
+	uint8_t        length;
+};
+
+/**
+ * @brief A read-only view of a raw advertising or scan response payload.
+ *
+ * Nothing is parsed up front.  Iterating the view or calling find() walks the length-type-value
+ * structures on demand and returns spans into the payload.  Walking stops at the first structure
+ * that is empty or runs past the end of the payload.
+ */
+class BLEAdvertisementView {
+public:
+	class iterator {
+	public:
+		iterator(const uint8_t* pPayload, size_t length, size_t pos);
+		BLEAdStructure operator*() const;
+		iterator&      operator++();
+		bool           operator!=(const iterator& other) const;
+	private:
+		void           validate();
+		const uint8_t* m_pPayload;
+		size_t         m_length;
+		size_t         m_pos;
+	};
+
+	BLEAdvertisementView(const uint8_t* pPayload, size_t length);
+	iterator begin() const;
+	iterator end() const;
+	bool     find(uint8_t type, BLEAdStructure* pStructure, const BLEAdStructure* pAfter = nullptr) const;
+	bool     findManufacturerData(uint16_t companyId, BLEAdStructure* pStructure) const;
+	size_t   getLength() const;
+	const uint8_t* getPayload() const;
+
+private:
+	const uint8_t* m_pPayload;
+	size_t         m_length;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_ */
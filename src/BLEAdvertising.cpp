@@ -21,6 +21,9 @@
 #include "BLEDevice.h"
 #include "rpc_unified_log.h"
 
+// Where each ble_adv_param lives in the shadow copy, the last entry is the size of the copy.
+static const uint8_t kShadowOffset[adv_param_count + 1] = { 0, 1, 2, 8, 9, 10, 12, 14, 45, 76 };
+
 /**
  * @brief Construct a default advertising object.
  *
@@ -30,7 +33,7 @@ BLEAdvertising::BLEAdvertising() {
 } // BLEAdvertising
 
 
-T_APP_RESULT BLEAdvertising::handleGAPEvent(uint8_t cb_type, void *p_cb_data) {
+T_APP_RESULT BLEAdvertising::handleGAPEvent(uint8_t cb_type, void * /*p_cb_data*/) {
 	T_APP_RESULT result = APP_RESULT_SUCCESS;
 	switch (cb_type) {
 		case GAP_MSG_LE_ADV_UPDATE_PARAM: {
@@ -135,11 +138,11 @@ void BLEAdvertising::setAppearance(uint16_t appearance) {
 	m_appearance = appearance;
 } // setAppearance
 
-void BLEAdvertising::setMaxInterval(uint16_t maxinterval) {
+void BLEAdvertising::setMaxInterval(uint16_t /*maxinterval*/) {
 
 } // setMaxInterval
 
-void BLEAdvertising::setMinInterval(uint16_t mininterval) {
+void BLEAdvertising::setMinInterval(uint16_t /*mininterval*/) {
 
 } // setMinInterval
 
@@ -185,9 +188,8 @@ void BLEAdvertising::setDeviceAddress(uint8_t* addr, T_GAP_REMOTE_ADDR_TYPE type
  * @param [in] advertisementData The data to be advertised.
  */
 void BLEAdvertising::setAdvertisementData(BLEAdvertisementData& advertisementData) {
-    memcpy(_advData, (uint8_t*)advertisementData.getPayload().data(), advertisementData.getPayload().length());
-    le_adv_set_param(GAP_PARAM_ADV_DATA,sizeof(_advData), _advData);
-    m_customAdvData = true; 
+    std::string payload = advertisementData.getPayload();
+    setAdvertisementData((const uint8_t*)payload.data(), payload.length() > 31 ? 31 : payload.length());
 } // setAdvertisementData
 
 
@@ -196,9 +198,44 @@ void BLEAdvertising::setAdvertisementData(BLEAdvertisementData& advertisementDat
  * @param [in] advertisementData The data to be advertised.
  */
 void BLEAdvertising::setScanResponseData(BLEAdvertisementData& advertisementData) { 
-    memcpy(_scanRspData, (uint8_t*)advertisementData.getPayload().data(), advertisementData.getPayload().length());
-    le_adv_set_param(GAP_PARAM_SCAN_RSP_DATA, sizeof(_scanRspData), _scanRspData);
+    std::string payload = advertisementData.getPayload();
+    setScanResponseData((const uint8_t*)payload.data(), payload.length() > 31 ? 31 : payload.length());
+} // setScanResponseData
+
+/**
+ * @brief Set a pre-encoded advertising payload, such as one built with BLEAdvPayload.
+ * @param [in] data The payload.
+ * @param [in] size The length of the payload, at most 31 bytes.
+ */
+void BLEAdvertising::setAdvertisementData(const uint8_t* data, uint8_t size) {
+    if (size > sizeof(_advData)) {
+        size = sizeof(_advData);
+    }
+    m_semaphorePayload.take("setAdvertisementData");
+    memcpy(_advData, data, size);
+    _advDataSize = size;
+    m_payloadGeneration++;   // Live fields taken on the old payload would write to the wrong bytes.
+    m_liveDirty = false;
+    pushParam(adv_param_data, GAP_PARAM_ADV_DATA, _advData, _advDataSize);
+    m_customAdvData = true;
+    m_semaphorePayload.give();
+} // setAdvertisementData
+
+/**
+ * @brief Set a pre-encoded scan response payload, such as one built with BLEAdvPayload.
+ * @param [in] data The payload.
+ * @param [in] size The length of the payload, at most 31 bytes.
+ */
+void BLEAdvertising::setScanResponseData(const uint8_t* data, uint8_t size) {
+    if (size > sizeof(_scanRspData)) {
+        size = sizeof(_scanRspData);
+    }
+    m_semaphorePayload.take("setScanResponseData");
+    memcpy(_scanRspData, data, size);
+    _scanRspDataSize = size;
+    pushParam(adv_param_scan_rsp_data, GAP_PARAM_SCAN_RSP_DATA, _scanRspData, _scanRspDataSize);
     m_customScanResponseData = true;
+    m_semaphorePayload.give();
 } // setScanResponseData
 
 
@@ -210,37 +247,54 @@ void BLEAdvertising::setAdvertisementType(uint8_t advType){
 
 /**
  * @brief Start advertising.
- * Start advertising.
+ * Only the parameters that changed since they were last pushed are sent to the stack, and nothing at all
+ * is sent when advertising is already running with the same parameters.  Changes made while advertising
+ * take effect with le_adv_update_param().
  * @return N/A.
  */
 void BLEAdvertising::start() {
+	m_semaphorePayload.take("start");
 	if(!m_customAdvData){
+		// The flags and the name follow whatever was added with addData(), without keeping them in _data,
+		// so every start builds the same payload.
+		uint8_t dataSize = _dataSize;
 		addFlags(GAP_ADTYPE_FLAGS_LIMITED | GAP_ADTYPE_FLAGS_BREDR_NOT_SUPPORTED);
 		addCompleteName(BLEDevice::ble_name.c_str());
 		setAdvData();
+		_dataSize = dataSize;
+	}
+	bool changed = false;
+	changed |= pushParam(adv_param_event_type, GAP_PARAM_ADV_EVENT_TYPE, &_advEvtType, sizeof(_advEvtType));
+	changed |= pushParam(adv_param_direct_addr_type, GAP_PARAM_ADV_DIRECT_ADDR_TYPE, &_advDirectType, sizeof(_advDirectType));
+	changed |= pushParam(adv_param_direct_addr, GAP_PARAM_ADV_DIRECT_ADDR, _advDirectAddr, sizeof(_advDirectAddr));
+	changed |= pushParam(adv_param_channel_map, GAP_PARAM_ADV_CHANNEL_MAP, &_advChannMap, sizeof(_advChannMap));
+	changed |= pushParam(adv_param_filter_policy, GAP_PARAM_ADV_FILTER_POLICY, &_advFilterPolicy, sizeof(_advFilterPolicy));
+	changed |= pushParam(adv_param_interval_min, GAP_PARAM_ADV_INTERVAL_MIN, &_advIntMin, sizeof(_advIntMin));
+	changed |= pushParam(adv_param_interval_max, GAP_PARAM_ADV_INTERVAL_MAX, &_advIntMax, sizeof(_advIntMax));
+	changed |= pushParam(adv_param_data, GAP_PARAM_ADV_DATA, _advData, _advDataSize);
+	changed |= pushParam(adv_param_scan_rsp_data, GAP_PARAM_SCAN_RSP_DATA, _scanRspData, _scanRspDataSize);
+
+	if (!m_shadowMtuReqValid || m_shadowMtuReq != _slaveInitMtuReq) {
+		le_set_gap_param(GAP_PARAM_SLAVE_INIT_GATT_MTU_REQ, sizeof(_slaveInitMtuReq), &_slaveInitMtuReq);
+		m_rpcCalls++;
+		m_shadowMtuReq      = _slaveInitMtuReq;
+		m_shadowMtuReqValid = true;
 	}
-	le_adv_set_param(GAP_PARAM_ADV_EVENT_TYPE, sizeof(_advEvtType), &(_advEvtType));
-    le_adv_set_param(GAP_PARAM_ADV_DIRECT_ADDR_TYPE, sizeof(_advDirectType), &(_advDirectType));
-    le_adv_set_param(GAP_PARAM_ADV_DIRECT_ADDR, sizeof(_advDirectAddr), (_advDirectAddr));
-    le_adv_set_param(GAP_PARAM_ADV_CHANNEL_MAP, sizeof(_advChannMap), &(_advChannMap));
-    le_adv_set_param(GAP_PARAM_ADV_FILTER_POLICY, sizeof(_advFilterPolicy), &(_advFilterPolicy));
-    le_adv_set_param(GAP_PARAM_ADV_INTERVAL_MIN, sizeof(_advIntMin), &(_advIntMin));
-    le_adv_set_param(GAP_PARAM_ADV_INTERVAL_MAX, sizeof(_advIntMax), &(_advIntMax));
-    if(!m_customAdvData){
-        le_adv_set_param(GAP_PARAM_ADV_DATA, _advDataSize, _advData);
-    }
-    
-    if(!m_customScanResponseData){
-        le_adv_set_param(GAP_PARAM_SCAN_RSP_DATA, _scanRspDataSize, _scanRspData);
-    }
-    
-    le_set_gap_param(GAP_PARAM_SLAVE_INIT_GATT_MTU_REQ, sizeof(_slaveInitMtuReq), &_slaveInitMtuReq);
     if (!BLEDevice::ble_start_flags)
 	{
 		BLEDevice::ble_start_flags = true;
 		ble_start();
+		m_rpcCalls++;
 	}
-    le_adv_start();   
+	if (!m_advertising) {
+		le_adv_start();
+		m_rpcCalls++;
+		m_advertising = true;
+	} else if (changed) {
+		le_adv_update_param();
+		m_rpcCalls++;
+	}
+	m_semaphorePayload.give();
 } // start
 
 /**
@@ -249,9 +303,178 @@ void BLEAdvertising::start() {
  * @return N/A.
  */
 void BLEAdvertising::stop() {
+	m_semaphorePayload.take("stop");
 	le_adv_stop();
+	m_rpcCalls++;
+	m_advertising = false;
+	m_semaphorePayload.give();
 } // stop
 
+/**
+ * @brief Set how often the payload may be pushed for live field changes.
+ * @param [in] ms The minimum time between two pushes, 0 to push on every change.
+ */
+void BLEAdvertising::setLiveUpdateInterval(uint32_t ms) {
+	m_liveInterval = ms;
+} // setLiveUpdateInterval
+
+/**
+ * @brief Push the advertising payload if a live field changed and the update interval has passed.
+ * Changes held back by the interval are pushed by a task once they are due, calling this from loop()
+ * pushes them no later than that.
+ * @return True if the payload was pushed.
+ */
+bool BLEAdvertising::updateLiveFields() {
+	m_semaphorePayload.take("updateLiveFields");
+	bool pushed = pushLiveFields(BLEFreeRTOS::getTimeSinceStart());
+	m_semaphorePayload.give();
+	return pushed;
+} // updateLiveFields
+
+/**
+ * @brief Push the advertising payload if a live field changed and the update interval has passed.
+ * Called with m_semaphorePayload held.
+ * @param [in] now The current time in milliseconds.
+ * @return True if the payload was pushed.
+ */
+bool BLEAdvertising::pushLiveFields(uint32_t now) {
+	if (!m_liveDirty || (m_liveInterval != 0 && now - m_livePushed < m_liveInterval)) {
+		return false;
+	}
+	m_liveDirty  = false;
+	m_livePushed = now;
+	if (!pushParam(adv_param_data, GAP_PARAM_ADV_DATA, _advData, _advDataSize)) {
+		return false;
+	}
+	if (m_advertising) {
+		le_adv_update_param();
+		m_rpcCalls++;
+	}
+	return true;
+} // pushLiveFields
+
+/**
+ * @brief Push a live field change held back by the update interval once it is due, then end.
+ */
+void BLEAdvertising::liveTask(void* pvParameters) {
+	BLEAdvertising* pAdvertising = (BLEAdvertising*)pvParameters;
+	for (;;) {
+		pAdvertising->m_semaphorePayload.take("liveTask");
+		uint32_t now     = BLEFreeRTOS::getTimeSinceStart();
+		uint32_t elapsed = now - pAdvertising->m_livePushed;
+		if (!pAdvertising->m_liveDirty || elapsed >= pAdvertising->m_liveInterval) {
+			pAdvertising->pushLiveFields(now);
+			pAdvertising->m_liveTaskActive = false;   // Decided under the lock, so writeLiveField() starts another.
+			pAdvertising->m_semaphorePayload.give();
+			break;
+		}
+		uint32_t delay = pAdvertising->m_liveInterval - elapsed;
+		pAdvertising->m_semaphorePayload.give();
+		BLEFreeRTOS::sleep(delay);
+	}
+	BLEFreeRTOS::deleteTask();
+} // liveTask
+
+/**
+ * @brief Find the data of the first AD structure of a type in the advertising payload.
+ * @param [in] adType The AD type.
+ * @return The offset of the data, or -1 if there is no such structure.
+ */
+int BLEAdvertising::findField(uint8_t adType) {
+	uint8_t i = 0;
+	while (i + 1 < _advDataSize && _advData[i] != 0) {
+		uint8_t length = _advData[i];
+		if (i + 1 + length > _advDataSize) {
+			break;
+		}
+		if (_advData[i + 1] == adType) {
+			return i + 2;
+		}
+		i += 1 + length;
+	}
+	return -1;
+} // findField
+
+/**
+ * @brief Patch a live field in the advertising payload and push the payload if it is due, or leave it to
+ * liveTask() when the update interval holds it back.
+ * @return False if the payload was replaced since the field was taken.
+ */
+bool BLEAdvertising::writeLiveField(uint32_t generation, uint8_t offset, uint32_t value, uint8_t size, bool bigEndian) {
+	m_semaphorePayload.take("writeLiveField");
+	if (generation != m_payloadGeneration) {
+		m_semaphorePayload.give();
+		RPC_DEBUG("Live field of a replaced advertising payload\n\r");
+		return false;
+	}
+	for (uint8_t i = 0; i < size; i++) {
+		uint8_t byte = (uint8_t)(value >> (8 * (bigEndian ? size - 1 - i : i)));
+		if (_advData[offset + i] != byte) {
+			_advData[offset + i] = byte;
+			m_liveDirty = true;
+		}
+	}
+	if (!pushLiveFields(BLEFreeRTOS::getTimeSinceStart()) && m_liveDirty && !m_liveTaskActive) {
+		m_liveTaskActive = true;
+		BLEFreeRTOS::startTask(liveTask, "BLEAdvLive", this);
+	}
+	m_semaphorePayload.give();
+	return true;
+} // writeLiveField
+
+/**
+ * @brief Forget the parameters last pushed, so the next start() pushes all of them.
+ * To be called when something else, such as BLEAdvertisingRotator, wrote advertising parameters.
+ */
+void BLEAdvertising::invalidate() {
+	m_semaphorePayload.take("invalidate");
+	m_shadowValid       = 0;
+	m_shadowMtuReqValid = false;
+	m_semaphorePayload.give();
+} // invalidate
+
+/**
+ * @brief Get the number of stack calls issued, each one a round trip over the RPC link to the radio.
+ */
+uint32_t BLEAdvertising::getRpcCalls() {
+	return m_rpcCalls;
+} // getRpcCalls
+
+/**
+ * @brief Track the advertising state reported by the stack.
+ * Advertising also stops when a connection is created and restarts when it is lost, without start() or
+ * stop() being called.
+ * @param [in] advState The new advertising state (GAP_ADV_STATE_IDLE ...).
+ */
+void BLEAdvertising::handleAdvStateChange(uint8_t advState) {
+	if (advState == GAP_ADV_STATE_IDLE) {
+		m_advertising = false;
+	} else if (advState == GAP_ADV_STATE_ADVERTISING) {
+		m_advertising = true;
+	}
+} // handleAdvStateChange
+
+/**
+ * @brief Push a parameter unless the stack already holds the same value.
+ * @param [in] param The parameter in the shadow copy.
+ * @param [in] type The stack parameter (GAP_PARAM_ADV_EVENT_TYPE ...).
+ * @param [in] pValue The value.
+ * @param [in] len The length of the value.
+ * @return True if the parameter was pushed.
+ */
+bool BLEAdvertising::pushParam(ble_adv_param param, uint16_t type, void* pValue, uint8_t len) {
+	uint8_t* pShadow = &m_shadow[kShadowOffset[param]];
+	if ((m_shadowValid & (1 << param)) && m_shadowSize[param] == len && memcmp(pShadow, pValue, len) == 0) {
+		return false;
+	}
+	le_adv_set_param(type, len, pValue);
+	m_rpcCalls++;
+	memcpy(pShadow, pValue, len);
+	m_shadowSize[param] = len;
+	m_shadowValid |= (1 << param);
+	return true;
+} // pushParam
+
 uint8_t BLEAdvertising::addFlags(uint8_t flags) {
     uint8_t data[3] = {2, GAP_ADTYPE_FLAGS, flags};
     addData(data, 3, adv_data);
@@ -278,6 +501,10 @@ uint8_t BLEAdvertising::addShortName(const char* str) {
 }
 
 void BLEAdvertising::setAdvData() {
+    if (_advDataSize != _dataSize || memcmp(_advData, _data, _dataSize) != 0) {
+        m_payloadGeneration++;
+        m_liveDirty = false;
+    }
     memcpy(_advData, _data, _dataSize);
     _advDataSize = _dataSize;
 }
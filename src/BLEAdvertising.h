@@ -8,7 +8,9 @@
 #ifndef COMPONENTS_CPP_UTILS_BLEADVERTISING_H_
 #define COMPONENTS_CPP_UTILS_BLEADVERTISING_H_
 #include "BLEUUID.h"
+#include "BLEAdvPayload.h"
 #include <vector>
+#include <type_traits>
 #include "BLEFreeRTOS.h"
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
@@ -20,8 +22,49 @@ typedef enum {
     adv_scan_data,
 } ble_adv_data_type;
 
+/// Advertising parameters of which BLEAdvertising keeps a copy of the value last pushed to the stack.
+typedef enum {
+    adv_param_event_type,
+    adv_param_direct_addr_type,
+    adv_param_direct_addr,
+    adv_param_channel_map,
+    adv_param_filter_policy,
+    adv_param_interval_min,
+    adv_param_interval_max,
+    adv_param_data,
+    adv_param_scan_rsp_data,
+    adv_param_count,
+} ble_adv_param;
+
 
 
+class BLEAdvertising;
+
+/**
+ * @brief A value inside the advertising payload that can be changed while advertising.
+ *
+ * Handles are obtained from BLEAdvertising::getLiveField() or findLiveField().  set() patches the bytes
+ * of the payload in place and pushes it, at most as often as BLEAdvertising::setLiveUpdateInterval()
+ * allows, without stopping advertising.  A change held back by the interval is pushed by a task once it
+ * is due.  Setting a new payload invalidates the handles taken on the old one.
+ */
+template <typename T>
+class BLEAdvLiveField {
+	static_assert(std::is_integral<T>::value && sizeof(T) <= 4, "Live fields are integers of up to 4 bytes");
+public:
+	BLEAdvLiveField() : m_pAdvertising(nullptr), m_generation(0), m_offset(0), m_bigEndian(false) {}
+	bool isValid() const;
+	bool set(T value);
+private:
+	friend class BLEAdvertising;
+	BLEAdvLiveField(BLEAdvertising* pAdvertising, uint32_t generation, uint8_t offset, bool bigEndian)
+		: m_pAdvertising(pAdvertising), m_generation(generation), m_offset(offset), m_bigEndian(bigEndian) {}
+	BLEAdvertising* m_pAdvertising;
+	uint32_t        m_generation;  // Payload the offset was taken in.
+	uint8_t         m_offset;      // Offset in the advertising payload.
+	bool            m_bigEndian;
+};
+
 /**
  * @brief Advertisement data set by the programmer to be published by the %BLE server.
  */
@@ -73,9 +116,31 @@ public:
     void addData(const uint8_t* data, uint8_t size,ble_adv_data_type type);
     void setAdvertisementData(BLEAdvertisementData& advertisementData);
     void setScanResponseData(BLEAdvertisementData& advertisementData);
+    void setAdvertisementData(const uint8_t* data, uint8_t size);
+    void setScanResponseData(const uint8_t* data, uint8_t size);
+    template <size_t N>
+    void setAdvertisementData(const BLEAdvPayload<N>& payload) { setAdvertisementData(payload.getData(), N); }
+    template <size_t N>
+    void setScanResponseData(const BLEAdvPayload<N>& payload) { setScanResponseData(payload.getData(), N); }
     void setAdvertisementType(uint8_t adv_type);
+    template <typename T>
+    BLEAdvLiveField<T> getLiveField(uint8_t offset, bool bigEndian = false);
+    template <typename T>
+    BLEAdvLiveField<T> findLiveField(uint8_t adType, uint8_t offset, bool bigEndian = false);
+    void setLiveUpdateInterval(uint32_t ms);
+    bool updateLiveFields();
+    void invalidate();
+    uint32_t getRpcCalls();
     T_APP_RESULT handleGAPEvent(uint8_t cb_type, void *p_cb_data);
+    void handleAdvStateChange(uint8_t advState);
 private:
+    template <typename T> friend class BLEAdvLiveField;
+    static void liveTask(void* pvParameters);
+    int  findField(uint8_t adType);
+    bool writeLiveField(uint32_t generation, uint8_t offset, uint32_t value, uint8_t size, bool bigEndian);
+    bool pushLiveFields(uint32_t now);
+    bool pushParam(ble_adv_param param, uint16_t type, void* pValue, uint8_t len);
+
     bool                 m_customAdvData = false;  // Are we using custom advertising data?
 	bool                 m_customScanResponseData = false;
 
@@ -98,6 +163,22 @@ private:
     uint8_t  _advDirectAddr[GAP_BD_ADDR_LEN] = {0};
     uint8_t  _advChannMap = GAP_ADVCHAN_ALL;
     uint8_t  _advFilterPolicy = GAP_ADV_FILTER_ANY;
+
+    // Values last pushed with le_adv_set_param(), start() only pushes the ones that differ.
+    uint8_t  m_shadow[76];
+    uint8_t  m_shadowSize[adv_param_count];
+    uint16_t m_shadowValid = 0;      // One bit per ble_adv_param.
+    uint8_t  m_shadowMtuReq;
+    bool     m_shadowMtuReqValid = false;
+    bool     m_advertising = false;  // le_adv_start() was issued and advertising has not stopped since.
+    uint32_t m_rpcCalls = 0;
+
+    bool     m_liveDirty = false;          // A live field changed since the payload was last pushed.
+    bool     m_liveTaskActive = false;     // A task is waiting to push a change held back by the interval.
+    uint32_t m_liveInterval = 0;
+    uint32_t m_livePushed = 0;             // When the payload was last pushed for a live field.
+    volatile uint32_t m_payloadGeneration = 0;   // Bumped whenever the advertising payload is replaced.
+    BLEFreeRTOS::Semaphore m_semaphorePayload = BLEFreeRTOS::Semaphore("AdvPayload");   // Held while the payload or the parameters pushed change.
   
     uint8_t _scanRspData[31] = {
                                     0x03,                             /* length */
@@ -119,4 +200,57 @@ private:
                                     };
 	
 };
+
+/**
+ * @brief Get a live field at a given offset of the advertising payload.
+ * @param [in] offset The offset of the field in the payload set with setAdvertisementData().
+ * @param [in] bigEndian Whether the field is sent most significant byte first, as Eddystone does.
+ * @return The handle, not valid if the field does not fit in the payload.
+ */
+template <typename T>
+BLEAdvLiveField<T> BLEAdvertising::getLiveField(uint8_t offset, bool bigEndian) {
+	if ((size_t)offset + sizeof(T) > _advDataSize) {
+		return BLEAdvLiveField<T>();
+	}
+	return BLEAdvLiveField<T>(this, m_payloadGeneration, offset, bigEndian);
+} // getLiveField
+
+/**
+ * @brief Get a live field inside the first AD structure of a type, for example the advertising count of
+ * an Eddystone TLM frame is findLiveField<uint32_t>(GAP_ADTYPE_SERVICE_DATA, 8, true).
+ * @param [in] adType The AD type of the structure.
+ * @param [in] offset The offset of the field in the data of the structure.
+ * @param [in] bigEndian Whether the field is sent most significant byte first.
+ * @return The handle, not valid if there is no such structure or the field does not fit in it.
+ */
+template <typename T>
+BLEAdvLiveField<T> BLEAdvertising::findLiveField(uint8_t adType, uint8_t offset, bool bigEndian) {
+	int field = findField(adType);
+	if (field < 0 || (size_t)offset + sizeof(T) > _advData[field - 2] - 1u) {
+		return BLEAdvLiveField<T>();
+	}
+	return BLEAdvLiveField<T>(this, m_payloadGeneration, field + offset, bigEndian);
+} // findLiveField
+
+/**
+ * @brief Whether the handle points into the payload on air, and not into one replaced since it was taken.
+ */
+template <typename T>
+bool BLEAdvLiveField<T>::isValid() const {
+	return m_pAdvertising != nullptr && m_pAdvertising->m_payloadGeneration == m_generation;
+} // isValid
+
+/**
+ * @brief Change the value of the field.
+ * @param [in] value The new value.
+ * @return False if the handle is not valid, the payload is then left alone.
+ */
+template <typename T>
+bool BLEAdvLiveField<T>::set(T value) {
+	if (m_pAdvertising == nullptr) {
+		return false;
+	}
+	return m_pAdvertising->writeLiveField(m_generation, m_offset, (uint32_t)value, sizeof(T), m_bigEndian);
+} // set
+
 #endif /* COMPONENTS_CPP_UTILS_BLEADVERTISING_H_ */
@@ -0,0 +1,264 @@
+/*
+ * BLEAdvertisingRotator.cpp
+ *
+ *  Takes turns on air between several pre-encoded advertising sets.
+ */
+
+#include <string.h>
+#include "BLEAdvertisingRotator.h"
+#include "BLEDevice.h"
+
+BLEAdvertisingRotator::BLEAdvertisingRotator() {
+	m_setCount   = 0;
+	m_current    = -1;
+	m_pushed     = -1;
+	m_turnStart  = 0;
+	m_running    = false;
+	m_taskActive = false;
+	resetStats();
+} // BLEAdvertisingRotator
+
+/**
+ * @brief Add an advertising set to the rotation.
+ * @param [in] advData The advertising payload.
+ * @param [in] advSize The length of the advertising payload, at most 31 bytes.
+ * @param [in] scanRspData The scan response payload, may be nullptr.
+ * @param [in] scanRspSize The length of the scan response payload, at most 31 bytes.
+ * @param [in] advType The advertising event type (GAP_ADTYPE_ADV_IND ...).
+ * @param [in] intervalMs The advertising interval in milliseconds, 20 to 10240.
+ * @param [in] turnMs How long the set stays on air each time its turn comes.
+ * @return The index of the set, or -1 if the rotator is full.
+ */
+int BLEAdvertisingRotator::addSet(const uint8_t* advData, uint8_t advSize, const uint8_t* scanRspData,
+                                  uint8_t scanRspSize, uint8_t advType, uint16_t intervalMs, uint32_t turnMs) {
+	if (intervalMs < 20) {
+		intervalMs = 20;
+	} else if (intervalMs > 10240) {
+		intervalMs = 10240;
+	}
+	m_semaphore.take("addSet");
+	if (m_setCount >= BLE_ADV_ROTATOR_MAX_SETS) {
+		m_semaphore.give();
+		return -1;
+	}
+	Set* pSet = &m_sets[m_setCount];
+	pSet->advSize     = (advSize > BLE_ADV_PAYLOAD_MAX) ? BLE_ADV_PAYLOAD_MAX : advSize;
+	pSet->scanRspSize = (scanRspData == nullptr) ? 0 :
+	                    (scanRspSize > BLE_ADV_PAYLOAD_MAX) ? BLE_ADV_PAYLOAD_MAX : scanRspSize;
+	memcpy(pSet->advData, advData, pSet->advSize);
+	memcpy(pSet->scanRspData, scanRspData, pSet->scanRspSize);
+	pSet->advType  = advType;
+	pSet->interval = (uint16_t)((uint32_t)intervalMs * 1000 / 625);
+	pSet->turnMs   = (turnMs == 0) ? 1 : turnMs;
+	int index = m_setCount++;
+	m_semaphore.give();
+	return index;
+} // addSet
+
+/**
+ * @brief Remove every set, stopping the rotation first.
+ */
+void BLEAdvertisingRotator::clear() {
+	stop();
+	m_semaphore.take("clear");
+	m_setCount = 0;
+	m_current  = -1;
+	memset(m_stats, 0, sizeof(m_stats));
+	m_rpcCalls = 0;
+	m_semaphore.give();
+} // clear
+
+/**
+ * @brief Put the first set on air and start advertising, tick() then moves on to the next sets.
+ * Every parameter of the first set is pushed, since BLEAdvertising may have changed them meanwhile.
+ */
+void BLEAdvertisingRotator::begin() {
+	m_semaphore.take("begin");
+	if (m_setCount == 0 || m_running) {
+		m_semaphore.give();
+		return;
+	}
+	if (!BLEDevice::ble_start_flags) {
+		BLEDevice::ble_start_flags = true;
+		ble_start();
+	}
+	m_pushed = -1;
+	BLEDevice::getAdvertising()->invalidate();
+	activate(0, BLEFreeRTOS::getTimeSinceStart());
+	le_adv_start();
+	m_rpcCalls++;
+	m_stats[0].rpcCalls++;
+	m_running = true;
+	m_semaphore.give();
+} // begin
+
+/**
+ * @brief Start the rotation in a task of its own.
+ */
+void BLEAdvertisingRotator::start() {
+	begin();
+	m_semaphore.take("start");
+	if (m_running && !m_taskActive) {   // A task still finishing its last turn picks the rotation up again.
+		m_taskActive = true;
+		BLEFreeRTOS::startTask(rotatorTask, "BLEAdvRotator", this);
+	}
+	m_semaphore.give();
+} // start
+
+/**
+ * @brief Stop advertising.  The task, if any, ends at the end of the current turn without touching the sets again.
+ */
+void BLEAdvertisingRotator::stop() {
+	m_semaphore.take("stop");
+	if (m_running) {
+		m_running = false;
+		endTurn(BLEFreeRTOS::getTimeSinceStart());
+		le_adv_stop();
+		m_rpcCalls++;
+	}
+	m_semaphore.give();
+} // stop
+
+/**
+ * @brief Switch to the next set once the current one has had its turn.
+ * @param [in] now The current time in milliseconds.
+ * @return The time in milliseconds until the next switch is due.
+ */
+uint32_t BLEAdvertisingRotator::tick(uint32_t now) {
+	m_semaphore.take("tick");
+	uint32_t delay = m_running ? advance(now) : 0;
+	m_semaphore.give();
+	return delay;
+} // tick
+
+/**
+ * @brief Switch to the next set if its turn is due, with the lock taken and the rotation running.
+ * @param [in] now The current time in milliseconds.
+ * @return The time in milliseconds until the next switch is due.
+ */
+uint32_t BLEAdvertisingRotator::advance(uint32_t now) {
+	uint32_t elapsed = now - m_turnStart;
+	if (elapsed < m_sets[m_current].turnMs) {
+		return m_sets[m_current].turnMs - elapsed;
+	}
+	endTurn(now);
+	activate((m_current + 1) % m_setCount, now);
+	return m_sets[m_current].turnMs;
+} // advance
+
+bool BLEAdvertisingRotator::isRunning() {
+	return m_running;
+} // isRunning
+
+/**
+ * @brief Get the index of the set on air, -1 if none was yet.
+ */
+int BLEAdvertisingRotator::getCurrentSet() {
+	return m_current;
+} // getCurrentSet
+
+uint8_t BLEAdvertisingRotator::getSetCount() {
+	return m_setCount;
+} // getSetCount
+
+/**
+ * @brief Get what a set achieved on air since the statistics were last reset.
+ * @param [in] index The index of the set.
+ */
+BLEAdvertisingSetStats BLEAdvertisingRotator::getStats(uint8_t index) {
+	BLEAdvertisingSetStats stats = {0, 0, 0};
+	m_semaphore.take("getStats");
+	if (index < m_setCount) {
+		stats = m_stats[index];
+		if (m_running && (int)index == m_current) {
+			stats.airtimeMs += BLEFreeRTOS::getTimeSinceStart() - m_turnStart;
+		}
+	}
+	m_semaphore.give();
+	return stats;
+} // getStats
+
+/**
+ * @brief Get the number of stack calls the rotator issued, over the RPC link to the radio.
+ */
+uint32_t BLEAdvertisingRotator::getRpcCalls() {
+	return m_rpcCalls;
+} // getRpcCalls
+
+void BLEAdvertisingRotator::resetStats() {
+	m_semaphore.take("resetStats");
+	memset(m_stats, 0, sizeof(m_stats));
+	m_rpcCalls  = 0;
+	m_turnStart = BLEFreeRTOS::getTimeSinceStart();
+	m_semaphore.give();
+} // resetStats
+
+/**
+ * @brief Push a set, writing only what differs from the set the stack holds.
+ * Parameters written while advertising take effect with le_adv_update_param(), without stopping.
+ * @param [in] index The index of the set.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEAdvertisingRotator::activate(int index, uint32_t now) {
+	Set*     pSet   = &m_sets[index];
+	Set*     pPrev  = (m_pushed >= 0) ? &m_sets[m_pushed] : nullptr;
+	uint32_t before = m_rpcCalls;
+
+	if (pPrev == nullptr || pPrev->advType != pSet->advType) {
+		push(GAP_PARAM_ADV_EVENT_TYPE, sizeof(pSet->advType), &pSet->advType, index);
+	}
+	if (pPrev == nullptr || pPrev->interval != pSet->interval) {
+		push(GAP_PARAM_ADV_INTERVAL_MIN, sizeof(pSet->interval), &pSet->interval, index);
+		push(GAP_PARAM_ADV_INTERVAL_MAX, sizeof(pSet->interval), &pSet->interval, index);
+	}
+	if (pPrev == nullptr || pPrev->advSize != pSet->advSize ||
+		memcmp(pPrev->advData, pSet->advData, pSet->advSize) != 0) {
+		push(GAP_PARAM_ADV_DATA, pSet->advSize, pSet->advData, index);
+	}
+	if (pPrev == nullptr || pPrev->scanRspSize != pSet->scanRspSize ||
+		memcmp(pPrev->scanRspData, pSet->scanRspData, pSet->scanRspSize) != 0) {
+		push(GAP_PARAM_SCAN_RSP_DATA, pSet->scanRspSize, pSet->scanRspData, index);
+	}
+	if (m_running && m_rpcCalls != before) {
+		le_adv_update_param();
+		m_rpcCalls++;
+		m_stats[index].rpcCalls++;
+	}
+
+	m_pushed    = index;
+	m_current   = index;
+	m_turnStart = now;
+	m_stats[index].activations++;
+} // activate
+
+void BLEAdvertisingRotator::push(uint16_t type, uint8_t len, void* pValue, uint8_t index) {
+	le_adv_set_param(type, len, pValue);
+	m_rpcCalls++;
+	m_stats[index].rpcCalls++;
+} // push
+
+/**
+ * @brief Credit the set on air with the time since its turn started.
+ */
+void BLEAdvertisingRotator::endTurn(uint32_t now) {
+	if (m_current >= 0) {
+		m_stats[m_current].airtimeMs += now - m_turnStart;
+	}
+	m_turnStart = now;
+} // endTurn
+
+void BLEAdvertisingRotator::rotatorTask(void* pvParameters) {
+	BLEAdvertisingRotator* pRotator = (BLEAdvertisingRotator*)pvParameters;
+	for (;;) {
+		pRotator->m_semaphore.take("rotatorTask");
+		if (!pRotator->m_running) {   // Decided under the lock, so start() either sees the task gone or keeps it.
+			pRotator->m_taskActive = false;
+			pRotator->m_semaphore.give();
+			break;
+		}
+		uint32_t delay = pRotator->advance(BLEFreeRTOS::getTimeSinceStart());
+		pRotator->m_semaphore.give();
+		BLEFreeRTOS::sleep(delay);
+	}
+	BLEFreeRTOS::deleteTask();
+} // rotatorTask
@@ -0,0 +1,102 @@
+/*
+ * BLEAdvertisingRotator.h
+ *
+ *  Takes turns on air between several pre-encoded advertising sets.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVERTISINGROTATOR_H_
+#define COMPONENTS_CPP_UTILS_BLEADVERTISINGROTATOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BLEAdvPayload.h"
+#include "BLEFreeRTOS.h"
+#include "rtl_ble/ble_unified.h"
+
+/// Number of advertising sets a rotator holds.
+#ifndef BLE_ADV_ROTATOR_MAX_SETS
+#define BLE_ADV_ROTATOR_MAX_SETS 4
+#endif
+
+/**
+ * @brief What a set achieved on air.
+ */
+typedef struct {
+	uint32_t activations;   // Number of turns the set was given.
+	uint32_t airtimeMs;     // Time the set was on air, the current turn included.
+	uint32_t rpcCalls;      // Stack calls issued to switch to the set.
+} BLEAdvertisingSetStats;
+
+/**
+ * @brief Rotate between advertising sets, such as an iBeacon frame, an Eddystone TLM frame and a
+ * connectable advertisement.
+ *
+ * Each set is encoded once when it is added and gets a turn of its own length, which is how the sets are
+ * weighted.  Switching pushes only the parameters that differ from the set on air and applies them with
+ * le_adv_update_param(), so sets that share their event type and interval cost a single data write:
+ *
+ *     rotator.addSet(kIBeacon, 100, 300);
+ *     rotator.addSet(kTlm, 100, 100);
+ *     rotator.addSet(kConnectable, kScanRsp, GAP_ADTYPE_ADV_IND, 100, 600);
+ *     rotator.start();
+ *
+ * start() runs the rotation in a task of its own.  Sketches that prefer to drive it from loop() call
+ * begin() instead and then tick() as often as they like.  The sets and the state on air are guarded by a
+ * lock, so stop(), clear() and addSet() may be called while the task is rotating.
+ */
+class BLEAdvertisingRotator {
+public:
+	BLEAdvertisingRotator();
+	int      addSet(const uint8_t* advData, uint8_t advSize, const uint8_t* scanRspData, uint8_t scanRspSize,
+	                uint8_t advType, uint16_t intervalMs, uint32_t turnMs);
+	template <size_t N>
+	int      addSet(const BLEAdvPayload<N>& adv, uint16_t intervalMs, uint32_t turnMs) {
+		return addSet(adv.getData(), N, nullptr, 0, GAP_ADTYPE_ADV_NONCONN_IND, intervalMs, turnMs);
+	}
+	template <size_t N, size_t M>
+	int      addSet(const BLEAdvPayload<N>& adv, const BLEAdvPayload<M>& scanRsp, uint8_t advType,
+	                uint16_t intervalMs, uint32_t turnMs) {
+		return addSet(adv.getData(), N, scanRsp.getData(), M, advType, intervalMs, turnMs);
+	}
+	void     clear();
+	void     begin();
+	void     start();
+	void     stop();
+	uint32_t tick(uint32_t now);
+	bool     isRunning();
+	int      getCurrentSet();
+	uint8_t  getSetCount();
+	BLEAdvertisingSetStats getStats(uint8_t index);
+	uint32_t getRpcCalls();
+	void     resetStats();
+
+private:
+	typedef struct {
+		uint8_t  advData[BLE_ADV_PAYLOAD_MAX];
+		uint8_t  advSize;
+		uint8_t  scanRspData[BLE_ADV_PAYLOAD_MAX];
+		uint8_t  scanRspSize;
+		uint8_t  advType;
+		uint16_t interval;    // 0.625ms units.
+		uint32_t turnMs;
+	} Set;
+
+	static void rotatorTask(void* pvParameters);
+	uint32_t    advance(uint32_t now);
+	void        activate(int index, uint32_t now);
+	void        push(uint16_t type, uint8_t len, void* pValue, uint8_t index);
+	void        endTurn(uint32_t now);
+
+	Set                    m_sets[BLE_ADV_ROTATOR_MAX_SETS];
+	BLEAdvertisingSetStats m_stats[BLE_ADV_ROTATOR_MAX_SETS];
+	uint8_t                m_setCount;
+	int                    m_current;      // Set on air, -1 before the first one was pushed.
+	int                    m_pushed;       // Set whose parameters the stack holds, -1 if unknown.
+	uint32_t               m_turnStart;
+	uint32_t               m_rpcCalls;
+	volatile bool          m_running;
+	bool                   m_taskActive;
+	BLEFreeRTOS::Semaphore m_semaphore = BLEFreeRTOS::Semaphore("Rotator");   // Held while the sets or the state on air change.
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEADVERTISINGROTATOR_H_ */
@@ -0,0 +1,179 @@
+/*
+ * BLEBeaconDecoder.cpp
+ *
+ *  Recognizes iBeacon, Eddystone and AltBeacon frames in raw advertising payloads.
+ */
+
+#include <string.h>
+#include "BLEBeaconDecoder.h"
+
+#define AD_TYPE_SERVICE_DATA      0x16
+#define AD_TYPE_MANUFACTURER_DATA 0xFF
+
+#define EDDYSTONE_UID_FRAME       0x00
+#define EDDYSTONE_URL_FRAME       0x10
+#define EDDYSTONE_TLM_FRAME       0x20
+
+static const char* const URL_SCHEMES[] = { "http://www.", "https://www.", "http://", "https://" };
+static const char* const URL_EXPANSIONS[] = {
+	".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+	".com",  ".org",  ".edu",  ".net",  ".info",  ".biz",  ".gov"
+};
+
+static inline uint16_t readBE16(const uint8_t* p) {
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t readBE32(const uint8_t* p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief Find the first beacon frame in an advertising payload.
+ * @param [in] pPayload The advertising or scan response payload.
+ * @param [in] length The length of the payload.
+ * @param [out] pFrame Receives the decoded frame.
+ * @return True if a beacon frame was found, otherwise the type of the frame is BLE_BEACON_NONE.
+ */
+bool BLEBeaconDecoder::decode(const uint8_t* pPayload, size_t length, BLEBeaconFrame* pFrame) {
+	pFrame->type = BLE_BEACON_NONE;
+	size_t pos = 0;
+	while (pos < length) {
+		uint8_t size = pPayload[pos];
+		if (size == 0 || pos + 1 + size > length) {
+			break;
+		}
+		uint8_t        type = pPayload[pos + 1];
+		const uint8_t* data = pPayload + pos + 2;
+		if (type == AD_TYPE_MANUFACTURER_DATA && decodeManufacturerData(data, size - 1, pFrame)) {
+			return true;
+		}
+		if (type == AD_TYPE_SERVICE_DATA && decodeServiceData(data, size - 1, pFrame)) {
+			return true;
+		}
+		pos += 1 + size;
+	}
+	return false;
+} // decode
+
+/**
+ * @brief Decode an iBeacon or AltBeacon frame from manufacturer specific data.
+ * @param [in] pData The data after the AD type, starting with the company identifier.
+ * @param [in] length The length of the data.
+ * @param [out] pFrame Receives the decoded frame.
+ * @return True if the data is a beacon frame.
+ */
+bool BLEBeaconDecoder::decodeManufacturerData(const uint8_t* pData, uint8_t length, BLEBeaconFrame* pFrame) {
+	if (length < 4) {   // Company identifier and beacon type, which may run past the end of the payload otherwise.
+		return false;
+	}
+	uint16_t companyId = pData[0] | (pData[1] << 8);
+	if (length == 25 && companyId == BLE_BEACON_APPLE_COMPANY_ID && pData[2] == 0x02 && pData[3] == 0x15) {
+		pFrame->type = BLE_BEACON_IBEACON;
+		memcpy(pFrame->iBeacon.proximityUUID, pData + 4, 16);
+		pFrame->iBeacon.major = readBE16(pData + 20);
+		pFrame->iBeacon.minor = readBE16(pData + 22);
+		pFrame->txPower       = (int8_t)pData[24];
+		return true;
+	}
+	if (length == 26 && pData[2] == 0xBE && pData[3] == 0xAC) {
+		pFrame->type = BLE_BEACON_ALTBEACON;
+		pFrame->altBeacon.manufacturerId = companyId;
+		memcpy(pFrame->altBeacon.beaconId, pData + 4, 20);
+		pFrame->txPower            = (int8_t)pData[24];
+		pFrame->altBeacon.reserved = pData[25];
+		return true;
+	}
+	return false;
+} // decodeManufacturerData
+
+/**
+ * @brief Decode an Eddystone frame from service data.
+ * @param [in] pData The data after the AD type, starting with the service UUID.
+ * @param [in] length The length of the data.
+ * @param [out] pFrame Receives the decoded frame.
+ * @return True if the data is an Eddystone frame.
+ */
+bool BLEBeaconDecoder::decodeServiceData(const uint8_t* pData, uint8_t length, BLEBeaconFrame* pFrame) {
+	if (length < 3 || (uint16_t)(pData[0] | (pData[1] << 8)) != BLE_BEACON_EDDYSTONE_UUID) {
+		return false;
+	}
+	const uint8_t* frame = pData + 2;
+	length -= 2;
+	switch (frame[0]) {
+		case EDDYSTONE_UID_FRAME:
+			if (length < 18) {
+				return false;
+			}
+			pFrame->type    = BLE_BEACON_EDDYSTONE_UID;
+			pFrame->txPower = (int8_t)frame[1] - 41;   // Eddystone calibrates at 0 m, 41 dB of path loss to 1 m.
+			memcpy(pFrame->uid.namespaceId, frame + 2, 10);
+			memcpy(pFrame->uid.instanceId, frame + 12, 6);
+			return true;
+		case EDDYSTONE_URL_FRAME:
+			if (length < 3 || length > 3 + BLE_BEACON_URL_MAX) {
+				return false;
+			}
+			pFrame->type       = BLE_BEACON_EDDYSTONE_URL;
+			pFrame->txPower    = (int8_t)frame[1] - 41;
+			pFrame->url.scheme = frame[2];
+			pFrame->url.length = length - 3;
+			memcpy(pFrame->url.url, frame + 3, length - 3);
+			return true;
+		case EDDYSTONE_TLM_FRAME:
+			if (length < 14 || frame[1] != 0x00) {   // Only the unencrypted version is understood.
+				return false;
+			}
+			pFrame->type             = BLE_BEACON_EDDYSTONE_TLM;
+			pFrame->txPower          = 0;
+			pFrame->tlm.version      = frame[1];
+			pFrame->tlm.voltage      = readBE16(frame + 2);
+			pFrame->tlm.temperature  = (int16_t)readBE16(frame + 4);
+			pFrame->tlm.advCount     = readBE32(frame + 6);
+			pFrame->tlm.secCount     = readBE32(frame + 10);
+			return true;
+		default:
+			return false;
+	}
+} // decodeServiceData
+
+/**
+ * @brief Expand the URL of an Eddystone-URL frame.
+ * @param [in] pFrame The decoded frame.
+ * @param [out] pBuffer Receives the URL, always terminated when size is not 0.
+ * @param [in] size The size of the buffer, 64 bytes hold any URL.
+ * @return The length of the expanded URL, which was truncated if it is not less than size.
+ */
+size_t BLEBeaconDecoder::expandURL(const BLEBeaconFrame* pFrame, char* pBuffer, size_t size) {
+	if (pFrame->type != BLE_BEACON_EDDYSTONE_URL) {
+		if (size != 0) {
+			pBuffer[0] = 0;
+		}
+		return 0;
+	}
+	size_t total = 0;
+	for (int i = -1; i < pFrame->url.length; i++) {
+		const char* text;
+		char        single[2] = { 0, 0 };
+		if (i < 0) {
+			if (pFrame->url.scheme >= sizeof(URL_SCHEMES) / sizeof(URL_SCHEMES[0])) {
+				continue;
+			}
+			text = URL_SCHEMES[pFrame->url.scheme];
+		} else if (pFrame->url.url[i] < sizeof(URL_EXPANSIONS) / sizeof(URL_EXPANSIONS[0])) {
+			text = URL_EXPANSIONS[pFrame->url.url[i]];
+		} else {
+			single[0] = (char)pFrame->url.url[i];
+			text = single;
+		}
+		for (; *text != 0; text++, total++) {
+			if (total + 1 < size) {
+				pBuffer[total] = *text;
+			}
+		}
+	}
+	if (size != 0) {
+		pBuffer[total < size ? total : size - 1] = 0;
+	}
+	return total;
+} // expandURL
@@ -0,0 +1,80 @@
+/*
+ * BLEBeaconDecoder.h
+ *
+ *  Recognizes iBeacon, Eddystone and AltBeacon frames in raw advertising payloads.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEBEACONDECODER_H_
+#define COMPONENTS_CPP_UTILS_BLEBEACONDECODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLE_BEACON_EDDYSTONE_UUID   0xFEAA
+#define BLE_BEACON_APPLE_COMPANY_ID 0x004C
+#define BLE_BEACON_URL_MAX          17     // Encoded URL octets of an Eddystone-URL frame.
+
+typedef enum {
+	BLE_BEACON_NONE = 0,
+	BLE_BEACON_IBEACON,
+	BLE_BEACON_EDDYSTONE_UID,
+	BLE_BEACON_EDDYSTONE_URL,
+	BLE_BEACON_EDDYSTONE_TLM,
+	BLE_BEACON_ALTBEACON
+} BLEBeaconType;
+
+/**
+ * @brief A decoded beacon frame.
+ *
+ * Plain data, filled in place by BLEBeaconDecoder::decode().  Multi-byte fields are converted to host
+ * order.  Only the member of the union that matches the type is valid.
+ */
+typedef struct {
+	uint8_t  type;                 // BLEBeaconType.
+	int8_t   txPower;              // Calibrated RSSI at 1 m, Eddystone's 0 m value is converted; 0 for TLM.
+	union {
+		struct {
+			uint8_t  proximityUUID[16];   // In the order transmitted.
+			uint16_t major;
+			uint16_t minor;
+		} iBeacon;
+		struct {
+			uint8_t  namespaceId[10];
+			uint8_t  instanceId[6];
+		} uid;
+		struct {
+			uint8_t  scheme;              // URL scheme prefix code, see BLEBeaconDecoder::expandURL().
+			uint8_t  length;              // Encoded octets in url.
+			uint8_t  url[BLE_BEACON_URL_MAX];
+		} url;
+		struct {
+			uint8_t  version;
+			uint16_t voltage;             // Battery voltage in mV, 0 if not supported.
+			int16_t  temperature;         // Degrees Celsius in 8.8 fixed point, -128.0 (0x8000) if not supported.
+			uint32_t advCount;            // Frames sent since power up.
+			uint32_t secCount;            // Time since power up in 0.1 s.
+		} tlm;
+		struct {
+			uint16_t manufacturerId;
+			uint8_t  beaconId[20];
+			uint8_t  reserved;
+		} altBeacon;
+	};
+} BLEBeaconFrame;
+
+/**
+ * @brief Classifies and decodes beacon frames without allocating.
+ *
+ * decode() walks the AD structures of a payload once and stops at the first beacon frame.  It only
+ * depends on the C library so it can be run and benchmarked on a host.
+ */
+class BLEBeaconDecoder {
+public:
+	static bool   decode(const uint8_t* pPayload, size_t length, BLEBeaconFrame* pFrame);
+	static size_t expandURL(const BLEBeaconFrame* pFrame, char* pBuffer, size_t size);
+private:
+	static bool   decodeManufacturerData(const uint8_t* pData, uint8_t length, BLEBeaconFrame* pFrame);
+	static bool   decodeServiceData(const uint8_t* pData, uint8_t length, BLEBeaconFrame* pFrame);
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEBEACONDECODER_H_ */
@@ -96,11 +96,17 @@ BLEDescriptor *BLECharacteristic::createDescriptor(BLEUUID uuid, uint16_t flags,
 /**
  * @brief Associate a descriptor with this characteristic.
  * @param [in] pDescriptor
- * @return N/A.
+ * @return False if the service was already started, the descriptor is then not served.
  */
-void BLECharacteristic::addDescriptor(BLEDescriptor *pDescriptor)
+bool BLECharacteristic::addDescriptor(BLEDescriptor *pDescriptor)
 {
-	m_descriptorMap.setByUUID(pDescriptor->getUUID(), pDescriptor);
+	if (!m_descriptorMap.setByUUID(pDescriptor->getUUID(), pDescriptor)) {
+		return false;
+	}
+	if (m_pCCCD == nullptr && pDescriptor->getUUID().equals(BLEUUID((uint16_t)0x2902))) {
+		m_pCCCD = pDescriptor;
+	}
+	return true;
 } // addDescriptor
 
 /**
@@ -299,6 +305,7 @@ void BLECharacteristic::setValue(std::string value)
 {
 	m_semaphoreSetValue.take();
 	m_value.setValue(value);
+	m_snapshotStale = true;
 	m_semaphoreSetValue.give();
 } // setValue
 
@@ -311,6 +318,7 @@ void BLECharacteristic::setValue(uint8_t *data, size_t length)
 {
 	m_semaphoreSetValue.take();
 	m_value.setValue(data, length);
+	m_snapshotStale = true;
 	m_semaphoreSetValue.give();
 	return;
 } // setValue
@@ -393,75 +401,149 @@ void BLECharacteristic::indicate()
 
 /**
  * @brief Send a notify.
- * A notification is a transmission of up to the first 20 bytes of the characteristic value.  An notification
- * will not block; it is a fire and forget.
+ * The value is sent to every connected peer that subscribed to it, or to every connected peer if the
+ * characteristic has no 0x2902 descriptor.  Each peer gets as much of the value as its own MTU allows, and
+ * its own status through BLECharacteristicCallbacks::onStatus().  The value is captured once, so all peers
+ * receive the same value even if setValue() runs meanwhile.
+ * @param [in] is_notification True to notify, false to indicate and wait for each confirmation in turn.
  * @return N/A.
  */
 void BLECharacteristic::notify(bool is_notification)
 {
-	RPC_DEBUG(">> notify: length: %d", m_value.getValue().length());
-
 	m_pCallbacks->onNotify(this);   // Invoke the notify callback.
 
-	if (getService()->getServer()->getConnectedCount() == 0) {
+	// Take the peers out of the server first, indications block and peers may come and go meanwhile.
+	BLEServer* pServer = getService()->getServer();
+	struct {
+		uint16_t connId;
+		uint16_t mtu;
+	} peers[BLE_LE_MAX_LINKS];
+	size_t peerCount = 0;
+	pServer->m_semaphorePeers.take("notify");
+	for (auto &myPair : pServer->m_connectedServersMap) {
+		if (peerCount == BLE_LE_MAX_LINKS) {
+			break;
+		}
+		peers[peerCount].connId = myPair.first;
+		peers[peerCount].mtu    = myPair.second.mtu;
+		peerCount++;
+	}
+	pServer->m_semaphorePeers.give();
+	if (peerCount == 0) {
 		RPC_DEBUG("<< notify: No connected clients.");
 		m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_NO_CLIENT, 0);
 		return;
 	}
 
-	// Test to see if we have a 0x2902 descriptor.  If we do, then check to see if notification is enabled
-	// and, if not, prevent the notification.
-
-	BLE2902 *p2902 = (BLE2902*)getDescriptorByUUID((uint16_t)0x2902);
-	if(is_notification) {
-		if (p2902 != nullptr && !p2902->getNotifications()) {
-			RPC_DEBUG("<< notifications disabled; ignoring");
-			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_NOTIFY_DISABLED, 0);   // Invoke the notify callback.
-			return;
-		}
-	}
-	else{
-		if (p2902 != nullptr && !p2902->getIndications()) {
-			RPC_DEBUG("<< indications disabled; ignoring");
-			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_INDICATE_DISABLED, 0);   // Invoke the notify callback.
-			return;
-		}
-	}
-	for (auto &myPair : getService()->getServer()->getPeerDevices(false)) {
-		uint16_t _mtu = (myPair.second.mtu);
-		if ((uint16_t)m_value.getValue().length() > _mtu - 3) {
-			RPC_DEBUG("- Truncating to %d bytes (maximum notify size)", _mtu - 3);
+	std::shared_ptr<const std::string> value = getSnapshot();
+	RPC_DEBUG(">> notify: length: %d", value->length());
+	for (size_t i = 0; i < peerCount; i++) {
+		uint16_t connId = peers[i].connId;
+		if (!isSubscribed(connId, is_notification)) {
+			RPC_DEBUG("<< %s disabled on %d; ignoring", is_notification ? "notifications" : "indications", connId);
+			m_pCallbacks->onStatus(this, is_notification ? BLECharacteristicCallbacks::Status::ERROR_NOTIFY_DISABLED :
+			                       BLECharacteristicCallbacks::Status::ERROR_INDICATE_DISABLED, 0, connId);
+			continue;
 		}
 
-		size_t length = m_value.getValue().length();
-		if(!is_notification) {// is indication
+		size_t length = value->length();
+		if (length > (size_t)(peers[i].mtu - 3)) {
+			RPC_DEBUG("- Truncating to %d bytes (maximum notify size)", peers[i].mtu - 3);
+			length = peers[i].mtu - 3;
+		}
+		if (!is_notification) {   // is indication
 			m_semaphoreConfEvt.take("indicate");
 		}
-		bool errRc = server_send_data(0, getService()->getHandle(), getHandle(), (uint8_t *)m_value.getData(), (uint16_t)length, GATT_PDU_TYPE_ANY);
+		bool errRc = server_send_data(connId, getService()->getHandle(), getHandle(), (uint8_t *)value->data(), (uint16_t)length,
+		                              is_notification ? GATT_PDU_TYPE_NOTIFICATION : GATT_PDU_TYPE_INDICATION);
 		if (errRc != true) {
-			m_semaphoreConfEvt.give();
-			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_GATT, errRc);   // Invoke the notify callback.
-			return;
+			if (!is_notification) {
+				m_semaphoreConfEvt.give();
+			}
+			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_GATT, errRc, connId);
+			continue;
 		}
-		if(!is_notification){ // is indication
-			if(!m_semaphoreConfEvt.timedWait("indicate", indicationTimeout)){
-				m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_INDICATE_TIMEOUT, 0);   // Invoke the notify callback.
+		if (!is_notification) {   // is indication
+			if (!m_semaphoreConfEvt.timedWait("indicate", indicationTimeout)) {
+				m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_INDICATE_TIMEOUT, 0, connId);
 			} else {
-				uint32_t code =  m_semaphoreConfEvt.value();
-				if(code == 0) {
-					m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::SUCCESS_INDICATE, code);   // Invoke the notify callback.
+				uint32_t code = m_semaphoreConfEvt.value();
+				if (code == 0) {
+					m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::SUCCESS_INDICATE, code, connId);
 				} else {
-					m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_INDICATE_FAILURE, code);
+					m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::ERROR_INDICATE_FAILURE, code, connId);
 				}
 			}
 		} else {
-			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::SUCCESS_NOTIFY, 0);   // Invoke the notify callback.
+			m_pCallbacks->onStatus(this, BLECharacteristicCallbacks::Status::SUCCESS_NOTIFY, 0, connId);
 		}
 	}
 	RPC_DEBUG("<< notify");
 
 } // Notify
 
+/**
+ * @brief Record the CCCD bits a connection wrote.
+ * @param [in] connId The connection.
+ * @param [in] cccBits The notification and indication bits.
+ */
+void BLECharacteristic::setSubscription(uint16_t connId, uint16_t cccBits)
+{
+	m_semaphoreSubscriptions.take("setSubscription");
+	for (Subscription& subscription : m_subscriptions) {
+		if (subscription.connId == connId) {
+			subscription.cccBits = cccBits;
+			m_semaphoreSubscriptions.give();
+			return;
+		}
+	}
+	Subscription subscription = { connId, cccBits };
+	m_subscriptions.push_back(subscription);
+	m_semaphoreSubscriptions.give();
+} // setSubscription
+
+/**
+ * @brief Find out whether a connection should receive a notification or indication.
+ * A connection that never wrote the 0x2902 descriptor follows its local value, as set with
+ * BLE2902::setNotifications() and setIndications().  Writes from peers never change that value, each
+ * peer's write only applies to its own connection.
+ * @param [in] connId The connection.
+ * @param [in] is_notification True for a notification, false for an indication.
+ */
+bool BLECharacteristic::isSubscribed(uint16_t connId, bool is_notification)
+{
+	if (m_pCCCD == nullptr) {
+		return true;
+	}
+	uint16_t mask = is_notification ? (1 << 0) : (1 << 1);
+	m_semaphoreSubscriptions.take("isSubscribed");
+	for (Subscription& subscription : m_subscriptions) {
+		if (subscription.connId == connId) {
+			bool subscribed = (subscription.cccBits & mask) != 0;
+			m_semaphoreSubscriptions.give();
+			return subscribed;
+		}
+	}
+	m_semaphoreSubscriptions.give();
+	return m_pCCCD->getValue() != nullptr && (m_pCCCD->getValue()[0] & mask) != 0;
+} // isSubscribed
+
+/**
+ * @brief Get the value as a snapshot that setValue() leaves alone.
+ * A new snapshot is only taken once the value changed, until then reads and notifications share it.
+ */
+std::shared_ptr<const std::string> BLECharacteristic::getSnapshot()
+{
+	m_semaphoreSetValue.take();
+	if (m_snapshotStale || !m_snapshot) {
+		m_snapshot = std::make_shared<const std::string>(m_value.getValue());
+		m_snapshotStale = false;
+	}
+	std::shared_ptr<const std::string> snapshot = m_snapshot;
+	m_semaphoreSetValue.give();
+	return snapshot;
+} // getSnapshot
+
 /**
  * @brief Register a new characteristic with the ESP runtime.
  * @param [in] pService The service with which to associate this characteristic.
@@ -476,12 +558,10 @@ void BLECharacteristic::executeCreate(BLEService *pService)
 	CHAR.permissions = getAccessPermissions();
 	uint8_t char_handle1 = ble_create_char(m_pService->getgiff(), CHAR);
 	m_handle = char_handle1;
-	BLEDescriptor *pDescriptor = m_descriptorMap.getFirst();
-	while (pDescriptor != nullptr)
+	for (BLEDescriptor *pDescriptor : m_descriptorMap)
 	{
 		pDescriptor->executeCreate(this);
-		pDescriptor = m_descriptorMap.getNext();
-	} // End while
+	} // End for
 
 } // executeCreate
 
@@ -489,7 +569,7 @@ void BLECharacteristic::executeCreate(BLEService *pService)
  * Handle a GATT server event.
  */
 
-void BLECharacteristic::handleGATTServerEvent(T_SERVER_ID service_id, void *p_data)
+void BLECharacteristic::handleGATTServerEvent(T_SERVER_ID /*service_id*/, void *p_data)
 {
 
 	ble_service_cb_data_t *cb_data = (ble_service_cb_data_t *)p_data;
@@ -501,30 +581,12 @@ void BLECharacteristic::handleGATTServerEvent(T_SERVER_ID service_id, void *p_da
 		{
 		case SERVICE_CALLBACK_TYPE_INDIFICATION_NOTIFICATION:
 		{
+			setSubscription(cb_data->conn_id, cb_data->cb_data_context.cccd_update_data.cccbits);
 			break;
 		}
 		case SERVICE_CALLBACK_TYPE_READ_CHAR_VALUE:
 		{
-			m_pCallbacks->onRead(this);
-			uint16_t maxOffset = getService()->getServer()->getPeerMTU(getService()->getServer()->getconnId()) - 1;
-			size_t length = m_value.getLength();
-			uint8_t *p_value = (uint8_t *)m_value.getData();
-			if (length - m_value.getReadOffset() < maxOffset)
-			{
-				cb_data->cb_data_context.read_data.length = length - m_value.getReadOffset();
-				cb_data->cb_data_context.read_data.offset = m_value.getReadOffset();
-				//memcpy(cb_data->cb_data_context.read_data.p_value, value.data() + cb_data->cb_data_context.read_data.offset, cb_data->cb_data_context.read_data.length);
-				cb_data->cb_data_context.read_data.p_value = (uint8_t *)(p_value);
-				m_value.setReadOffset(0);
-			}
-			else
-			{
-				cb_data->cb_data_context.read_data.length = maxOffset;
-				cb_data->cb_data_context.read_data.offset = m_value.getReadOffset();
-				//memcpy(cb_data->cb_data_context.read_data.p_value, value.data() + cb_data->cb_data_context.read_data.offset, cb_data->cb_data_context.read_data.length);
-				cb_data->cb_data_context.read_data.p_value = ((uint8_t *)p_value + cb_data->cb_data_context.read_data.offset);
-				m_value.setReadOffset(cb_data->cb_data_context.read_data.offset + maxOffset);
-			}
+			handleReadEvent(cb_data);
 			break;
 		}
 		case SERVICE_CALLBACK_TYPE_WRITE_CHAR_VALUE:
@@ -542,14 +604,81 @@ void BLECharacteristic::handleGATTServerEvent(T_SERVER_ID service_id, void *p_da
 			break;
 		}
 	}
-	m_descriptorMap.handleGATTServerEvent(service_id, p_data);
 } // handleGATTServerEvent
 
+/**
+ * @brief Answer a read request, or the next part of a long read, from the requesting connection.
+ * Each connection is answered from the offset its peer asked for, in chunks that fit its own MTU.  Responses
+ * point into a snapshot of the value rather than copying it: a long read holds on to the snapshot it started
+ * with, so setValue() in the middle of it does not tear the value the peer receives.  Only a read at the
+ * offset where the previous response of the connection ended continues it, any other read, a plain read
+ * at offset 0 in particular, starts over from the current value.
+ * @param [in] cb_data The read event, with the offset the peer asked for, whose response fields are filled in.
+ */
+void BLECharacteristic::handleReadEvent(ble_service_cb_data_t *cb_data)
+{
+	uint16_t connId = cb_data->conn_id;
+	uint16_t offset = cb_data->cb_data_context.read_data.offset;
+	ReadCursor* pCursor = nullptr;
+	for (ReadCursor& cursor : m_readCursors) {
+		if (cursor.connId == connId) {
+			pCursor = &cursor;
+			break;
+		}
+	}
+	if (pCursor == nullptr) {
+		ReadCursor cursor = { connId, 0, nullptr };
+		m_readCursors.push_back(cursor);
+		pCursor = &m_readCursors.back();
+	}
+	if (offset == 0 || offset != pCursor->offset || !pCursor->snapshot) {
+		// A new read, onRead() may still update the value.
+		m_pCallbacks->onRead(this);
+		pCursor->snapshot = getSnapshot();
+	}
+
+	const std::string& value = *pCursor->snapshot;
+	uint16_t chunk  = getService()->getServer()->getPeerMTU(connId) - 1;
+	if (offset > value.length()) {   // Past the end, answered with nothing.
+		offset = value.length();
+	}
+	size_t length = value.length() - offset;
+	if (length > chunk) {
+		length = chunk;
+	}
+	cb_data->cb_data_context.read_data.offset  = offset;
+	cb_data->cb_data_context.read_data.length  = length;
+	cb_data->cb_data_context.read_data.p_value = (uint8_t *)value.data() + offset;
+	pCursor->offset = offset + length;
+} // handleReadEvent
+
+/**
+ * @brief Forget the read and subscription state of a connection that went away.
+ * @param [in] connId The connection.
+ */
+void BLECharacteristic::releaseConnection(uint16_t connId)
+{
+	for (size_t i = 0; i < m_readCursors.size(); i++) {
+		if (m_readCursors[i].connId == connId) {
+			m_readCursors.erase(m_readCursors.begin() + i);
+			break;
+		}
+	}
+	m_semaphoreSubscriptions.take("releaseConnection");
+	for (size_t i = 0; i < m_subscriptions.size(); i++) {
+		if (m_subscriptions[i].connId == connId) {
+			m_subscriptions.erase(m_subscriptions.begin() + i);
+			break;
+		}
+	}
+	m_semaphoreSubscriptions.give();
+} // releaseConnection
+
 /**
  * @brief Callback function to support a read request.
  * @param [in] pCharacteristic The characteristic that is the source of the event.
  */
-void BLECharacteristicCallbacks::onRead(BLECharacteristic *pCharacteristic)
+void BLECharacteristicCallbacks::onRead(BLECharacteristic * /*pCharacteristic*/)
 {
 
 } // onRead
@@ -558,7 +687,7 @@ void BLECharacteristicCallbacks::onRead(BLECharacteristic *pCharacteristic)
  * @brief Callback function to support a write request.
  * @param [in] pCharacteristic The characteristic that is the source of the event.
  */
-void BLECharacteristicCallbacks::onWrite(BLECharacteristic *pCharacteristic)
+void BLECharacteristicCallbacks::onWrite(BLECharacteristic * /*pCharacteristic*/)
 {
 
 } // onWrite
@@ -567,7 +696,7 @@ void BLECharacteristicCallbacks::onWrite(BLECharacteristic *pCharacteristic)
  * @brief Callback function to support a Notify request.
  * @param [in] pCharacteristic The characteristic that is the source of the event.
  */
-void BLECharacteristicCallbacks::onNotify(BLECharacteristic *pCharacteristic)
+void BLECharacteristicCallbacks::onNotify(BLECharacteristic * /*pCharacteristic*/)
 {
 
 } // onNotify
@@ -578,7 +707,20 @@ void BLECharacteristicCallbacks::onNotify(BLECharacteristic *pCharacteristic)
  * @param [in] s Status of the notification/indication
  * @param [in] code Additional code of underlying errors
  */
-void BLECharacteristicCallbacks::onStatus(BLECharacteristic *pCharacteristic, Status s, uint32_t code)
+void BLECharacteristicCallbacks::onStatus(BLECharacteristic * /*pCharacteristic*/, Status /*s*/, uint32_t /*code*/)
 {
 
+} // onStatus
+
+/**
+ * @brief Callback function to support a Notify/Indicate Status report for one connection.
+ * By default the report is passed on without the connection.
+ * @param [in] pCharacteristic The characteristic that is the source of the event.
+ * @param [in] s Status of the notification/indication
+ * @param [in] code Additional code of underlying errors
+ * @param [in] connId The connection the notification/indication was sent to.
+ */
+void BLECharacteristicCallbacks::onStatus(BLECharacteristic *pCharacteristic, Status s, uint32_t code, uint16_t /*connId*/)
+{
+	onStatus(pCharacteristic, s, code);
 } // onStatus
\ No newline at end of file
@@ -9,10 +9,13 @@
 #define COMPONENTS_CPP_UTILS_BLECHARACTERISTIC_H_
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 #include "BLEUUID.h"
 #include "BLEDescriptor.h"
 #include "BLEValue.h"
 #include "BLEFreeRTOS.h"
+#include "BLEUUIDIndex.h"
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
 
@@ -25,8 +28,8 @@ class BLECharacteristicCallbacks;
  */
 class BLEDescriptorMap {
 public:
-    void setByUUID(const char* uuid, BLEDescriptor* pDescriptor);
-    void setByUUID(BLEUUID uuid, BLEDescriptor* pDescriptor);
+    bool setByUUID(const char* uuid, BLEDescriptor* pDescriptor);
+    bool setByUUID(BLEUUID uuid, BLEDescriptor* pDescriptor);
 	void setByHandle(uint16_t handle, BLEDescriptor* pDescriptor);
 	BLEDescriptor* getByUUID(const char* uuid);
 	BLEDescriptor* getByUUID(BLEUUID uuid);
@@ -35,11 +38,17 @@ public:
 	BLEDescriptor* getByHandle(uint16_t handle);
 	std::string	toString();
 	void handleGATTServerEvent(T_SERVER_ID service_id, void *p_data);
+	BLEDescriptor* const* begin() const;
+	BLEDescriptor* const* end() const;
+	size_t getCount();
+	void   freeze();
+	size_t getMemoryUsage();
  
 private:
-	std::map<BLEDescriptor*, std::string> m_uuidMap;
-	std::map<uint16_t, BLEDescriptor*> m_handleMap;
-    std::map<BLEDescriptor*, std::string>::iterator m_iterator;
+	std::vector<BLEDescriptor*> m_descriptors;   // In the order they were added.
+	BLEUUIDIndex<BLEDescriptor> m_uuidIndex;
+	size_t m_iterator = 0;
+	bool   m_frozen = false;
 };
 
 
@@ -71,7 +80,7 @@ public:
 	void setCallbacks(BLECharacteristicCallbacks* pCallbacks);
 	BLEDescriptor* createDescriptor(BLEUUID uuid,uint16_t flags,uint32_t permissions,uint16_t max_len);
 	BLEDescriptor* createDescriptor(const char* uuid, uint16_t flags,uint32_t permissions,uint16_t max_len);
-	void           addDescriptor(BLEDescriptor* pDescriptor);
+	bool           addDescriptor(BLEDescriptor* pDescriptor);
 	BLEDescriptor* getDescriptorByUUID(const char* descriptorUUID);
 	BLEDescriptor* getDescriptorByUUID(BLEUUID descriptorUUID);
 	BLEService*    getService();
@@ -96,6 +105,7 @@ private:
     friend class BLEServer;
 	friend class BLEService;
 	friend class BLECharacteristicMap;
+	friend class BLEServiceMap;
 	friend class BLEDescriptor;
 
     BLEUUID                     m_bleUUID;
@@ -105,16 +115,41 @@ private:
     BLECharacteristicCallbacks* m_pCallbacks;
 
 
+	// The read state of one connection.  A long read sees the value as it was when the read started, and
+	// the snapshot is held after the last response until the connection reads again, since the response
+	// points into it.
+	typedef struct {
+		uint16_t                           connId;
+		uint16_t                           offset;       // Where the last response ended.
+		std::shared_ptr<const std::string> snapshot;
+	} ReadCursor;
+
 	BLEValue                    m_value;
 	BLEService*                 m_pService;
 	BLEDescriptorMap            m_descriptorMap;
+	std::shared_ptr<const std::string> m_snapshot;        // The value read responses point into.
+	bool                        m_snapshotStale = true;   // The value changed since m_snapshot was taken.
+	std::vector<ReadCursor>     m_readCursors;            // One per connection that read the value.
+	// The CCCD bits a connection wrote, guarded by m_semaphoreSubscriptions.
+	typedef struct {
+		uint16_t connId;
+		uint16_t cccBits;
+	} Subscription;
+	BLEDescriptor*              m_pCCCD = nullptr;        // The 0x2902 descriptor, if any.
+	std::vector<Subscription>   m_subscriptions;
 
     void                 executeCreate(BLEService* pService);
 	uint8_t              getProperties();
 	void handleGATTServerEvent(T_SERVER_ID service_id, void *p_data);
+	void handleReadEvent(ble_service_cb_data_t *cb_data);
+	void releaseConnection(uint16_t connId);
+	void setSubscription(uint16_t connId, uint16_t cccBits);
+	bool isSubscribed(uint16_t connId, bool is_notification);
+	std::shared_ptr<const std::string> getSnapshot();
 	BLEFreeRTOS::Semaphore m_semaphoreCreateEvt = BLEFreeRTOS::Semaphore("CreateEvt");
 	BLEFreeRTOS::Semaphore m_semaphoreSetValue  = BLEFreeRTOS::Semaphore("SetValue");
 	BLEFreeRTOS::Semaphore m_semaphoreConfEvt   = BLEFreeRTOS::Semaphore("ConfEvt");
+	BLEFreeRTOS::Semaphore m_semaphoreSubscriptions = BLEFreeRTOS::Semaphore("Subscriptions");
 
 
 
@@ -146,6 +181,7 @@ public:
 	virtual void onWrite(BLECharacteristic* pCharacteristic);
 	virtual void onNotify(BLECharacteristic* pCharacteristic);
 	virtual void onStatus(BLECharacteristic* pCharacteristic, Status s, uint32_t code);
+	virtual void onStatus(BLECharacteristic* pCharacteristic, Status s, uint32_t code, uint16_t connId);
 
 };
 #endif /* COMPONENTS_CPP_UTILS_BLECHARACTERISTIC_H_ */
@@ -8,27 +8,41 @@
 #include <iomanip>
 #include "BLEService.h"
 #include "Arduino.h"
+#include "rpc_unified_log.h"
 
 
 /**
  * @brief Set the characteristic by UUID.
+ * The UUID is that of the characteristic itself, characteristics are kept in the order they are added.
  * @param [in] uuid The uuid of the characteristic.
  * @param [in] characteristic The characteristic to cache.
- * @return N/A.
+ * @return False if the service was already started, the characteristic is then not added.
  */
-void BLECharacteristicMap::setByUUID(BLECharacteristic* pCharacteristic, BLEUUID uuid) {
-	m_uuidMap.insert(std::pair<BLECharacteristic*, std::string>(pCharacteristic, uuid.toString()));
+bool BLECharacteristicMap::setByUUID(BLECharacteristic* pCharacteristic, BLEUUID /*uuid*/) {
+	if (m_frozen) {
+		RPC_DEBUG("Characteristic %s not added, the service is already started\n\r", uuid.toString().c_str());
+		return false;
+	}
+	for (BLECharacteristic* pExisting : m_characteristics) {
+		if (pExisting == pCharacteristic) {
+			return true;
+		}
+	}
+	m_characteristics.push_back(pCharacteristic);
+	m_uuidIndex.insert(pCharacteristic->getUUID(), pCharacteristic);
+	return true;
 } // setByUUID
 
 
 /**
  * @brief Set the characteristic by handle.
+ * The handle is that of the characteristic itself, this only adds the characteristic if it is not known yet.
  * @param [in] handle The handle of the characteristic.
  * @param [in] characteristic The characteristic to cache.
  * @return N/A.
  */
-void BLECharacteristicMap::setByHandle(uint16_t handle, BLECharacteristic* characteristic) {
-	m_handleMap.insert(std::pair<uint16_t, BLECharacteristic*>(handle, characteristic));
+void BLECharacteristicMap::setByHandle(uint16_t /*handle*/, BLECharacteristic* characteristic) {
+	setByUUID(characteristic, characteristic->getUUID());
 } // setByHandle
 
 
@@ -36,10 +50,15 @@ void BLECharacteristicMap::setByHandle(uint16_t handle, BLECharacteristic* chara
 /**
  * @brief Return the characteristic by handle.
  * @param [in] handle The handle to look up the characteristic.
- * @return The characteristic.
+ * @return The characteristic, or nullptr if there is none with this handle.
  */
 BLECharacteristic* BLECharacteristicMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	for (BLECharacteristic* pCharacteristic : m_characteristics) {
+		if (pCharacteristic->getHandle() == handle) {
+			return pCharacteristic;
+		}
+	}
+	return nullptr;
 } // getByHandle
 
 /**
@@ -48,24 +67,18 @@ BLECharacteristic* BLECharacteristicMap::getByHandle(uint16_t handle) {
  * @return The characteristic.
  */
 BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
-	}
-	return nullptr;
+	return m_uuidIndex.get(uuid);
 } // getByUUID
 
 /**
  * @brief Get the first characteristic in the map.
+ * getFirst() and getNext() share one position, code that may run while another walk is in progress
+ * iterates from begin() to end() instead.
  * @return The first characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLECharacteristic* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 
@@ -74,12 +87,43 @@ BLECharacteristic* BLECharacteristicMap::getFirst() {
  * @return The next characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLECharacteristic* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	if (m_iterator >= m_characteristics.size()) return nullptr;
+	return m_characteristics[m_iterator++];
 } // getNext
 
+BLECharacteristic* const* BLECharacteristicMap::begin() const {
+	return m_characteristics.data();
+} // begin
+
+BLECharacteristic* const* BLECharacteristicMap::end() const {
+	return m_characteristics.data() + m_characteristics.size();
+} // end
+
+size_t BLECharacteristicMap::getCount() {
+	return m_characteristics.size();
+} // getCount
+
+/**
+ * @brief Stop accepting characteristics and give back the spare capacity, once the service has started.
+ */
+void BLECharacteristicMap::freeze() {
+	m_characteristics.shrink_to_fit();
+	m_uuidIndex.compact();
+	m_frozen = true;
+} // freeze
+
+/**
+ * @brief Get the memory used by the map and its descriptor maps, in bytes.
+ */
+size_t BLECharacteristicMap::getMemoryUsage() {
+	size_t size = sizeof(*this) + m_characteristics.capacity() * sizeof(BLECharacteristic*) +
+		m_uuidIndex.getMemoryUsage();
+	for (BLECharacteristic* pCharacteristic : m_characteristics) {
+		size += pCharacteristic->m_descriptorMap.getMemoryUsage();
+	}
+	return size;
+} // getMemoryUsage
+
 
 /**
  * @brief Pass the GATT server event onwards to each of the characteristics found in the mapping
@@ -88,11 +132,9 @@ BLECharacteristic* BLECharacteristicMap::getNext() {
  * @param [in] param
  */
 void BLECharacteristicMap::handleGATTServerEvent(T_SERVER_ID service_id, void *p_data) {
-	// Invoke the handler for every Service we have.
-	for (auto& myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(service_id,p_data);
+	// Invoke the handler for every characteristic and descriptor we have.
+	for (BLECharacteristic* pCharacteristic : m_characteristics) {
+		pCharacteristic->handleGATTServerEvent(service_id,p_data);
+		pCharacteristic->m_descriptorMap.handleGATTServerEvent(service_id,p_data);
 	}
 } // handleGATTServerEvent
-
-
-
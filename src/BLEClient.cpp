@@ -197,16 +197,7 @@ BLERemoteService* BLEClient::getService(BLEUUID uuid) {
 	if (!m_haveServices) {
 		getServices();
 	}
-	std::string uuidStr = uuid.toString();
-	
-	for (auto &myPair : m_servicesMap) {
-		if (myPair.first == uuidStr) {
-			return myPair.second;
-		}
-	} // End of each of the services.
-	
-	RPC_DEBUG("end  BLEClient::getServices():\n\r "); 
-	return nullptr;
+	return m_serviceIndex.get(uuid);
 } // getService
 
 /**
@@ -238,6 +229,7 @@ void BLEClient::clearServices() {
 	   delete myPair.second;
 	}
 	m_servicesMap.clear();
+	m_serviceIndex.clear();
 	m_haveServices = false;
 } // clearServices
 
@@ -320,7 +312,8 @@ T_APP_RESULT BLEClient::clientCallbackDefault(T_CLIENT_ID client_id, uint8_t con
 			);
 			
 			RPC_DEBUG(pRemoteService->getUUID().toString().c_str());
-			m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(uuid.toString(), pRemoteService));			         				
+			m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(uuid.toString(), pRemoteService));
+			m_serviceIndex.insert(uuid, pRemoteService);
 			break;
         }
         case DISC_RESULT_ALL_SRV_UUID128:
@@ -335,7 +328,8 @@ T_APP_RESULT BLEClient::clientCallbackDefault(T_CLIENT_ID client_id, uint8_t con
 			);
 			
 			RPC_DEBUG(pRemoteService->getUUID().toString().c_str());  
-			m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(uuid.toString(), pRemoteService));			
+			m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(uuid.toString(), pRemoteService));
+			m_serviceIndex.insert(uuid, pRemoteService);
             break;
         }
         case DISC_RESULT_SRV_DATA:
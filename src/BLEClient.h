@@ -16,6 +16,7 @@
 #include "BLEAdvertisedDevice.h"
 #include "BLERemoteService.h"
 #include "BLERemoteDescriptor.h"
+#include "BLEUUIDIndex.h"
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
 
@@ -75,6 +76,7 @@ private:
 	BLEFreeRTOS::Semaphore m_semaphoreRssiCmplEvt   = BLEFreeRTOS::Semaphore("RssiCmplEvt");
 	void clearServices();   // Clear any existing services.
 	std::map<std::string, BLERemoteService*> m_servicesMap;
+	BLEUUIDIndex<BLERemoteService>           m_serviceIndex;
 	uint16_t m_mtu = 23;
 }; // class BLEDevice
 
@@ -159,7 +159,7 @@ BLEDescriptorCallbacks::~BLEDescriptorCallbacks() {}
  * @brief Callback function to support a read request.
  * @param [in] pDescriptor The descriptor that is the source of the event.
  */
-void BLEDescriptorCallbacks::onRead(BLEDescriptor *pDescriptor)
+void BLEDescriptorCallbacks::onRead(BLEDescriptor * /*pDescriptor*/)
 {
 
 } // onRead
@@ -168,7 +168,7 @@ void BLEDescriptorCallbacks::onRead(BLEDescriptor *pDescriptor)
  * @brief Callback function to support a write request.
  * @param [in] pDescriptor The descriptor that is the source of the event.
  */
-void BLEDescriptorCallbacks::onWrite(BLEDescriptor *pDescriptor)
+void BLEDescriptorCallbacks::onWrite(BLEDescriptor * /*pDescriptor*/)
 {
 
 } // onWrite
@@ -180,7 +180,7 @@ void BLEDescriptorCallbacks::onWrite(BLEDescriptor *pDescriptor)
  * @param [in] param
  */
 void BLEDescriptor::handleGATTServerEvent(
-	T_SERVER_ID service_id,
+	T_SERVER_ID /*service_id*/,
 	void *p_data)
 {
 	RPC_DEBUG("BLEDescriptor handleGATTServerEvent: service_id: %d\n\r", service_id);
@@ -192,7 +192,12 @@ void BLEDescriptor::handleGATTServerEvent(
 		case SERVICE_CALLBACK_TYPE_INDIFICATION_NOTIFICATION:
 		{
 			RPC_DEBUG("SERVICE_CALLBACK_TYPE_INDIFICATION_NOTIFICATION: cccdbit: %d\n\r", cb_data->cb_data_context.cccd_update_data.cccbits);
-	        setValue((uint8_t *)&cb_data->cb_data_context.cccd_update_data.cccbits, 2);
+			// The bits belong to the connection that wrote them, the value stays the local default for the others.
+			if (m_pCharacteristic != nullptr) {
+				m_pCharacteristic->setSubscription(cb_data->conn_id, cb_data->cb_data_context.cccd_update_data.cccbits);
+			} else {
+				setValue((uint8_t *)&cb_data->cb_data_context.cccd_update_data.cccbits, 2);
+			}
 			break;
 		}
 		case SERVICE_CALLBACK_TYPE_READ_CHAR_VALUE:
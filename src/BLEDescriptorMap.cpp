@@ -9,6 +9,7 @@
 #include <iomanip>
 #include "BLECharacteristic.h"
 #include "BLEDescriptor.h"
+#include "rpc_unified_log.h"
 
 /**
  * @brief Return the descriptor by UUID.
@@ -25,32 +26,39 @@ BLEDescriptor* BLEDescriptorMap::getByUUID(const char* uuid) {
  * @return The descriptor.  If not present, then nullptr is returned.
  */
 BLEDescriptor* BLEDescriptorMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
-	}
-	return nullptr;
+	return m_uuidIndex.get(uuid);
 } // getByUUID
 
 /**
  * @brief Set the descriptor by UUID.
  * @param [in] uuid The uuid of the descriptor.
  * @param [in] characteristic The descriptor to cache.
- * @return N/A.
+ * @return False if the service was already started, the descriptor is then not added.
  */
-void BLEDescriptorMap::setByUUID(const char* uuid, BLEDescriptor* pDescriptor){
-	m_uuidMap.insert(std::pair<BLEDescriptor*, std::string>(pDescriptor, uuid));
+bool BLEDescriptorMap::setByUUID(const char* uuid, BLEDescriptor* pDescriptor){
+	return setByUUID(BLEUUID(uuid), pDescriptor);
 } // setByUUID
 
 /**
  * @brief Set the descriptor by UUID.
+ * The UUID is that of the descriptor itself, descriptors are kept in the order they are added.
  * @param [in] uuid The uuid of the descriptor.
  * @param [in] characteristic The descriptor to cache.
- * @return N/A.
+ * @return False if the service was already started, the descriptor is then not added.
  */
-void BLEDescriptorMap::setByUUID(BLEUUID uuid, BLEDescriptor* pDescriptor) {
-	m_uuidMap.insert(std::pair<BLEDescriptor*, std::string>(pDescriptor, uuid.toString()));
+bool BLEDescriptorMap::setByUUID(BLEUUID /*uuid*/, BLEDescriptor* pDescriptor) {
+	if (m_frozen) {
+		RPC_DEBUG("Descriptor %s not added, the service is already started\n\r", uuid.toString().c_str());
+		return false;
+	}
+	for (BLEDescriptor* pExisting : m_descriptors) {
+		if (pExisting == pDescriptor) {
+			return true;
+		}
+	}
+	m_descriptors.push_back(pDescriptor);
+	m_uuidIndex.insert(pDescriptor->getUUID(), pDescriptor);
+	return true;
 } // setByUUID
 
 
@@ -61,21 +69,20 @@ void BLEDescriptorMap::setByUUID(BLEUUID uuid, BLEDescriptor* pDescriptor) {
  * @param [in] descriptor The descriptor to cache.
  * @return N/A.
  */
-void BLEDescriptorMap::setByHandle(uint16_t handle, BLEDescriptor* pDescriptor) {
-	m_handleMap.insert(std::pair<uint16_t, BLEDescriptor*>(handle, pDescriptor));
+void BLEDescriptorMap::setByHandle(uint16_t /*handle*/, BLEDescriptor* pDescriptor) {
+	setByUUID(pDescriptor->getUUID(), pDescriptor);
 } // setByHandle
 
 
 /**
  * @brief Get the first descriptor in the map.
+ * getFirst() and getNext() share one position, code that may run while another walk is in progress
+ * iterates from begin() to end() instead.
  * @return The first descriptor in the map.
  */
 BLEDescriptor* BLEDescriptorMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEDescriptor* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 
@@ -84,21 +91,52 @@ BLEDescriptor* BLEDescriptorMap::getFirst() {
  * @return The next descriptor in the map.
  */
 BLEDescriptor* BLEDescriptorMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEDescriptor* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	if (m_iterator >= m_descriptors.size()) return nullptr;
+	return m_descriptors[m_iterator++];
 } // getNext
 
+BLEDescriptor* const* BLEDescriptorMap::begin() const {
+	return m_descriptors.data();
+} // begin
+
+BLEDescriptor* const* BLEDescriptorMap::end() const {
+	return m_descriptors.data() + m_descriptors.size();
+} // end
+
+size_t BLEDescriptorMap::getCount() {
+	return m_descriptors.size();
+} // getCount
+
+/**
+ * @brief Stop accepting descriptors and give back the spare capacity, once the service has started.
+ */
+void BLEDescriptorMap::freeze() {
+	m_descriptors.shrink_to_fit();
+	m_uuidIndex.compact();
+	m_frozen = true;
+} // freeze
+
+/**
+ * @brief Get the memory used by the map, in bytes.
+ */
+size_t BLEDescriptorMap::getMemoryUsage() {
+	return sizeof(*this) + m_descriptors.capacity() * sizeof(BLEDescriptor*) + m_uuidIndex.getMemoryUsage();
+} // getMemoryUsage
+
 
 
 /**
  * @brief Return the descriptor by handle.
  * @param [in] handle The handle to look up the descriptor.
- * @return The descriptor.
+ * @return The descriptor, or nullptr if there is none with this handle.
  */
 BLEDescriptor* BLEDescriptorMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	for (BLEDescriptor* pDescriptor : m_descriptors) {
+		if (pDescriptor->getHandle() == handle) {
+			return pDescriptor;
+		}
+	}
+	return nullptr;
 } // getByHandle
 
 
@@ -113,8 +151,8 @@ void BLEDescriptorMap::handleGATTServerEvent(
 		T_SERVER_ID service_id,
 	    void *p_datas) {
 	// Invoke the handler for every descriptor we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(service_id,p_datas);
+	for (BLEDescriptor* pDescriptor : m_descriptors) {
+		pDescriptor->handleGATTServerEvent(service_id,p_datas);
 	}
 } // handleGATTServerEvent
 
@@ -127,13 +165,13 @@ std::string BLEDescriptorMap::toString() {
 	std::string res;
 	char hex[5];
 	int count = 0;
-	for (auto &myPair : m_uuidMap) {
+	for (BLEDescriptor* pDescriptor : m_descriptors) {
 		if (count > 0) {res += "\n";}
-		snprintf(hex, sizeof(hex), "%04x", myPair.first->getHandle());
+		snprintf(hex, sizeof(hex), "%04x", pDescriptor->getHandle());
 		count++;
 		res += "handle: 0x";
 		res += hex;
-		res += ", uuid: " + myPair.first->getUUID().toString();
+		res += ", uuid: " + pDescriptor->getUUID().toString();
 	}
 	return res;
 } // toString
\ No newline at end of file
@@ -203,6 +203,10 @@ BLEClient *BLEDevice::getClientByGattIf(uint16_t conn_id)
 	 * Bluetooth controller initialization
 	 */
         ble_init();
+        if (m_bleAdvertising != nullptr)
+        {
+            m_bleAdvertising->invalidate();  // A fresh stack holds none of the parameters pushed before.
+        }
         ble_server_init(BLE_SERVER_MAX_APPS);
         ble_client_init(BLE_CLIENT_MAX_APPS);
 
@@ -261,6 +265,12 @@ BLEClient *BLEDevice::getClientByGattIf(uint16_t conn_id)
     if (!initialized)
         return;
     ble_deinit();
+    initialized     = false;
+    ble_start_flags = false;
+    if (m_bleAdvertising != nullptr)
+    {
+        m_bleAdvertising->invalidate();  // The stack forgets the advertising parameters with it.
+    }
 }
 
 /**
@@ -315,12 +325,12 @@ BLEClient *BLEDevice::getClientByGattIf(uint16_t conn_id)
 
 /* multi connect support */
 /* requires a little more work */
-std::map<uint16_t, conn_status_t> BLEDevice::getPeerDevices(bool _client)
+std::map<uint16_t, conn_status_t> BLEDevice::getPeerDevices(bool /*_client*/)
 {
     return m_connectedClientsMap;
 }
 
-void BLEDevice::addPeerDevice(void *peer, bool _client, uint16_t conn_id)
+void BLEDevice::addPeerDevice(void *peer, bool /*_client*/, uint16_t conn_id)
 {
     conn_status_t status = {
         .peer_device = peer,
@@ -330,7 +340,7 @@ void BLEDevice::addPeerDevice(void *peer, bool _client, uint16_t conn_id)
     m_connectedClientsMap.insert(std::pair<uint16_t, conn_status_t>(conn_id, status));
 }
 
-void BLEDevice::updatePeerDevice(void *peer, bool _client, uint16_t conn_id)
+void BLEDevice::updatePeerDevice(void *peer, bool /*_client*/, uint16_t conn_id)
 {
     std::map<uint16_t, conn_status_t>::iterator it = m_connectedClientsMap.find(0xff);
     if (it != m_connectedClientsMap.end())
@@ -350,7 +360,7 @@ void BLEDevice::updatePeerDevice(void *peer, bool _client, uint16_t conn_id)
     }
 }
 
-void BLEDevice::removePeerDevice(uint16_t conn_id, bool _client)
+void BLEDevice::removePeerDevice(uint16_t conn_id, bool /*_client*/)
 {
     if (m_connectedClientsMap.find(conn_id) != m_connectedClientsMap.end())
         m_connectedClientsMap.erase(conn_id);
@@ -400,6 +410,10 @@ void BLEDevice::ble_handle_gap_msg(T_IO_MSG *p_gap_msg)
         RPC_DEBUG("GAP_MSG_LE_DEV_STATE_CHANGE\n\r");
         ble_dev_state_evt_handler(gap_msg.msg_data.gap_dev_state_change.new_state,
                                   gap_msg.msg_data.gap_dev_state_change.cause);
+        if (m_bleAdvertising != nullptr)
+        {
+            m_bleAdvertising->handleAdvStateChange(gap_msg.msg_data.gap_dev_state_change.new_state.gap_adv_state);
+        }
     }
     break;
     case GAP_MSG_LE_CONN_STATE_CHANGE:
@@ -511,6 +525,7 @@ void ble_conn_state_evt_handler(uint8_t conn_id, T_GAP_CONN_STATE new_state, uin
             {
                 BLEDevice::getServer()->getCallbacks()->onDisconnect(BLEDevice::getServer());
             }
+            BLEDevice::getServer()->removePeerDevice(conn_id, false);
             le_adv_start();
         }
 
@@ -549,7 +564,7 @@ void ble_conn_state_evt_handler(uint8_t conn_id, T_GAP_CONN_STATE new_state, uin
  * @param[in] cause GAP device state change cause
  * @return   void
  */
-void ble_dev_state_evt_handler(T_GAP_DEV_STATE new_state, uint16_t cause)
+void ble_dev_state_evt_handler(T_GAP_DEV_STATE new_state, uint16_t /*cause*/)
 {
     RPC_DEBUG("ble_dev_state_evt_handler: init state %d, adv state %d, cause 0x%x\n\r", new_state.gap_init_state, new_state.gap_adv_state, cause);
     if (ble_gap_dev_state.gap_init_state != new_state.gap_init_state)
@@ -614,7 +629,7 @@ void ble_dev_state_evt_handler(T_GAP_DEV_STATE new_state, uint16_t cause)
  * @param[in] cause Use this cause when status is GAP_CONN_PARAM_UPDATE_STATUS_FAIL
  * @return   void
  */
-void ble_param_update_evt_handler(uint8_t conn_id, uint8_t status, uint16_t cause)
+void ble_param_update_evt_handler(uint8_t conn_id, uint8_t status, uint16_t /*cause*/)
 {
     switch (status)
     {
@@ -654,10 +669,14 @@ void ble_param_update_evt_handler(uint8_t conn_id, uint8_t status, uint16_t caus
  */
 void ble_mtu_info_evt_handler(uint8_t conn_id, uint16_t mtu_size)
 {
-    if (BLEDevice::getClient()->getConnId() == conn_id)
+    if (BLEDevice::getClient() != nullptr && BLEDevice::getClient()->getConnId() == conn_id)
     {
         BLEDevice::getClient()->setMTU(mtu_size);
     }
+    if (BLEDevice::getServer() != nullptr)
+    {
+        BLEDevice::getServer()->updatePeerMTU(conn_id, mtu_size);
+    }
     RPC_DEBUG("app_handle_conn_mtu_info_evt: conn_id %d, mtu_size %d\n\r", conn_id, mtu_size);
 }
 
@@ -670,7 +689,7 @@ void ble_mtu_info_evt_handler(uint8_t conn_id, uint16_t mtu_size)
  * @param[in] cause Use this cause when new_state is GAP_AUTHEN_STATE_COMPLETE
  * @return   void
  */
-void ble_authen_state_evt_handler(uint8_t conn_id, uint8_t new_state, uint16_t cause)
+void ble_authen_state_evt_handler(uint8_t /*conn_id*/, uint8_t new_state, uint16_t cause)
 {
     RPC_DEBUG("app_handle_authen_state_evt:conn_id %d, cause 0x%x\n\r", conn_id, cause);
 
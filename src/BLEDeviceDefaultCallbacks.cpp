@@ -48,9 +48,19 @@ T_APP_RESULT BLEScan::gapCallbackDefault(uint8_t cb_type, void *p_cb_data) {
         case GAP_MSG_LE_SCAN_CMPL:
         {
             RPC_DEBUG("GAP_MSG_LE_SCAN_CMPL");
+            endScanPeriod();
+            m_semaphoreBatch.take("scanComplete");
+            flushBatch();
+            m_semaphoreBatch.give();
+            serviceErase();
+            m_mergeFlushRequested = false;
+            deliverPending(0, true);
             m_semaphoreScanEnd.give();
+            if (m_pRecordWriter != nullptr) {
+                m_pRecordWriter->flush();
+            }
              if(m_scanCompleteCB != nullptr) {
-                 m_scanCompleteCB(m_scanResults);
+                 m_scanCompleteCB(getResults());
              }
             break;
         }         
@@ -67,38 +77,209 @@ T_APP_RESULT BLEScan::gapCallbackDefault(uint8_t cb_type, void *p_cb_data) {
                             p_data->p_le_scan_info->rssi,
                             p_data->p_le_scan_info->data_len);
 			RPC_DEBUG("GAP_MSG_LE_SCAN_INFO:\r\n");
-            BLEAddress advertisedAddress(p_data->p_le_scan_info->bd_addr);			
-            bool found = false;
-			if (m_scanResults.m_vectorAdvertisedDevices.count(advertisedAddress.toString()) != 0) {
-				found = true;
-			}
-
-            if (found && !m_wantDuplicates) {  // If we found a previous entry AND we don't want duplicates, then we are done.
-				vTaskDelay(1);  // <--- allow to switch task in case we scan infinity and dont have new devices to report, or we are blocked here
-				break;
-			}
-
-			BLEAdvertisedDevice *advertisedDevice = new BLEAdvertisedDevice();		
-			advertisedDevice->setAddress(advertisedAddress);
-			advertisedDevice->setRSSI(p_data->p_le_scan_info->rssi);
-			advertisedDevice->parseAdvertisement(p_data);
-			advertisedDevice->setScan(this);
-			advertisedDevice->setAddressType(p_data->p_le_scan_info->remote_addr_type);
-			
-			if (!found) {   // If we have previously seen this device, don't record it again.
-				m_scanResults.m_vectorAdvertisedDevices.insert(std::pair<std::string, BLEAdvertisedDevice*>(advertisedAddress.toString(), advertisedDevice));
-			}			
-			
-            if (m_pAdvertisedDeviceCallbacks) {
-                m_pAdvertisedDeviceCallbacks->onResult(*advertisedDevice);
-            }
-			if(found)
-				delete advertisedDevice;
+            T_LE_SCAN_INFO *scan_info = p_data->p_le_scan_info;
+            BLEScanReport report;
+            report.address     = scan_info->bd_addr;
+            report.addressType = scan_info->remote_addr_type;
+            report.advType     = scan_info->adv_type;
+            report.rssi        = scan_info->rssi;
+            report.txPower     = BLE_SCAN_TX_POWER_NONE;
+            report.extended    = false;
+            report.sid         = 0;
+            report.dataLength  = (scan_info->data_len <= sizeof(scan_info->data)) ? scan_info->data_len : sizeof(scan_info->data);
+            report.data        = scan_info->data;
+            handleReport(&report);
+            break;
+        }
+#ifdef GAP_MSG_LE_EXT_ADV_REPORT_INFO
+        case GAP_MSG_LE_EXT_ADV_REPORT_INFO: {
+            T_LE_EXT_ADV_REPORT_INFO *ext_info = p_data->p_le_ext_adv_report_info;
+            RPC_DEBUG("GAP_MSG_LE_EXT_ADV_REPORT_INFO: event_type 0x%x, data_status %d, sid %d, rssi %d, data_len %d\r\n",
+                            ext_info->event_type, ext_info->data_status, ext_info->adv_sid, ext_info->rssi, ext_info->data_len);
+            BLEScanReport report;
+            report.address     = ext_info->bd_addr;
+            report.addressType = ext_info->addr_type;
+            if (ext_info->event_type & BLE_SCAN_EXT_EVT_SCAN_RESPONSE)
+                report.advType = GAP_ADV_EVT_TYPE_SCAN_RSP;
+            else if (ext_info->event_type & BLE_SCAN_EXT_EVT_DIRECTED)
+                report.advType = GAP_ADV_EVT_TYPE_DIRECTED;
+            else if (ext_info->event_type & BLE_SCAN_EXT_EVT_CONNECTABLE)
+                report.advType = GAP_ADV_EVT_TYPE_UNDIRECTED;
+            else if (ext_info->event_type & BLE_SCAN_EXT_EVT_SCANNABLE)
+                report.advType = GAP_ADV_EVT_TYPE_SCANNABLE;
+            else
+                report.advType = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+            report.rssi        = ext_info->rssi;
+            report.txPower     = ext_info->tx_power;
+            report.extended    = !(ext_info->event_type & BLE_SCAN_EXT_EVT_LEGACY);
+            report.sid         = ext_info->adv_sid;
+            report.dataLength  = ext_info->data_len;
+            report.data        = ext_info->p_data;
+            injectReport(&report, ext_info->data_status);
             break;
         }
+#endif
         default:
             RPC_DEBUG("gapCallbackDefault: unhandled cb_type 0x%x\r\n", cb_type);
             break;
     }
     return result;
 }
+
+/**
+ * @brief Process an advertising report.
+ * Every legacy and extended report received ends up here, once its payload is complete.
+ * @param [in] pReport The report.
+ */
+void BLEScan::handleReport(const BLEScanReport *pReport) {
+    m_periodReports++;
+    serviceErase();
+    if (m_mergeFlushRequested) {  // The merge was disabled, hand over the devices it still held back.
+        m_mergeFlushRequested = false;
+        deliverPending(0, true);
+    }
+    if (m_pScanFilter != nullptr && !m_pScanFilter->match(pReport)) {
+        return;
+    }
+    uint64_t key = BLEAddress::toKey(pReport->address, pReport->addressType);
+    if (m_pScheduler != nullptr && m_pScheduler->observe(key)) {  // Counted across periods, the results are cleared by every start().
+        m_periodNewDevices++;
+    }
+    if ((m_beaconDecoding && m_pAdvertisedDeviceCallbacks != nullptr) || m_pProximityTracker != nullptr) {
+        BLEBeaconFrame beacon;
+        if (BLEBeaconDecoder::decode(pReport->data, pReport->dataLength, &beacon)) {
+            if (m_pProximityTracker != nullptr) {
+                m_pProximityTracker->update(beacon, key, pReport->rssi, BLEFreeRTOS::getTimeSinceStart());
+            }
+            if (m_beaconDecoding && m_pAdvertisedDeviceCallbacks != nullptr) {
+                m_pAdvertisedDeviceCallbacks->onBeacon(beacon, key, pReport->rssi);
+            }
+        }
+    }
+
+    if (m_streaming) {  // Hand the raw report to the application task, nothing is recorded here.
+        uint32_t now = BLEFreeRTOS::getTimeSinceStart();
+        if (m_duplicateFilterEnabled &&
+            !m_pDuplicateFilter.load()->update(key, pReport->advType == GAP_ADV_EVT_TYPE_SCAN_RSP,
+                pReport->data, pReport->dataLength, pReport->rssi, now)) {
+            return;
+        }
+        BLEScanRecord record;
+        makeRecord(pReport, now, &record);
+        m_pRecordStream.load()->push(&record);
+        if (m_pRecordWriter != nullptr) {
+            m_pRecordWriter->write(&record);
+        }
+        return;
+    }
+
+    uint32_t now = BLEFreeRTOS::getTimeSinceStart();
+    m_scanResults.reclaim(&m_devicePool);  // Records that snapshots held on to, once they are gone.
+    if (m_cacheEnabled) {
+        evictCache(now, false);
+    }
+    bool scanResponse = (pReport->advType == GAP_ADV_EVT_TYPE_SCAN_RSP);
+    int index = m_scanResults.findIndex(key);
+    bool found = (index >= 0);
+    if (found) {
+        m_scanResults.touch(index, now, pReport->rssi, scanResponse);
+    }
+
+    if (m_mergeEnabled && m_batchSize == 0) {
+        deliverPending(now, false);
+        if (found) {
+            const BLEAdvertisedDevice *storedDevice = m_scanResults.getDevices()[index];
+            if (!storedDevice->m_delivered) {  // The other half is still outstanding, complete the record instead of reporting it.
+                BLEAdvertisedDevice *mergedDevice = cloneRecord(index);
+                if (mergedDevice == nullptr) {
+                    return;
+                }
+                mergedDevice->mergeReport(pReport);
+                mergedDevice->setRSSI(pReport->rssi);
+                mergedDevice->m_delivered = isMergeComplete(mergedDevice);
+                publishRecord(index, mergedDevice);
+                exportReport(pReport, now);
+                if (mergedDevice->m_delivered) {
+                    deliverDevice(mergedDevice);
+                }
+                return;
+            }
+            if (scanResponse ? !storedDevice->m_haveScanResponse : !storedDevice->m_haveAdvData) {  // A half that arrived after the timeout.
+                BLEAdvertisedDevice *mergedDevice = cloneRecord(index);
+                if (mergedDevice != nullptr) {
+                    mergedDevice->setPayload(scanResponse, pReport->data, pReport->dataLength);
+                    publishRecord(index, mergedDevice);
+                }
+            }
+        }
+    }
+
+    if (m_duplicateFilterEnabled) {  // Repeats are reported only when something changed.
+        if (!m_pDuplicateFilter.load()->update(key, scanResponse, pReport->data, pReport->dataLength,
+                pReport->rssi, now) && found) {
+            return;
+        }
+    } else if (found && !m_wantDuplicates) {  // If we found a previous entry AND we don't want duplicates, then we are done.
+		vTaskDelay(1);  // <--- allow to switch task in case we scan infinity and dont have new devices to report, or we are blocked here
+		return;
+	}
+
+    if (m_batchSize != 0) {  // Buffer the report for onResults(), a known device needs no further work.
+        m_semaphoreBatch.take("handleReport");  // Shared with the batch task, which checks the delay.
+        if (m_flushRequested) {
+            flushBatch();
+        }
+        if (m_batchCount == 0) {
+            m_batchStart = now;
+        }
+        makeRecord(pReport, now, &m_pBatch[m_batchCount]);
+        if (m_pRecordWriter != nullptr) {
+            m_pRecordWriter->write(&m_pBatch[m_batchCount]);
+        }
+        if (++m_batchCount >= m_batchSize) {
+            flushBatch();
+        }
+        m_semaphoreBatch.give();
+        if (found) {
+            return;
+        }
+    }
+
+	BLEAdvertisedDevice *advertisedDevice = m_devicePool.acquire();
+	if (advertisedDevice == nullptr) {  // Every record is in use, drop the advertisement.
+		return;
+	}
+	advertisedDevice->setScan(this);  // Gives the device access to the payload pool.
+	if (m_mergeEnabled && found) {  // Start from the merged record, then apply this report.
+		*advertisedDevice = *m_scanResults.getDevices()[index];
+		advertisedDevice->mergeReport(pReport);
+	} else {
+		advertisedDevice->clear();
+		advertisedDevice->mergeReport(pReport);
+	}
+	advertisedDevice->setRSSI(pReport->rssi);
+	advertisedDevice->setAddressType((T_GAP_REMOTE_ADDR_TYPE)pReport->addressType);
+
+	bool hold = m_mergeEnabled && m_batchSize == 0 && !found && !isMergeComplete(advertisedDevice);
+	advertisedDevice->m_delivered = !hold;  // Recorded devices are not changed any more.
+	bool stored = false;
+	if (!found) {   // If we have previously seen this device, don't record it again.
+		if (m_cacheEnabled) {
+			evictCache(now, true);
+		}
+		stored = m_scanResults.insert(key, advertisedDevice, now, pReport->rssi, scanResponse);
+	}
+
+    if (m_batchSize == 0) {
+        exportReport(pReport, now);
+    }
+    if (hold && stored) {
+        holdDevice(key, now);  // Reported once the scan response arrives or the merge times out.
+        return;
+    }
+    if (m_pAdvertisedDeviceCallbacks && m_batchSize == 0) {
+        m_pAdvertisedDeviceCallbacks->onResult(*advertisedDevice);
+    }
+	if (!stored)
+		m_devicePool.release(advertisedDevice);
+} // handleReport
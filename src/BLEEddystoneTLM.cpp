@@ -53,7 +53,7 @@ uint32_t BLEEddystoneTLM::getTime() {
 std::string BLEEddystoneTLM::toString() {
   std::string out = "";
   uint32_t rawsec = ENDIAN_CHANGE_U32(m_eddystoneData.tmil);
-  char val[6];
+  char val[12];
 
   out += "Version " + m_eddystoneData.version;
   out += "\n";
@@ -66,25 +66,25 @@ std::string BLEEddystoneTLM::toString() {
   out += ".0 °C\n";
 
   out += "Adv. Count ";
-  snprintf(val, sizeof(val), "%lu", ENDIAN_CHANGE_U32(m_eddystoneData.advCount));
+  snprintf(val, sizeof(val), "%lu", (unsigned long)ENDIAN_CHANGE_U32(m_eddystoneData.advCount));
   out += val;
   out += "\n";
 
   out += "Time ";
 
-  snprintf(val, sizeof(val), "%04lu", rawsec / 864000);
+  snprintf(val, sizeof(val), "%04lu", (unsigned long)(rawsec / 864000));
   out += val;
   out += ".";
 
-  snprintf(val, sizeof(val), "%02lu", (rawsec / 36000) % 24);
+  snprintf(val, sizeof(val), "%02lu", (unsigned long)(rawsec / 36000) % 24);
   out += val;
   out += ":";
 
-  snprintf(val, sizeof(val), "%02lu", (rawsec / 600) % 60);
+  snprintf(val, sizeof(val), "%02lu", (unsigned long)(rawsec / 600) % 60);
   out += val;
   out += ":";
 
-  snprintf(val, sizeof(val), "%02lu", (rawsec / 10) % 60);
+  snprintf(val, sizeof(val), "%02lu", (unsigned long)(rawsec / 10) % 60);
   out += val;
   out += "\n";
 
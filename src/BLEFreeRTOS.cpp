@@ -48,7 +48,7 @@ uint32_t BLEFreeRTOS::getTimeSinceStart()
  * @param [in] owner A debug tag.
  * @return The value associated with the semaphore.
  */
-uint32_t BLEFreeRTOS::Semaphore::wait(std::string owner)
+uint32_t BLEFreeRTOS::Semaphore::wait(std::string /*owner*/)
 {
 	xSemaphoreTake(m_semaphore, portMAX_DELAY);
 	xSemaphoreGive(m_semaphore);
@@ -62,7 +62,7 @@ uint32_t BLEFreeRTOS::Semaphore::wait(std::string owner)
  * @param [in] timeoutMs timeout to wait in ms.
  * @return True if we took the semaphore within timeframe.
  */
-bool BLEFreeRTOS::Semaphore::timedWait(std::string owner, uint32_t timeoutMs)
+bool BLEFreeRTOS::Semaphore::timedWait(std::string /*owner*/, uint32_t timeoutMs)
 {
 	auto ret = pdTRUE;
 	ret = xSemaphoreTake(m_semaphore, timeoutMs);
@@ -151,7 +151,7 @@ std::string BLEFreeRTOS::Semaphore::toString()
 {
 	char hex[9];
 	std::string res = "name: " + m_name + " (0x";
-	snprintf(hex, sizeof(hex), "%08x", (unsigned int)m_semaphore);
+	snprintf(hex, sizeof(hex), "%08x", (unsigned int)(uintptr_t)m_semaphore);
 	res += hex;
 	res += "), owner: " + m_owner;
 	return res;
@@ -0,0 +1,324 @@
+/*
+ * BLEProximityTracker.cpp
+ *
+ *  Filters beacon RSSI, estimates distance and reports zone changes.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "BLEProximityTracker.h"
+#include "BLEAddress.h"
+
+BLEProximityTracker::BLEProximityTracker() {
+	m_droppedCount = 0;
+	m_nearCm       = 100;
+	m_farCm        = 500;
+	m_hysteresis   = 20;
+	m_timeout      = 10000;
+	m_exponent     = 2.0f;
+	m_pCallbacks   = nullptr;
+	updateThresholds();
+	clear();
+} // BLEProximityTracker
+
+/**
+ * @brief Set the receiver of zone events.
+ * @param [in] pCallbacks The call backs, or nullptr for none.
+ */
+void BLEProximityTracker::setCallbacks(BLEProximityCallbacks* pCallbacks) {
+	m_pCallbacks = pCallbacks;
+} // setCallbacks
+
+/**
+ * @brief Set the zone boundaries.
+ * @param [in] nearMeters Beacons closer than this are in the near zone.
+ * @param [in] farMeters Beacons closer than this are in the far zone, further ones are out of range.
+ * @param [in] hysteresisPercent How far past a boundary, in percent of it, a beacon must be to change zone.
+ */
+void BLEProximityTracker::setZones(float nearMeters, float farMeters, uint8_t hysteresisPercent) {
+	if (farMeters < nearMeters) {
+		farMeters = nearMeters;
+	}
+	m_nearCm     = (nearMeters * 100 < 65535) ? (uint16_t)(nearMeters * 100) : 65535;
+	m_farCm      = (farMeters * 100 < 65535) ? (uint16_t)(farMeters * 100) : 65535;
+	m_hysteresis = (hysteresisPercent < 100) ? hysteresisPercent : 99;
+	updateThresholds();
+} // setZones
+
+/**
+ * @brief Set how long a beacon may go unheard before it exits.
+ * @param [in] timeoutMs The timeout in milliseconds.
+ */
+void BLEProximityTracker::setTimeout(uint32_t timeoutMs) {
+	m_timeout = timeoutMs;
+} // setTimeout
+
+/**
+ * @brief Set the path loss exponent of the environment.
+ * 2 is free space, indoor environments are typically between 2.5 and 4.
+ * @param [in] exponent The path loss exponent.
+ */
+void BLEProximityTracker::setPathLossExponent(float exponent) {
+	m_exponent = (exponent > 0) ? exponent : 2.0f;
+	updateThresholds();
+} // setPathLossExponent
+
+/**
+ * @brief Get the path loss at a distance, relative to the loss at 1 m.
+ * @param [in] cm The distance in cm.
+ * @param [in] exponent The path loss exponent.
+ * @return The path loss in 1/16 dB.
+ */
+static int32_t pathLoss(uint32_t cm, float exponent) {
+	return (int32_t)lroundf(160.0f * exponent * log10f((cm != 0) ? cm / 100.0f : 0.001f));
+} // pathLoss
+
+/**
+ * @brief Convert the zone boundaries into path loss thresholds.
+ * In the log-distance model a beacon at d meters is received 10 * n * log10(d) dB below its calibrated
+ * power, so comparing that loss against the loss at each boundary is the same as comparing distances.
+ */
+void BLEProximityTracker::updateThresholds() {
+	m_nearEnter = pathLoss((uint32_t)m_nearCm * (100 - m_hysteresis) / 100, m_exponent);
+	m_nearLeave = pathLoss((uint32_t)m_nearCm * (100 + m_hysteresis) / 100, m_exponent);
+	m_farEnter  = pathLoss((uint32_t)m_farCm * (100 - m_hysteresis) / 100, m_exponent);
+	m_farLeave  = pathLoss((uint32_t)m_farCm * (100 + m_hysteresis) / 100, m_exponent);
+} // updateThresholds
+
+/**
+ * @brief Estimate the distance of a transmitter.
+ * @param [in] rssiAverage The received power in 1/16 dBm.
+ * @param [in] txPower The calibrated received power at 1 m.
+ * @param [in] exponent The path loss exponent.
+ * @return The distance in meters.
+ */
+float BLEProximityTracker::estimateDistance(int16_t rssiAverage, int8_t txPower, float exponent) {
+	return powf(10.0f, (txPower - rssiAverage / 16.0f) / (10.0f * exponent));
+} // estimateDistance
+
+/**
+ * @brief Estimate the distance of a tracked beacon from its filtered RSSI.
+ * @param [in] beacon The beacon, as returned by find() or getBeacons() or passed to onZoneEvent().
+ * @return The distance in meters.
+ */
+float BLEProximityTracker::getDistance(const BLEProximityBeacon& beacon) {
+	return estimateDistance(beacon.rssiAverage, beacon.txPower, m_exponent);
+} // getDistance
+
+/**
+ * @brief Locate the index slot holding a beacon.
+ * @param [in] key The packed address key.
+ * @return The slot in m_index, or -1 if the beacon is not tracked.
+ */
+int BLEProximityTracker::findSlot(uint64_t key) {
+	uint32_t slot = BLEAddress::hashKey(key) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+	while (m_index[slot] != 0) {
+		if (m_beacons[m_index[slot] - 1].key == key) {
+			return slot;
+		}
+		slot = (slot + 1) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+	}
+	return -1;
+} // findSlot
+
+/**
+ * @brief Find a tracked beacon.
+ * @param [in] key The packed address and address type of the beacon.
+ * @return The beacon, or nullptr if it is not tracked.
+ */
+const BLEProximityBeacon* BLEProximityTracker::find(uint64_t key) {
+	int slot = findSlot(key);
+	return (slot < 0) ? nullptr : &m_beacons[m_index[slot] - 1];
+} // find
+
+/**
+ * @brief Get the tracked beacons, getCount() of them in no particular order.
+ * The array changes as beacons are added and expired.
+ */
+const BLEProximityBeacon* BLEProximityTracker::getBeacons() {
+	return m_beacons;
+} // getBeacons
+
+uint16_t BLEProximityTracker::getCount() {
+	return m_count;
+} // getCount
+
+/**
+ * @brief Get the number of samples ignored because every entry was in use.
+ */
+uint32_t BLEProximityTracker::getDroppedCount() {
+	return m_droppedCount;
+} // getDroppedCount
+
+/**
+ * @brief Forget every beacon without reporting exits.
+ */
+void BLEProximityTracker::clear() {
+	memset(m_index, 0, sizeof(m_index));
+	m_count = 0;
+	m_sweep = 0;
+} // clear
+
+/**
+ * @brief Choose the zone for a path loss, given the current zone.
+ * @param [in] zone The current zone.
+ * @param [in] pathLoss The calibrated power less the filtered RSSI, in 1/16 dB.
+ * @return The new zone.
+ */
+uint8_t BLEProximityTracker::classify(uint8_t zone, int32_t pathLoss) {
+	switch (zone) {
+		case BLE_PROXIMITY_ZONE_NEAR:
+			if (pathLoss > m_farLeave) {
+				return BLE_PROXIMITY_ZONE_NONE;
+			}
+			return (pathLoss > m_nearLeave) ? BLE_PROXIMITY_ZONE_FAR : BLE_PROXIMITY_ZONE_NEAR;
+		case BLE_PROXIMITY_ZONE_FAR:
+			if (pathLoss > m_farLeave) {
+				return BLE_PROXIMITY_ZONE_NONE;
+			}
+			return (pathLoss < m_nearEnter) ? BLE_PROXIMITY_ZONE_NEAR : BLE_PROXIMITY_ZONE_FAR;
+		default:
+			if (pathLoss >= m_farEnter) {
+				return BLE_PROXIMITY_ZONE_NONE;
+			}
+			return (pathLoss < m_nearEnter) ? BLE_PROXIMITY_ZONE_NEAR : BLE_PROXIMITY_ZONE_FAR;
+	}
+} // classify
+
+void BLEProximityTracker::notify(const BLEProximityBeacon* pBeacon, uint8_t event) {
+	if (m_pCallbacks != nullptr) {
+		m_pCallbacks->onZoneEvent(*pBeacon, event);
+	}
+} // notify
+
+/**
+ * @brief Feed an RSSI sample of a beacon.
+ * @param [in] key The packed address and address type of the beacon.
+ * @param [in] rssi The RSSI of the report.
+ * @param [in] txPower The calibrated RSSI at 1 m, or 0 to keep the last one known.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEProximityTracker::update(uint64_t key, int8_t rssi, int8_t txPower, uint32_t now) {
+	BLEProximityBeacon* pBeacon;
+	int slot = findSlot(key);
+	if (slot >= 0) {
+		pBeacon = &m_beacons[m_index[slot] - 1];
+		pBeacon->rssiAverage += ((int16_t)(rssi * 16) - pBeacon->rssiAverage) / (1 << BLE_PROXIMITY_EWMA_SHIFT);
+		pBeacon->count++;
+	} else {
+		if (m_count >= BLE_PROXIMITY_MAX_BEACONS) {
+			m_droppedCount++;
+			return;
+		}
+		uint32_t free = BLEAddress::hashKey(key) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+		while (m_index[free] != 0) {
+			free = (free + 1) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+		}
+		pBeacon = &m_beacons[m_count];
+		pBeacon->key         = key;
+		pBeacon->rssiAverage = rssi * 16;
+		pBeacon->txPower     = BLE_PROXIMITY_DEFAULT_TX_POWER;
+		pBeacon->zone        = BLE_PROXIMITY_ZONE_NONE;
+		pBeacon->count       = 1;
+		pBeacon->firstSeen   = now;
+		m_index[free] = ++m_count;
+	}
+	if (txPower != 0) {
+		pBeacon->txPower = txPower;
+	}
+	pBeacon->lastSeen = now;
+
+	uint8_t zone = classify(pBeacon->zone, pBeacon->txPower * 16 - pBeacon->rssiAverage);
+	if (zone != pBeacon->zone) {
+		uint8_t previous = pBeacon->zone;
+		pBeacon->zone = zone;
+		if (previous == BLE_PROXIMITY_ZONE_NONE) {
+			notify(pBeacon, BLE_PROXIMITY_EVENT_ENTER);
+		}
+		if (zone == BLE_PROXIMITY_ZONE_NONE) {
+			notify(pBeacon, BLE_PROXIMITY_EVENT_EXIT);
+		} else {
+			notify(pBeacon, (zone == BLE_PROXIMITY_ZONE_NEAR) ? BLE_PROXIMITY_EVENT_NEAR : BLE_PROXIMITY_EVENT_FAR);
+		}
+	}
+
+	// Check one other beacon for expiry, so stale entries are reclaimed without a full sweep.
+	if (m_count != 0) {
+		if (m_sweep >= m_count) {
+			m_sweep = 0;
+		}
+		expireAt(m_sweep++, now);
+	}
+} // update
+
+/**
+ * @brief Feed a decoded beacon frame.
+ * The calibrated power is taken from the frame; Eddystone-TLM frames carry none and keep the last known one.
+ * @param [in] frame The frame, as passed to BLEAdvertisedDeviceCallbacks::onBeacon().
+ * @param [in] key The packed address and address type of the beacon.
+ * @param [in] rssi The RSSI of the report.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEProximityTracker::update(const BLEBeaconFrame& frame, uint64_t key, int8_t rssi, uint32_t now) {
+	update(key, rssi, frame.txPower, now);
+} // update
+
+/**
+ * @brief Expire every beacon that has not been heard for the timeout.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEProximityTracker::expire(uint32_t now) {
+	uint16_t pos = 0;
+	while (pos < m_count) {
+		uint16_t count = m_count;
+		expireAt(pos, now);
+		if (m_count == count) {   // Otherwise another beacon was moved into pos.
+			pos++;
+		}
+	}
+} // expire
+
+/**
+ * @brief Expire a beacon if it has not been heard for the timeout.
+ * @param [in] pos The position of the beacon.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEProximityTracker::expireAt(uint16_t pos, uint32_t now) {
+	BLEProximityBeacon* pBeacon = &m_beacons[pos];
+	if (now - pBeacon->lastSeen < m_timeout) {
+		return;
+	}
+	if (pBeacon->zone != BLE_PROXIMITY_ZONE_NONE) {
+		pBeacon->zone = BLE_PROXIMITY_ZONE_NONE;
+		notify(pBeacon, BLE_PROXIMITY_EVENT_EXIT);
+	}
+	removeAt(findSlot(pBeacon->key));
+} // expireAt
+
+/**
+ * @brief Drop the beacon referenced by an index slot.
+ * The last beacon is moved into the hole and the probe sequence following the slot is shifted back.
+ * @param [in] slot The slot returned by findSlot().
+ */
+void BLEProximityTracker::removeAt(int slot) {
+	uint16_t pos  = m_index[slot] - 1;
+	uint16_t last = m_count - 1;
+	if (pos != last) {
+		m_index[findSlot(m_beacons[last].key)] = pos + 1;
+		m_beacons[pos] = m_beacons[last];
+	}
+	m_count--;
+
+	uint32_t hole = slot;
+	uint32_t next = (hole + 1) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+	while (m_index[next] != 0) {
+		uint32_t home = BLEAddress::hashKey(m_beacons[m_index[next] - 1].key) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+		// Move the entry back if its home slot does not lie cyclically in (hole, next].
+		if (((next - home) & (BLE_PROXIMITY_INDEX_SIZE - 1)) >= ((next - hole) & (BLE_PROXIMITY_INDEX_SIZE - 1))) {
+			m_index[hole] = m_index[next];
+			hole = next;
+		}
+		next = (next + 1) & (BLE_PROXIMITY_INDEX_SIZE - 1);
+	}
+	m_index[hole] = 0;
+} // removeAt
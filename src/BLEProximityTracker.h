@@ -0,0 +1,126 @@
+/*
+ * BLEProximityTracker.h
+ *
+ *  Filters beacon RSSI, estimates distance and reports zone changes.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEPROXIMITYTRACKER_H_
+#define COMPONENTS_CPP_UTILS_BLEPROXIMITYTRACKER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BLEBeaconDecoder.h"
+
+/// Maximum number of beacons tracked at once.
+#ifndef BLE_PROXIMITY_MAX_BEACONS
+#define BLE_PROXIMITY_MAX_BEACONS 256
+#endif
+
+/// Number of slots in the beacon index, must be a power of two larger than BLE_PROXIMITY_MAX_BEACONS.
+#ifndef BLE_PROXIMITY_INDEX_SIZE
+#define BLE_PROXIMITY_INDEX_SIZE  (BLE_PROXIMITY_MAX_BEACONS * 2)
+#endif
+
+/// Weight of a new RSSI sample is 1 / 2^BLE_PROXIMITY_EWMA_SHIFT.
+#ifndef BLE_PROXIMITY_EWMA_SHIFT
+#define BLE_PROXIMITY_EWMA_SHIFT  2
+#endif
+
+/// Calibrated RSSI at 1 m assumed for beacons that do not advertise one.
+#define BLE_PROXIMITY_DEFAULT_TX_POWER -59
+
+typedef enum {
+	BLE_PROXIMITY_ZONE_NONE = 0,    // Out of range.
+	BLE_PROXIMITY_ZONE_NEAR,
+	BLE_PROXIMITY_ZONE_FAR
+} BLEProximityZone;
+
+typedef enum {
+	BLE_PROXIMITY_EVENT_ENTER = 0,  // The beacon came within the far distance.
+	BLE_PROXIMITY_EVENT_EXIT,       // The beacon went beyond the far distance or was not heard for the timeout.
+	BLE_PROXIMITY_EVENT_NEAR,       // The beacon moved into the near zone.
+	BLE_PROXIMITY_EVENT_FAR         // The beacon moved into the far zone.
+} BLEProximityEvent;
+
+/**
+ * @brief The state of a tracked beacon.
+ */
+typedef struct {
+	uint64_t key;                   // Packed address and address type, see BLEAddress::toKey().
+	int16_t  rssiAverage;           // Filtered RSSI in 1/16 dBm.
+	int8_t   txPower;               // Calibrated RSSI at 1 m.
+	uint8_t  zone;                  // BLEProximityZone.
+	uint32_t count;                 // Samples received.
+	uint32_t firstSeen;             // Milliseconds, as passed to update().
+	uint32_t lastSeen;
+} BLEProximityBeacon;
+
+/**
+ * @brief Receives zone events from a BLEProximityTracker.
+ */
+class BLEProximityCallbacks {
+public:
+	virtual ~BLEProximityCallbacks() {}
+	/**
+	 * @brief Called when a beacon changes zone.
+	 * @param [in] beacon The beacon, after the sample that caused the event.
+	 * @param [in] event The BLEProximityEvent.
+	 */
+	virtual void onZoneEvent(const BLEProximityBeacon& beacon, uint8_t event) = 0;
+};
+
+/**
+ * @brief Tracks the distance of many beacons in fixed memory.
+ *
+ * Each sample costs one hash lookup, one filter step and a few integer compares.  The zone boundaries
+ * are converted once, by setZones() and setPathLossExponent(), into path loss thresholds of the
+ * log-distance model, so a sample is classified by comparing the filtered RSSI against the calibrated
+ * power of the beacon less a threshold.  The distance itself is only computed by getDistance().  Zone
+ * changes only happen once the beacon is a hysteresis margin past the boundary, so a beacon sitting
+ * on a boundary does not flap.  Beacons that are not heard for the timeout are expired a few at a
+ * time by update(), or all at once by expire().
+ */
+class BLEProximityTracker {
+public:
+	BLEProximityTracker();
+	void     setCallbacks(BLEProximityCallbacks* pCallbacks);
+	void     setZones(float nearMeters, float farMeters, uint8_t hysteresisPercent = 20);
+	void     setTimeout(uint32_t timeoutMs);
+	void     setPathLossExponent(float exponent);
+	void     update(uint64_t key, int8_t rssi, int8_t txPower, uint32_t now);
+	void     update(const BLEBeaconFrame& frame, uint64_t key, int8_t rssi, uint32_t now);
+	void     expire(uint32_t now);
+	void     clear();
+	const BLEProximityBeacon* find(uint64_t key);
+	const BLEProximityBeacon* getBeacons();
+	uint16_t getCount();
+	uint32_t getDroppedCount();
+	float    getDistance(const BLEProximityBeacon& beacon);
+	static float estimateDistance(int16_t rssiAverage, int8_t txPower, float exponent);
+
+private:
+	int      findSlot(uint64_t key);
+	void     removeAt(int slot);
+	void     expireAt(uint16_t pos, uint32_t now);
+	void     updateThresholds();
+	uint8_t  classify(uint8_t zone, int32_t pathLoss);
+	void     notify(const BLEProximityBeacon* pBeacon, uint8_t event);
+
+	BLEProximityBeacon     m_beacons[BLE_PROXIMITY_MAX_BEACONS];
+	uint16_t               m_index[BLE_PROXIMITY_INDEX_SIZE];   // Position in m_beacons + 1, 0 marks a free slot.
+	uint16_t               m_count;
+	uint16_t               m_sweep;                             // Next beacon checked for expiry.
+	uint32_t               m_droppedCount;
+	uint16_t               m_nearCm;
+	uint16_t               m_farCm;
+	uint8_t                m_hysteresis;                        // Percent of a boundary.
+	uint32_t               m_timeout;
+	float                  m_exponent;
+	int32_t                m_nearEnter;                         // Path loss thresholds in 1/16 dB, see updateThresholds().
+	int32_t                m_nearLeave;
+	int32_t                m_farEnter;
+	int32_t                m_farLeave;
+	BLEProximityCallbacks* m_pCallbacks;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEPROXIMITYTRACKER_H_ */
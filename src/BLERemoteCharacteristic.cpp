@@ -10,7 +10,7 @@
 #include "rpc_unified_log.h"
 
 BLERemoteCharacteristic::BLERemoteCharacteristic(
-    uint16_t    decl_handle,  
+    uint16_t    /*decl_handle*/,  
     uint16_t    properties,   
     uint16_t    value_handle,  
     BLEUUID     uuid,
@@ -218,14 +218,8 @@ void BLERemoteCharacteristic::registerForNotify(notify_callback notifyCallback,
  * @return The Remote descriptor (if present) or null if not present.
  */
 BLERemoteDescriptor* BLERemoteCharacteristic::getDescriptor(BLEUUID uuid) {
-	std::string v = uuid.toString();
 	retrieveDescriptors();
-	for (auto &myPair : m_descriptorMap) {
-		if (myPair.first == v) {			
-			return myPair.second;
-		}
-	}
-	return nullptr;
+	return m_descriptorIndex.get(uuid);
 } // getDescriptor
 
 /**
@@ -251,7 +245,7 @@ void BLERemoteCharacteristic::writeValue(std::string newValue, bool response) {
 } // writeValue
 
 
-void BLERemoteCharacteristic::writeValue(uint8_t* data, size_t length, bool response) {
+void BLERemoteCharacteristic::writeValue(uint8_t* data, size_t length, bool /*response*/) {
 	// Check to see that we are connected.
 	if (!getRemoteService()->getClient()->isConnected()) {
 		return;
@@ -302,15 +296,16 @@ void BLERemoteCharacteristic::retrieveDescriptors() {
  * @return N/A.
  */
 void BLERemoteCharacteristic::removeDescriptors() {
-	// Iterate through all the descriptors releasing their storage and erasing them from the map.
+	// Release the storage of all the descriptors, then forget them.  Erasing while iterating would
+	// invalidate the iterator.
 	for (auto &myPair : m_descriptorMap) {
-	   m_descriptorMap.erase(myPair.first);
 	   delete myPair.second;
 	}
-	m_descriptorMap.clear();   // Technically not neeeded, but just to be sure.
+	m_descriptorMap.clear();
+	m_descriptorIndex.clear();
 } // removeCharacteristics
 
-T_APP_RESULT BLERemoteCharacteristic::clientCallbackDefault(T_CLIENT_ID client_id, uint8_t conn_id, void *p_data) {
+T_APP_RESULT BLERemoteCharacteristic::clientCallbackDefault(T_CLIENT_ID /*client_id*/, uint8_t /*conn_id*/, void *p_data) {
  
 	T_APP_RESULT result = APP_RESULT_SUCCESS;
     T_BLE_CLIENT_CB_DATA *p_ble_client_cb_data = (T_BLE_CLIENT_CB_DATA *)p_data;
@@ -349,6 +344,7 @@ T_APP_RESULT BLERemoteCharacteristic::clientCallbackDefault(T_CLIENT_ID client_i
 		    );  
 			RPC_DEBUG(pNewRemoteDescriptor->getUUID().toString().c_str());
 		    m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pNewRemoteDescriptor->getUUID().toString(), pNewRemoteDescriptor));
+		    m_descriptorIndex.insert(pNewRemoteDescriptor->getUUID(), pNewRemoteDescriptor);
 			break;
         }
         case DISC_RESULT_CHAR_DESC_UUID128:
@@ -361,6 +357,7 @@ T_APP_RESULT BLERemoteCharacteristic::clientCallbackDefault(T_CLIENT_ID client_i
 		    );  
 			RPC_DEBUG(pNewRemoteDescriptor->getUUID().toString().c_str());
 		    m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pNewRemoteDescriptor->getUUID().toString(), pNewRemoteDescriptor));
+		    m_descriptorIndex.insert(pNewRemoteDescriptor->getUUID(), pNewRemoteDescriptor);
 			break;
         }
         default:
@@ -6,6 +6,7 @@
 #include "BLEUUID.h"
 #include "BLEFreeRTOS.h"
 #include "BLERemoteDescriptor.h"
+#include "BLEUUIDIndex.h"
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
 
@@ -71,6 +72,7 @@ private:
 	bool              m_haveDescriptor;
 	
 	std::map<std::string, BLERemoteDescriptor*> m_descriptorMap;
+	BLEUUIDIndex<BLERemoteDescriptor>           m_descriptorIndex;
 	BLEFreeRTOS::Semaphore m_semaphoreReadCharEvt  = BLEFreeRTOS::Semaphore("ReadCharEvt");
 	BLEFreeRTOS::Semaphore  m_semaphoreRegForNotifyEvt  = BLEFreeRTOS::Semaphore("RegForNotifyEvt");
 	BLEFreeRTOS::Semaphore m_semaphoregetdescEvt = BLEFreeRTOS::Semaphore("getDescriptor");
@@ -57,7 +57,7 @@ BLERemoteCharacteristic* BLERemoteDescriptor::getRemoteCharacteristic() {
 } // getRemoteCharacteristic
 
 
-void BLERemoteDescriptor::writeValue(uint8_t* data, size_t length, bool response) {
+void BLERemoteDescriptor::writeValue(uint8_t* data, size_t length, bool /*response*/) {
 	// Check to see that we are connected.
 	if (!getRemoteCharacteristic()->getRemoteService()->getClient()->isConnected()) {
 		return;
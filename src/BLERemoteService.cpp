@@ -97,14 +97,8 @@ BLERemoteCharacteristic* BLERemoteService::getCharacteristic(BLEUUID uuid) {
 	if (!m_haveCharacteristics) {
 		retrieveCharacteristics();
 	}
-	std::string v = uuid.toString();
-	for (auto &myPair : m_characteristicMap) {
-		if (myPair.first == v) {
-			return myPair.second;
-		}
-	}
 	// throw new BLEUuidNotFoundException();  // <-- we dont want exception here, which will cause app crash, we want to search if any characteristic can be found one after another
-	return nullptr;
+	return m_characteristicIndex.get(uuid);
 } // getCharacteristic
 
 /**
@@ -138,7 +132,7 @@ std::map<uint16_t, BLERemoteCharacteristic*>* BLERemoteService::getCharacteristi
 /**
  * @brief This function is designed to get characteristics map when we have multiple characteristics with the same UUID
  */
-void BLERemoteService::getCharacteristics(std::map<uint16_t, BLERemoteCharacteristic*>* pCharacteristicMap) {
+void BLERemoteService::getCharacteristics(std::map<uint16_t, BLERemoteCharacteristic*>* /*pCharacteristicMap*/) {
 	// pCharacteristicMap = &m_characteristicMapByHandle;
 }  // Get the characteristics map.
 
@@ -164,15 +158,13 @@ void BLERemoteService::retrieveCharacteristics() {
  * @return N/A.
  */
 void BLERemoteService::removeCharacteristics() {
-	for (auto &myPair : m_characteristicMap) {
-	   delete myPair.second;
-	   //m_characteristicMap.erase(myPair.first);  // Should be no need to delete as it will be deleted by the clear
-	}
-	m_characteristicMap.clear();   // Clear the map
+	// Every characteristic is in the map by handle, the other maps hold the same pointers.
 	for (auto &myPair : m_characteristicMapByHandle) {
 	   delete myPair.second;
 	}
 	m_characteristicMapByHandle.clear();   // Clear the map
+	m_characteristicMap.clear();
+	m_characteristicIndex.clear();
 } // removeCharacteristics
 
 /**
@@ -252,7 +244,8 @@ T_APP_RESULT BLERemoteService::clientCallbackDefault(
 			this
 		    ); 			
             m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pNewRemoteCharacteristic->getUUID().toString(), pNewRemoteCharacteristic));
-		    m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(disc_data->decl_handle, pNewRemoteCharacteristic));					           
+		    m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(disc_data->decl_handle, pNewRemoteCharacteristic));
+		    m_characteristicIndex.insert(uuid, pNewRemoteCharacteristic);
             break;
         }
         case DISC_RESULT_CHAR_UUID128:
@@ -269,7 +262,8 @@ T_APP_RESULT BLERemoteService::clientCallbackDefault(
 		    ); 
 			
             m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pNewRemoteCharacteristic->getUUID().toString(), pNewRemoteCharacteristic));
-		    m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(disc_data->decl_handle, pNewRemoteCharacteristic));           
+		    m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(disc_data->decl_handle, pNewRemoteCharacteristic));
+		    m_characteristicIndex.insert(uuid, pNewRemoteCharacteristic);
             break;
         }
         default:
@@ -7,6 +7,7 @@
 #include "BLEUUID.h"
 #include "FreeRTOS.h"
 #include "BLERemoteCharacteristic.h"
+#include "BLEUUIDIndex.h"
 typedef uint8_t T_CLIENT_ID;
 
 class BLEClient;
@@ -52,6 +53,7 @@ private:
 
 	std::map<std::string, BLERemoteCharacteristic*> m_characteristicMap;
 	std::map<uint16_t, BLERemoteCharacteristic*> m_characteristicMapByHandle;
+	BLEUUIDIndex<BLERemoteCharacteristic> m_characteristicIndex;
 	BLEFreeRTOS::Semaphore m_semaphoregetchaEvt = BLEFreeRTOS::Semaphore("getCharacteristic");
 
   	T_APP_RESULT   clientCallbackDefault(T_CLIENT_ID client_id, uint8_t conn_id, void *p_dat);
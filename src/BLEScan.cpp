@@ -18,6 +18,10 @@
 
 BLEScan::BLEScan()
 {
+	m_batchTaskActive.store(false);
+	m_pExtended.store(nullptr);
+	m_pDuplicateFilter.store(nullptr);
+	m_pRecordStream.store(nullptr);
 } // BLEScan
 
 /**
@@ -99,7 +103,7 @@ BLEScanResults BLEScan::start(uint32_t duration, bool is_continue)
 	{
 		m_semaphoreScanEnd.wait("start"); // Wait for the semaphore to release.
 	}
-	return m_scanResults;
+	return getResults();
 } // start
 
 /**
@@ -121,14 +125,33 @@ bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), b
 	}
 	//  if we are connecting to devices that are advertising even after being connected, multiconnecting peripherals
 	//  then we should not clear map or we will connect the same device few times
+	m_scanResults.reclaim(&m_devicePool);
+	serviceErase();
 	if (!is_continue)
 	{
-		for (auto _dev : m_scanResults.m_vectorAdvertisedDevices)
+		m_scanResults.clear(&m_devicePool);
+		BLEScanDuplicateFilter *pDuplicateFilter = m_pDuplicateFilter.load();
+		if (pDuplicateFilter != nullptr)
 		{
-			delete _dev.second;
+			pDuplicateFilter->clear();
 		}
-		m_scanResults.m_vectorAdvertisedDevices.clear();
+		m_pendingCount = 0;
+		m_mergeFlushRequested = false;
 	}
+	BLEScanExtendedBuffers *pExtended = m_pExtended.load();
+	for (int i = 0; pExtended != nullptr && i < BLE_SCAN_EXT_REASSEMBLY; i++)
+	{
+		pExtended->reassembly[i].busy = false;
+	}
+	if (m_pScheduler != nullptr)
+	{
+		applyScanParams(m_pScheduler->getParams());
+	}
+	m_periodStart      = BLEFreeRTOS::getTimeSinceStart();
+	m_periodReports    = 0;
+	m_periodNewDevices = 0;
+	BLEScanRecordStream *pRecordStream = m_pRecordStream.load();
+	m_periodDropped    = (pRecordStream != nullptr) ? pRecordStream->getDroppedCount() : 0;
 	updateScanParams();
 	uint32_t m_duration = duration * 1000;
 	le_scan_timer_start(m_duration);
@@ -143,17 +166,63 @@ bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), b
 void BLEScan::stop()
 {
 	le_scan_stop();
+	m_flushRequested = true;   // Delivered from the batch task, not from the caller's.
 	m_semaphoreScanEnd.give();
 	RPC_DEBUG("Level  BLEScan stop\n\r");
 } // stop
 
-// delete peer device from cache after disconnecting, it is required in case we are connecting to devices with not public address
+/**
+ * @brief Forget a recorded device, whatever its address type.
+ * Needed after disconnecting from a device with a non public address, so that a continued scan reports it again.
+ * The results belong to the scan task, so the device is removed there: on the next report, when the scan
+ * completes or when it is started again.
+ * @param [in] address The address of the device.
+ */
 void BLEScan::erase(BLEAddress address)
 {
-	BLEAdvertisedDevice *advertisedDevice = m_scanResults.m_vectorAdvertisedDevices.find(address.toString())->second;
-	m_scanResults.m_vectorAdvertisedDevices.erase(address.toString());
-	delete advertisedDevice;
-}
+	m_semaphoreErase.take("erase");
+	if (m_eraseCount < BLE_SCAN_ERASE_PENDING)
+	{
+		m_eraseKeys[m_eraseCount++] = address.toKey();
+	}
+	else
+	{
+		RPC_DEBUG("BLEScan erase: too many requests pending, %s is kept\n\r", address.toString().c_str());
+	}
+	m_semaphoreErase.give();
+} // erase
+
+/**
+ * @brief Remove the devices erase() was asked to forget.
+ */
+void BLEScan::serviceErase()
+{
+	if (m_eraseCount == 0)
+	{
+		return;
+	}
+	m_semaphoreErase.take("serviceErase");
+	for (uint8_t i = 0; i < m_eraseCount; i++)
+	{
+		BLEAdvertisedDevice *advertisedDevice = m_scanResults.removeAddress(m_eraseKeys[i]);
+		if (advertisedDevice != nullptr)
+		{
+			m_scanResults.retire(advertisedDevice, &m_devicePool);
+		}
+	}
+	m_eraseCount = 0;
+	m_semaphoreErase.give();
+} // serviceErase
+
+/**
+ * @brief Get the pool that supplies the device records of this scan.
+ * The pool counters can be used to size BLE_SCAN_POOL_SIZE for a product.
+ * @return The device pool.
+ */
+BLEAdvertisedDevicePool *BLEScan::getDevicePool()
+{
+	return &m_devicePool;
+} // getDevicePool
 
 /**
  * @brief Set the call backs to be invoked.
@@ -167,44 +236,1425 @@ void BLEScan::setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks *pAdvert
 } // setAdvertisedDeviceCallbacks
 
 /**
- * @brief Return the count of devices found in the last scan.
- * @return The number of devices found in the last scan.
+ * @brief Set the filter applied to scan reports.
+ * Reports rejected by the filter are dropped before they are looked up, recorded or passed to the call backs.
+ * @param [in] pScanFilter The filter, or nullptr to accept every report.
  */
-int BLEScanResults::getCount()
+void BLEScan::setScanFilter(BLEScanFilter *pScanFilter)
 {
-	return m_vectorAdvertisedDevices.size();
-} // getCount
+	m_pScanFilter = pScanFilter;
+} // setScanFilter
 
 /**
- * @brief Return the specified device at the given index.
- * The index should be between 0 and getCount()-1.
- * @param [in] i The index of the device.
- * @return The device at the specified index.
+ * @brief Report repeated advertisements only when they carry something new.
+ * When enabled, a device already seen is reported again if its payload changed, its RSSI moved by more
+ * than the threshold or the refresh interval expired.  This takes the place of the wantDuplicates flag.
+ * The filter table, BLE_SCAN_DEDUP_SIZE entries of 24 bytes or 12 KB with the defaults, is allocated the
+ * first time the filter is enabled and kept from then on.
+ * @param [in] enable True to enable the duplicate filter.
+ * @param [in] rssiThreshold The RSSI change in dBm that triggers a new report.
+ * @param [in] refreshIntervalMs The time after which a device is reported again, 0 to disable.
  */
-BLEAdvertisedDevice BLEScanResults::getDevice(uint32_t i)
+void BLEScan::setDuplicateFilter(bool enable, uint8_t rssiThreshold, uint32_t refreshIntervalMs)
+{
+	BLEScanDuplicateFilter *pDuplicateFilter = m_pDuplicateFilter.load();
+	if (pDuplicateFilter == nullptr)
+	{
+		if (!enable)
+		{
+			m_duplicateFilterEnabled = false;
+			return;
+		}
+		pDuplicateFilter = new BLEScanDuplicateFilter();
+		if (pDuplicateFilter == nullptr)
+		{
+			RPC_DEBUG("setDuplicateFilter: no memory for the filter table\n\r");
+			return;
+		}
+		m_pDuplicateFilter.store(pDuplicateFilter);
+	}
+	pDuplicateFilter->setThresholds(rssiThreshold, refreshIntervalMs);
+	m_duplicateFilterEnabled = enable;
+} // setDuplicateFilter
+
+/**
+ * @brief Get the duplicate filter, for example to read its counters.
+ * @return The duplicate filter, or nullptr if it was never enabled.
+ */
+BLEScanDuplicateFilter *BLEScan::getDuplicateFilter()
+{
+	return m_pDuplicateFilter.load();
+} // getDuplicateFilter
+
+/**
+ * @brief Select streaming mode.
+ * In streaming mode every report that passes the filters is copied into a BLEScanRecord and pushed to
+ * the record stream.  No device is recorded in the scan results and the advertised device call backs
+ * are not invoked, the application reads the records from its own task with getRecordStream()->pop().
+ * The stream, BLE_SCAN_STREAM_SIZE records, is allocated the first time streaming is selected and kept
+ * from then on.
+ * @param [in] streaming True to enable streaming mode.
+ */
+void BLEScan::setStreaming(bool streaming)
+{
+	if (streaming && m_pRecordStream.load() == nullptr)
+	{
+		BLEScanRecordStream *pRecordStream = new BLEScanRecordStream();
+		if (pRecordStream == nullptr)
+		{
+			RPC_DEBUG("setStreaming: no memory for the record stream\n\r");
+			return;
+		}
+		m_pRecordStream.store(pRecordStream);
+	}
+	m_streaming = streaming;
+} // setStreaming
+
+bool BLEScan::isStreaming()
+{
+	return m_streaming;
+} // isStreaming
+
+/**
+ * @brief Get the stream the scan pushes records to in streaming mode.
+ * The stream has a single consumer; only one task may pop records from it.
+ * @return The record stream, or nullptr if streaming was never selected.
+ */
+BLEScanRecordStream *BLEScan::getRecordStream()
+{
+	return m_pRecordStream.load();
+} // getRecordStream
+
+/**
+ * @brief Export scan reports in binary form.
+ * Every report that is delivered, to the call backs or to the record stream, is also written to the writer.
+ * The pending frame is flushed when the scan completes.
+ * @param [in] pRecordWriter The writer, or nullptr to stop exporting.
+ */
+void BLEScan::setRecordWriter(BLEScanRecordWriter *pRecordWriter)
+{
+	m_pRecordWriter = pRecordWriter;
+} // setRecordWriter
+
+/**
+ * @brief Deliver scan reports in batches.
+ * Instead of calling onResult() with a device for every report, the scan copies the reports into a
+ * reusable buffer and calls onResults() once maxRecords have been collected, once the oldest record is
+ * maxDelayMs old, or when the scan completes or is stopped.  While batching, a task of its own checks
+ * the delay and delivers the records buffered when the scan is stopped or the batching changed, so
+ * onResults() is never called from the application's task.  Devices are still recorded in the scan
+ * results.
+ * The buffer, BLE_SCAN_BATCH_SIZE records, is allocated the first time batching is enabled and kept
+ * from then on.
+ * @param [in] maxRecords Records per batch, at most BLE_SCAN_BATCH_SIZE, or 0 to call onResult() again.
+ * @param [in] maxDelayMs Longest time a record waits in the buffer, 0 for no limit.
+ */
+void BLEScan::setBatchDelivery(uint16_t maxRecords, uint32_t maxDelayMs)
+{
+	if (maxRecords > BLE_SCAN_BATCH_SIZE)
+		maxRecords = BLE_SCAN_BATCH_SIZE;
+	if (maxRecords != 0 && m_pBatch == nullptr)
+	{
+		m_pBatch = new BLEScanRecord[BLE_SCAN_BATCH_SIZE];
+		if (m_pBatch == nullptr)
+		{
+			RPC_DEBUG("setBatchDelivery: no memory for the batch\n\r");
+			return;
+		}
+	}
+	if (m_batchCount != 0)
+	{
+		m_flushRequested = true;   // Records buffered under the old settings go out first.
+	}
+	m_batchDelay = maxDelayMs;
+	m_batchSize = maxRecords;
+	if (maxRecords != 0 && !m_batchTaskActive.exchange(true))
+	{
+		BLEFreeRTOS::startTask(batchTask, "BLEScanBatch", this);
+	}
+} // setBatchDelivery
+
+/**
+ * @brief Decode beacon frames on the scan path.
+ * Every report that passes the scan filter is checked for an iBeacon, Eddystone or AltBeacon frame,
+ * and the frames found are passed to BLEAdvertisedDeviceCallbacks::onBeacon().  Decoding does not
+ * allocate and works in every scan mode, including streaming.
+ * @param [in] enable True to decode beacon frames.
+ */
+void BLEScan::setBeaconDecoding(bool enable)
+{
+	m_beaconDecoding = enable;
+} // setBeaconDecoding
+
+/**
+ * @brief Feed the beacons received to a proximity tracker.
+ * Every beacon frame that passes the scan filter updates the tracker from the scan task, whether or
+ * not beacon decoding was enabled for the call backs.
+ * @param [in] pTracker The tracker, or nullptr to stop tracking.
+ */
+void BLEScan::setProximityTracker(BLEProximityTracker *pTracker)
+{
+	m_pProximityTracker = pTracker;
+} // setProximityTracker
+
+/**
+ * @brief Process an advertising report as if the stack had delivered it.
+ * Both the legacy and the extended advertising reports of the stack are passed through here, and it can
+ * be called directly to replay recorded reports or to test the scan without a radio.  Fragments of a
+ * chained extended payload, marked BLE_SCAN_DATA_MORE, are collected per address and advertising set
+ * until the last fragment arrives; up to BLE_SCAN_EXT_MAX_DATA bytes are kept.  The first report that is
+ * fragmented or larger than a legacy one allocates the buffers for this, see BLEScanExtendedBuffers.
+ * @param [in] pReport The report, the payload only has to stay valid for the call.
+ * @param [in] dataStatus BLE_SCAN_DATA_COMPLETE, BLE_SCAN_DATA_MORE or BLE_SCAN_DATA_TRUNCATED.
+ */
+void BLEScan::injectReport(const BLEScanReport *pReport, uint8_t dataStatus)
 {
-	uint32_t x = 0;
-	BLEAdvertisedDevice dev = *m_vectorAdvertisedDevices.begin()->second;
-	for (auto it = m_vectorAdvertisedDevices.begin(); it != m_vectorAdvertisedDevices.end(); it++)
+	if (dataStatus == BLE_SCAN_DATA_COMPLETE && pReport->dataLength <= BLE_SCAN_LEGACY_MAX_DATA && m_pExtended.load() == nullptr)
+	{
+		handleReport(pReport);
+		return;
+	}
+	BLEScanExtendedBuffers *pExtended = getExtendedBuffers();
+	if (pExtended == nullptr)
+	{
+		if (dataStatus != BLE_SCAN_DATA_MORE)
+		{
+			handleReport(pReport);     // Truncated to the legacy size by the device record.
+		}
+		return;
+	}
+
+	uint64_t key = BLEAddress::toKey(pReport->address, pReport->addressType);
+	int      slot = -1;
+	for (int i = 0; i < BLE_SCAN_EXT_REASSEMBLY; i++)
 	{
-		dev = *it->second;
-		if (x == i)
+		if (pExtended->reassembly[i].busy && pExtended->reassembly[i].key == key && pExtended->reassembly[i].sid == pReport->sid)
+		{
+			slot = i;
 			break;
-		x++;
+		}
+	}
+	if (slot < 0 && dataStatus == BLE_SCAN_DATA_COMPLETE)
+	{
+		handleReport(pReport);
+		return;
+	}
+	if (slot < 0)
+	{
+		slot = 0;                  // Without a free buffer the payload in the first one is given up.
+		for (int i = 0; i < BLE_SCAN_EXT_REASSEMBLY; i++)
+		{
+			if (!pExtended->reassembly[i].busy)
+			{
+				slot = i;
+				break;
+			}
+		}
+		pExtended->reassembly[slot].key    = key;
+		pExtended->reassembly[slot].sid    = pReport->sid;
+		pExtended->reassembly[slot].busy   = true;
+		pExtended->reassembly[slot].length = 0;
 	}
-	return dev;
-}
 
-BLEScanResults BLEScan::getResults()
+	uint16_t length = pReport->dataLength;
+	if (length > BLE_SCAN_EXT_MAX_DATA - pExtended->reassembly[slot].length)
+	{
+		length = BLE_SCAN_EXT_MAX_DATA - pExtended->reassembly[slot].length;
+	}
+	memcpy(pExtended->reassembly[slot].data + pExtended->reassembly[slot].length, pReport->data, length);
+	pExtended->reassembly[slot].length += length;
+	if (dataStatus == BLE_SCAN_DATA_MORE)
+	{
+		return;
+	}
+
+	BLEScanReport report = *pReport;
+	report.data = pExtended->reassembly[slot].data;
+	report.dataLength = pExtended->reassembly[slot].length;
+	pExtended->reassembly[slot].busy = false;
+	handleReport(&report);
+} // injectReport
+
+/**
+ * @brief Get the buffers for extended payloads, allocating them the first time.
+ * Only called from the task processing reports.
+ * @return The buffers, or nullptr if they could not be allocated.
+ */
+BLEScanExtendedBuffers *BLEScan::getExtendedBuffers()
 {
-	return m_scanResults;
-}
+	BLEScanExtendedBuffers *pExtended = m_pExtended.load();
+	if (pExtended == nullptr)
+	{
+		pExtended = new BLEScanExtendedBuffers();
+		if (pExtended == nullptr)
+		{
+			return nullptr;
+		}
+		for (int i = 0; i < BLE_SCAN_EXT_REASSEMBLY; i++)
+		{
+			pExtended->reassembly[i].busy = false;
+		}
+		m_pExtended.store(pExtended);
+	}
+	return pExtended;
+} // getExtendedBuffers
 
-void BLEScan::clearResults()
+/**
+ * @brief Get the pool holding the payloads of devices that do not fit in their record.
+ * @return The payload pool, or nullptr until the first extended payload was received.
+ */
+BLEScanPayloadPool *BLEScan::getPayloadPool()
+{
+	BLEScanExtendedBuffers *pExtended = m_pExtended.load();
+	return (pExtended != nullptr) ? &pExtended->payloadPool : nullptr;
+} // getPayloadPool
+
+/**
+ * @brief Merge scan responses into the advertisement they belong to.
+ * With active scanning a device sends its primary advertisement and a scan response as two reports.
+ * When merging, a newly found device that can be scanned is held back until its other half arrives,
+ * or until timeoutMs have passed (checked as reports arrive and when the scan completes), and onResult()
+ * is called once with both payloads.  Later reports of the device are delivered with the last payload
+ * of the other half as well.  Batched delivery and streaming receive the raw reports and are not affected.
+ * Disabling the merge does not call back from the caller's task: the devices still held back are delivered
+ * from the scan task, on the next report or when the scan completes.
+ * @param [in] enable True to merge scan responses.
+ * @param [in] timeoutMs Longest time a new device is held back waiting for its other half.
+ */
+void BLEScan::setScanResponseMerge(bool enable, uint32_t timeoutMs)
+{
+	if (!enable)
+	{
+		m_mergeFlushRequested = true;
+	}
+	m_mergeEnabled = enable;
+	m_mergeTimeout = timeoutMs;
+} // setScanResponseMerge
+
+/**
+ * @brief Check whether a device has every half it is going to get.
+ * @param [in] pDevice The device.
+ * @return True if the device can be delivered.
+ */
+bool BLEScan::isMergeComplete(const BLEAdvertisedDevice *pDevice)
+{
+	if (!pDevice->m_haveAdvData)
+	{
+		return false;
+	}
+	bool scannable = (pDevice->_advType == GAP_ADV_EVT_TYPE_UNDIRECTED || pDevice->_advType == GAP_ADV_EVT_TYPE_SCANNABLE);
+	return pDevice->m_haveScanResponse || !scannable || m_scanMode != GAP_SCAN_MODE_ACTIVE;
+} // isMergeComplete
+
+/**
+ * @brief Hold back a newly recorded device until it is complete.
+ * @param [in] key The packed address and address type of the device.
+ * @param [in] now The current time in milliseconds.
+ */
+void BLEScan::holdDevice(uint64_t key, uint32_t now)
+{
+	if (m_pendingCount == BLE_SCAN_MERGE_PENDING)   // Make room by giving up on the oldest device.
+	{
+		m_pendingDeadlines[m_pendingHead] = now;
+		deliverPending(now, false);
+	}
+	uint8_t tail = (m_pendingHead + m_pendingCount) % BLE_SCAN_MERGE_PENDING;
+	m_pendingKeys[tail] = key;
+	m_pendingDeadlines[tail] = now + m_mergeTimeout;
+	m_pendingCount++;
+} // holdDevice
+
+/**
+ * @brief Deliver the held back devices whose merge timed out.
+ * Devices that were completed, evicted or erased in the meantime are skipped.
+ * @param [in] now The current time in milliseconds.
+ * @param [in] all True to deliver every held back device regardless of time.
+ */
+void BLEScan::deliverPending(uint32_t now, bool all)
+{
+	while (m_pendingCount != 0)
+	{
+		int  index    = m_scanResults.findIndex(m_pendingKeys[m_pendingHead]);
+		bool resolved = index < 0 || m_scanResults.getDevices()[index]->m_delivered;
+		if (!resolved && !all && (int32_t)(m_pendingDeadlines[m_pendingHead] - now) > 0)
+		{
+			break;
+		}
+		m_pendingHead = (m_pendingHead + 1) % BLE_SCAN_MERGE_PENDING;
+		m_pendingCount--;
+		if (resolved)   // Completed, evicted or erased before its deadline, it no longer holds back the next one.
+		{
+			continue;
+		}
+		BLEAdvertisedDevice *pDevice = cloneRecord(index);
+		if (pDevice != nullptr)
+		{
+			pDevice->m_delivered = true;
+			publishRecord(index, pDevice);
+		}
+		else   // Without a spare record it is reported as it is and may be reported again later.
+		{
+			pDevice = m_scanResults.getDevices()[index];
+		}
+		deliverDevice(pDevice);
+	}
+} // deliverPending
+
+/**
+ * @brief Report a recorded device to the call backs.
+ * @param [in] pDevice The device.
+ */
+void BLEScan::deliverDevice(BLEAdvertisedDevice *pDevice)
+{
+	if (m_pAdvertisedDeviceCallbacks != nullptr)
+	{
+		m_pAdvertisedDeviceCallbacks->onResult(*pDevice);
+	}
+} // deliverDevice
+
+/**
+ * @brief Copy a recorded device so that it can be updated.
+ * Recorded devices are never changed in place since snapshots may be reading them, the copy takes
+ * the place of the original with publishRecord().  An original a snapshot can read is retired, and
+ * only BLE_SCAN_POOL_RETIRED of them are, so that the pool can still fill the results.
+ * @param [in] index The position of the device.
+ * @return The copy, or nullptr if the device has to stay as it is for now.
+ */
+BLEAdvertisedDevice *BLEScan::cloneRecord(int index)
+{
+	if (m_devicePool.getRetiredCount() >= BLE_SCAN_POOL_RETIRED && m_scanResults.isShared(m_scanResults.getDevices()[index]))
+	{
+		return nullptr;
+	}
+	BLEAdvertisedDevice *pDevice = m_devicePool.acquire();
+	if (pDevice != nullptr)
+	{
+		*pDevice = *m_scanResults.getDevices()[index];
+	}
+	return pDevice;
+} // cloneRecord
+
+/**
+ * @brief Record an updated device in the place of the original.
+ * @param [in] index The position of the device.
+ * @param [in] pDevice The copy returned by cloneRecord().
+ */
+void BLEScan::publishRecord(int index, BLEAdvertisedDevice *pDevice)
+{
+	m_scanResults.retire(m_scanResults.replace(index, pDevice), &m_devicePool);
+} // publishRecord
+
+/**
+ * @brief Write a report to the record writer, if there is one.
+ * @param [in] pReport The report.
+ * @param [in] now The time the report was received.
+ */
+void BLEScan::exportReport(const BLEScanReport *pReport, uint32_t now)
+{
+	if (m_pRecordWriter == nullptr)
+	{
+		return;
+	}
+	BLEScanRecord record;
+	makeRecord(pReport, now, &record);
+	m_pRecordWriter->write(&record);
+} // exportReport
+
+/**
+ * @brief Hand the buffered records to the call backs and empty the buffer.
+ * Must be called with the batch semaphore taken.
+ */
+void BLEScan::flushBatch()
+{
+	m_flushRequested = false;
+	if (m_batchCount == 0)
+	{
+		return;
+	}
+	if (m_pAdvertisedDeviceCallbacks != nullptr)
+	{
+		m_pAdvertisedDeviceCallbacks->onResults(m_pBatch, m_batchCount);
+	}
+	m_batchCount = 0;
+} // flushBatch
+
+/**
+ * @brief Deliver batches that reached their delay, or that the application asked for, while batching.
+ * @param [in] pvParameters The scan.
+ */
+void BLEScan::batchTask(void *pvParameters)
+{
+	BLEScan *pScan = (BLEScan *)pvParameters;
+	for (;;)
+	{
+		pScan->m_semaphoreBatch.take("batchTask");
+		uint32_t now = BLEFreeRTOS::getTimeSinceStart();
+		uint32_t delay = pScan->m_batchDelay;
+		uint32_t wait = (delay != 0) ? delay : BLE_SCAN_BATCH_TICK;
+		if (pScan->m_flushRequested || (pScan->m_batchCount != 0 && delay != 0 && now - pScan->m_batchStart >= delay))
+		{
+			pScan->flushBatch();
+		}
+		else if (pScan->m_batchCount != 0 && delay != 0)
+		{
+			wait = delay - (now - pScan->m_batchStart);
+		}
+		pScan->m_semaphoreBatch.give();
+
+		if (pScan->m_batchSize == 0 && !pScan->m_flushRequested)
+		{
+			pScan->m_batchTaskActive = false;
+			// Batching may have been enabled again in between, without starting a task.
+			if (pScan->m_batchSize == 0 || pScan->m_batchTaskActive.exchange(true))
+			{
+				break;
+			}
+		}
+		if (wait > BLE_SCAN_BATCH_TICK)
+		{
+			wait = BLE_SCAN_BATCH_TICK;
+		}
+		BLEFreeRTOS::sleep(wait);
+	}
+	BLEFreeRTOS::deleteTask();
+} // batchTask
+
+/**
+ * @brief Let a scheduler choose the scan parameters.
+ * At the end of every scan period the scheduler is told how many devices were discovered and how far the
+ * consumer of the results is behind, and the parameters it chooses are used from the next call to start().
+ * While a scheduler is set it overrides setInterval(), setWindow() and setActiveScan().
+ * @param [in] pScheduler The scheduler, or nullptr to keep the parameters fixed.
+ */
+void BLEScan::setScheduler(BLEScanScheduler *pScheduler)
+{
+	m_pScheduler = pScheduler;
+	if (m_pScheduler != nullptr)
+	{
+		m_pScheduler->reset();
+	}
+} // setScheduler
+
+/**
+ * @brief Use scheduler parameters for the next scan period.
+ * @param [in] params The parameters, in milliseconds.
+ */
+void BLEScan::applyScanParams(BLEScanParams params)
+{
+	uint32_t interval = (uint32_t)params.intervalMs * 1000 / 625;
+	uint32_t window = (uint32_t)params.windowMs * 1000 / 625;
+	if (interval < 0x0004)
+		interval = 0x0004;
+	if (interval > 0x4000)
+		interval = 0x4000;
+	if (window < 0x0004)
+		window = 0x0004;
+	if (window > interval)
+		window = interval;
+	m_scanInterval = interval;
+	m_scanWindow = window;
+	m_scanMode = params.active ? GAP_SCAN_MODE_ACTIVE : GAP_SCAN_MODE_PASSIVE;
+} // applyScanParams
+
+/**
+ * @brief Report the scan period that just completed to the scheduler.
+ */
+void BLEScan::endScanPeriod()
+{
+	if (m_pScheduler == nullptr)
+	{
+		return;
+	}
+	BLEScanObservation observation;
+	observation.durationMs = BLEFreeRTOS::getTimeSinceStart() - m_periodStart;
+	observation.reports    = m_periodReports;
+	observation.newDevices = m_periodNewDevices;
+	BLEScanRecordStream *pRecordStream = m_pRecordStream.load();
+	observation.backlog    = (pRecordStream != nullptr) ? pRecordStream->available() : 0;
+	observation.dropped    = (pRecordStream != nullptr) ? pRecordStream->getDroppedCount() - m_periodDropped : 0;
+	applyScanParams(m_pScheduler->update(&observation));
+} // endScanPeriod
+
+/**
+ * @brief Copy a scan report into a record.
+ * Payloads longer than BLE_SCAN_RECORD_MAX_DATA, from extended advertising, are truncated.
+ * @param [in] pReport The report.
+ * @param [in] now The current time in milliseconds.
+ * @param [out] pRecord The record to fill.
+ */
+void BLEScan::makeRecord(const BLEScanReport *pReport, uint32_t now, BLEScanRecord *pRecord)
+{
+	pRecord->timestamp   = now;
+	memcpy(pRecord->address, pReport->address, sizeof(pRecord->address));
+	pRecord->addressType = pReport->addressType;
+	pRecord->advType     = pReport->advType;
+	pRecord->rssi        = pReport->rssi;
+	pRecord->dataLength  = (pReport->dataLength <= BLE_SCAN_RECORD_MAX_DATA) ? pReport->dataLength : BLE_SCAN_RECORD_MAX_DATA;
+	memcpy(pRecord->data, pReport->data, pRecord->dataLength);
+} // makeRecord
+
+/**
+ * @brief Bound the scan results for continuous scanning.
+ * In cache mode the scan never stops recording new devices.  When the limit is reached the device that
+ * has not advertised for the longest time is evicted, and devices silent for longer than maxAgeMs are
+ * evicted as new advertisements arrive.  Evicted devices are passed to BLEAdvertisedDeviceCallbacks::onEvict().
+ * The memory used is fixed: the result arrays are sized by BLE_SCAN_MAX_DEVICES and at most one device
+ * record more than the limit is ever taken from the pool.
+ * @param [in] enable True to enable cache mode.
+ * @param [in] maxEntries The maximum number of devices kept, at most BLE_SCAN_MAX_DEVICES.
+ * @param [in] maxBytes A memory budget for the kept devices, 0 for no budget.
+ * @param [in] maxAgeMs Evict devices not seen for this long, 0 to only evict when full.
+ */
+void BLEScan::setCacheMode(bool enable, uint16_t maxEntries, size_t maxBytes, uint32_t maxAgeMs)
+{
+	if (maxEntries > BLE_SCAN_MAX_DEVICES)
+	{
+		maxEntries = BLE_SCAN_MAX_DEVICES;
+	}
+	if (maxBytes != 0 && maxBytes / BLEScanResultStore::getEntrySize() < maxEntries)
+	{
+		maxEntries = maxBytes / BLEScanResultStore::getEntrySize();
+	}
+	if (maxEntries == 0)
+	{
+		maxEntries = 1;
+	}
+	m_cacheEnabled    = enable;
+	m_cacheMaxEntries = maxEntries;
+	m_cacheMaxAge     = maxAgeMs;
+} // setCacheMode
+
+/**
+ * @brief Get the number of devices evicted in cache mode.
+ */
+uint32_t BLEScan::getEvictedCount()
+{
+	return m_evictedCount;
+} // getEvictedCount
+
+/**
+ * @brief Evict expired devices and, if asked, make room for one more.
+ * @param [in] now The current time in milliseconds.
+ * @param [in] makeRoom True if a new device is about to be recorded.
+ */
+void BLEScan::evictCache(uint32_t now, bool makeRoom)
 {
-	for (auto _dev : m_scanResults.m_vectorAdvertisedDevices)
+	int oldest;
+	while ((oldest = m_scanResults.getOldest()) >= 0)
 	{
-		delete _dev.second;
+		bool expired = (m_cacheMaxAge != 0) && (now - m_scanResults.getLastSeen(oldest) > m_cacheMaxAge);
+		bool full = makeRoom && (m_scanResults.getCount() >= m_cacheMaxEntries);
+		if (!expired && !full)
+		{
+			break;
+		}
+		BLEAdvertisedDevice *advertisedDevice = m_scanResults.remove(m_scanResults.getKey(oldest));
+		m_evictedCount++;
+		if (m_pAdvertisedDeviceCallbacks)
+		{
+			m_pAdvertisedDeviceCallbacks->onEvict(*advertisedDevice);
+		}
+		m_scanResults.retire(advertisedDevice, &m_devicePool);
 	}
-	m_scanResults.m_vectorAdvertisedDevices.clear();
-}
\ No newline at end of file
+} // evictCache
+
+BLEScanResultStore::BLEScanResultStore()
+{
+	m_newest = BLE_SCAN_NO_ENTRY;
+	m_oldest = BLE_SCAN_NO_ENTRY;
+	m_count.store(0);
+	m_generation.store(0);
+	m_snapshots.store(0);
+	m_snapshotsTaken.store(0);
+	memset(m_index, 0, sizeof(m_index));
+	m_pDevices = new BLEScanDeviceArray;
+	m_pDevices->snapshots = 0;
+} // BLEScanResultStore
+
+BLEScanResultStore::~BLEScanResultStore()
+{
+	delete m_pDevices;   // Arrays left to snapshots are deleted by the last of them.
+} // ~BLEScanResultStore
+
+/**
+ * @brief Get the number of recorded devices.
+ */
+uint16_t BLEScanResultStore::getCount()
+{
+	return m_count.load(std::memory_order_acquire);
+} // getCount
+
+/**
+ * @brief Get the generation, bumped whenever recorded devices are removed or moved.
+ */
+uint32_t BLEScanResultStore::getGeneration()
+{
+	return m_generation.load(std::memory_order_acquire);
+} // getGeneration
+
+/**
+ * @brief Get the memory one recorded device costs, including its device record.
+ * Used to turn a byte budget into a number of entries.
+ */
+size_t BLEScanResultStore::getEntrySize()
+{
+	return sizeof(BLEAdvertisedDevice) + sizeof(BLEAdvertisedDevice *) + sizeof(uint64_t) + sizeof(BLEScanDeviceStats) +
+		   2 * sizeof(uint16_t) + (BLE_SCAN_INDEX_SIZE / BLE_SCAN_MAX_DEVICES) * sizeof(uint16_t);
+} // getEntrySize
+
+/**
+ * @brief Get the recorded devices in discovery order.
+ */
+BLEAdvertisedDevice *const *BLEScanResultStore::getDevices()
+{
+	return m_pDevices->devices;
+} // getDevices
+
+/**
+ * @brief Locate the index slot holding a key.
+ * @param [in] key The packed address key.
+ * @param [in] mask The key bits that take part in the comparison.
+ * @return The slot in m_index, or -1 if the key is not present.
+ */
+int BLEScanResultStore::findSlot(uint64_t key, uint64_t mask)
+{
+	uint32_t slot = BLEAddress::hashKey(key) & (BLE_SCAN_INDEX_SIZE - 1);
+	while (m_index[slot] != 0)
+	{
+		if (((m_keys[m_index[slot] - 1] ^ key) & mask) == 0)
+		{
+			return slot;
+		}
+		slot = (slot + 1) & (BLE_SCAN_INDEX_SIZE - 1);
+	}
+	return -1;
+} // findSlot
+
+/**
+ * @brief Find a recorded device.
+ * @param [in] key The packed address and address type of the device.
+ * @return The device or nullptr if it has not been recorded.
+ */
+BLEAdvertisedDevice *BLEScanResultStore::find(uint64_t key)
+{
+	int slot = findSlot(key, UINT64_MAX);
+	return (slot < 0) ? nullptr : m_pDevices->devices[m_index[slot] - 1];
+} // find
+
+/**
+ * @brief Find the position of a recorded device.
+ * @param [in] key The packed address and address type of the device.
+ * @return The index of the device, or -1 if it has not been recorded.
+ */
+int BLEScanResultStore::findIndex(uint64_t key)
+{
+	int slot = findSlot(key, UINT64_MAX);
+	return (slot < 0) ? -1 : m_index[slot] - 1;
+} // findIndex
+
+/**
+ * @brief Remove a device from the recency list.
+ * @param [in] index The position of the device.
+ */
+void BLEScanResultStore::unlink(uint16_t index)
+{
+	uint16_t newer = m_newer[index];
+	uint16_t older = m_older[index];
+	if (newer != BLE_SCAN_NO_ENTRY)
+		m_older[newer] = older;
+	else
+		m_newest = older;
+	if (older != BLE_SCAN_NO_ENTRY)
+		m_newer[older] = newer;
+	else
+		m_oldest = newer;
+} // unlink
+
+/**
+ * @brief Put a device at the most recently seen end of the recency list.
+ * @param [in] index The position of the device.
+ */
+void BLEScanResultStore::linkFirst(uint16_t index)
+{
+	m_newer[index] = BLE_SCAN_NO_ENTRY;
+	m_older[index] = m_newest;
+	if (m_newest != BLE_SCAN_NO_ENTRY)
+		m_newer[m_newest] = index;
+	else
+		m_oldest = index;
+	m_newest = index;
+} // linkFirst
+
+/**
+ * @brief Move a running average in fixed point one step towards a sample.
+ * The step is rounded to the nearest unit instead of towards zero.  A steady input then pulls the
+ * average to less than half of 2^BLE_SCAN_EWMA_SHIFT units away, 3/16 dBm with the default shift, where
+ * truncation stalls up to 7/16 dBm away.
+ * @param [in] average The average, in the same units as the sample.
+ * @param [in] sample The new sample.
+ * @return The new average.
+ */
+static int32_t ewmaStep(int32_t average, int32_t sample)
+{
+	int32_t difference = sample - average;
+	int32_t half = (1 << BLE_SCAN_EWMA_SHIFT) >> 1;
+	return average + (difference + (difference < 0 ? -half : half)) / (1 << BLE_SCAN_EWMA_SHIFT);
+} // ewmaStep
+
+/**
+ * @brief Note that a recorded device advertised again.
+ * Moves the device to the front of the recency list and updates its statistics.
+ * @param [in] index The position returned by findIndex().
+ * @param [in] now The current time in milliseconds.
+ * @param [in] rssi The RSSI of the report.
+ * @param [in] scanResponse True if the report is a scan response.
+ */
+void BLEScanResultStore::touch(int index, uint32_t now, int8_t rssi, bool scanResponse)
+{
+	BLEScanDeviceStats *pStats = &m_stats[index];
+	pStats->rssiAverage = (int16_t)ewmaStep(pStats->rssiAverage, rssi * 16);
+	if (rssi < pStats->rssiMin)
+		pStats->rssiMin = rssi;
+	if (rssi > pStats->rssiMax)
+		pStats->rssiMax = rssi;
+	pStats->rssiLast = rssi;
+	pStats->count++;
+	pStats->lastSeen = now;
+	if (!scanResponse)
+	{
+		if (pStats->lastAdvertised != 0)   // 0 until the first advertisement that is not a scan response.
+		{
+			uint32_t interval = now - pStats->lastAdvertised;
+			if (pStats->intervalAverage == 0)
+				pStats->intervalAverage = interval * 16;
+			else
+				pStats->intervalAverage = (uint32_t)ewmaStep((int32_t)pStats->intervalAverage, (int32_t)(interval * 16));
+			if (pStats->intervalMin == 0 || interval < pStats->intervalMin)
+				pStats->intervalMin = interval;
+		}
+		pStats->lastAdvertised = now;
+	}
+	if (m_newest != index)
+	{
+		unlink(index);
+		linkFirst(index);
+	}
+} // touch
+
+/**
+ * @brief Get the device that has not advertised for the longest time.
+ * @return Its index, or -1 if nothing is recorded.
+ */
+int BLEScanResultStore::getOldest()
+{
+	return (m_oldest == BLE_SCAN_NO_ENTRY) ? -1 : m_oldest;
+} // getOldest
+
+uint32_t BLEScanResultStore::getLastSeen(int index)
+{
+	return m_stats[index].lastSeen;
+} // getLastSeen
+
+uint64_t BLEScanResultStore::getKey(int index)
+{
+	return m_keys[index];
+} // getKey
+
+/**
+ * @brief Get the statistics of the recorded devices, in the same order as getDevices().
+ */
+const BLEScanDeviceStats *BLEScanResultStore::getStats()
+{
+	return m_stats;
+} // getStats
+
+/**
+ * @brief Record a newly found device.
+ * @param [in] key The packed address and address type of the device.
+ * @param [in] pDevice The device, ownership passes to the results.
+ * @param [in] now The current time in milliseconds.
+ * @param [in] rssi The RSSI of the first report.
+ * @param [in] scanResponse True if the first report is a scan response.
+ * @return False if the results are full and the device was not recorded.
+ */
+bool BLEScanResultStore::insert(uint64_t key, BLEAdvertisedDevice *pDevice, uint32_t now, int8_t rssi, bool scanResponse)
+{
+	if (m_count >= BLE_SCAN_MAX_DEVICES)
+	{
+		return false;
+	}
+	uint32_t slot = BLEAddress::hashKey(key) & (BLE_SCAN_INDEX_SIZE - 1);
+	while (m_index[slot] != 0)
+	{
+		slot = (slot + 1) & (BLE_SCAN_INDEX_SIZE - 1);
+	}
+	uint16_t count = m_count.load(std::memory_order_relaxed);
+	pDevice->m_published = m_snapshotsTaken.load();   // Read before the device is published, see isShared().
+	m_pDevices->devices[count] = pDevice;   // Past the count of every snapshot, so no copy is needed.
+	m_keys[count] = key;
+	BLEScanDeviceStats *pStats = &m_stats[count];
+	pStats->rssiAverage     = rssi * 16;
+	pStats->rssiMin         = rssi;
+	pStats->rssiMax         = rssi;
+	pStats->rssiLast        = rssi;
+	pStats->count           = 1;
+	pStats->firstSeen       = now;
+	pStats->lastSeen        = now;
+	pStats->lastAdvertised  = scanResponse ? 0 : now;
+	pStats->intervalAverage = 0;
+	pStats->intervalMin     = 0;
+	linkFirst(count);
+	m_index[slot] = count + 1;
+	m_count.store(count + 1, std::memory_order_release);   // Publish the device to outstanding snapshots.
+	return true;
+} // insert
+
+/**
+ * @brief Stop changing an array that snapshots hold.
+ * Must be called with the snapshot semaphore taken, before the live array is changed other than by
+ * appending to it.
+ * @param [in] copy True to carry the recorded devices over to the new array.
+ */
+void BLEScanResultStore::detach(bool copy)
+{
+	if (m_pDevices->snapshots == 0)
+	{
+		return;
+	}
+	BLEScanDeviceArray *pArray = new BLEScanDeviceArray;
+	pArray->snapshots = 0;
+	if (copy)
+	{
+		memcpy(pArray->devices, m_pDevices->devices, m_count * sizeof(BLEAdvertisedDevice *));
+	}
+	m_pDevices = pArray;   // The old array now belongs to its snapshots.
+} // detach
+
+/**
+ * @brief Share the live array with a new snapshot.
+ * @param [out] pCount The number of devices the snapshot sees.
+ * @param [out] pGeneration The generation the snapshot was taken in.
+ * @return The array, to be given back with releaseArray().
+ */
+BLEScanDeviceArray *BLEScanResultStore::acquireArray(uint16_t *pCount, uint32_t *pGeneration)
+{
+	m_semaphoreSnapshots.take("acquireArray");
+	BLEScanDeviceArray *pArray = m_pDevices;
+	pArray->snapshots++;
+	m_snapshots++;
+	*pCount = getCount();
+	*pGeneration = getGeneration();
+	m_snapshotsTaken++;   // After the count is read, see isShared().
+	m_semaphoreSnapshots.give();
+	return pArray;
+} // acquireArray
+
+/**
+ * @brief Share an array a snapshot already holds with a copy of the snapshot.
+ * @param [in] pArray The array.
+ */
+void BLEScanResultStore::retainArray(BLEScanDeviceArray *pArray)
+{
+	m_semaphoreSnapshots.take("retainArray");
+	pArray->snapshots++;
+	m_snapshots++;
+	m_semaphoreSnapshots.give();
+} // retainArray
+
+/**
+ * @brief Give back an array taken with acquireArray() or retainArray().
+ * An array the store has moved on from is deleted with its last snapshot.
+ * @param [in] pArray The array.
+ */
+void BLEScanResultStore::releaseArray(BLEScanDeviceArray *pArray)
+{
+	m_semaphoreSnapshots.take("releaseArray");
+	pArray->snapshots--;
+	m_snapshots--;
+	bool orphaned = (pArray != m_pDevices && pArray->snapshots == 0);
+	m_semaphoreSnapshots.give();
+	if (orphaned)
+	{
+		delete pArray;
+	}
+} // releaseArray
+
+/**
+ * @brief Drop the entry referenced by an index slot.
+ * The last device is moved into the hole so the array stays dense, which invalidates outstanding
+ * snapshots, and the probe sequence
+ * following the slot is shifted back so no tombstones are needed.
+ * Must be called with the snapshot semaphore taken.
+ * @param [in] slot The slot returned by findSlot().
+ */
+void BLEScanResultStore::removeAt(int slot)
+{
+	detach(true);
+	m_generation++;
+	uint16_t pos = m_index[slot] - 1;
+	uint16_t last = m_count - 1;
+	unlink(pos);
+	if (pos != last)
+	{
+		int lastSlot = findSlot(m_keys[last], UINT64_MAX);
+		m_pDevices->devices[pos] = m_pDevices->devices[last];
+		m_keys[pos] = m_keys[last];
+		m_stats[pos] = m_stats[last];
+		m_index[lastSlot] = pos + 1;
+		// Take over the place of the moved device in the recency list.
+		m_newer[pos] = m_newer[last];
+		m_older[pos] = m_older[last];
+		if (m_newer[pos] != BLE_SCAN_NO_ENTRY)
+			m_older[m_newer[pos]] = pos;
+		else
+			m_newest = pos;
+		if (m_older[pos] != BLE_SCAN_NO_ENTRY)
+			m_newer[m_older[pos]] = pos;
+		else
+			m_oldest = pos;
+	}
+	m_count--;
+
+	uint32_t hole = slot;
+	uint32_t next = (hole + 1) & (BLE_SCAN_INDEX_SIZE - 1);
+	while (m_index[next] != 0)
+	{
+		uint32_t home = BLEAddress::hashKey(m_keys[m_index[next] - 1]) & (BLE_SCAN_INDEX_SIZE - 1);
+		// Move the entry back if its home slot does not lie cyclically in (hole, next].
+		if (((next - home) & (BLE_SCAN_INDEX_SIZE - 1)) >= ((next - hole) & (BLE_SCAN_INDEX_SIZE - 1)))
+		{
+			m_index[hole] = m_index[next];
+			hole = next;
+		}
+		next = (next + 1) & (BLE_SCAN_INDEX_SIZE - 1);
+	}
+	m_index[hole] = 0;
+} // removeAt
+
+/**
+ * @brief Forget a recorded device.
+ * @param [in] key The packed address and address type of the device.
+ * @return The device, which the caller now owns, or nullptr if it was not recorded.
+ */
+BLEAdvertisedDevice *BLEScanResultStore::remove(uint64_t key)
+{
+	int slot = findSlot(key, UINT64_MAX);
+	if (slot < 0)
+	{
+		return nullptr;
+	}
+	m_semaphoreSnapshots.take("remove");
+	BLEAdvertisedDevice *pDevice = m_pDevices->devices[m_index[slot] - 1];
+	removeAt(slot);
+	m_semaphoreSnapshots.give();
+	return pDevice;
+} // remove
+
+/**
+ * @brief Forget a recorded device whatever its address type.
+ * @param [in] key The packed address, the address type bits are ignored.
+ * @return The device, which the caller now owns, or nullptr if it was not recorded.
+ */
+BLEAdvertisedDevice *BLEScanResultStore::removeAddress(uint64_t key)
+{
+	int slot = findSlot(key, 0xffffffffffffULL);
+	if (slot < 0)
+	{
+		return nullptr;
+	}
+	m_semaphoreSnapshots.take("removeAddress");
+	BLEAdvertisedDevice *pDevice = m_pDevices->devices[m_index[slot] - 1];
+	removeAt(slot);
+	m_semaphoreSnapshots.give();
+	return pDevice;
+} // removeAddress
+
+/**
+ * @brief Put an updated record in the place of a recorded device.
+ * The position, key and statistics of the device do not change.
+ * @param [in] index The position of the device.
+ * @param [in] pDevice The new record, ownership passes to the results.
+ * @return The old record, which the caller now owns.
+ */
+BLEAdvertisedDevice *BLEScanResultStore::replace(int index, BLEAdvertisedDevice *pDevice)
+{
+	m_semaphoreSnapshots.take("replace");
+	detach(true);
+	BLEAdvertisedDevice *pOld = m_pDevices->devices[index];
+	pDevice->m_published = m_snapshotsTaken.load();
+	m_pDevices->devices[index] = pDevice;
+	m_semaphoreSnapshots.give();
+	return pOld;
+} // replace
+
+/**
+ * @brief Forget every recorded device.
+ * @param [in] pPool The pool the device records are returned to.
+ */
+void BLEScanResultStore::clear(BLEAdvertisedDevicePool *pPool)
+{
+	reclaim(pPool);
+	m_semaphoreSnapshots.take("clear");
+	for (uint16_t i = 0; i < m_count; i++)
+	{
+		retire(m_pDevices->devices[i], pPool);
+	}
+	detach(false);
+	m_generation++;
+	m_count = 0;
+	m_newest = BLE_SCAN_NO_ENTRY;
+	m_oldest = BLE_SCAN_NO_ENTRY;
+	memset(m_index, 0, sizeof(m_index));
+	m_semaphoreSnapshots.give();
+} // clear
+
+/**
+ * @brief Return a record the results no longer hold to the pool.
+ * If a snapshot may still read it, it is kept until reclaim() finds none.
+ * @param [in] pDevice The record returned by remove(), removeAddress() or replace().
+ * @param [in] pPool The pool the record came from.
+ */
+void BLEScanResultStore::retire(BLEAdvertisedDevice *pDevice, BLEAdvertisedDevicePool *pPool)
+{
+	if (!isShared(pDevice))
+	{
+		pPool->release(pDevice);
+	}
+	else
+	{
+		pPool->retire(pDevice);
+	}
+} // retire
+
+/**
+ * @brief Return the retired records to the pool once no snapshot is left.
+ * @param [in] pPool The pool the records came from.
+ */
+void BLEScanResultStore::reclaim(BLEAdvertisedDevicePool *pPool)
+{
+	if (m_snapshots.load(std::memory_order_acquire) == 0)
+	{
+		pPool->reclaim();
+	}
+} // reclaim
+
+/**
+ * @brief Check whether an outstanding snapshot may read a record.
+ * A snapshot reads the devices recorded when it was taken, so a record recorded after the last snapshot
+ * was taken, such as one that replaced a device again since, cannot be seen by any of them.
+ * @param [in] pDevice A record the results hold or have just let go of.
+ * @return True if the record may be read by a snapshot.
+ */
+bool BLEScanResultStore::isShared(const BLEAdvertisedDevice *pDevice)
+{
+	return m_snapshots.load(std::memory_order_acquire) != 0 && pDevice->m_published != m_snapshotsTaken.load();
+} // isShared
+
+BLEScanResults::BLEScanResults()
+{
+	m_pStore     = nullptr;
+	m_pDevices   = nullptr;
+	m_count      = 0;
+	m_generation = 0;
+} // BLEScanResults
+
+/**
+ * @brief Take a snapshot of the devices recorded so far.
+ * @param [in] pStore The store of the scan.
+ */
+BLEScanResults::BLEScanResults(BLEScanResultStore *pStore)
+{
+	m_pStore   = pStore;
+	m_pDevices = pStore->acquireArray(&m_count, &m_generation);
+} // BLEScanResults
+
+BLEScanResults::BLEScanResults(const BLEScanResults &other)
+{
+	m_pStore     = other.m_pStore;
+	m_pDevices   = nullptr;
+	m_count      = other.m_count;
+	m_generation = other.m_generation;
+	if (m_pStore != nullptr)
+	{
+		m_pDevices = other.m_pDevices;
+		m_pStore->retainArray(m_pDevices);
+	}
+} // BLEScanResults
+
+BLEScanResults::~BLEScanResults()
+{
+	if (m_pStore != nullptr)
+	{
+		m_pStore->releaseArray(m_pDevices);
+	}
+} // ~BLEScanResults
+
+BLEScanResults &BLEScanResults::operator=(const BLEScanResults &other)
+{
+	if (this != &other)
+	{
+		BLEScanResults copy(other);
+		std::swap(m_pStore, copy.m_pStore);
+		std::swap(m_pDevices, copy.m_pDevices);
+		m_count      = copy.m_count;
+		m_generation = copy.m_generation;
+	}
+	return *this;
+} // operator=
+
+/**
+ * @brief Return the count of devices found in the last scan.
+ * @return The number of devices found in the last scan.
+ */
+int BLEScanResults::getCount()
+{
+	return m_count;
+} // getCount
+
+/**
+ * @brief Return the specified device at the given index.
+ * The index should be between 0 and getCount()-1.  Prefer operator[] or iteration, which do not copy the device.
+ * @param [in] i The index of the device.
+ * @return The device at the specified index.
+ */
+BLEAdvertisedDevice BLEScanResults::getDevice(uint32_t i)
+{
+	if (i >= m_count)
+	{
+		return BLEAdvertisedDevice();
+	}
+	return *m_pDevices->devices[i];
+} // getDevice
+
+/**
+ * @brief Access a device without copying it.
+ * @param [in] i The index of the device, between 0 and getCount()-1.
+ * @return The device at the specified index.
+ */
+const BLEAdvertisedDevice &BLEScanResults::operator[](uint32_t i) const
+{
+	return *m_pDevices->devices[i];
+} // operator[]
+
+/**
+ * @brief Access the running statistics of a device.
+ * The statistics are the live ones of the scan, they keep changing while it runs.
+ * @param [in] i The index of the device, between 0 and getCount()-1.
+ * @return The statistics of the device at the specified index, all zero if the scan no longer records it.
+ */
+const BLEScanDeviceStats &BLEScanResults::getStats(uint32_t i) const
+{
+	static const BLEScanDeviceStats noStats = {};
+	if (m_pStore->getGeneration() == m_generation)   // Nothing was removed, the device is still at the same position.
+	{
+		return m_pStore->getStats()[i];
+	}
+	const BLEAdvertisedDevice *pDevice = m_pDevices->devices[i];
+	int index = m_pStore->findIndex(pDevice->getAddress().toKey(pDevice->getAddressType()));
+	return (index < 0) ? noStats : m_pStore->getStats()[index];
+} // getStats
+
+BLEScanResults::iterator BLEScanResults::begin() const
+{
+	return iterator(m_pDevices != nullptr ? m_pDevices->devices : nullptr);
+} // begin
+
+BLEScanResults::iterator BLEScanResults::end() const
+{
+	return iterator(m_pDevices != nullptr ? m_pDevices->devices + m_count : nullptr);
+} // end
+
+/**
+ * @brief Check that the snapshot still matches the devices recorded by the scan.
+ * The snapshot remains safe to read either way.
+ * @return False once devices have been removed from the scan since the snapshot was taken.
+ */
+bool BLEScanResults::isValid()
+{
+	return m_pStore == nullptr || m_pStore->getGeneration() == m_generation;
+} // isValid
+
+BLEScanResults::iterator::iterator(BLEAdvertisedDevice *const *pDevice)
+{
+	m_pDevice = pDevice;
+} // iterator
+
+const BLEAdvertisedDevice &BLEScanResults::iterator::operator*() const
+{
+	return **m_pDevice;
+} // operator*
+
+const BLEAdvertisedDevice *BLEScanResults::iterator::operator->() const
+{
+	return *m_pDevice;
+} // operator->
+
+BLEScanResults::iterator &BLEScanResults::iterator::operator++()
+{
+	m_pDevice++;
+	return *this;
+} // operator++
+
+bool BLEScanResults::iterator::operator!=(const iterator &other) const
+{
+	return m_pDevice != other.m_pDevice;
+} // operator!=
+
+bool BLEScanResults::iterator::operator==(const iterator &other) const
+{
+	return m_pDevice == other.m_pDevice;
+} // operator==
+
+BLEAdvertisedDevicePool::BLEAdvertisedDevicePool()
+{
+	m_slabCount      = 0;
+	m_allocated      = 0;
+	m_freeCount      = 0;
+	m_retiredCount   = 0;
+	m_highWaterMark  = 0;
+	m_exhaustedCount = 0;
+} // BLEAdvertisedDevicePool
+
+BLEAdvertisedDevicePool::~BLEAdvertisedDevicePool()
+{
+	for (uint16_t i = 0; i < m_slabCount; i++)
+	{
+		delete[] m_slabs[i];
+	}
+} // ~BLEAdvertisedDevicePool
+
+/**
+ * @brief Take a device record from the pool.
+ * A new slab is constructed only when every record built so far is in use.
+ * @return A cleared device record, or nullptr if all BLE_SCAN_POOL_SIZE records are in use.
+ */
+BLEAdvertisedDevice *BLEAdvertisedDevicePool::acquire()
+{
+	if (m_freeCount == 0)
+	{
+		if (m_allocated >= BLE_SCAN_POOL_SIZE)
+		{
+			m_exhaustedCount++;
+			return nullptr;
+		}
+		uint16_t count = BLE_SCAN_POOL_SIZE - m_allocated;
+		if (count > BLE_SCAN_POOL_SLAB)
+		{
+			count = BLE_SCAN_POOL_SLAB;
+		}
+		BLEAdvertisedDevice *pSlab = new BLEAdvertisedDevice[count];
+		m_slabs[m_slabCount++] = pSlab;
+		for (uint16_t i = 0; i < count; i++)
+		{
+			m_free[m_freeCount++] = &pSlab[i];
+		}
+		m_allocated += count;
+	}
+	BLEAdvertisedDevice *pDevice = m_free[--m_freeCount];
+	pDevice->clear();
+	if (getInUse() > m_highWaterMark)
+	{
+		m_highWaterMark = getInUse();
+	}
+	return pDevice;
+} // acquire
+
+/**
+ * @brief Return a device record to the pool.
+ * @param [in] pDevice A record previously obtained from acquire().
+ */
+void BLEAdvertisedDevicePool::release(BLEAdvertisedDevice *pDevice)
+{
+	pDevice->m_payloadBlock.release();   // A free record must not pin a block of the payload pool.
+	m_free[m_freeCount++] = pDevice;
+} // release
+
+/**
+ * @brief Set aside a record that may still be read, until reclaim() is called.
+ * The record stays in use meanwhile.
+ * @param [in] pDevice A record previously obtained from acquire().
+ */
+void BLEAdvertisedDevicePool::retire(BLEAdvertisedDevice *pDevice)
+{
+	m_free[BLE_SCAN_POOL_SIZE - 1 - m_retiredCount++] = pDevice;   // Free and retired records never outnumber the allocated ones.
+} // retire
+
+/**
+ * @brief Release every retired record.
+ */
+void BLEAdvertisedDevicePool::reclaim()
+{
+	while (m_retiredCount != 0)
+	{
+		release(m_free[BLE_SCAN_POOL_SIZE - m_retiredCount--]);
+	}
+} // reclaim
+
+/**
+ * @brief Get the maximum number of records the pool will construct.
+ * @return The pool capacity.
+ */
+uint16_t BLEAdvertisedDevicePool::getCapacity()
+{
+	return BLE_SCAN_POOL_SIZE;
+} // getCapacity
+
+/**
+ * @brief Get the number of records constructed so far.
+ * @return The number of records owned by the pool.
+ */
+uint16_t BLEAdvertisedDevicePool::getAllocated()
+{
+	return m_allocated;
+} // getAllocated
+
+/**
+ * @brief Get the number of records currently handed out.
+ * @return The pool occupancy.
+ */
+uint16_t BLEAdvertisedDevicePool::getInUse()
+{
+	return m_allocated - m_freeCount;
+} // getInUse
+
+/**
+ * @brief Get the number of records set aside for snapshots that may still read them.
+ * @return The number of retired records.
+ */
+uint16_t BLEAdvertisedDevicePool::getRetiredCount()
+{
+	return m_retiredCount;
+} // getRetiredCount
+
+/**
+ * @brief Get the largest number of records that were in use at the same time.
+ * @return The high-water mark.
+ */
+uint16_t BLEAdvertisedDevicePool::getHighWaterMark()
+{
+	return m_highWaterMark;
+} // getHighWaterMark
+
+/**
+ * @brief Get the number of advertisements dropped because the pool was empty.
+ * @return The number of failed acquire() calls.
+ */
+uint32_t BLEAdvertisedDevicePool::getExhaustedCount()
+{
+	return m_exhaustedCount;
+} // getExhaustedCount
+
+/**
+ * @brief Get a snapshot of the devices recorded so far.
+ * The snapshot does not copy the devices, see BLEScanResults.
+ * @return The scan results.
+ */
+BLEScanResults BLEScan::getResults()
+{
+	return BLEScanResults(&m_scanResults);
+} // getResults
+
+void BLEScan::clearResults()
+{
+	m_scanResults.clear(&m_devicePool);
+}
@@ -10,30 +10,284 @@
 
 // #include <vector>
 #include <string>
+#include <atomic>
 #include "BLEAdvertisedDevice.h"
+#include "BLEScanFilter.h"
+#include "BLEScanDuplicateFilter.h"
+#include "BLEScanRecordStream.h"
+#include "BLEScanRecordWriter.h"
+#include "BLEScanScheduler.h"
+#include "BLEProximityTracker.h"
+#include "BLEScanReport.h"
+#include "BLEScanPayloadPool.h"
 #include "BLEClient.h"
 #include "BLEFreeRTOS.h"
 #include "seeed_rpcUnified.h"
 #include "rtl_ble/ble_unified.h"
 
+/// Maximum number of devices recorded by a scan.
+#ifndef BLE_SCAN_MAX_DEVICES
+#define BLE_SCAN_MAX_DEVICES 256
+#endif
+
+/// Number of slots in the address index, must be a power of two larger than BLE_SCAN_MAX_DEVICES.
+#ifndef BLE_SCAN_INDEX_SIZE
+#define BLE_SCAN_INDEX_SIZE  (BLE_SCAN_MAX_DEVICES * 2)
+#endif
+
+/// Marks the end of the recency list of the scan results.
+#define BLE_SCAN_NO_ENTRY    0xffff
+
+/// Weight of a new sample in the running averages is 1 / 2^BLE_SCAN_EWMA_SHIFT.
+#ifndef BLE_SCAN_EWMA_SHIFT
+#define BLE_SCAN_EWMA_SHIFT  3
+#endif
+
+/// Number of replaced device records kept for outstanding BLEScanResults that can still read them.
+/// Once it is reached, updates to devices those snapshots hold wait until the snapshots are gone.
+#ifndef BLE_SCAN_POOL_RETIRED
+#define BLE_SCAN_POOL_RETIRED 16
+#endif
+
+/// Number of device records the scan may have in use at once: a full set of results, the retired records
+/// and the one being updated.  Records removed or cleared while BLEScanResults are outstanding stay in use
+/// until the last of them is gone.
+#ifndef BLE_SCAN_POOL_SIZE
+#define BLE_SCAN_POOL_SIZE   (BLE_SCAN_MAX_DEVICES + BLE_SCAN_POOL_RETIRED + 1)
+#endif
+
+/// Number of device records constructed together when the pool has to grow.
+#ifndef BLE_SCAN_POOL_SLAB
+#define BLE_SCAN_POOL_SLAB   16
+#endif
+
+/// Largest number of records delivered to BLEAdvertisedDeviceCallbacks::onResults() at once.
+#ifndef BLE_SCAN_BATCH_SIZE
+#define BLE_SCAN_BATCH_SIZE  16
+#endif
+
+/// Milliseconds between checks of the batch task when batches have no delay limit.
+#ifndef BLE_SCAN_BATCH_TICK
+#define BLE_SCAN_BATCH_TICK  50
+#endif
+
+/// Largest number of erase() requests waiting for the scan task at once.
+#ifndef BLE_SCAN_ERASE_PENDING
+#define BLE_SCAN_ERASE_PENDING 4
+#endif
+
+/// Largest number of new devices waiting for their scan response at once.
+#ifndef BLE_SCAN_MERGE_PENDING
+#define BLE_SCAN_MERGE_PENDING 16
+#endif
+
+/// Number of extended advertising payloads that can be reassembled from fragments at once, each takes BLE_SCAN_EXT_MAX_DATA bytes.
+#ifndef BLE_SCAN_EXT_REASSEMBLY
+#define BLE_SCAN_EXT_REASSEMBLY 2
+#endif
+
+/// Event type bits of an extended advertising report.
+#define BLE_SCAN_EXT_EVT_CONNECTABLE   0x01
+#define BLE_SCAN_EXT_EVT_SCANNABLE     0x02
+#define BLE_SCAN_EXT_EVT_DIRECTED      0x04
+#define BLE_SCAN_EXT_EVT_SCAN_RESPONSE 0x08
+#define BLE_SCAN_EXT_EVT_LEGACY        0x10
+
 class BLEScan;
 class BLEAdvertisedDeviceCallbacks;
 class BLEAdvertisedDevice;
 
+/**
+ * @brief Storage for extended advertising payloads.
+ *
+ * About BLE_SCAN_PAYLOAD_BLOCKS * BLE_SCAN_PAYLOAD_BLOCK + BLE_SCAN_EXT_REASSEMBLY * BLE_SCAN_EXT_MAX_DATA
+ * bytes, 4.6 KB with the defaults.  The scan only allocates it when the first report that does not fit a
+ * legacy advertisement arrives, so applications that never see extended advertising do not pay for it.
+ * It is kept from then on, since device copies may still reference its payload blocks.
+ */
+typedef struct {
+	BLEScanPayloadPool payloadPool;
+	struct {
+		uint64_t key;
+		uint8_t  sid;
+		bool     busy;
+		uint16_t length;
+		uint8_t  data[BLE_SCAN_EXT_MAX_DATA];
+	}                  reassembly[BLE_SCAN_EXT_REASSEMBLY];   // Extended payloads still arriving in fragments.
+} BLEScanExtendedBuffers;
+
+/**
+ * @brief A pool of recycled device records.
+ *
+ * Device records are constructed in slabs of BLE_SCAN_POOL_SLAB the first time they are needed and
+ * are never returned to the heap, so once the pool has warmed up a continuous scan no longer
+ * touches the heap.
+ *
+ * A record that may still be read through a snapshot is retired instead of released, and only
+ * becomes free again when reclaim() is called after the last snapshot is gone.
+ */
+class BLEAdvertisedDevicePool {
+public:
+	BLEAdvertisedDevicePool();
+	~BLEAdvertisedDevicePool();
+	BLEAdvertisedDevice* acquire();
+	void                 release(BLEAdvertisedDevice* pDevice);
+	void                 retire(BLEAdvertisedDevice* pDevice);
+	void                 reclaim();
+	uint16_t             getCapacity();
+	uint16_t             getAllocated();
+	uint16_t             getInUse();
+	uint16_t             getRetiredCount();
+	uint16_t             getHighWaterMark();
+	uint32_t             getExhaustedCount();
+private:
+	BLEAdvertisedDevice* m_slabs[(BLE_SCAN_POOL_SIZE + BLE_SCAN_POOL_SLAB - 1) / BLE_SCAN_POOL_SLAB];
+	BLEAdvertisedDevice* m_free[BLE_SCAN_POOL_SIZE];   // Records ready for reuse from the bottom, retired records from the top.
+	uint16_t             m_slabCount;
+	uint16_t             m_allocated;
+	uint16_t             m_freeCount;
+	uint16_t             m_retiredCount;
+	uint16_t             m_highWaterMark;
+	uint32_t             m_exhaustedCount;
+};
+
+/**
+ * @brief Running statistics of a recorded device.
+ *
+ * Updated in constant time on every advertisement of the device, including the duplicates that are
+ * not reported.  The averages are exponentially weighted and kept in fixed point with 4 fractional
+ * bits.  Scan responses count as RSSI samples but not towards the advertising interval.
+ */
+typedef struct {
+	int16_t  rssiAverage;       // Average RSSI in 1/16 dBm.
+	int8_t   rssiMin;
+	int8_t   rssiMax;
+	int8_t   rssiLast;
+	uint32_t count;             // Number of reports received.
+	uint32_t firstSeen;         // Milliseconds since the scheduler started.
+	uint32_t lastSeen;
+	uint32_t lastAdvertised;    // Time of the last report that was not a scan response.
+	uint32_t intervalAverage;   // Average advertising interval in 1/16 ms, 0 until known.
+	uint32_t intervalMin;       // Shortest advertising interval in ms, 0 until known.
+} BLEScanDeviceStats;
+
+/**
+ * @brief The devices recorded by a scan.
+ *
+ * Devices are kept in discovery order in a fixed size array.  An open addressing index keyed by
+ * the packed address and address type (see BLEAddress::toKey()) gives constant time lookups from
+ * the scan callback without formatting the address as a string.
+ *
+ * Appending a device never moves the devices already recorded.  Removing or clearing devices does,
+ * and bumps the generation so that outstanding BLEScanResults can tell they are stale.
+ *
+ * Snapshots share the device array while the scan only appends to it.  Before a device is removed
+ * or replaced in an array a snapshot holds, the store moves on to a copy and leaves the old array to
+ * the snapshots, the last of which deletes it.  Recorded devices are never changed in place, an
+ * updated device is a new record passed to replace().
+ */
+typedef struct {
+	uint16_t             snapshots;                         // Number of BLEScanResults holding the array.
+	BLEAdvertisedDevice* devices[BLE_SCAN_MAX_DEVICES];     // Devices in discovery order.
+} BLEScanDeviceArray;
+
+class BLEScanResultStore {
+public:
+	BLEScanResultStore();
+	~BLEScanResultStore();
+	BLEAdvertisedDevice* find(uint64_t key);
+	int                  findIndex(uint64_t key);
+	bool                 insert(uint64_t key, BLEAdvertisedDevice* pDevice, uint32_t now, int8_t rssi, bool scanResponse);
+	BLEAdvertisedDevice* remove(uint64_t key);
+	BLEAdvertisedDevice* removeAddress(uint64_t key);
+	BLEAdvertisedDevice* replace(int index, BLEAdvertisedDevice* pDevice);
+	void                 clear(BLEAdvertisedDevicePool* pPool);
+	void                 retire(BLEAdvertisedDevice* pDevice, BLEAdvertisedDevicePool* pPool);
+	void                 reclaim(BLEAdvertisedDevicePool* pPool);
+	bool                 isShared(const BLEAdvertisedDevice* pDevice);
+	void                 touch(int index, uint32_t now, int8_t rssi, bool scanResponse);
+	int                  getOldest();
+	uint32_t             getLastSeen(int index);
+	uint64_t             getKey(int index);
+	uint16_t             getCount();
+	uint32_t             getGeneration();
+	BLEAdvertisedDevice* const* getDevices();
+	const BLEScanDeviceStats* getStats();
+	static size_t        getEntrySize();
+private:
+	friend class BLEScanResults;
+	int                  findSlot(uint64_t key, uint64_t mask);
+	void                 removeAt(int slot);
+	void                 unlink(uint16_t index);
+	void                 linkFirst(uint16_t index);
+	void                 detach(bool copy);
+	BLEScanDeviceArray*  acquireArray(uint16_t* pCount, uint32_t* pGeneration);
+	void                 retainArray(BLEScanDeviceArray* pArray);
+	void                 releaseArray(BLEScanDeviceArray* pArray);
+
+	BLEScanDeviceArray*   m_pDevices;                        // The live array, see BLEScanDeviceArray.
+	std::atomic<uint16_t> m_snapshots;                       // Snapshots outstanding, whatever array they hold.
+	std::atomic<uint32_t> m_snapshotsTaken;                  // Snapshots ever taken, see isShared().
+	BLEFreeRTOS::Semaphore m_semaphoreSnapshots = BLEFreeRTOS::Semaphore("Snapshots");
+	uint64_t              m_keys[BLE_SCAN_MAX_DEVICES];      // Packed address key of each device.
+	BLEScanDeviceStats    m_stats[BLE_SCAN_MAX_DEVICES];     // Running statistics of each device.
+	uint16_t              m_newer[BLE_SCAN_MAX_DEVICES];     // Recency list, towards the most recently seen device.
+	uint16_t              m_older[BLE_SCAN_MAX_DEVICES];     // Recency list, towards the least recently seen device.
+	uint16_t              m_newest;
+	uint16_t              m_oldest;
+	uint16_t              m_index[BLE_SCAN_INDEX_SIZE];      // Position of the device + 1, 0 marks a free slot.
+	std::atomic<uint16_t> m_count;
+	std::atomic<uint32_t> m_generation;
+};
+
 /**
  * @brief The result of having performed a scan.
  * When a scan completes, we have a set of found devices.  Each device is described
  * by a BLEAdvertisedDevice object.  The number of items in the set is given by
  * getCount().  We can retrieve a device by calling getDevice() passing in the
  * index (starting at 0) of the desired device.
+ *
+ * The results are a snapshot of the devices recorded when they were taken and share the scan's
+ * storage rather than copying it.  Devices appended by a scan that is still running do not show up
+ * and do not disturb iteration.  The devices of a snapshot stay readable and unchanged for as long
+ * as the snapshot exists, even when the scan updates, removes or clears them; isValid() tells
+ * whether the snapshot still matches the scan.  Devices the scan lets go of while snapshots exist
+ * are only returned to the pool once the last snapshot is destroyed, so do not keep snapshots longer
+ * than needed.
  */
 class BLEScanResults {
 public:
-	  int                 getCount();
-      BLEAdvertisedDevice getDevice(uint32_t i);
+	class iterator {
+	public:
+		iterator(BLEAdvertisedDevice* const* pDevice);
+		const BLEAdvertisedDevice& operator*() const;
+		const BLEAdvertisedDevice* operator->() const;
+		iterator&                  operator++();
+		bool                       operator!=(const iterator& other) const;
+		bool                       operator==(const iterator& other) const;
+	private:
+		BLEAdvertisedDevice* const* m_pDevice;
+	};
+
+	BLEScanResults();
+	BLEScanResults(const BLEScanResults& other);
+	~BLEScanResults();
+	BLEScanResults&     operator=(const BLEScanResults& other);
+	int                 getCount();
+	BLEAdvertisedDevice getDevice(uint32_t i);
+	const BLEAdvertisedDevice& operator[](uint32_t i) const;
+	const BLEScanDeviceStats&  getStats(uint32_t i) const;
+	iterator            begin() const;
+	iterator            end() const;
+	bool                isValid();
 private:
 	friend BLEScan;
-	std::map<std::string, BLEAdvertisedDevice*> m_vectorAdvertisedDevices;
+	BLEScanResults(BLEScanResultStore* pStore);
+
+	BLEScanResultStore* m_pStore;
+	BLEScanDeviceArray* m_pDevices;
+	uint16_t            m_count;
+	uint32_t            m_generation;
 };
 
 
@@ -51,6 +305,23 @@ public:
 	void		   clearResults();
 	void           stop();
 	void 		   erase(BLEAddress address);
+	BLEAdvertisedDevicePool* getDevicePool();
+	void           setScanFilter(BLEScanFilter* pScanFilter);
+	void           setDuplicateFilter(bool enable, uint8_t rssiThreshold = 5, uint32_t refreshIntervalMs = 10000);
+	BLEScanDuplicateFilter* getDuplicateFilter();
+	void           setStreaming(bool streaming);
+	bool           isStreaming();
+	BLEScanRecordStream* getRecordStream();
+	void           setRecordWriter(BLEScanRecordWriter* pRecordWriter);
+	void           setScheduler(BLEScanScheduler* pScheduler);
+	void           setBatchDelivery(uint16_t maxRecords, uint32_t maxDelayMs = 100);
+	void           setBeaconDecoding(bool enable);
+	void           setProximityTracker(BLEProximityTracker* pTracker);
+	void           setScanResponseMerge(bool enable, uint32_t timeoutMs = 500);
+	void           injectReport(const BLEScanReport* pReport, uint8_t dataStatus = BLE_SCAN_DATA_COMPLETE);
+	BLEScanPayloadPool* getPayloadPool();
+	void           setCacheMode(bool enable, uint16_t maxEntries = BLE_SCAN_MAX_DEVICES, size_t maxBytes = 0, uint32_t maxAgeMs = 0);
+	uint32_t       getEvictedCount();
     
 private:
     BLEScan();   // One doesn't create a new instance instead one asks the BLEDevice for the singleton.
@@ -62,9 +333,62 @@ private:
 	BLEFreeRTOS::Semaphore             m_semaphoreScanEnd = BLEFreeRTOS::Semaphore("ScanEnd");
     void                               updateScanParams();
     T_APP_RESULT                       gapCallbackDefault(uint8_t cb_type, void *p_cb_data);
-	BLEScanResults                     m_scanResults;
+	BLEScanResultStore                 m_scanResults;
+	BLEAdvertisedDevicePool            m_devicePool;
 	void                               (*m_scanCompleteCB)(BLEScanResults scanResults);
 	BLEAdvertisedDeviceCallbacks*      m_pAdvertisedDeviceCallbacks = nullptr;
+	BLEScanFilter*                     m_pScanFilter = nullptr;
+	std::atomic<BLEScanDuplicateFilter*> m_pDuplicateFilter;                   // Allocated when the filter is first enabled.
+	bool                               m_duplicateFilterEnabled = false;
+	bool                               m_streaming = false;
+	std::atomic<BLEScanRecordStream*>  m_pRecordStream;                       // Allocated when streaming is first selected.
+	BLEScanRecordWriter*               m_pRecordWriter = nullptr;
+	void                               makeRecord(const BLEScanReport* pReport, uint32_t now, BLEScanRecord* pRecord);
+	BLEScanScheduler*                  m_pScheduler = nullptr;
+	uint32_t                           m_periodStart = 0;
+	uint32_t                           m_periodReports = 0;
+	uint32_t                           m_periodNewDevices = 0;
+	uint32_t                           m_periodDropped = 0;
+	void                               applyScanParams(BLEScanParams params);
+	void                               endScanPeriod();
+	BLEScanRecord*                     m_pBatch = nullptr;                 // BLE_SCAN_BATCH_SIZE records, allocated when batching is first enabled.
+	uint16_t                           m_batchCount = 0;
+	uint16_t                           m_batchSize = 0;                    // 0 when every report goes to onResult().
+	uint32_t                           m_batchDelay = 0;
+	uint32_t                           m_batchStart = 0;                   // Time the oldest record in the batch was received.
+	volatile bool                      m_flushRequested = false;           // Set by the application, serviced where the batch is delivered.
+	std::atomic<bool>                  m_batchTaskActive;
+	BLEFreeRTOS::Semaphore             m_semaphoreBatch = BLEFreeRTOS::Semaphore("Batch");
+	void                               flushBatch();
+	static void                        batchTask(void* pvParameters);
+	bool                               m_beaconDecoding = false;
+	BLEProximityTracker*               m_pProximityTracker = nullptr;
+	volatile bool                      m_mergeEnabled = false;
+	volatile bool                      m_mergeFlushRequested = false;      // Set by the application, serviced on the next report or scan complete.
+	uint64_t                           m_eraseKeys[BLE_SCAN_ERASE_PENDING];        // Devices erase() asked the scan task to forget.
+	volatile uint8_t                   m_eraseCount = 0;
+	BLEFreeRTOS::Semaphore             m_semaphoreErase = BLEFreeRTOS::Semaphore("Erase");
+	void                               serviceErase();
+	uint32_t                           m_mergeTimeout = 500;
+	uint64_t                           m_pendingKeys[BLE_SCAN_MERGE_PENDING];      // New devices waiting for their other half, oldest first.
+	uint32_t                           m_pendingDeadlines[BLE_SCAN_MERGE_PENDING];
+	uint8_t                            m_pendingHead = 0;
+	uint8_t                            m_pendingCount = 0;
+	bool                               isMergeComplete(const BLEAdvertisedDevice* pDevice);
+	void                               holdDevice(uint64_t key, uint32_t now);
+	void                               deliverPending(uint32_t now, bool all);
+	void                               deliverDevice(BLEAdvertisedDevice* pDevice);
+	BLEAdvertisedDevice*               cloneRecord(int index);
+	void                               publishRecord(int index, BLEAdvertisedDevice* pDevice);
+	void                               exportReport(const BLEScanReport* pReport, uint32_t now);
+	void                               handleReport(const BLEScanReport* pReport);
+	std::atomic<BLEScanExtendedBuffers*> m_pExtended;                          // Allocated on the first extended payload.
+	BLEScanExtendedBuffers*            getExtendedBuffers();
+	bool                               m_cacheEnabled = false;
+	uint16_t                           m_cacheMaxEntries = BLE_SCAN_MAX_DEVICES;
+	uint32_t                           m_cacheMaxAge = 0;
+	uint32_t                           m_evictedCount = 0;
+	void                               evictCache(uint32_t now, bool makeRoom);
 	static uint8_t                     _scanProcessing;	
 };
 
@@ -0,0 +1,123 @@
+/*
+ * BLEScanDuplicateFilter.cpp
+ *
+ *  Suppresses repeated advertisements that carry no new information.
+ */
+
+#include <string.h>
+#include "BLEScanDuplicateFilter.h"
+#include "BLEAddress.h"
+
+BLEScanDuplicateFilter::BLEScanDuplicateFilter() {
+	m_rssiThreshold   = 5;
+	m_refreshInterval = 10000;
+	clear();
+} // BLEScanDuplicateFilter
+
+/**
+ * @brief Set when a repeated advertisement is reported again.
+ * @param [in] rssiThreshold Report when the RSSI differs from the last report by more than this many dBm.
+ * @param [in] refreshIntervalMs Report when the last report is older than this, 0 disables the refresh.
+ */
+void BLEScanDuplicateFilter::setThresholds(uint8_t rssiThreshold, uint32_t refreshIntervalMs) {
+	m_rssiThreshold   = rssiThreshold;
+	m_refreshInterval = refreshIntervalMs;
+} // setThresholds
+
+/**
+ * @brief Forget every device and reset the counters.
+ */
+void BLEScanDuplicateFilter::clear() {
+	memset(m_entries, 0, sizeof(m_entries));
+	m_reportedCount   = 0;
+	m_suppressedCount = 0;
+} // clear
+
+/**
+ * @brief Record an advertisement and decide whether to report it.
+ * @param [in] key The packed address of the device, see BLEAddress::toKey().
+ * @param [in] scanResponse True if the payload is a scan response.
+ * @param [in] pData The raw payload.
+ * @param [in] length The length of the payload.
+ * @param [in] rssi The RSSI of the advertisement.
+ * @param [in] now The current time in milliseconds.
+ * @return True if the advertisement should be reported.
+ */
+bool BLEScanDuplicateFilter::update(uint64_t key, bool scanResponse, const uint8_t* pData, size_t length, int8_t rssi, uint32_t now) {
+	uint32_t hash  = hashPayload(pData, length);
+	uint32_t slot  = BLEAddress::hashKey(key) & (BLE_SCAN_DEDUP_SIZE - 1);
+	entry_t* pEntry = nullptr;
+	entry_t* pStalest = nullptr;
+
+	for (uint8_t i = 0; i < BLE_SCAN_DEDUP_PROBE; i++) {
+		entry_t* pCandidate = &m_entries[(slot + i) & (BLE_SCAN_DEDUP_SIZE - 1)];
+		if (!(pCandidate->flags & FLAG_USED) || pCandidate->key == key) {
+			pEntry = pCandidate;
+			break;
+		}
+		if (pStalest == nullptr || (int32_t)(pCandidate->lastReport - pStalest->lastReport) < 0) {
+			pStalest = pCandidate;
+		}
+	}
+	if (pEntry == nullptr) {
+		pEntry = pStalest;
+		pEntry->flags = 0;
+	}
+
+	bool report;
+	if (!(pEntry->flags & FLAG_USED) || pEntry->key != key) {
+		report = true;
+	} else {
+		uint8_t  haveFlag = scanResponse ? FLAG_HAVE_RSP : FLAG_HAVE_ADV;
+		uint32_t lastHash = scanResponse ? pEntry->rspHash : pEntry->advHash;
+		int      delta    = (int)rssi - (int)pEntry->rssi;
+		report = !(pEntry->flags & haveFlag) || lastHash != hash ||
+			delta > m_rssiThreshold || -delta > m_rssiThreshold ||
+			(m_refreshInterval != 0 && now - pEntry->lastReport >= m_refreshInterval);
+	}
+
+	if (!report) {
+		m_suppressedCount++;
+		return false;
+	}
+	pEntry->key        = key;
+	pEntry->rssi       = rssi;
+	pEntry->lastReport = now;
+	pEntry->flags     |= FLAG_USED | (scanResponse ? FLAG_HAVE_RSP : FLAG_HAVE_ADV);
+	if (scanResponse) {
+		pEntry->rspHash = hash;
+	} else {
+		pEntry->advHash = hash;
+	}
+	m_reportedCount++;
+	return true;
+} // update
+
+/**
+ * @brief Get the number of advertisements that were reported.
+ */
+uint32_t BLEScanDuplicateFilter::getReportedCount() {
+	return m_reportedCount;
+} // getReportedCount
+
+/**
+ * @brief Get the number of repeats that were suppressed.
+ */
+uint32_t BLEScanDuplicateFilter::getSuppressedCount() {
+	return m_suppressedCount;
+} // getSuppressedCount
+
+/**
+ * @brief Hash a payload with 32 bit FNV-1a.
+ * @param [in] pData The payload.
+ * @param [in] length The length of the payload.
+ * @return The hash.
+ */
+uint32_t BLEScanDuplicateFilter::hashPayload(const uint8_t* pData, size_t length) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= pData[i];
+		hash *= 16777619u;
+	}
+	return hash;
+} // hashPayload
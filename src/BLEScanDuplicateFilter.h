@@ -0,0 +1,71 @@
+/*
+ * BLEScanDuplicateFilter.h
+ *
+ *  Suppresses repeated advertisements that carry no new information.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANDUPLICATEFILTER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANDUPLICATEFILTER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Maximum number of devices recorded by a scan, the same default as in BLEScan.h.
+#ifndef BLE_SCAN_MAX_DEVICES
+#define BLE_SCAN_MAX_DEVICES 256
+#endif
+
+/// Number of devices tracked, must be a power of two.  Twice the devices a scan can record, so they
+/// all fit inside their probe windows; each entry takes 24 bytes.
+#ifndef BLE_SCAN_DEDUP_SIZE
+#define BLE_SCAN_DEDUP_SIZE  (BLE_SCAN_MAX_DEVICES * 2)
+#endif
+
+/// Number of slots probed for a device before the stalest of them is replaced.
+#ifndef BLE_SCAN_DEDUP_PROBE
+#define BLE_SCAN_DEDUP_PROBE 8
+#endif
+
+/**
+ * @brief Decides whether a repeated advertisement is worth reporting.
+ *
+ * For every device the filter remembers a hash of the last reported advertising and scan response
+ * payloads, the last reported RSSI and when it was last reported.  A repeat is reported only when
+ * its payload hash changed, its RSSI moved by more than the threshold or the refresh interval has
+ * expired.  The table has a fixed size; when the probe window of a device is full the entry that
+ * was reported longest ago is recycled.
+ */
+class BLEScanDuplicateFilter {
+public:
+	BLEScanDuplicateFilter();
+	void     setThresholds(uint8_t rssiThreshold, uint32_t refreshIntervalMs);
+	bool     update(uint64_t key, bool scanResponse, const uint8_t* pData, size_t length, int8_t rssi, uint32_t now);
+	void     clear();
+	uint32_t getReportedCount();
+	uint32_t getSuppressedCount();
+	static uint32_t hashPayload(const uint8_t* pData, size_t length);
+
+private:
+	enum {
+		FLAG_USED     = 0x01,
+		FLAG_HAVE_ADV = 0x02,
+		FLAG_HAVE_RSP = 0x04,
+	};
+
+	typedef struct {
+		uint64_t key;
+		uint32_t advHash;
+		uint32_t rspHash;
+		uint32_t lastReport;
+		int8_t   rssi;
+		uint8_t  flags;
+	} entry_t;
+
+	entry_t  m_entries[BLE_SCAN_DEDUP_SIZE];
+	uint8_t  m_rssiThreshold;
+	uint32_t m_refreshInterval;
+	uint32_t m_reportedCount;
+	uint32_t m_suppressedCount;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANDUPLICATEFILTER_H_ */
@@ -0,0 +1,324 @@
+/*
+ * BLEScanFilter.cpp
+ *
+ *  Rejects advertisements before the scan records them.
+ */
+
+#include <string.h>
+#include "BLEScanFilter.h"
+#include "BLEAdvertisementView.h"
+
+/// Number of manufacturer data or service UUID structures looked at in one payload.
+#define BLE_SCAN_FILTER_MAX_FIELDS 6
+
+BLEScanFilter::BLEScanFilter() {
+	clear();
+} // BLEScanFilter
+
+/**
+ * @brief Remove every rule and reset the counters.
+ */
+void BLEScanFilter::clear() {
+	m_ruleCount      = 0;
+	m_usedConditions = 0;
+	m_passedCount    = 0;
+	m_rejectedCount  = 0;
+} // clear
+
+/**
+ * @brief Start a new rule.
+ * The rule matches every advertisement until conditions are added to it.
+ * @return The index of the rule, or -1 if the filter is full.
+ */
+int BLEScanFilter::addRule() {
+	if (m_ruleCount >= BLE_SCAN_FILTER_MAX_RULES) {
+		return -1;
+	}
+	memset(&m_rules[m_ruleCount], 0, sizeof(rule_t));
+	return m_ruleCount++;
+} // addRule
+
+bool BLEScanFilter::isValid(int rule) {
+	return (rule >= 0) && (rule < m_ruleCount);
+} // isValid
+
+/**
+ * @brief Require an advertised service UUID.
+ * The UUID is compared against the service UUID lists of the same size and, for 16 bit UUIDs,
+ * against the UUID of the service data.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] uuid The service UUID.
+ * @return False if the UUID has no value or the rule index is invalid.
+ */
+bool BLEScanFilter::setServiceUUID(int rule, BLEUUID uuid) {
+	bt_uuid_t* pNative = uuid.getNative();
+	if (pNative == nullptr || !isValid(rule) || pNative->len > sizeof(m_rules[rule].uuid)) {
+		return false;
+	}
+	m_rules[rule].uuidLength = pNative->len;
+	memcpy(m_rules[rule].uuid, &pNative->uuid, pNative->len);
+	m_rules[rule].conditions |= COND_SERVICE_UUID;
+	m_usedConditions |= COND_SERVICE_UUID;
+	return true;
+} // setServiceUUID
+
+/**
+ * @brief Require manufacturer specific data from a company.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] companyId The Bluetooth SIG company identifier.
+ * @return False if the rule index is invalid.
+ */
+bool BLEScanFilter::setManufacturerId(int rule, uint16_t companyId) {
+	if (!isValid(rule)) {
+		return false;
+	}
+	m_rules[rule].companyId = companyId;
+	m_rules[rule].conditions |= COND_MANUFACTURER_ID;
+	m_usedConditions |= COND_MANUFACTURER_ID;
+	return true;
+} // setManufacturerId
+
+/**
+ * @brief Require manufacturer specific data starting with a masked prefix.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] companyId The Bluetooth SIG company identifier.
+ * @param [in] pPrefix The bytes expected after the company identifier.
+ * @param [in] pMask The bits of each prefix byte that are compared, or nullptr to compare every bit.
+ * @param [in] length The length of the prefix, at most BLE_SCAN_FILTER_MAX_PREFIX.
+ * @return False if the rule index is invalid or the prefix is too long.
+ */
+bool BLEScanFilter::setManufacturerData(int rule, uint16_t companyId, const uint8_t* pPrefix, const uint8_t* pMask, uint8_t length) {
+	if (!isValid(rule) || length > BLE_SCAN_FILTER_MAX_PREFIX) {
+		return false;
+	}
+	rule_t* pRule = &m_rules[rule];
+	for (uint8_t i = 0; i < length; i++) {
+		pRule->mask[i]   = (pMask != nullptr) ? pMask[i] : 0xff;
+		pRule->prefix[i] = pPrefix[i] & pRule->mask[i];
+	}
+	pRule->prefixLength = length;
+	pRule->companyId    = companyId;
+	pRule->conditions |= COND_MANUFACTURER_ID | COND_MANUFACTURER_DATA;
+	m_usedConditions |= COND_MANUFACTURER_ID | COND_MANUFACTURER_DATA;
+	return true;
+} // setManufacturerData
+
+/**
+ * @brief Require the local name to start with a prefix.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] prefix The name prefix, at most BLE_SCAN_FILTER_MAX_PREFIX characters.
+ * @return False if the rule index is invalid or the prefix is too long.
+ */
+bool BLEScanFilter::setNamePrefix(int rule, const char* prefix) {
+	size_t length = strlen(prefix);
+	if (!isValid(rule) || length > BLE_SCAN_FILTER_MAX_PREFIX) {
+		return false;
+	}
+	memcpy(m_rules[rule].name, prefix, length);
+	m_rules[rule].nameLength = length;
+	m_rules[rule].conditions |= COND_NAME_PREFIX;
+	m_usedConditions |= COND_NAME_PREFIX;
+	return true;
+} // setNamePrefix
+
+/**
+ * @brief Require a minimum signal strength.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] rssi The weakest RSSI accepted, in dBm.
+ * @return False if the rule index is invalid.
+ */
+bool BLEScanFilter::setMinRSSI(int rule, int8_t rssi) {
+	if (!isValid(rule)) {
+		return false;
+	}
+	m_rules[rule].minRSSI = rssi;
+	m_rules[rule].conditions |= COND_MIN_RSSI;
+	m_usedConditions |= COND_MIN_RSSI;
+	return true;
+} // setMinRSSI
+
+/**
+ * @brief Require an address type.
+ * @param [in] rule The rule index returned by addRule().
+ * @param [in] type The address type.
+ * @return False if the rule index is invalid.
+ */
+bool BLEScanFilter::setAddressType(int rule, T_GAP_REMOTE_ADDR_TYPE type) {
+	if (!isValid(rule)) {
+		return false;
+	}
+	m_rules[rule].addressType = type;
+	m_rules[rule].conditions |= COND_ADDRESS_TYPE;
+	m_usedConditions |= COND_ADDRESS_TYPE;
+	return true;
+} // setAddressType
+
+int BLEScanFilter::getRuleCount() {
+	return m_ruleCount;
+} // getRuleCount
+
+/**
+ * @brief Evaluate the filter against a legacy scan report.
+ * @param [in] pScanInfo The report delivered with GAP_MSG_LE_SCAN_INFO.
+ * @return True if the advertisement should be processed.
+ */
+bool BLEScanFilter::match(const T_LE_SCAN_INFO* pScanInfo) {
+	BLEScanReport report;
+	report.address     = pScanInfo->bd_addr;
+	report.addressType = pScanInfo->remote_addr_type;
+	report.advType     = pScanInfo->adv_type;
+	report.rssi        = pScanInfo->rssi;
+	report.txPower     = BLE_SCAN_TX_POWER_NONE;
+	report.extended    = false;
+	report.sid         = 0;
+	report.dataLength  = (pScanInfo->data_len <= sizeof(pScanInfo->data)) ? pScanInfo->data_len : sizeof(pScanInfo->data);
+	report.data        = pScanInfo->data;
+	return match(&report);
+} // match
+
+/**
+ * @brief Evaluate the filter against a scan report.
+ * @param [in] pReport The legacy or extended report.
+ * @return True if the advertisement should be processed.
+ */
+bool BLEScanFilter::match(const BLEScanReport* pReport) {
+	if (m_ruleCount == 0) {
+		m_passedCount++;
+		return true;
+	}
+
+	// Locate the structures the rules refer to in a single walk of the payload.
+	const uint8_t* pName = nullptr;
+	uint8_t        nameLength = 0;
+	const uint8_t* pManufacturer[BLE_SCAN_FILTER_MAX_FIELDS];
+	uint8_t        manufacturerLength[BLE_SCAN_FILTER_MAX_FIELDS];
+	uint8_t        manufacturerCount = 0;
+	const uint8_t* pUUIDs[BLE_SCAN_FILTER_MAX_FIELDS];
+	uint8_t        uuidsLength[BLE_SCAN_FILTER_MAX_FIELDS];
+	uint8_t        uuidSize[BLE_SCAN_FILTER_MAX_FIELDS];
+	uint8_t        uuidsCount = 0;
+
+	if (m_usedConditions & (COND_SERVICE_UUID | COND_MANUFACTURER_ID | COND_NAME_PREFIX)) {
+		BLEAdvertisementView view(pReport->data, pReport->dataLength);
+		for (BLEAdvertisementView::iterator it = view.begin(); it != view.end(); ++it) {
+			BLEAdStructure structure = *it;
+			uint8_t size = 0;
+			switch (structure.type) {
+				case GAP_ADTYPE_LOCAL_NAME_SHORT:
+				case GAP_ADTYPE_LOCAL_NAME_COMPLETE:
+					pName = structure.data;
+					nameLength = structure.length;
+					break;
+				case GAP_ADTYPE_MANUFACTURER_SPECIFIC:
+					if (structure.length >= 2 && manufacturerCount < BLE_SCAN_FILTER_MAX_FIELDS) {
+						pManufacturer[manufacturerCount] = structure.data;
+						manufacturerLength[manufacturerCount++] = structure.length;
+					}
+					break;
+				case GAP_ADTYPE_16BIT_MORE:
+				case GAP_ADTYPE_16BIT_COMPLETE:
+					size = 2;
+					break;
+				case GAP_ADTYPE_32BIT_MORE:
+				case GAP_ADTYPE_32BIT_COMPLETE:
+					size = 4;
+					break;
+				case GAP_ADTYPE_128BIT_MORE:
+				case GAP_ADTYPE_128BIT_COMPLETE:
+					size = 16;
+					break;
+				case GAP_ADTYPE_SERVICE_DATA:
+					// Only the leading 16 bit UUID of the service data takes part.
+					if (structure.length >= 2 && uuidsCount < BLE_SCAN_FILTER_MAX_FIELDS) {
+						pUUIDs[uuidsCount] = structure.data;
+						uuidsLength[uuidsCount] = 2;
+						uuidSize[uuidsCount++] = 2;
+					}
+					break;
+				default:
+					break;
+			}
+			if (size != 0 && uuidsCount < BLE_SCAN_FILTER_MAX_FIELDS) {
+				pUUIDs[uuidsCount] = structure.data;
+				uuidsLength[uuidsCount] = structure.length;
+				uuidSize[uuidsCount++] = size;
+			}
+		}
+	}
+
+	for (uint8_t r = 0; r < m_ruleCount; r++) {
+		const rule_t* pRule = &m_rules[r];
+		uint8_t conditions = pRule->conditions;
+
+		if ((conditions & COND_ADDRESS_TYPE) && pReport->addressType != pRule->addressType) {
+			continue;
+		}
+		if ((conditions & COND_MIN_RSSI) && pReport->rssi < pRule->minRSSI) {
+			continue;
+		}
+		if ((conditions & COND_NAME_PREFIX) &&
+			(pName == nullptr || nameLength < pRule->nameLength || memcmp(pName, pRule->name, pRule->nameLength) != 0)) {
+			continue;
+		}
+		if (conditions & COND_MANUFACTURER_ID) {
+			bool found = false;
+			for (uint8_t m = 0; m < manufacturerCount && !found; m++) {
+				const uint8_t* pData = pManufacturer[m];
+				if ((uint16_t)(pData[0] | (pData[1] << 8)) != pRule->companyId) {
+					continue;
+				}
+				if (conditions & COND_MANUFACTURER_DATA) {
+					if (manufacturerLength[m] - 2 < pRule->prefixLength) {
+						continue;
+					}
+					uint8_t i = 0;
+					while (i < pRule->prefixLength && (pData[2 + i] & pRule->mask[i]) == pRule->prefix[i]) {
+						i++;
+					}
+					if (i < pRule->prefixLength) {
+						continue;
+					}
+				}
+				found = true;
+			}
+			if (!found) {
+				continue;
+			}
+		}
+		if (conditions & COND_SERVICE_UUID) {
+			bool found = false;
+			for (uint8_t u = 0; u < uuidsCount && !found; u++) {
+				if (uuidSize[u] != pRule->uuidLength) {
+					continue;
+				}
+				for (uint8_t pos = 0; pos + uuidSize[u] <= uuidsLength[u]; pos += uuidSize[u]) {
+					if (memcmp(pUUIDs[u] + pos, pRule->uuid, uuidSize[u]) == 0) {
+						found = true;
+						break;
+					}
+				}
+			}
+			if (!found) {
+				continue;
+			}
+		}
+		m_passedCount++;
+		return true;
+	}
+	m_rejectedCount++;
+	return false;
+} // match
+
+/**
+ * @brief Get the number of reports that passed the filter.
+ */
+uint32_t BLEScanFilter::getPassedCount() {
+	return m_passedCount;
+} // getPassedCount
+
+/**
+ * @brief Get the number of reports rejected by the filter.
+ */
+uint32_t BLEScanFilter::getRejectedCount() {
+	return m_rejectedCount;
+} // getRejectedCount
@@ -0,0 +1,87 @@
+/*
+ * BLEScanFilter.h
+ *
+ *  Rejects advertisements before the scan records them.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANFILTER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANFILTER_H_
+
+#include <stdint.h>
+#include "BLEUUID.h"
+#include "BLEScanReport.h"
+#include "seeed_rpcUnified.h"
+#include "rtl_ble/ble_unified.h"
+
+/// Maximum number of rules a filter holds.
+#ifndef BLE_SCAN_FILTER_MAX_RULES
+#define BLE_SCAN_FILTER_MAX_RULES  16
+#endif
+
+/// Maximum length of a manufacturer data prefix or a name prefix.
+#ifndef BLE_SCAN_FILTER_MAX_PREFIX
+#define BLE_SCAN_FILTER_MAX_PREFIX 8
+#endif
+
+/**
+ * @brief A declarative filter applied to raw scan reports.
+ *
+ * A filter is a table of rules.  Every condition set on a rule must hold for the rule to match,
+ * and an advertisement passes the filter when any rule matches.  A filter without rules passes
+ * everything.
+ *
+ * The payload of a report is walked once to locate the structures the rules look at, then each
+ * rule is a handful of integer and byte compares.  The filter runs on the T_LE_SCAN_INFO delivered
+ * by the stack, before the scan looks up, allocates or parses a device record.
+ */
+class BLEScanFilter {
+public:
+	BLEScanFilter();
+	int      addRule();
+	bool     setServiceUUID(int rule, BLEUUID uuid);
+	bool     setManufacturerId(int rule, uint16_t companyId);
+	bool     setManufacturerData(int rule, uint16_t companyId, const uint8_t* pPrefix, const uint8_t* pMask, uint8_t length);
+	bool     setNamePrefix(int rule, const char* prefix);
+	bool     setMinRSSI(int rule, int8_t rssi);
+	bool     setAddressType(int rule, T_GAP_REMOTE_ADDR_TYPE type);
+	void     clear();
+	int      getRuleCount();
+	bool     match(const T_LE_SCAN_INFO* pScanInfo);
+	bool     match(const BLEScanReport* pReport);
+	uint32_t getPassedCount();
+	uint32_t getRejectedCount();
+
+private:
+	enum {
+		COND_SERVICE_UUID      = 0x01,
+		COND_MANUFACTURER_ID   = 0x02,
+		COND_MANUFACTURER_DATA = 0x04,
+		COND_NAME_PREFIX       = 0x08,
+		COND_MIN_RSSI          = 0x10,
+		COND_ADDRESS_TYPE      = 0x20,
+	};
+
+	typedef struct {
+		uint8_t  conditions;                           // COND_* bits that must all hold.
+		int8_t   minRSSI;
+		uint8_t  addressType;
+		uint8_t  uuidLength;                           // 2, 4 or 16.
+		uint8_t  uuid[16];                             // Service UUID, least significant octet first.
+		uint16_t companyId;
+		uint8_t  prefixLength;                         // Manufacturer data prefix length.
+		uint8_t  prefix[BLE_SCAN_FILTER_MAX_PREFIX];   // Manufacturer data after the company ID, pre-masked.
+		uint8_t  mask[BLE_SCAN_FILTER_MAX_PREFIX];
+		uint8_t  nameLength;
+		char     name[BLE_SCAN_FILTER_MAX_PREFIX];
+	} rule_t;
+
+	bool     isValid(int rule);
+
+	rule_t   m_rules[BLE_SCAN_FILTER_MAX_RULES];
+	uint8_t  m_ruleCount;
+	uint8_t  m_usedConditions;                         // Union of the conditions of every rule.
+	uint32_t m_passedCount;
+	uint32_t m_rejectedCount;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANFILTER_H_ */
@@ -0,0 +1,145 @@
+/*
+ * BLEScanPayloadPool.cpp
+ *
+ *  Shared storage for advertising payloads too large for a device record.
+ */
+
+#include "BLEScanPayloadPool.h"
+
+BLEScanPayloadPool::BLEScanPayloadPool() {
+	for (int i = 0; i < BLE_SCAN_PAYLOAD_BLOCKS; i++) {
+		m_refs[i].store(0);
+	}
+	m_exhaustedCount.store(0);
+} // BLEScanPayloadPool
+
+/**
+ * @brief Take a free block.
+ * @return The block, or -1 if every block is in use.
+ */
+int BLEScanPayloadPool::acquire() {
+	for (int i = 0; i < BLE_SCAN_PAYLOAD_BLOCKS; i++) {
+		uint8_t expected = 0;
+		if (m_refs[i].load(std::memory_order_relaxed) == 0 &&
+			m_refs[i].compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+			return i;
+		}
+	}
+	m_exhaustedCount++;
+	return -1;
+} // acquire
+
+/**
+ * @brief Add a reference to a block.
+ * @param [in] block A block the caller already holds a reference to.
+ */
+void BLEScanPayloadPool::retain(int block) {
+	m_refs[block].fetch_add(1, std::memory_order_relaxed);
+} // retain
+
+/**
+ * @brief Drop a reference to a block, the block is free again once the last one is dropped.
+ * @param [in] block The block.
+ */
+void BLEScanPayloadPool::release(int block) {
+	m_refs[block].fetch_sub(1, std::memory_order_release);
+} // release
+
+/**
+ * @brief Check whether more than one reference to a block exists.
+ * A shared block must be copied before it is written.
+ * @param [in] block The block.
+ */
+bool BLEScanPayloadPool::isShared(int block) {
+	return m_refs[block].load(std::memory_order_acquire) > 1;
+} // isShared
+
+uint8_t* BLEScanPayloadPool::getBlock(int block) {
+	return m_blocks[block];
+} // getBlock
+
+/**
+ * @brief Get the number of blocks currently referenced.
+ */
+uint16_t BLEScanPayloadPool::getInUse() {
+	uint16_t count = 0;
+	for (int i = 0; i < BLE_SCAN_PAYLOAD_BLOCKS; i++) {
+		if (m_refs[i].load(std::memory_order_relaxed) != 0) {
+			count++;
+		}
+	}
+	return count;
+} // getInUse
+
+/**
+ * @brief Get the number of times a block was needed and none was free.
+ */
+uint32_t BLEScanPayloadPool::getExhaustedCount() {
+	return m_exhaustedCount;
+} // getExhaustedCount
+
+
+BLEScanPayloadRef::BLEScanPayloadRef() {
+	m_pPool = nullptr;
+	m_block = -1;
+} // BLEScanPayloadRef
+
+BLEScanPayloadRef::BLEScanPayloadRef(const BLEScanPayloadRef& other) {
+	m_pPool = other.m_pPool;
+	m_block = other.m_block;
+	if (m_block >= 0) {
+		m_pPool->retain(m_block);
+	}
+} // BLEScanPayloadRef
+
+BLEScanPayloadRef::~BLEScanPayloadRef() {
+	release();
+} // ~BLEScanPayloadRef
+
+BLEScanPayloadRef& BLEScanPayloadRef::operator=(const BLEScanPayloadRef& other) {
+	if (other.m_block >= 0) {
+		other.m_pPool->retain(other.m_block);
+	}
+	release();
+	m_pPool = other.m_pPool;
+	m_block = other.m_block;
+	return *this;
+} // operator=
+
+/**
+ * @brief Take a fresh block of the pool, dropping the current one.
+ * @param [in] pPool The pool.
+ * @return False if the pool is exhausted, the reference is then empty.
+ */
+bool BLEScanPayloadRef::acquire(BLEScanPayloadPool* pPool) {
+	release();
+	m_block = pPool->acquire();
+	m_pPool = (m_block >= 0) ? pPool : nullptr;
+	return m_block >= 0;
+} // acquire
+
+/**
+ * @brief Drop the block, leaving the reference empty.
+ */
+void BLEScanPayloadRef::release() {
+	if (m_block >= 0) {
+		m_pPool->release(m_block);
+	}
+	m_pPool = nullptr;
+	m_block = -1;
+} // release
+
+bool BLEScanPayloadRef::isValid() const {
+	return m_block >= 0;
+} // isValid
+
+bool BLEScanPayloadRef::isShared() const {
+	return m_block >= 0 && m_pPool->isShared(m_block);
+} // isShared
+
+/**
+ * @brief Get the block, nullptr if the reference is empty.
+ */
+uint8_t* BLEScanPayloadRef::getData() const {
+	return (m_block >= 0) ? m_pPool->getBlock(m_block) : nullptr;
+} // getData
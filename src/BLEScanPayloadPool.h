@@ -0,0 +1,69 @@
+/*
+ * BLEScanPayloadPool.h
+ *
+ *  Shared storage for advertising payloads too large for a device record.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANPAYLOADPOOL_H_
+#define COMPONENTS_CPP_UTILS_BLESCANPAYLOADPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/// Largest extended advertising payload kept, chained payloads included (the specification allows 1650).
+#ifndef BLE_SCAN_EXT_MAX_DATA
+#define BLE_SCAN_EXT_MAX_DATA    255
+#endif
+
+/// Size of a payload block, enough for an extended advertisement and its scan response.
+#define BLE_SCAN_PAYLOAD_BLOCK   (BLE_SCAN_EXT_MAX_DATA * 2)
+
+/// Number of payload blocks, devices with larger payloads than that are truncated to the legacy size.
+#ifndef BLE_SCAN_PAYLOAD_BLOCKS
+#define BLE_SCAN_PAYLOAD_BLOCKS  8
+#endif
+
+/**
+ * @brief A fixed set of reference counted payload blocks.
+ *
+ * Device records keep legacy payloads inline and only take a block when an extended advertisement does
+ * not fit.  Copies of a device share its block, the reference counts are atomic so copies may be
+ * destroyed from any task.
+ */
+class BLEScanPayloadPool {
+public:
+	BLEScanPayloadPool();
+	int      acquire();
+	void     retain(int block);
+	void     release(int block);
+	bool     isShared(int block);
+	uint8_t* getBlock(int block);
+	uint16_t getInUse();
+	uint32_t getExhaustedCount();
+private:
+	uint8_t               m_blocks[BLE_SCAN_PAYLOAD_BLOCKS][BLE_SCAN_PAYLOAD_BLOCK];
+	std::atomic<uint8_t>  m_refs[BLE_SCAN_PAYLOAD_BLOCKS];
+	std::atomic<uint32_t> m_exhaustedCount;
+};
+
+/**
+ * @brief A reference to a payload block, released when the last copy goes away.
+ */
+class BLEScanPayloadRef {
+public:
+	BLEScanPayloadRef();
+	BLEScanPayloadRef(const BLEScanPayloadRef& other);
+	~BLEScanPayloadRef();
+	BLEScanPayloadRef& operator=(const BLEScanPayloadRef& other);
+	bool     acquire(BLEScanPayloadPool* pPool);
+	void     release();
+	bool     isValid() const;
+	bool     isShared() const;
+	uint8_t* getData() const;
+private:
+	BLEScanPayloadPool* m_pPool;
+	int                 m_block;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANPAYLOADPOOL_H_ */
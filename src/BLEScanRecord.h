@@ -0,0 +1,33 @@
+/*
+ * BLEScanRecord.h
+ *
+ *  A compact, fixed size copy of a single scan report.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANRECORD_H_
+#define COMPONENTS_CPP_UTILS_BLESCANRECORD_H_
+
+#include <stdint.h>
+
+/// Largest payload held by a scan record.
+#ifndef BLE_SCAN_RECORD_MAX_DATA
+#define BLE_SCAN_RECORD_MAX_DATA 31
+#endif
+
+/**
+ * @brief A scan report as delivered by the stack, without any parsing.
+ *
+ * The record is plain data so it can be copied into queues and buffers with memcpy.  The payload
+ * can be walked with BLEAdvertisementView.
+ */
+typedef struct {
+	uint32_t timestamp;                        // Milliseconds since the scheduler started.
+	uint8_t  address[6];                       // Native order, least significant octet first.
+	uint8_t  addressType;                      // T_GAP_REMOTE_ADDR_TYPE.
+	uint8_t  advType;                          // T_GAP_ADV_EVT_TYPE.
+	int8_t   rssi;
+	uint8_t  dataLength;
+	uint8_t  data[BLE_SCAN_RECORD_MAX_DATA];
+} BLEScanRecord;
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANRECORD_H_ */
@@ -0,0 +1,201 @@
+/*
+ * BLEScanRecordReader.cpp
+ *
+ *  Decodes the binary scan record frames produced by BLEScanRecordWriter.
+ */
+
+#include <string.h>
+#include "BLEScanRecordReader.h"
+
+BLEScanRecordReader::BLEScanRecordReader() {
+	m_length         = 0;
+	m_expected       = 0;
+	m_consumed       = 0;
+	m_recordCount    = 0;
+	m_haveSequence   = false;
+	m_sequence       = 0;
+	m_frameCount     = 0;
+	m_lostFrameCount = 0;
+	m_errorCount     = 0;
+} // BLEScanRecordReader
+
+/**
+ * @brief Compute a CRC-16/CCITT-FALSE.
+ * @param [in] pData The data.
+ * @param [in] length The length of the data.
+ * @param [in] crc The CRC of the preceding data, to checksum in several steps.
+ * @return The CRC.
+ */
+uint16_t BLEScanRecordReader::crc16(const uint8_t* pData, size_t length, uint16_t crc) {
+	for (size_t i = 0; i < length; i++) {
+		crc ^= (uint16_t)pData[i] << 8;
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+	}
+	return crc;
+} // crc16
+
+/**
+ * @brief Feed the next byte of the stream.
+ * The records of the last valid frame are given up once the next byte is fed.
+ * @param [in] byte The byte received.
+ * @return True if the byte completed a valid frame, whose records can now be read.
+ */
+bool BLEScanRecordReader::feed(uint8_t byte) {
+	if (m_consumed != 0) {   // Bytes received after the last frame are kept for the next one.
+		skip(m_consumed);
+		m_consumed = 0;
+	}
+	if (m_length == sizeof(m_frame)) {
+		skip(1);
+	}
+	m_frame[m_length++] = byte;
+	return parse();
+} // feed
+
+/**
+ * @brief Drop bytes from the front of the buffer, and any that follow up to the next sync byte.
+ * @param [in] count The number of bytes to drop.
+ */
+void BLEScanRecordReader::skip(size_t count) {
+	while (count < m_length && m_frame[count] != BLE_SCAN_EXPORT_SYNC0) {
+		count++;
+	}
+	memmove(m_frame, m_frame + count, m_length - count);
+	m_length -= count;
+} // skip
+
+/**
+ * @brief Look for a complete frame at the front of the buffer.
+ * A frame that turns out to be corrupt is dropped from its sync byte only, and the bytes received
+ * after it are searched again, so that a damaged length field does not swallow the frames behind it.
+ * @return True if a valid frame was found.
+ */
+bool BLEScanRecordReader::parse() {
+	for (;;) {
+		if (m_length == 0) {
+			return false;
+		}
+		if (m_frame[0] != BLE_SCAN_EXPORT_SYNC0 || (m_length > 1 && m_frame[1] != BLE_SCAN_EXPORT_SYNC1)) {
+			skip(1);
+			continue;
+		}
+		if (m_length < BLE_SCAN_EXPORT_HEADER_SIZE) {
+			return false;
+		}
+		uint16_t length = m_frame[8] | (m_frame[9] << 8);
+		m_expected = BLE_SCAN_EXPORT_HEADER_SIZE + length + 2;
+		if (m_frame[2] != BLE_SCAN_EXPORT_VERSION || m_frame[3] > BLE_SCAN_EXPORT_BATCH || m_expected > sizeof(m_frame)) {
+			m_errorCount++;
+			skip(1);
+			continue;
+		}
+		if (m_length < m_expected) {
+			return false;
+		}
+		if (decodeFrame()) {
+			m_consumed = m_expected;
+			return true;
+		}
+		m_errorCount++;
+		skip(1);
+	}
+} // parse
+
+/**
+ * @brief Check the completed frame and index its records.
+ * @return False if the frame is corrupt.
+ */
+bool BLEScanRecordReader::decodeFrame() {
+	size_t   end = m_expected - 2;
+	uint16_t crc = m_frame[end] | (m_frame[end + 1] << 8);
+	if (crc16(m_frame + 2, end - 2) != crc) {
+		return false;
+	}
+
+	uint8_t count  = m_frame[3];
+	size_t  offset = BLE_SCAN_EXPORT_HEADER_SIZE;
+	for (uint8_t i = 0; i < count; i++) {
+		if (offset >= end) {
+			return false;
+		}
+		uint8_t size = m_frame[offset];
+		if (size + 1 < BLE_SCAN_EXPORT_RECORD_HEAD || size + 1 > BLE_SCAN_EXPORT_RECORD_HEAD + BLE_SCAN_RECORD_MAX_DATA ||
+			offset + 1 + size > end) {
+			return false;
+		}
+		m_recordOffset[i] = offset;
+		offset += 1 + size;
+	}
+	if (offset != end) {
+		return false;
+	}
+
+	uint32_t sequence = m_frame[4] | (m_frame[5] << 8) | (m_frame[6] << 16) | ((uint32_t)m_frame[7] << 24);
+	if (m_haveSequence && sequence != m_sequence + 1) {
+		m_lostFrameCount += sequence - m_sequence - 1;
+	}
+	m_haveSequence = true;
+	m_sequence     = sequence;
+	m_recordCount  = count;
+	m_frameCount++;
+	return true;
+} // decodeFrame
+
+/**
+ * @brief Get the number of records in the last valid frame.
+ */
+uint8_t BLEScanRecordReader::getRecordCount() {
+	return m_recordCount;
+} // getRecordCount
+
+/**
+ * @brief Decode a record of the last valid frame.
+ * Must be called before the next byte is fed.
+ * @param [in] i The index of the record.
+ * @param [out] pRecord Receives the record.
+ * @return False if there is no record with that index.
+ */
+bool BLEScanRecordReader::getRecord(uint8_t i, BLEScanRecord* pRecord) {
+	if (i >= m_recordCount) {
+		return false;
+	}
+	const uint8_t* p = m_frame + m_recordOffset[i];
+	pRecord->dataLength  = p[0] + 1 - BLE_SCAN_EXPORT_RECORD_HEAD;
+	pRecord->timestamp   = p[1] | (p[2] << 8) | (p[3] << 16) | ((uint32_t)p[4] << 24);
+	memcpy(pRecord->address, p + 5, sizeof(pRecord->address));
+	pRecord->addressType = p[11];
+	pRecord->advType     = p[12];
+	pRecord->rssi        = (int8_t)p[13];
+	memcpy(pRecord->data, p + BLE_SCAN_EXPORT_RECORD_HEAD, pRecord->dataLength);
+	return true;
+} // getRecord
+
+/**
+ * @brief Get the sequence number of the last valid frame.
+ */
+uint32_t BLEScanRecordReader::getSequence() {
+	return m_sequence;
+} // getSequence
+
+/**
+ * @brief Get the number of valid frames decoded.
+ */
+uint32_t BLEScanRecordReader::getFrameCount() {
+	return m_frameCount;
+} // getFrameCount
+
+/**
+ * @brief Get the number of frames missing from the sequence.
+ */
+uint32_t BLEScanRecordReader::getLostFrameCount() {
+	return m_lostFrameCount;
+} // getLostFrameCount
+
+/**
+ * @brief Get the number of corrupt frames skipped.
+ */
+uint32_t BLEScanRecordReader::getErrorCount() {
+	return m_errorCount;
+} // getErrorCount
@@ -0,0 +1,78 @@
+/*
+ * BLEScanRecordReader.h
+ *
+ *  Decodes the binary scan record frames produced by BLEScanRecordWriter.
+ *
+ *  Frame layout, every multi-byte field little endian:
+ *
+ *    'B' 'S'        sync
+ *    version        BLE_SCAN_EXPORT_VERSION
+ *    count          number of records in the frame
+ *    sequence       uint32, incremented for every frame, gaps mean frames were lost
+ *    length         uint16, number of record bytes that follow
+ *    records        count times: size, timestamp(4), address(6), addressType, advType, rssi, data
+ *                   where size counts the bytes after itself
+ *    crc            uint16 CRC-16/CCITT-FALSE over version .. records
+ *
+ *  The reader only depends on the C library so it can be built into host tools.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANRECORDREADER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANRECORDREADER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BLEScanRecord.h"
+
+#define BLE_SCAN_EXPORT_SYNC0       'B'
+#define BLE_SCAN_EXPORT_SYNC1       'S'
+#define BLE_SCAN_EXPORT_VERSION     1
+#define BLE_SCAN_EXPORT_HEADER_SIZE 10     // Sync, version, count, sequence and length.
+#define BLE_SCAN_EXPORT_RECORD_HEAD 14     // Size, timestamp, address, address type, adv type and rssi.
+
+/// Maximum number of records batched into one frame.
+#ifndef BLE_SCAN_EXPORT_BATCH
+#define BLE_SCAN_EXPORT_BATCH       8
+#endif
+
+#define BLE_SCAN_EXPORT_MAX_FRAME   (BLE_SCAN_EXPORT_HEADER_SIZE + \
+                                     BLE_SCAN_EXPORT_BATCH * (BLE_SCAN_EXPORT_RECORD_HEAD + BLE_SCAN_RECORD_MAX_DATA) + 2)
+
+/**
+ * @brief Reassembles frames from a byte stream and hands out their records.
+ *
+ * Bytes are fed one at a time, as they arrive from a serial port.  Corrupt frames are skipped by
+ * hunting for the next sync sequence from the byte after their own, and lost frames are counted from
+ * gaps in the sequence number.
+ */
+class BLEScanRecordReader {
+public:
+	BLEScanRecordReader();
+	bool     feed(uint8_t byte);
+	uint8_t  getRecordCount();
+	bool     getRecord(uint8_t i, BLEScanRecord* pRecord);
+	uint32_t getSequence();
+	uint32_t getFrameCount();
+	uint32_t getLostFrameCount();
+	uint32_t getErrorCount();
+	static uint16_t crc16(const uint8_t* pData, size_t length, uint16_t crc = 0xffff);
+
+private:
+	bool     parse();
+	void     skip(size_t count);
+	bool     decodeFrame();
+
+	uint8_t  m_frame[BLE_SCAN_EXPORT_MAX_FRAME];
+	size_t   m_length;                       // Bytes received and not yet dropped, starting with the current frame.
+	size_t   m_expected;                     // Total size of the current frame once the header is known.
+	size_t   m_consumed;                     // Size of the valid frame at the front, dropped on the next byte.
+	uint8_t  m_recordCount;
+	uint16_t m_recordOffset[BLE_SCAN_EXPORT_BATCH];
+	bool     m_haveSequence;
+	uint32_t m_sequence;
+	uint32_t m_frameCount;
+	uint32_t m_lostFrameCount;
+	uint32_t m_errorCount;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANRECORDREADER_H_ */
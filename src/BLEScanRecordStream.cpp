@@ -0,0 +1,84 @@
+/*
+ * BLEScanRecordStream.cpp
+ *
+ *  Hands scan records from the BLE callback to an application task.
+ */
+
+#include "BLEScanRecordStream.h"
+
+BLEScanRecordStream::BLEScanRecordStream() {
+	m_head.store(0);
+	m_tail.store(0);
+	m_pushedCount   = 0;
+	m_droppedCount.store(0);
+	m_highWaterMark = 0;
+} // BLEScanRecordStream
+
+/**
+ * @brief Append a record, called by the producer only.
+ * @param [in] pRecord The record to copy into the ring.
+ * @return False if the ring was full and the record was dropped.
+ */
+bool BLEScanRecordStream::push(const BLEScanRecord* pRecord) {
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+	uint32_t tail = m_tail.load(std::memory_order_acquire);
+	if (head - tail >= BLE_SCAN_STREAM_SIZE) {
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	m_records[head & (BLE_SCAN_STREAM_SIZE - 1)] = *pRecord;
+	m_head.store(head + 1, std::memory_order_release);
+	m_pushedCount++;
+	if (head + 1 - tail > m_highWaterMark) {
+		m_highWaterMark = head + 1 - tail;
+	}
+	return true;
+} // push
+
+/**
+ * @brief Remove the oldest record, called by the consumer only.
+ * @param [out] pRecord Receives the record.
+ * @return False if the ring was empty.
+ */
+bool BLEScanRecordStream::pop(BLEScanRecord* pRecord) {
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	uint32_t head = m_head.load(std::memory_order_acquire);
+	if (head == tail) {
+		return false;
+	}
+	*pRecord = m_records[tail & (BLE_SCAN_STREAM_SIZE - 1)];
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+} // pop
+
+/**
+ * @brief Get the number of records waiting to be read.
+ */
+size_t BLEScanRecordStream::available() {
+	return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+} // available
+
+size_t BLEScanRecordStream::getCapacity() {
+	return BLE_SCAN_STREAM_SIZE;
+} // getCapacity
+
+/**
+ * @brief Get the number of records written to the ring.
+ */
+uint32_t BLEScanRecordStream::getPushedCount() {
+	return m_pushedCount;
+} // getPushedCount
+
+/**
+ * @brief Get the number of records dropped because the consumer fell behind.
+ */
+uint32_t BLEScanRecordStream::getDroppedCount() {
+	return m_droppedCount.load(std::memory_order_relaxed);
+} // getDroppedCount
+
+/**
+ * @brief Get the largest number of records that were waiting at the same time.
+ */
+size_t BLEScanRecordStream::getHighWaterMark() {
+	return m_highWaterMark;
+} // getHighWaterMark
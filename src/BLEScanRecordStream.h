@@ -0,0 +1,47 @@
+/*
+ * BLEScanRecordStream.h
+ *
+ *  Hands scan records from the BLE callback to an application task.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANRECORDSTREAM_H_
+#define COMPONENTS_CPP_UTILS_BLESCANRECORDSTREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "BLEScanRecord.h"
+
+/// Number of records buffered between the scan callback and the application, must be a power of two.
+#ifndef BLE_SCAN_STREAM_SIZE
+#define BLE_SCAN_STREAM_SIZE 32
+#endif
+
+/**
+ * @brief A single producer, single consumer ring of scan records.
+ *
+ * The scan callback is the only producer and calls push(); one application task is the only consumer
+ * and calls pop().  Neither side blocks or takes a lock.  When the ring is full the new record is
+ * dropped and counted.  The class has no dependency on the BLE stack.
+ */
+class BLEScanRecordStream {
+public:
+	BLEScanRecordStream();
+	bool     push(const BLEScanRecord* pRecord);
+	bool     pop(BLEScanRecord* pRecord);
+	size_t   available();
+	size_t   getCapacity();
+	uint32_t getPushedCount();
+	uint32_t getDroppedCount();
+	size_t   getHighWaterMark();
+
+private:
+	BLEScanRecord         m_records[BLE_SCAN_STREAM_SIZE];
+	std::atomic<uint32_t> m_head;        // Next record to write, owned by the producer.
+	std::atomic<uint32_t> m_tail;        // Next record to read, owned by the consumer.
+	uint32_t              m_pushedCount;
+	std::atomic<uint32_t> m_droppedCount;
+	size_t                m_highWaterMark;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANRECORDSTREAM_H_ */
@@ -0,0 +1,149 @@
+/*
+ * BLEScanRecordWriter.cpp
+ *
+ *  Encodes scan records into compact binary frames, see BLEScanRecordReader.h for the layout.
+ */
+
+#include "BLEScanRecordWriter.h"
+
+/**
+ * @brief Create a writer sending frames to a stream, for example Serial.
+ * @param [in] pOutput The stream.
+ * @param [in] batchSize The number of records per frame, at most BLE_SCAN_EXPORT_BATCH.
+ */
+BLEScanRecordWriter::BLEScanRecordWriter(Print* pOutput, uint8_t batchSize) {
+	m_pOutput    = pOutput;
+	m_pBuffer    = nullptr;
+	m_bufferSize = 0;
+	init(batchSize);
+} // BLEScanRecordWriter
+
+/**
+ * @brief Create a writer appending frames to a memory buffer.
+ * @param [in] pBuffer The buffer.
+ * @param [in] size The size of the buffer.
+ * @param [in] batchSize The number of records per frame, at most BLE_SCAN_EXPORT_BATCH.
+ */
+BLEScanRecordWriter::BLEScanRecordWriter(uint8_t* pBuffer, size_t size, uint8_t batchSize) {
+	m_pOutput    = nullptr;
+	m_pBuffer    = pBuffer;
+	m_bufferSize = size;
+	init(batchSize);
+} // BLEScanRecordWriter
+
+void BLEScanRecordWriter::init(uint8_t batchSize) {
+	if (batchSize == 0 || batchSize > BLE_SCAN_EXPORT_BATCH) {
+		batchSize = BLE_SCAN_EXPORT_BATCH;
+	}
+	m_batchSize         = batchSize;
+	m_bufferLength      = 0;
+	m_frameLength       = BLE_SCAN_EXPORT_HEADER_SIZE;
+	m_frameCount        = 0;
+	m_sequence          = 0;
+	m_recordCount       = 0;
+	m_droppedFrameCount = 0;
+} // init
+
+/**
+ * @brief Append a record to the current frame.
+ * The frame is written out when it holds the batch size of records.
+ * @param [in] pRecord The record.
+ * @return False if a completed frame could not be written.
+ */
+bool BLEScanRecordWriter::write(const BLEScanRecord* pRecord) {
+	uint8_t  dataLength = (pRecord->dataLength <= BLE_SCAN_RECORD_MAX_DATA) ? pRecord->dataLength : BLE_SCAN_RECORD_MAX_DATA;
+	uint8_t* p = m_frame + m_frameLength;
+	p[0]  = BLE_SCAN_EXPORT_RECORD_HEAD - 1 + dataLength;
+	p[1]  = pRecord->timestamp;
+	p[2]  = pRecord->timestamp >> 8;
+	p[3]  = pRecord->timestamp >> 16;
+	p[4]  = pRecord->timestamp >> 24;
+	memcpy(p + 5, pRecord->address, sizeof(pRecord->address));
+	p[11] = pRecord->addressType;
+	p[12] = pRecord->advType;
+	p[13] = (uint8_t)pRecord->rssi;
+	memcpy(p + BLE_SCAN_EXPORT_RECORD_HEAD, pRecord->data, dataLength);
+	m_frameLength += BLE_SCAN_EXPORT_RECORD_HEAD + dataLength;
+	m_frameCount++;
+	m_recordCount++;
+	if (m_frameCount >= m_batchSize) {
+		return flush();
+	}
+	return true;
+} // write
+
+/**
+ * @brief Write out the current frame, even if it is not full.
+ * @return False if the frame did not fit in the buffer and was dropped.
+ */
+bool BLEScanRecordWriter::flush() {
+	if (m_frameCount == 0) {
+		return true;
+	}
+	uint16_t length = m_frameLength - BLE_SCAN_EXPORT_HEADER_SIZE;
+	m_frame[0] = BLE_SCAN_EXPORT_SYNC0;
+	m_frame[1] = BLE_SCAN_EXPORT_SYNC1;
+	m_frame[2] = BLE_SCAN_EXPORT_VERSION;
+	m_frame[3] = m_frameCount;
+	m_frame[4] = m_sequence;
+	m_frame[5] = m_sequence >> 8;
+	m_frame[6] = m_sequence >> 16;
+	m_frame[7] = m_sequence >> 24;
+	m_frame[8] = length;
+	m_frame[9] = length >> 8;
+	uint16_t crc = BLEScanRecordReader::crc16(m_frame + 2, m_frameLength - 2);
+	m_frame[m_frameLength++] = crc;
+	m_frame[m_frameLength++] = crc >> 8;
+	m_sequence++;
+
+	bool written = true;
+	if (m_pOutput != nullptr) {
+		written = (m_pOutput->write(m_frame, m_frameLength) == m_frameLength);
+	} else if (m_bufferLength + m_frameLength <= m_bufferSize) {
+		memcpy(m_pBuffer + m_bufferLength, m_frame, m_frameLength);
+		m_bufferLength += m_frameLength;
+	} else {
+		written = false;
+	}
+	if (!written) {
+		m_droppedFrameCount++;
+	}
+	m_frameLength = BLE_SCAN_EXPORT_HEADER_SIZE;
+	m_frameCount  = 0;
+	return written;
+} // flush
+
+/**
+ * @brief Get the number of bytes of frames held in the buffer sink.
+ */
+size_t BLEScanRecordWriter::getBufferLength() {
+	return m_bufferLength;
+} // getBufferLength
+
+/**
+ * @brief Empty the buffer sink once its frames have been sent.
+ */
+void BLEScanRecordWriter::resetBuffer() {
+	m_bufferLength = 0;
+} // resetBuffer
+
+/**
+ * @brief Get the sequence number the next frame will carry.
+ */
+uint32_t BLEScanRecordWriter::getSequence() {
+	return m_sequence;
+} // getSequence
+
+/**
+ * @brief Get the number of records written.
+ */
+uint32_t BLEScanRecordWriter::getRecordCount() {
+	return m_recordCount;
+} // getRecordCount
+
+/**
+ * @brief Get the number of frames that could not be written.
+ */
+uint32_t BLEScanRecordWriter::getDroppedFrameCount() {
+	return m_droppedFrameCount;
+} // getDroppedFrameCount
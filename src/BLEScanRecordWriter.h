@@ -0,0 +1,50 @@
+/*
+ * BLEScanRecordWriter.h
+ *
+ *  Encodes scan records into compact binary frames, see BLEScanRecordReader.h for the layout.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANRECORDWRITER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANRECORDWRITER_H_
+
+#include <Arduino.h>
+#include "BLEScanRecord.h"
+#include "BLEScanRecordReader.h"
+
+/**
+ * @brief Batches scan records into frames and writes them to a Print or a memory buffer.
+ *
+ * Records are appended to a frame in place, no intermediate strings are built.  A frame is written
+ * once it holds the batch size of records or when flush() is called.  Every frame carries a
+ * sequence number; frames that do not fit in a buffer sink are dropped but still consume a sequence
+ * number so the receiver can detect the loss.
+ */
+class BLEScanRecordWriter {
+public:
+	BLEScanRecordWriter(Print* pOutput, uint8_t batchSize = BLE_SCAN_EXPORT_BATCH);
+	BLEScanRecordWriter(uint8_t* pBuffer, size_t size, uint8_t batchSize = BLE_SCAN_EXPORT_BATCH);
+	bool     write(const BLEScanRecord* pRecord);
+	bool     flush();
+	size_t   getBufferLength();
+	void     resetBuffer();
+	uint32_t getSequence();
+	uint32_t getRecordCount();
+	uint32_t getDroppedFrameCount();
+
+private:
+	void     init(uint8_t batchSize);
+
+	Print*   m_pOutput;
+	uint8_t* m_pBuffer;
+	size_t   m_bufferSize;
+	size_t   m_bufferLength;
+	uint8_t  m_batchSize;
+	uint8_t  m_frame[BLE_SCAN_EXPORT_MAX_FRAME];
+	size_t   m_frameLength;
+	uint8_t  m_frameCount;                   // Records in the frame being built.
+	uint32_t m_sequence;
+	uint32_t m_recordCount;
+	uint32_t m_droppedFrameCount;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANRECORDWRITER_H_ */
@@ -0,0 +1,44 @@
+/*
+ * BLEScanReport.h
+ *
+ *  A scan report as handed to the scan, independent of the stack message it came from.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANREPORT_H_
+#define COMPONENTS_CPP_UTILS_BLESCANREPORT_H_
+
+#include <stdint.h>
+
+/// The report carries a complete payload.
+#define BLE_SCAN_DATA_COMPLETE  0
+/// More fragments of the payload follow in further reports.
+#define BLE_SCAN_DATA_MORE      1
+/// The payload is incomplete and no more fragments will follow.
+#define BLE_SCAN_DATA_TRUNCATED 2
+
+/// Largest payload of a legacy advertising report.
+#define BLE_SCAN_LEGACY_MAX_DATA 31
+
+/// Value of txPower when the report does not carry one.
+#define BLE_SCAN_TX_POWER_NONE  127
+
+/**
+ * @brief A legacy or extended advertising report.
+ *
+ * Legacy reports (GAP_MSG_LE_SCAN_INFO) and extended reports are both converted to this form before
+ * they are processed, and it is what BLEScan::injectReport() takes to replay reports without a radio.
+ * The report only points at the address and payload, which must stay valid for the call.
+ */
+typedef struct {
+	const uint8_t* address;        // 6 octets, least significant first.
+	uint8_t        addressType;    // T_GAP_REMOTE_ADDR_TYPE.
+	uint8_t        advType;        // T_GAP_ADV_EVT_TYPE, extended reports are mapped to the nearest legacy type.
+	int8_t         rssi;
+	int8_t         txPower;        // BLE_SCAN_TX_POWER_NONE if not reported.
+	bool           extended;       // Received through extended advertising.
+	uint8_t        sid;            // Advertising set of an extended report.
+	uint16_t       dataLength;
+	const uint8_t* data;
+} BLEScanReport;
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANREPORT_H_ */
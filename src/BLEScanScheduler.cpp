@@ -0,0 +1,140 @@
+/*
+ * BLEScanScheduler.cpp
+ *
+ *  Chooses the scan duty cycle from what the previous scan periods observed.
+ */
+
+#include <string.h>
+#include "BLEScanScheduler.h"
+
+BLEScanScheduler::BLEScanScheduler() {
+	m_config.minIntervalMs  = 40;
+	m_config.maxIntervalMs  = 1280;
+	m_config.minDutyPercent = 10;
+	m_config.maxDutyPercent = 100;
+	m_config.busyRate       = 10;
+	m_config.stableRate     = 1;
+	m_config.stablePeriods  = 3;
+	m_config.backlogLimit   = 16;
+	m_config.allowActive    = true;
+	m_config.memoryPeriods  = 10;
+	reset();
+} // BLEScanScheduler
+
+/**
+ * @brief Replace the limits and thresholds.
+ * @param [in] pConfig The new configuration.
+ */
+void BLEScanScheduler::setConfig(const BLEScanSchedulerConfig* pConfig) {
+	m_config = *pConfig;
+	if (m_config.maxIntervalMs < m_config.minIntervalMs) {
+		m_config.maxIntervalMs = m_config.minIntervalMs;
+	}
+	if (m_config.maxDutyPercent > 100) {
+		m_config.maxDutyPercent = 100;
+	}
+	if (m_config.minDutyPercent > m_config.maxDutyPercent) {
+		m_config.minDutyPercent = m_config.maxDutyPercent;
+	}
+} // setConfig
+
+/**
+ * @brief Start again from the most aggressive level.
+ * A fresh scan has to discover its environment first, every device counts as new again.
+ */
+void BLEScanScheduler::reset() {
+	m_level       = BLE_SCAN_SCHEDULER_LEVELS - 1;
+	m_stableCount = 0;
+	m_congested   = false;
+	m_period      = 1;
+	memset(m_seen, 0, sizeof(m_seen));
+} // reset
+
+/**
+ * @brief Note a device seen during the current period.
+ * @param [in] key The packed address and address type of the device, see BLEAddress::toKey().
+ * @return True if the device was not seen in the previous memoryPeriods periods.
+ */
+bool BLEScanScheduler::observe(uint64_t key) {
+	uint32_t fingerprint = (uint32_t)((key * 0x9e3779b97f4a7c15ULL) >> 32);
+	uint32_t victim = fingerprint & (BLE_SCAN_SCHEDULER_SEEN_SIZE - 1);
+	for (uint32_t i = 0; i < BLE_SCAN_SCHEDULER_SEEN_PROBE; i++) {
+		uint32_t slot = (fingerprint + i) & (BLE_SCAN_SCHEDULER_SEEN_SIZE - 1);
+		if (m_seen[slot].period != 0 && m_seen[slot].fingerprint == fingerprint) {
+			bool isNew = (m_period - m_seen[slot].period > m_config.memoryPeriods);
+			m_seen[slot].period = m_period;
+			return isNew;
+		}
+		if (m_seen[slot].period < m_seen[victim].period) {   // Free slots come first.
+			victim = slot;
+		}
+	}
+	m_seen[victim].fingerprint = fingerprint;
+	m_seen[victim].period      = m_period;
+	return true;
+} // observe
+
+/**
+ * @brief Feed the result of a scan period and choose the parameters of the next one.
+ * @param [in] pObservation What the period observed.
+ * @return The parameters for the next period.
+ */
+BLEScanParams BLEScanScheduler::update(const BLEScanObservation* pObservation) {
+	uint32_t duration = (pObservation->durationMs != 0) ? pObservation->durationMs : 1;
+	uint32_t rate     = (uint32_t)((uint64_t)pObservation->newDevices * 60000 / duration);
+
+	m_congested = (pObservation->dropped != 0 || pObservation->backlog > m_config.backlogLimit);
+	if (m_congested) {
+		if (m_level > 0) {
+			m_level--;
+		}
+		m_stableCount = 0;
+	} else if (rate >= m_config.busyRate) {
+		if (m_level < BLE_SCAN_SCHEDULER_LEVELS - 1) {
+			m_level++;
+		}
+		m_stableCount = 0;
+	} else if (rate <= m_config.stableRate) {
+		if (++m_stableCount >= m_config.stablePeriods) {
+			if (m_level > 0) {
+				m_level--;
+			}
+			m_stableCount = 0;
+		}
+	} else {
+		m_stableCount = 0;
+	}
+
+	m_period++;
+	return getParams();
+} // update
+
+/**
+ * @brief Get the parameters of the current level.
+ */
+BLEScanParams BLEScanScheduler::getParams() {
+	BLEScanParams params;
+	uint32_t steps = BLE_SCAN_SCHEDULER_LEVELS - 1;
+	uint32_t range = m_config.maxIntervalMs - m_config.minIntervalMs;
+	uint32_t duty  = m_config.minDutyPercent;
+	if (steps != 0) {
+		params.intervalMs = m_config.maxIntervalMs - range * m_level / steps;
+		duty += (uint32_t)(m_config.maxDutyPercent - m_config.minDutyPercent) * m_level / steps;
+	} else {
+		params.intervalMs = m_config.minIntervalMs;
+		duty = m_config.maxDutyPercent;
+	}
+	params.windowMs = (uint32_t)params.intervalMs * duty / 100;
+	if (params.windowMs == 0) {
+		params.windowMs = 1;
+	}
+	params.active = m_config.allowActive && !m_congested && (m_level == BLE_SCAN_SCHEDULER_LEVELS - 1);
+	return params;
+} // getParams
+
+/**
+ * @brief Get the current level, 0 is the most relaxed.
+ */
+uint8_t BLEScanScheduler::getLevel() {
+	return m_level;
+} // getLevel
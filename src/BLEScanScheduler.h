@@ -0,0 +1,99 @@
+/*
+ * BLEScanScheduler.h
+ *
+ *  Chooses the scan duty cycle from what the previous scan periods observed.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANSCHEDULER_H_
+#define COMPONENTS_CPP_UTILS_BLESCANSCHEDULER_H_
+
+#include <stdint.h>
+
+/// Number of duty cycle steps between the most relaxed and the most aggressive scan.
+#ifndef BLE_SCAN_SCHEDULER_LEVELS
+#define BLE_SCAN_SCHEDULER_LEVELS 4
+#endif
+
+/// Number of devices remembered to tell new devices from returning ones, must be a power of two.
+/// Each entry takes 8 bytes.
+#ifndef BLE_SCAN_SCHEDULER_SEEN_SIZE
+#define BLE_SCAN_SCHEDULER_SEEN_SIZE  256
+#endif
+
+/// Number of slots probed for a device before the one seen longest ago is replaced.
+#ifndef BLE_SCAN_SCHEDULER_SEEN_PROBE
+#define BLE_SCAN_SCHEDULER_SEEN_PROBE 8
+#endif
+
+/**
+ * @brief Limits and thresholds of the scan scheduler.
+ */
+typedef struct {
+	uint16_t minIntervalMs;       // Scan interval at the most aggressive level, bounds discovery latency.
+	uint16_t maxIntervalMs;       // Scan interval at the most relaxed level.
+	uint8_t  minDutyPercent;      // Window / interval at the most relaxed level, bounds power.
+	uint8_t  maxDutyPercent;      // Window / interval at the most aggressive level.
+	uint16_t busyRate;            // New devices per minute that count as a changing environment.
+	uint16_t stableRate;          // New devices per minute below which the environment is stable.
+	uint8_t  stablePeriods;       // Stable periods in a row before stepping down one level.
+	uint16_t backlogLimit;        // Undelivered records above which the scan backs off.
+	bool     allowActive;         // Use active scanning at the most aggressive level.
+	uint8_t  memoryPeriods;       // A device seen again within this many periods is not new.
+} BLEScanSchedulerConfig;
+
+/**
+ * @brief What a scan period observed.
+ */
+typedef struct {
+	uint32_t durationMs;          // Length of the period.
+	uint32_t reports;             // Advertisements received.
+	uint32_t newDevices;          // Devices not seen in the previous memoryPeriods periods.
+	uint32_t backlog;             // Records waiting to be consumed at the end of the period.
+	uint32_t dropped;             // Records dropped during the period because the consumer fell behind.
+} BLEScanObservation;
+
+/**
+ * @brief Scan parameters chosen for the next period.
+ */
+typedef struct {
+	uint16_t intervalMs;
+	uint16_t windowMs;
+	bool     active;
+} BLEScanParams;
+
+/**
+ * @brief A pure scan duty cycle policy.
+ *
+ * The scheduler steps between BLE_SCAN_SCHEDULER_LEVELS levels, from a long interval with a small
+ * duty cycle to a short interval with a large one.  A discovery rate above busyRate steps up straight
+ * away, stablePeriods periods below stableRate in a row step down one level, and a consumer that falls
+ * behind (backlog or drops) forces a step down and passive scanning.
+ *
+ * New devices are counted by observe(), which remembers the devices of the last memoryPeriods periods
+ * in a fixed table, so a device that keeps advertising is new once however often the scan restarts.
+ * When the probe window of a device is full the entry seen longest ago is recycled.  The class has
+ * no dependency on the BLE stack or the clock, so it can be replayed against recorded traces.
+ */
+class BLEScanScheduler {
+public:
+	BLEScanScheduler();
+	void           setConfig(const BLEScanSchedulerConfig* pConfig);
+	bool           observe(uint64_t key);
+	BLEScanParams  update(const BLEScanObservation* pObservation);
+	BLEScanParams  getParams();
+	uint8_t        getLevel();
+	void           reset();
+
+private:
+	BLEScanSchedulerConfig m_config;
+	uint8_t                m_level;
+	uint8_t                m_stableCount;
+	bool                   m_congested;      // The consumer fell behind in the last period.
+	uint32_t               m_period;         // Number of the current period, from 1.
+	struct {
+		uint32_t fingerprint;
+		uint32_t period;                      // Last period the device was seen in, 0 marks a free slot.
+	}                      m_seen[BLE_SCAN_SCHEDULER_SEEN_SIZE];
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANSCHEDULER_H_ */
@@ -82,31 +82,41 @@ BLEServerCallbacks* BLEServer::getCallbacks() {
 	return m_pServerCallbacks;
 }
 
-void BLEServerCallbacks::onConnect(BLEServer* pServer) {
+void BLEServerCallbacks::onConnect(BLEServer* /*pServer*/) {
 
 } // onConnect
 
-void BLEServerCallbacks::onDisconnect(BLEServer* pServer) {
+void BLEServerCallbacks::onDisconnect(BLEServer* /*pServer*/) {
 
 } // onDisconnect
 
-void BLEServer::addPeerDevice(void* peer, bool _client, uint16_t conn_id) {
+void BLEServer::addPeerDevice(void* peer, bool /*_client*/, uint16_t conn_id) {
 	conn_status_t status = {
 		.peer_device = peer,
 		.connected = true,
-		.mtu = 247
+		.mtu = 23    // Until the peer exchanges MTU.
 	};
     m_connId = conn_id;
+	m_semaphorePeers.take("addPeerDevice");
 	m_connectedServersMap.insert(std::pair<uint16_t, conn_status_t>(conn_id, status));	
+	m_semaphorePeers.give();
 }
 
-bool BLEServer::removePeerDevice(uint16_t conn_id, bool _client) {
-	return m_connectedServersMap.erase(conn_id) > 0;
+bool BLEServer::removePeerDevice(uint16_t conn_id, bool /*_client*/) {
+	m_semaphorePeers.take("removePeerDevice");
+	bool removed = m_connectedServersMap.erase(conn_id) > 0;
+	m_semaphorePeers.give();
+	m_serviceMap.releaseConnection(conn_id);
+	return removed;
 }
 /* multi connect support */
 
 uint16_t BLEServer::getPeerMTU(uint16_t conn_id) {
-	return m_connectedServersMap.find(conn_id)->second.mtu;
+	m_semaphorePeers.take("getPeerMTU");
+	std::map<uint16_t, conn_status_t>::iterator it = m_connectedServersMap.find(conn_id);
+	uint16_t mtu = (it != m_connectedServersMap.end()) ? it->second.mtu : 23;
+	m_semaphorePeers.give();
+	return mtu;
 }
 
 uint16_t  BLEServer::getconnId(){
@@ -117,11 +127,13 @@ uint16_t  BLEServer::getconnId(){
 /* TODO do some more tweaks */
 void BLEServer::updatePeerMTU(uint16_t conn_id, uint16_t mtu) {
 	// set mtu in conn_status_t
+	m_semaphorePeers.take("updatePeerMTU");
 	const std::map<uint16_t, conn_status_t>::iterator it = m_connectedServersMap.find(conn_id);
 	if (it != m_connectedServersMap.end()) {
 		it->second.mtu = mtu;
 		std::swap(m_connectedServersMap[conn_id], it->second);
 	}
+	m_semaphorePeers.give();
 }
 
 /**
@@ -159,11 +171,11 @@ BLEService* BLEServer::getServiceByUUID(BLEUUID uuid) {
  * Allow to connect GATT server to peer device
  * Probably can be used in ANCS for iPhone
  */
-bool BLEServer::connect(BLEAddress address) {
+bool BLEServer::connect(BLEAddress /*address*/) {
 	return true;
 } // connect
 
-void BLEServer::disconnect(uint16_t connId) {
+void BLEServer::disconnect(uint16_t /*connId*/) {
 
 }
 
@@ -215,10 +227,28 @@ void BLEServer::startAdvertising() {
 
 
 
-std::map<uint16_t, conn_status_t> BLEServer::getPeerDevices(bool _client) {
-	return m_connectedServersMap;
+std::map<uint16_t, conn_status_t> BLEServer::getPeerDevices(bool /*_client*/) {
+	m_semaphorePeers.take("getPeerDevices");
+	std::map<uint16_t, conn_status_t> peers = m_connectedServersMap;
+	m_semaphorePeers.give();
+	return peers;
 }
 
+/**
+ * @brief Get the number of services, characteristics and descriptors of the server.
+ */
+uint16_t BLEServer::getAttributeCount() {
+	return m_serviceMap.getAttributeCount();
+} // getAttributeCount
+
+/**
+ * @brief Get the memory used to look up the attributes of the server, in bytes.
+ * Divided by getAttributeCount() this gives the cost of each attribute.
+ */
+size_t BLEServer::getAttributeMemoryUsage() {
+	return m_serviceMap.getMemoryUsage();
+} // getAttributeMemoryUsage
+
 /*
  * Remove service
  */
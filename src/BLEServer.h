@@ -11,6 +11,7 @@
 
 #include <string>
 #include <string.h>
+#include <vector>
 
 #include "BLEUUID.h"
 #include "BLEAdvertising.h"
@@ -18,6 +19,7 @@
 #include "BLEService.h"
 #include "BLEFreeRTOS.h"
 #include "BLEAddress.h"
+#include "BLEUUIDIndex.h"
 typedef uint8_t T_SERVER_ID; 
 
 class BLEServerCallbacks;
@@ -45,10 +47,31 @@ public:
     void        handleGATTServerEvent(T_SERVER_ID service_id, void *p_data);
     void 		removeService(BLEService *service);
     int 		getRegisteredServiceCount();
+    void        addToDispatch(BLEService* service);
+    void        releaseConnection(uint16_t connId);
+    BLEService* const* begin() const;
+    BLEService* const* end() const;
+    uint16_t    getAttributeCount();
+    size_t      getMemoryUsage();
 private:
-    std::map<BLEService*, std::string> m_uuidMap;
-    std::map<uint16_t, BLEService*>    m_handleMap;
-    std::map<BLEService*, std::string>::iterator m_iterator;
+    // The owner of an attribute, exactly one of the two is set for a handle in use.
+    typedef struct {
+        BLECharacteristic* pCharacteristic;
+        BLEDescriptor*     pDescriptor;
+    } DispatchEntry;
+    // The entries of a started service in m_dispatch, indexed by attribute handle.
+    typedef struct {
+        uint16_t    base;
+        uint16_t    count;
+        BLEService* pService;
+    } DispatchRange;
+
+    std::vector<BLEService*>           m_services;        // In the order they were created.
+    BLEUUIDIndex<BLEService>           m_uuidIndex;
+    size_t                             m_iterator = 0;
+    std::vector<DispatchEntry>         m_dispatch;
+    std::vector<DispatchRange>         m_dispatchRanges;   // Indexed by service id.
+    void                               removeFromDispatch(BLEService* service);
 
 };
 
@@ -83,19 +106,24 @@ public:
     BLEServerCallbacks* getCallbacks();
     std::map<uint16_t, conn_status_t> getPeerDevices(bool client);
     void updatePeerMTU(uint16_t connId, uint16_t mtu);
+    uint16_t        getAttributeCount();
+    size_t          getAttributeMemoryUsage();
     uint16_t		m_appId;
 private:
     BLEServer();
     friend class BLEDevice;
+    friend class BLEService;
+    friend class BLECharacteristic;
 
     uint16_t			m_connId;
     uint32_t            m_connectedCount;
     uint16_t            m_gatts_if;
     BLEServerCallbacks* m_pServerCallbacks = nullptr;
-    std::map<uint16_t, conn_status_t> m_connectedServersMap;
+    std::map<uint16_t, conn_status_t> m_connectedServersMap;   // Guarded by m_semaphorePeers, peers come and go on the BLE task.
 
     BLEFreeRTOS::Semaphore m_semaphoreRegisterAppEvt 	= BLEFreeRTOS::Semaphore("RegisterAppEvt");
     BLEFreeRTOS::Semaphore m_semaphoreCreateEvt 		= BLEFreeRTOS::Semaphore("CreateEvt");
+    BLEFreeRTOS::Semaphore m_semaphorePeers 			= BLEFreeRTOS::Semaphore("Peers");
     void            createApp(uint16_t appId);  
     BLEServiceMap       m_serviceMap;
 	void             handleGATTServerEvent(T_SERVER_ID service_id, void *p_data);
@@ -92,18 +92,21 @@ BLECharacteristic* BLEService::getCharacteristic(BLEUUID uuid) {
 /**
  * @brief Add a characteristic to the service.
  * @param [in] pCharacteristic A pointer to the characteristic to be added.
+ * @return False if the characteristic was not added, because the service was already started or already
+ * holds a characteristic with this UUID.
  */
-void BLEService::addCharacteristic(BLECharacteristic* pCharacteristic) {
+bool BLEService::addCharacteristic(BLECharacteristic* pCharacteristic) {
 	// We maintain a mapping of characteristics owned by this service.  These are managed by the
 	// BLECharacteristicMap class instance found in m_characteristicMap.  We add the characteristic
 	// to the map and then ask the service to add the characteristic at the BLE level (ESP-IDF).
 	// Check that we don't add the same characteristic twice.
-	if (m_characteristicMap.getByUUID(pCharacteristic->getUUID()) != nullptr) {	
-		return;
+	BLECharacteristic* pExisting = m_characteristicMap.getByUUID(pCharacteristic->getUUID());
+	if (pExisting != nullptr) {
+		return pExisting == pCharacteristic;
 	}
 	// Remember this characteristic in our map of characteristics.  At this point, we can lookup by UUID
 	// but not by handle.  The handle is allocated to us on the ESP_GATTS_ADD_CHAR_EVT.
-	m_characteristicMap.setByUUID(pCharacteristic, pCharacteristic->getUUID());
+	return m_characteristicMap.setByUUID(pCharacteristic, pCharacteristic->getUUID());
 } // addCharacteristic
 
 
@@ -165,18 +168,18 @@ void BLEService::start() {
 // We ask the BLE runtime to start the service and then create each of the characteristics.
 // We start the service through its local handle which was returned in the ESP_GATTS_CREATE_EVT event
 // obtained as a result of calling esp_ble_gatts_create_service().
-	BLECharacteristic *pCharacteristic = m_characteristicMap.getFirst();
-
-	while (pCharacteristic != nullptr) {
+	for (BLECharacteristic* pCharacteristic : m_characteristicMap) {
 		m_lastCreatedCharacteristic = pCharacteristic;
 		pCharacteristic->executeCreate(this);
-
-		pCharacteristic = m_characteristicMap.getNext();
+		pCharacteristic->m_descriptorMap.freeze();
 	}
+	// The attributes are now known to the stack, later additions would not be served.
+	m_characteristicMap.freeze();
 	// Start each of the characteristics ... these are found in the m_characteristicMap.
 	T_SERVER_ID handle = ble_service_start(getgiff());
 	m_handle = handle;
 	RPC_DEBUG("ble_service_start: %d", handle);
+	m_pServer->m_serviceMap.addToDispatch(this);
 } // start
 
 /**
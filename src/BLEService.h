@@ -12,6 +12,8 @@
 #include "BLEServer.h"
 #include "BLEUUID.h"
 #include "BLEFreeRTOS.h"
+#include "BLEUUIDIndex.h"
+#include <vector>
 typedef uint8_t T_SERVER_ID;
 
 class BLEServer;
@@ -21,20 +23,24 @@ class BLEServer;
  */
 class BLECharacteristicMap {
 public:
-    void setByUUID(BLECharacteristic* pCharacteristic, BLEUUID uuid);
+    bool setByUUID(BLECharacteristic* pCharacteristic, BLEUUID uuid);
 	void setByHandle(uint16_t handle, BLECharacteristic* pCharacteristic);
 	BLECharacteristic* getByUUID(BLEUUID uuid);
 	BLECharacteristic* getFirst();
 	BLECharacteristic* getNext();
     BLECharacteristic* getByHandle(uint16_t handle);
     void handleGATTServerEvent(T_SERVER_ID service_id, void *p_data);
+    BLECharacteristic* const* begin() const;
+    BLECharacteristic* const* end() const;
+    size_t getCount();
+    void   freeze();
+    size_t getMemoryUsage();
 
 private:
-	std::map<BLECharacteristic*, std::string> m_uuidMap;
-	std::map<uint16_t, BLECharacteristic*> m_handleMap;
-	std::map<BLECharacteristic*, std::string>::iterator m_iterator;
-
-
+	std::vector<BLECharacteristic*> m_characteristics;   // In the order they were added.
+	BLEUUIDIndex<BLECharacteristic> m_uuidIndex;
+	size_t m_iterator = 0;
+	bool   m_frozen = false;
 };
 
 
@@ -44,7 +50,7 @@ private:
  */
 class BLEService {
 public:
-    void               addCharacteristic(BLECharacteristic* pCharacteristic);
+    bool               addCharacteristic(BLECharacteristic* pCharacteristic);
     BLEUUID            getUUID();
 	uint16_t           getHandle();
 	BLEServer*         getServer();
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <iomanip>
 #include "BLEService.h"
+#include "BLEDescriptor.h"
 
 
 /**
@@ -15,32 +16,34 @@
  * @param [in] UUID The UUID to look up the service.
  * @return The characteristic.
  */
-BLEService* BLEServiceMap::getByUUID(BLEUUID uuid, uint8_t inst_id) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
-	}
-	//return m_uuidMap.at(uuid.toString());
-	return nullptr;
+BLEService* BLEServiceMap::getByUUID(BLEUUID uuid, uint8_t /*inst_id*/) {
+	return m_uuidIndex.get(uuid);
 } // getByUUID
 
 
 /**
  * @brief Return the service by handle.
  * @param [in] handle The handle to look up the service.
- * @return The service.
+ * @return The service, or nullptr if there is none with this handle.
  */
 BLEService* BLEServiceMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	for (BLEService* pService : m_services) {
+		if (pService->getHandle() == handle) {
+			return pService;
+		}
+	}
+	return nullptr;
 } // getByHandle
 
+/**
+ * @brief Get the first service in the map.
+ * getFirst() and getNext() share one position, code that may run while another walk is in progress
+ * iterates from begin() to end() instead.
+ * @return The first service in the map.
+ */
 BLEService* BLEServiceMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEService* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 /**
@@ -57,33 +60,47 @@ BLEService* BLEServiceMap::getByUUID(const char* uuid) {
  * @return The next service in the map.
  */
 BLEService* BLEServiceMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) return nullptr;
-	BLEService* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	if (m_iterator >= m_services.size()) return nullptr;
+	return m_services[m_iterator++];
 } // getNext
 
+BLEService* const* BLEServiceMap::begin() const {
+	return m_services.data();
+} // begin
+
+BLEService* const* BLEServiceMap::end() const {
+	return m_services.data() + m_services.size();
+} // end
+
 
 
 
 /**
  * @brief Set the service by handle.
+ * The handle is that of the service itself, this only adds the service if it is not known yet.
  * @param [in] handle The handle of the service.
  * @param [in] service The service to cache.
  * @return N/A.
  */
-void BLEServiceMap::setByHandle(uint16_t handle, BLEService* service) {
-	m_handleMap.insert(std::pair<uint16_t, BLEService*>(handle, service));
+void BLEServiceMap::setByHandle(uint16_t /*handle*/, BLEService* service) {
+	setByUUID(service->getUUID(), service);
 } // setByHandle
 
 /**
  * @brief Set the service by UUID.
+ * The UUID is that of the service itself, services are kept in the order they are created.
  * @param [in] uuid The uuid of the service.
  * @param [in] characteristic The service to cache.
  * @return N/A.
  */
-void BLEServiceMap::setByUUID(BLEUUID uuid, BLEService* service) {
-	m_uuidMap.insert(std::pair<BLEService*, std::string>(service, uuid.toString()));
+void BLEServiceMap::setByUUID(BLEUUID /*uuid*/, BLEService* service) {
+	for (BLEService* pExisting : m_services) {
+		if (pExisting == service) {
+			return;
+		}
+	}
+	m_services.push_back(service);
+	m_uuidIndex.insert(service->getUUID(), service);
 } // setByUUID
 
 /**
@@ -93,11 +110,11 @@ void BLEServiceMap::setByUUID(BLEUUID uuid, BLEService* service) {
 std::string BLEServiceMap::toString() {
 	std::string res;
 	char hex[5];
-	for (auto &myPair: m_handleMap) {
+	for (BLEService* pService : m_services) {
 		res += "handle: 0x";
-		snprintf(hex, sizeof(hex), "%04x", myPair.first);
+		snprintf(hex, sizeof(hex), "%04x", pService->getHandle());
 		res += hex;
-		res += ", uuid: " + myPair.second->getUUID().toString() + "\n";
+		res += ", uuid: " + pService->getUUID().toString() + "\n";
 	}
 	return res;
 } // toString
@@ -107,8 +124,26 @@ std::string BLEServiceMap::toString() {
  * @return N/A.
  */
 void BLEServiceMap::removeService(BLEService* service) {
-	m_handleMap.erase(service->getHandle());
-	m_uuidMap.erase(service);
+	removeFromDispatch(service);
+	for (size_t i = 0; i < m_services.size(); i++) {
+		if (m_services[i] == service) {
+			m_services.erase(m_services.begin() + i);
+			if (m_iterator > i) {
+				m_iterator--;
+			}
+			break;
+		}
+	}
+	if (m_uuidIndex.remove(service->getUUID(), service)) {
+		// Another service may share the UUID, the first of them takes its place in the index.
+		BLEUUIDKey key(service->getUUID());
+		for (BLEService* pService : m_services) {
+			if (BLEUUIDKey(pService->getUUID()) == key) {
+				m_uuidIndex.insert(pService->getUUID(), pService);
+				break;
+			}
+		}
+	}
 } // removeService
 
 /**
@@ -116,12 +151,122 @@ void BLEServiceMap::removeService(BLEService* service) {
  * @return amount of registered services
  */
 int BLEServiceMap::getRegisteredServiceCount(){
-	return m_handleMap.size();
+	return m_services.size();
 }
 
+/**
+ * @brief Get the number of services, characteristics and descriptors in the map.
+ */
+uint16_t BLEServiceMap::getAttributeCount() {
+	uint16_t count = 0;
+	for (BLEService* pService : m_services) {
+		count++;
+		for (BLECharacteristic* pCharacteristic : pService->m_characteristicMap) {
+			count += 1 + pCharacteristic->m_descriptorMap.getCount();
+		}
+	}
+	return count;
+} // getAttributeCount
+
+/**
+ * @brief Get the memory used by the attribute database, the service, characteristic and descriptor
+ * maps and the dispatch table, in bytes.  The attribute objects themselves are not included.
+ */
+size_t BLEServiceMap::getMemoryUsage() {
+	size_t size = sizeof(*this) + m_services.capacity() * sizeof(BLEService*) + m_uuidIndex.getMemoryUsage() +
+		m_dispatch.capacity() * sizeof(DispatchEntry) + m_dispatchRanges.capacity() * sizeof(DispatchRange);
+	for (BLEService* pService : m_services) {
+		size += pService->m_characteristicMap.getMemoryUsage() - sizeof(BLECharacteristicMap);
+	}
+	return size;
+} // getMemoryUsage
+
+/**
+ * @brief Enter the attributes of a started service in the dispatch table.
+ * Every characteristic and descriptor gets an entry at its attribute handle, so an event reaches its
+ * owner with a single lookup.  Restarting a service replaces its entries, whatever id it had before.
+ * @param [in] service The service, after ble_service_start() has assigned its id.
+ */
+void BLEServiceMap::addToDispatch(BLEService* service) {
+	removeFromDispatch(service);
+	uint16_t serviceId = service->getHandle();
+	uint16_t count     = 0;
+	for (BLECharacteristic* pCharacteristic : service->m_characteristicMap) {
+		if (pCharacteristic->getHandle() >= count) {
+			count = pCharacteristic->getHandle() + 1;
+		}
+		for (BLEDescriptor* pDescriptor : pCharacteristic->m_descriptorMap) {
+			if (pDescriptor->getHandle() >= count) {
+				count = pDescriptor->getHandle() + 1;
+			}
+		}
+	}
+
+	DispatchRange range = { (uint16_t)m_dispatch.size(), count, service };
+	DispatchEntry empty = { nullptr, nullptr };
+	m_dispatch.resize(m_dispatch.size() + count, empty);
+	for (BLECharacteristic* pCharacteristic : service->m_characteristicMap) {
+		m_dispatch[range.base + pCharacteristic->getHandle()].pCharacteristic = pCharacteristic;
+		for (BLEDescriptor* pDescriptor : pCharacteristic->m_descriptorMap) {
+			m_dispatch[range.base + pDescriptor->getHandle()].pDescriptor = pDescriptor;
+		}
+	}
+
+	if (serviceId >= m_dispatchRanges.size()) {
+		DispatchRange none = { 0, 0, nullptr };
+		m_dispatchRanges.resize(serviceId + 1, none);
+	}
+	m_dispatchRanges[serviceId] = range;
+} // addToDispatch
+
+/**
+ * @brief Drop the entries of a service from the dispatch table.
+ * The entries of the services after it move down, so the table only ever holds the started services.
+ * @param [in] service The service.
+ */
+void BLEServiceMap::removeFromDispatch(BLEService* service) {
+	for (DispatchRange& range : m_dispatchRanges) {
+		if (range.pService != service) {
+			continue;
+		}
+		m_dispatch.erase(m_dispatch.begin() + range.base, m_dispatch.begin() + range.base + range.count);
+		for (DispatchRange& other : m_dispatchRanges) {
+			if (other.pService != nullptr && other.base > range.base) {
+				other.base -= range.count;
+			}
+		}
+		range.base     = 0;
+		range.count    = 0;
+		range.pService = nullptr;
+		break;
+	}
+} // removeFromDispatch
+
+/**
+ * @brief Forget the read and subscription state every characteristic keeps for a connection.
+ * @param [in] connId The connection that went away.
+ */
+void BLEServiceMap::releaseConnection(uint16_t connId) {
+	for (BLEService* pService : m_services) {
+		for (BLECharacteristic* pCharacteristic : pService->m_characteristicMap) {
+			pCharacteristic->releaseConnection(connId);
+		}
+	}
+} // releaseConnection
+
+/**
+ * @brief Pass a GATT server event to the characteristic or descriptor that owns its attribute handle.
+ */
 void BLEServiceMap::handleGATTServerEvent(T_SERVER_ID service_id, void *p_datas) {
-	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(service_id, p_datas);
+	ble_service_cb_data_t *cb_data = (ble_service_cb_data_t *)p_datas;
+	if (service_id >= m_dispatchRanges.size() || cb_data->attrib_handle >= m_dispatchRanges[service_id].count) {
+		return;
+	}
+	DispatchEntry& entry = m_dispatch[m_dispatchRanges[service_id].base + cb_data->attrib_handle];
+	if (entry.pCharacteristic != nullptr) {
+		entry.pCharacteristic->handleGATTServerEvent(service_id, p_datas);
+	}
+	if (entry.pDescriptor != nullptr) {
+		entry.pDescriptor->handleGATTServerEvent(service_id, p_datas);
 	}
-}
\ No newline at end of file
+} // handleGATTServerEvent
@@ -0,0 +1,263 @@
+/*
+ * BLEUUIDIndex.h
+ *
+ *  Looks up attributes by UUID without formatting UUID strings.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEUUIDINDEX_H_
+#define COMPONENTS_CPP_UTILS_BLEUUIDINDEX_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "BLEUUID.h"
+
+// Indexes of up to this many attributes are a list of pointers and key hashes searched in order.  A descriptor
+// map usually holds one or two entries, a hash table would cost it 16 slots of a normalized UUID and a pointer.
+#ifndef BLE_UUID_INDEX_LINEAR
+#define BLE_UUID_INDEX_LINEAR 8
+#endif
+
+/**
+ * @brief A UUID normalized to its 128 bit value, so that 16, 32 and 128 bit forms of the same UUID
+ * compare equal.
+ *
+ * UUIDs built on the Bluetooth base UUID, which is nearly all of them, are reduced to their 32 bit value
+ * and compared and hashed as one word.  Only vendor UUIDs keep all 16 bytes.
+ */
+class BLEUUIDKey {
+public:
+	BLEUUIDKey() : m_short(0), m_isBase(false), m_valid(false) {
+		memset(m_bytes, 0, sizeof(m_bytes));
+	}
+
+	explicit BLEUUIDKey(BLEUUID uuid) : BLEUUIDKey() {
+		// The Bluetooth base UUID 00000000-0000-1000-8000-00805f9b34fb without its 32 bit value, LSB first.
+		static const uint8_t kBase[12] = { 0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00 };
+		bt_uuid_t* pNative = uuid.getNative();
+		if (pNative == nullptr) {
+			return;
+		}
+		m_valid = true;
+		if (pNative->len == UUID_LEN_16) {
+			m_isBase = true;
+			m_short  = pNative->uuid.uuid16;
+		} else if (pNative->len == UUID_LEN_32) {
+			m_isBase = true;
+			m_short  = pNative->uuid.uuid32;
+		} else if (memcmp(pNative->uuid.uuid128, kBase, sizeof(kBase)) == 0) {
+			m_isBase = true;
+			m_short  = (uint32_t)pNative->uuid.uuid128[12] | ((uint32_t)pNative->uuid.uuid128[13] << 8) |
+			           ((uint32_t)pNative->uuid.uuid128[14] << 16) | ((uint32_t)pNative->uuid.uuid128[15] << 24);
+		} else {
+			memcpy(m_bytes, pNative->uuid.uuid128, sizeof(m_bytes));
+		}
+	}
+
+	bool isValid() const { return m_valid; }
+
+	bool operator==(const BLEUUIDKey& other) const {
+		if (m_isBase != other.m_isBase) {
+			return false;
+		}
+		return m_isBase ? m_short == other.m_short : memcmp(m_bytes, other.m_bytes, sizeof(m_bytes)) == 0;
+	}
+
+	uint32_t hash() const {
+		if (m_isBase) {
+			uint32_t h = m_short * 0x9E3779B1u;
+			return h ^ (h >> 15);
+		}
+		uint32_t h = 2166136261u;   // FNV-1a
+		for (size_t i = 0; i < sizeof(m_bytes); i++) {
+			h = (h ^ m_bytes[i]) * 16777619u;
+		}
+		return h;
+	}
+
+private:
+	uint8_t  m_bytes[16];   // The whole UUID, LSB first, for UUIDs not built on the base UUID.
+	uint32_t m_short;       // The 16 or 32 bit value of a UUID built on the base UUID.
+	bool     m_isBase;
+	bool     m_valid;
+};
+
+/**
+ * @brief A hash table from UUIDs to attributes.
+ *
+ * Up to BLE_UUID_INDEX_LINEAR attributes the index is a list of pointers searched one by one, each stored
+ * with the hash of its key so that only a matching hash costs a comparison of the full key.  Past that
+ * lookups hash the normalized UUID and probe linearly, the table doubles before it is 3/4 full.  The first
+ * attribute added with a UUID is the one found, like the std::map lookups it replaces.  The index does not
+ * own the attributes.
+ */
+template <typename T>
+class BLEUUIDIndex {
+public:
+	/**
+	 * @brief Add an attribute, unless one with the same UUID is already present.
+	 * @return False if the UUID has no value or is already present.
+	 */
+	bool insert(BLEUUID uuid, T* pValue) {
+		BLEUUIDKey key(uuid);
+		if (!key.isValid()) {
+			return false;
+		}
+		if (!m_hashed && m_count < BLE_UUID_INDEX_LINEAR) {
+			if (findLinear(key) != nullptr) {
+				return false;
+			}
+			Entry entry = { pValue, key.hash() };
+			m_entries.push_back(entry);
+			m_count++;
+			return true;
+		}
+		if ((size_t)(m_count + 1) * 4 > m_slots.size() * 3) {
+			grow();
+		}
+		size_t i = find(key);
+		if (m_slots[i].pValue != nullptr) {
+			return false;
+		}
+		m_slots[i].key    = key;
+		m_slots[i].pValue = pValue;
+		m_count++;
+		return true;
+	}
+
+	/**
+	 * @brief Find the attribute with a UUID.
+	 * @return The attribute, or nullptr if there is none.
+	 */
+	T* get(BLEUUID uuid) const {
+		BLEUUIDKey key(uuid);
+		if (m_count == 0 || !key.isValid()) {
+			return nullptr;
+		}
+		return m_hashed ? m_slots[find(key)].pValue : findLinear(key);
+	}
+
+	/**
+	 * @brief Remove an attribute.
+	 * Nothing is removed if the UUID leads to another attribute, the one that was added first.
+	 * @return False if the attribute was not the one found for the UUID.
+	 */
+	bool remove(BLEUUID uuid, T* pValue) {
+		BLEUUIDKey key(uuid);
+		if (m_count == 0 || !key.isValid()) {
+			return false;
+		}
+		if (!m_hashed) {
+			for (size_t i = 0; i < m_entries.size(); i++) {
+				if (m_entries[i].pValue == pValue) {
+					m_entries.erase(m_entries.begin() + i);
+					m_count--;
+					return true;
+				}
+			}
+			return false;
+		}
+		size_t hole = find(key);
+		if (m_slots[hole].pValue != pValue) {
+			return false;
+		}
+		// Shift the probe sequence following the slot back, so no tombstones are needed.
+		size_t mask = m_slots.size() - 1;
+		size_t next = (hole + 1) & mask;
+		while (m_slots[next].pValue != nullptr) {
+			size_t home = m_slots[next].key.hash() & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask)) {
+				m_slots[hole] = m_slots[next];
+				hole = next;
+			}
+			next = (next + 1) & mask;
+		}
+		m_slots[hole].key    = BLEUUIDKey();
+		m_slots[hole].pValue = nullptr;
+		m_count--;
+		return true;
+	}
+
+	void clear() {
+		m_entries.clear();
+		m_slots.clear();
+		m_count  = 0;
+		m_hashed = false;
+	}
+
+	size_t getCount() const { return m_count; }
+
+	/**
+	 * @brief Release the spare capacity of a small index, once no more attributes will be added.
+	 */
+	void compact() {
+		if (!m_hashed) {
+			m_entries.shrink_to_fit();
+		}
+	}
+
+	size_t getMemoryUsage() const {
+		return m_entries.capacity() * sizeof(Entry) + m_slots.capacity() * sizeof(Slot);
+	}
+
+	bool isHashed() const { return m_hashed; }
+
+private:
+	typedef struct {
+		BLEUUIDKey key;
+		T*         pValue;
+	} Slot;
+	typedef struct {
+		T*         pValue;
+		uint32_t   hash;     // Of the key of the attribute.
+	} Entry;
+
+	// The attribute with the key in a small index.  The full key is only built, from the UUID of the attribute,
+	// when the hashes match.
+	T* findLinear(const BLEUUIDKey& key) const {
+		uint32_t hash = key.hash();
+		for (const Entry& entry : m_entries) {
+			if (entry.hash == hash && BLEUUIDKey(entry.pValue->getUUID()) == key) {
+				return entry.pValue;
+			}
+		}
+		return nullptr;
+	}
+
+	// The slot holding the key, or the empty slot where it would go.
+	size_t find(const BLEUUIDKey& key) const {
+		size_t mask = m_slots.size() - 1;
+		size_t i    = key.hash() & mask;
+		while (m_slots[i].pValue != nullptr && !(m_slots[i].key == key)) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+
+	void grow() {
+		std::vector<Slot> old;
+		old.swap(m_slots);
+		Slot empty = { BLEUUIDKey(), nullptr };
+		m_slots.assign(m_hashed ? old.size() * 2 : 2 * BLE_UUID_INDEX_LINEAR, empty);
+		for (const Slot& slot : old) {
+			if (slot.pValue != nullptr) {
+				m_slots[find(slot.key)] = slot;
+			}
+		}
+		if (!m_hashed) {
+			for (const Entry& entry : m_entries) {
+				Slot slot = { BLEUUIDKey(entry.pValue->getUUID()), entry.pValue };
+				m_slots[find(slot.key)] = slot;
+			}
+			std::vector<Entry>().swap(m_entries);
+			m_hashed = true;
+		}
+	}
+
+	std::vector<Entry> m_entries;   // The attributes of a small index, in the order they were added.
+	std::vector<Slot>  m_slots;     // Past BLE_UUID_INDEX_LINEAR, a power of two in size.
+	uint16_t           m_count  = 0;
+	bool               m_hashed = false;   // Set once the index outgrows BLE_UUID_INDEX_LINEAR.
+};
+
+#endif /* COMPONENTS_CPP_UTILS_BLEUUIDINDEX_H_ */
@@ -0,0 +1,65 @@
+/*
+ * bench_beacon_decode.cpp
+ *
+ *  Beacon frames decoded per second, from the raw payload and through the std::string classes.
+ */
+
+#include <chrono>
+#include <string>
+#include <stdio.h>
+#include "BLEBeacon.h"
+#include "BLEBeaconDecoder.h"
+
+#define DECODES 5000000
+
+static uint8_t s_iBeacon[] = { 2, 0x01, 0x06, 26, 0xFF, 0x4C, 0x00, 0x02, 0x15,
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 0x00, 0x05, 0x00, 0x07, 0xC5 };
+static uint8_t s_tlm[] = { 17, 0x16, 0xAA, 0xFE, 0x20, 0x00, 0x0B, 0xB8, 0x17, 0x80,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x01, 0x00 };
+static uint8_t s_other[] = { 2, 0x01, 0x06, 5, 0x09, 'T', 'a', 'g', '1', 3, 0x03, 0x0F, 0x18 };
+
+static volatile uint32_t s_sink;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+} // secondsSince
+
+/**
+ * @brief Decode a payload over and over, changing a byte so the work cannot be hoisted.
+ */
+static double benchDecoder(uint8_t* pPayload, size_t length, size_t vary) {
+	BLEBeaconFrame frame;
+	uint32_t found = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < DECODES; i++) {
+		pPayload[vary] = (uint8_t)i;
+		found += BLEBeaconDecoder::decode(pPayload, length, &frame);
+	}
+	s_sink = found;
+	return DECODES / secondsSince(start);
+} // benchDecoder
+
+/**
+ * @brief The iBeacon the way it was decoded: the manufacturer data copied into a string for BLEBeacon.
+ */
+static double benchStringBeacon() {
+	BLEBeacon beacon;
+	uint32_t sum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < DECODES; i++) {
+		s_iBeacon[27] = (uint8_t)i;
+		beacon.setData(std::string((const char*)s_iBeacon + 5, 25));
+		sum += beacon.getMajor();
+	}
+	s_sink = sum;
+	return DECODES / secondsSince(start);
+} // benchStringBeacon
+
+int main() {
+	printf("beacon decode\n");
+	printf("  iBeacon, BLEBeacon::setData()   %10.0f decodes/s\n", benchStringBeacon());
+	printf("  iBeacon, raw payload            %10.0f decodes/s\n", benchDecoder(s_iBeacon, sizeof(s_iBeacon), 27));
+	printf("  Eddystone-TLM, raw payload      %10.0f decodes/s\n", benchDecoder(s_tlm, sizeof(s_tlm), 17));
+	printf("  no beacon, raw payload          %10.0f decodes/s\n", benchDecoder(s_other, sizeof(s_other), 8));
+	return 0;
+} // main
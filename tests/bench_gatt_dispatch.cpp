@@ -0,0 +1,95 @@
+/*
+ * bench_gatt_dispatch.cpp
+ *
+ *  GATT server events dispatched per second to the characteristics and descriptors that own them.
+ */
+
+#include <chrono>
+#include "BLEDevice.h"
+#include "BLEServer.h"
+#include "BLEDescriptor.h"
+#include "stub_stack.h"
+
+#define SERVICES        10
+#define CHARACTERISTICS 8     // Per service.
+#define EVENTS          2000000
+
+class CountingCallbacks : public BLECharacteristicCallbacks {
+public:
+	uint32_t writes = 0;
+	void onWrite(BLECharacteristic* /*pCharacteristic*/) {
+		writes++;
+	}
+};
+
+typedef struct {
+	uint8_t  serviceId;
+	uint16_t handle;
+} Target;
+
+static Target s_characteristics[SERVICES * CHARACTERISTICS];
+static Target s_descriptors[SERVICES * CHARACTERISTICS];
+static Target s_unowned[SERVICES * CHARACTERISTICS];    // Declaration handles, owned by nothing: the lookup alone.
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+} // secondsSince
+
+/**
+ * @brief Deliver write events round the targets, as the stack delivers them to the registered callback.
+ * @return Nanoseconds per event.
+ */
+static double benchWrites(const Target* pTargets) {
+	uint8_t value[2] = { 1, 2 };
+	ble_service_cb_data_t data = {};
+	data.event = SERVICE_CALLBACK_TYPE_WRITE_CHAR_VALUE;
+	data.cb_data_context.write_data.length  = sizeof(value);
+	data.cb_data_context.write_data.p_value = value;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < EVENTS; i++) {
+		const Target* pTarget = &pTargets[(i * 7) % (SERVICES * CHARACTERISTICS)];
+		data.attrib_handle = pTarget->handle;
+		g_stubGattsCallback(pTarget->serviceId, &data);
+	}
+	return secondsSince(start) * 1e9 / EVENTS;
+} // benchWrites
+
+int main() {
+	BLEDevice::init("Bench");
+	BLEServer* pServer = BLEDevice::createServer();
+	CountingCallbacks callbacks;
+	for (int s = 0; s < SERVICES; s++) {
+		BLEService*        pService = pServer->createService(BLEUUID((uint16_t)(0x1800 + s)), 40);
+		BLECharacteristic* characteristics[CHARACTERISTICS];
+		BLEDescriptor*     descriptors[CHARACTERISTICS];
+		for (int c = 0; c < CHARACTERISTICS; c++) {
+			characteristics[c] = pService->createCharacteristic(
+				BLEUUID((uint16_t)(0x2a00 + s * CHARACTERISTICS + c)), BLECharacteristic::PROPERTY_WRITE);
+			characteristics[c]->setCallbacks(&callbacks);
+			descriptors[c] = characteristics[c]->createDescriptor(BLEUUID((uint16_t)0x2901), 0, 0, 4);
+		}
+		pService->start();   // Handles are assigned here.
+		for (int c = 0; c < CHARACTERISTICS; c++) {
+			Target characteristic = { (uint8_t)pService->getHandle(), characteristics[c]->getHandle() };
+			Target descriptor     = { (uint8_t)pService->getHandle(), descriptors[c]->getHandle() };
+			s_characteristics[s * CHARACTERISTICS + c] = characteristic;
+			s_descriptors[s * CHARACTERISTICS + c]     = descriptor;
+			s_unowned[s * CHARACTERISTICS + c]         = characteristic;
+			s_unowned[s * CHARACTERISTICS + c].handle--;
+		}
+	}
+	printf("gatt dispatch, %d services, %d characteristics, %d descriptors\n",
+		SERVICES, SERVICES * CHARACTERISTICS, SERVICES * CHARACTERISTICS);
+	double characteristicNs = benchWrites(s_characteristics);
+	uint32_t delivered = callbacks.writes;
+	double descriptorNs = benchWrites(s_descriptors);
+	double unownedNs = benchWrites(s_unowned);
+	printf("  characteristic writes     %10.1f ns/event\n", characteristicNs);
+	printf("  descriptor writes         %10.1f ns/event\n", descriptorNs);
+	printf("  unowned handles           %10.1f ns/event\n", unownedNs);
+	if (delivered != EVENTS || callbacks.writes != EVENTS) {
+		printf("  %u of %d characteristic writes delivered, %u extra\n", delivered, EVENTS, callbacks.writes - delivered);
+		return 1;
+	}
+	return 0;
+} // main
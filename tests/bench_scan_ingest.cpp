@@ -0,0 +1,117 @@
+/*
+ * bench_scan_ingest.cpp
+ *
+ *  Advertisements ingested per second by the result lookup, keyed by string and by packed address.
+ */
+
+#include <chrono>
+#include <map>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+
+#define ADVERTISERS 300
+#define REPORTS     2000000
+
+static uint8_t s_addresses[ADVERTISERS][6];
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+} // secondsSince
+
+/**
+ * @brief The lookup as it was: the address formatted as a string for the find and again for the insert.
+ */
+static double benchStringMap() {
+	static BLEAdvertisedDevice device;
+	std::map<std::string, BLEAdvertisedDevice*> results;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < REPORTS; i++) {
+		uint8_t* address = s_addresses[i % ADVERTISERS];
+		if (results.find(BLEAddress(address).toString()) == results.end()) {
+			results.insert(std::pair<std::string, BLEAdvertisedDevice*>(BLEAddress(address).toString(), &device));
+		}
+	}
+	return REPORTS / secondsSince(start);
+} // benchStringMap
+
+/**
+ * @brief The lookup in the address-keyed table.
+ */
+static double benchKeyedStore() {
+	static BLEAdvertisedDevice device;
+	static BLEScanResultStore store;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < REPORTS; i++) {
+		uint64_t key = BLEAddress::toKey(s_addresses[i % ADVERTISERS], GAP_REMOTE_ADDR_LE_PUBLIC);
+		int index = store.findIndex(key);
+		if (index >= 0) {
+			store.touch(index, i, -60, false);
+		} else {
+			store.insert(key, &device, i, -60, false);
+		}
+	}
+	return REPORTS / secondsSince(start);
+} // benchKeyedStore
+
+/**
+ * @brief The whole report path, from injectReport() to a repeat of a recorded device being handled.
+ */
+static double benchInject() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	pScan->setAdvertisedDeviceCallbacks(nullptr, true);
+	uint8_t payload[] = { 2, 0x01, 0x06, 5, 0x09, 'T', 'a', 'g', '1' };
+	BLEScanReport report = {};
+	report.advType    = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+	report.rssi       = -60;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = sizeof(payload);
+	report.data       = payload;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < REPORTS; i++) {
+		report.address = s_addresses[i % ADVERTISERS];
+		pScan->injectReport(&report);
+	}
+	double rate = REPORTS / secondsSince(start);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	pScan->clearResults();
+	return rate;
+} // benchInject
+
+/**
+ * @brief The report path with the duplicate filter dropping every repeat.
+ */
+static double benchDeduplicated() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	pScan->setDuplicateFilter(true, 100, 0);
+	uint8_t payload[] = { 2, 0x01, 0x06, 5, 0x09, 'T', 'a', 'g', '1' };
+	BLEScanReport report = {};
+	report.advType    = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+	report.rssi       = -60;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = sizeof(payload);
+	report.data       = payload;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < REPORTS; i++) {
+		report.address = s_addresses[i % ADVERTISERS];
+		pScan->injectReport(&report);
+	}
+	double rate = REPORTS / secondsSince(start);
+	pScan->setDuplicateFilter(false);
+	pScan->clearResults();
+	return rate;
+} // benchDeduplicated
+
+int main() {
+	for (uint32_t n = 0; n < ADVERTISERS; n++) {
+		uint8_t address[6] = { (uint8_t)(n * 37), (uint8_t)(n >> 8), 0xa0, 0x1b, 0x2c, 0xd3 };
+		memcpy(s_addresses[n], address, sizeof(address));
+	}
+	printf("scan ingest, %d advertisers\n", ADVERTISERS);
+	printf("  string-keyed map lookup   %10.0f reports/s\n", benchStringMap());
+	printf("  address-keyed table       %10.0f reports/s\n", benchKeyedStore());
+	printf("  injectReport(), repeats   %10.0f reports/s\n", benchInject());
+	printf("  injectReport(), deduped   %10.0f reports/s\n", benchDeduplicated());
+	return 0;
+} // main
@@ -0,0 +1,62 @@
+/*
+ * Arduino.h
+ *
+ *  Host stand-in for the parts of the Arduino core the library uses.
+ */
+
+#ifndef TESTS_STUBS_ARDUINO_H_
+#define TESTS_STUBS_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include "Seeed_Arduino_FreeRTOS.h"
+
+#define LO_WORD(x) ((uint8_t)((x) & 0xff))
+#define HI_WORD(x) ((uint8_t)(((x) >> 8) & 0xff))
+
+class String {
+public:
+	String() {}
+	String(const char* s) : m_value(s) {}
+	unsigned    length() const { return m_value.size(); }
+	const char* c_str() const { return m_value.c_str(); }
+private:
+	std::string m_value;
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size) {
+		size_t n = 0;
+		while (size--) {
+			n += write(*buffer++);
+		}
+		return n;
+	}
+	size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+	size_t print(int) { return 0; }
+	size_t println(const char*) { return 0; }
+	size_t println(int) { return 0; }
+	size_t printf(const char*, ...) { return 0; }
+};
+
+class HardwareSerial : public Print {
+public:
+	size_t write(uint8_t) { return 1; }
+	void   begin(int) {}
+	operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+
+#endif /* TESTS_STUBS_ARDUINO_H_ */
@@ -0,0 +1,7 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Host stand-in, see Seeed_Arduino_FreeRTOS.h.
+ */
+
+#include "Seeed_Arduino_FreeRTOS.h"
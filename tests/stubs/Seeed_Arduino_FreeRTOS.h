@@ -0,0 +1,34 @@
+/*
+ * Seeed_Arduino_FreeRTOS.h
+ *
+ *  Host stand-in for the FreeRTOS calls the library uses, backed by std::thread.
+ */
+
+#ifndef TESTS_STUBS_SEEED_ARDUINO_FREERTOS_H_
+#define TESTS_STUBS_SEEED_ARDUINO_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef void*    SemaphoreHandle_t;
+typedef void*    TaskHandle_t;
+typedef long     BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE             1
+#define pdFALSE            0
+#define portMAX_DELAY      0xffffffffUL
+#define portTICK_PERIOD_MS 1
+
+void              vTaskDelay(TickType_t ticks);
+void              vTaskDelete(TaskHandle_t task);
+TickType_t        xTaskGetTickCount();
+BaseType_t        xTaskCreate(void (*task)(void*), const char* name, uint32_t stackSize, void* param, int priority, TaskHandle_t* pTask);
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t        xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* pWoken);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+void              vSemaphoreDelete(SemaphoreHandle_t semaphore);
+void              taskENTER_CRITICAL();
+void              taskEXIT_CRITICAL();
+
+#endif /* TESTS_STUBS_SEEED_ARDUINO_FREERTOS_H_ */
@@ -0,0 +1,14 @@
+/*
+ * rpc_unified_log.h
+ *
+ *  Host stand-in for the RPC log macros, which compile to nothing.
+ */
+
+#ifndef TESTS_STUBS_RPC_UNIFIED_LOG_H_
+#define TESTS_STUBS_RPC_UNIFIED_LOG_H_
+
+#define RPC_DEBUG(...) do {} while (0)
+#define RPC_INFO(...)  do {} while (0)
+#define RPC_ERROR(...) do {} while (0)
+
+#endif /* TESTS_STUBS_RPC_UNIFIED_LOG_H_ */
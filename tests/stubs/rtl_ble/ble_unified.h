@@ -0,0 +1,339 @@
+/*
+ * ble_unified.h
+ *
+ *  Host stand-in for the RTL8720 BLE stack interface.  Only the types, constants and calls used
+ *  by the library are declared; the calls are implemented in ../stub_stack.cpp.
+ */
+
+#ifndef TESTS_STUBS_RTL_BLE_BLE_UNIFIED_H_
+#define TESTS_STUBS_RTL_BLE_BLE_UNIFIED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint8_t T_SERVER_ID;
+typedef uint8_t T_CLIENT_ID;
+
+typedef enum { APP_RESULT_SUCCESS, APP_RESULT_ACCEPT, APP_RESULT_REJECT } T_APP_RESULT;
+typedef enum { GAP_REMOTE_ADDR_LE_PUBLIC = 0, GAP_REMOTE_ADDR_LE_RANDOM = 1 } T_GAP_REMOTE_ADDR_TYPE;
+typedef enum {
+	GAP_ADV_EVT_TYPE_UNDIRECTED = 0,
+	GAP_ADV_EVT_TYPE_DIRECTED = 1,
+	GAP_ADV_EVT_TYPE_SCANNABLE = 2,
+	GAP_ADV_EVT_TYPE_NON_CONNECTABLE = 3,
+	GAP_ADV_EVT_TYPE_SCAN_RSP = 4
+} T_GAP_ADV_EVT_TYPE;
+typedef enum { GAP_WHITE_LIST_OP_CLEAR, GAP_WHITE_LIST_OP_ADD, GAP_WHITE_LIST_OP_REMOVE } T_GAP_WHITE_LIST_OP;
+typedef enum { GAP_CONN_STATE_DISCONNECTED, GAP_CONN_STATE_CONNECTING, GAP_CONN_STATE_CONNECTED, GAP_CONN_STATE_DISCONNECTING } T_GAP_CONN_STATE;
+typedef enum { GAP_CAUSE_SUCCESS } T_GAP_CAUSE;
+typedef enum { DISC_STATE_SRV_DONE, DISC_STATE_CHAR_DONE, DISC_STATE_CHAR_DESCRIPTOR_DONE } T_DISCOVERY_STATE;
+typedef enum {
+	DISC_RESULT_ALL_SRV_UUID16,
+	DISC_RESULT_ALL_SRV_UUID128,
+	DISC_RESULT_SRV_DATA,
+	DISC_RESULT_CHAR_UUID16,
+	DISC_RESULT_CHAR_UUID128,
+	DISC_RESULT_CHAR_DESC_UUID16,
+	DISC_RESULT_CHAR_DESC_UUID128
+} T_DISCOVERY_RESULT_TYPE;
+typedef enum {
+	BLE_CLIENT_CB_TYPE_DISCOVERY_STATE,
+	BLE_CLIENT_CB_TYPE_DISCOVERY_RESULT,
+	BLE_CLIENT_CB_TYPE_READ_RESULT,
+	BLE_CLIENT_CB_TYPE_WRITE_RESULT,
+	BLE_CLIENT_CB_TYPE_NOTIF_IND,
+	BLE_CLIENT_CB_TYPE_DISCONNECT_RESULT
+} T_BLE_CLIENT_CB_TYPE;
+typedef enum {
+	SERVICE_CALLBACK_TYPE_INDIFICATION_NOTIFICATION = 1,
+	SERVICE_CALLBACK_TYPE_READ_CHAR_VALUE,
+	SERVICE_CALLBACK_TYPE_WRITE_CHAR_VALUE
+} T_SERVICE_CALLBACK_TYPE;
+typedef enum { GATT_PDU_TYPE_ANY, GATT_PDU_TYPE_NOTIFICATION, GATT_PDU_TYPE_INDICATION } T_GATT_PDU_TYPE;
+typedef enum { GATT_WRITE_TYPE_REQ, GATT_WRITE_TYPE_CMD } T_GATT_WRITE_TYPE;
+
+#define GAP_BD_ADDR_LEN 6
+#define GAP_DEVICE_NAME_LEN 40
+#define GAP_OOB_LEN 16
+#define BLE_CLIENT_MAX_APPS 1
+#define BLE_SERVER_MAX_APPS 1
+#define BLE_LE_MAX_LINKS 4
+#define GAP_SUCCESS 0
+#define HCI_ERR 0x100
+#define HCI_ERR_REMOTE_USER_TERMINATE 0x13
+#define HCI_ERR_LOCAL_HOST_TERMINATE 0x16
+#define GAP_CFM_CAUSE_ACCEPT 1
+#define GAP_CONN_PARAM_1M 0
+#define GAP_LOCAL_ADDR_LE_PUBLIC 0
+#define GAP_SCAN_MODE_PASSIVE 0
+#define GAP_SCAN_MODE_ACTIVE 1
+#define GAP_ADTYPE_FLAGS 0x01
+#define GAP_ADTYPE_16BIT_MORE 0x02
+#define GAP_ADTYPE_16BIT_COMPLETE 0x03
+#define GAP_ADTYPE_32BIT_MORE 0x04
+#define GAP_ADTYPE_32BIT_COMPLETE 0x05
+#define GAP_ADTYPE_128BIT_MORE 0x06
+#define GAP_ADTYPE_128BIT_COMPLETE 0x07
+#define GAP_ADTYPE_LOCAL_NAME_SHORT 0x08
+#define GAP_ADTYPE_LOCAL_NAME_COMPLETE 0x09
+#define GAP_ADTYPE_POWER_LEVEL 0x0A
+#define GAP_ADTYPE_SERVICE_DATA 0x16
+#define GAP_ADTYPE_APPEARANCE 0x19
+#define GAP_ADTYPE_MANUFACTURER_SPECIFIC 0xFF
+#define GAP_ADTYPE_FLAGS_LIMITED 0x01
+#define GAP_ADTYPE_FLAGS_GENERAL 0x02
+#define GAP_ADTYPE_FLAGS_BREDR_NOT_SUPPORTED 0x04
+#define GAP_ADTYPE_ADV_IND 0
+#define GAP_ADTYPE_ADV_HDC_DIRECT_IND 1
+#define GAP_ADTYPE_ADV_SCAN_IND 2
+#define GAP_ADTYPE_ADV_NONCONN_IND 3
+#define GAP_ADTYPE_ADV_LDC_DIRECT_IND 4
+#define GAP_ADVCHAN_ALL 7
+#define GAP_ADV_FILTER_ANY 0
+#define GAP_ADV_FILTER_WHITE_LIST_SCAN 1
+#define GAP_ADV_FILTER_WHITE_LIST_CONN 2
+#define GAP_ADV_FILTER_WHITE_LIST_ALL 3
+#define GAP_GATT_APPEARANCE_MOUSE 962
+#define GAP_PARAM_ADV_EVENT_TYPE 0x260
+#define GAP_PARAM_ADV_DIRECT_ADDR_TYPE 0x261
+#define GAP_PARAM_ADV_DIRECT_ADDR 0x262
+#define GAP_PARAM_ADV_CHANNEL_MAP 0x263
+#define GAP_PARAM_ADV_FILTER_POLICY 0x264
+#define GAP_PARAM_ADV_INTERVAL_MIN 0x265
+#define GAP_PARAM_ADV_INTERVAL_MAX 0x266
+#define GAP_PARAM_ADV_DATA 0x267
+#define GAP_PARAM_SCAN_RSP_DATA 0x268
+#define GAP_PARAM_SCAN_MODE 0x240
+#define GAP_PARAM_SCAN_INTERVAL 0x241
+#define GAP_PARAM_SCAN_WINDOW 0x242
+#define GAP_PARAM_SLAVE_INIT_GATT_MTU_REQ 0x20
+#define GAP_PARAM_DEVICE_NAME 0x21
+#define GAP_PARAM_BD_ADDR 0x200
+#define GAP_PARAM_BOND_OOB_DATA 0x210
+#define GAP_PARAM_CONN_INTERVAL 0x280
+#define GAP_PARAM_CONN_LATENCY 0x281
+#define GAP_PARAM_CONN_TIMEOUT 0x282
+#define GAP_INIT_STATE_STACK_READY 1
+#define GAP_SCAN_STATE_IDLE 0
+#define GAP_SCAN_STATE_SCANNING 2
+#define GAP_ADV_STATE_IDLE 0
+#define GAP_ADV_STATE_ADVERTISING 2
+#define GAP_ADV_TO_IDLE_CAUSE_CONN 1
+#define GAP_CONN_PARAM_UPDATE_STATUS_SUCCESS 0
+#define GAP_CONN_PARAM_UPDATE_STATUS_FAIL 1
+#define GAP_CONN_PARAM_UPDATE_STATUS_PENDING 2
+#define GAP_AUTHEN_STATE_STARTED 1
+#define GAP_AUTHEN_STATE_COMPLETE 2
+#define LE_SUPPORT_FEATURES_MASK_ARRAY_INDEX1 1
+#define LE_SUPPORT_FEATURES_LE_2M_MASK_BIT 1
+#define LE_SUPPORT_FEATURES_LE_CODED_PHY_MASK_BIT 8
+#define GAP_MSG_LE_MODIFY_WHITE_LIST 0x10
+#define GAP_MSG_LE_READ_RSSI 0x11
+#define GAP_MSG_LE_DATA_LEN_CHANGE_INFO 0x12
+#define GAP_MSG_LE_CONN_UPDATE_IND 0x13
+#define GAP_MSG_LE_PHY_UPDATE_INFO 0x14
+#define GAP_MSG_LE_REMOTE_FEATS_INFO 0x15
+#define GAP_MSG_LE_ADV_UPDATE_PARAM 0x16
+#define GAP_MSG_LE_SCAN_INFO 0x17
+#define GAP_MSG_LE_SCAN_CMPL 0x18
+#define GAP_MSG_LE_DEV_STATE_CHANGE 1
+#define GAP_MSG_LE_CONN_STATE_CHANGE 2
+#define GAP_MSG_LE_CONN_PARAM_UPDATE 3
+#define GAP_MSG_LE_CONN_MTU_INFO 4
+#define GAP_MSG_LE_AUTHEN_STATE_CHANGE 5
+#define GAP_MSG_LE_BOND_PASSKEY_DISPLAY 6
+#define GAP_MSG_LE_BOND_PASSKEY_INPUT 7
+#define GAP_MSG_LE_BOND_OOB_INPUT 8
+#define GAP_MSG_LE_BOND_USER_CONFIRMATION 9
+#define GAP_MSG_LE_BOND_JUST_WORK 10
+#define GATT_CHAR_PROP_BROADCAST 0x01
+#define GATT_CHAR_PROP_READ 0x02
+#define GATT_CHAR_PROP_WRITE_NO_RSP 0x04
+#define GATT_CHAR_PROP_WRITE 0x08
+#define GATT_CHAR_PROP_NOTIFY 0x10
+#define GATT_CHAR_PROP_INDICATE 0x20
+#define GATT_PERM_READ 0x01
+#define GATT_PERM_WRITE 0x10
+#define GATT_PERM_NOTIF_IND 0x1000
+#define GATT_PERM_READ_AUTHEN_REQ 0x02
+#define GATT_PERM_WRITE_AUTHEN_REQ 0x20
+#define ATTRIB_FLAG_VALUE_APPL 0x10
+#define ATTRIB_FLAG_CCCD_APPL 0x20
+#define GAP_MSG_LE_EXT_ADV_REPORT_INFO 0x1e
+typedef struct {
+	uint8_t gap_init_state: 2;
+	uint8_t gap_adv_sub_state: 1;
+	uint8_t gap_adv_state: 2;
+	uint8_t gap_scan_state: 2;
+	uint8_t gap_conn_state: 1;
+} T_GAP_DEV_STATE;
+
+typedef struct {
+	uint8_t                bd_addr[6];
+	T_GAP_REMOTE_ADDR_TYPE remote_addr_type;
+	T_GAP_ADV_EVT_TYPE     adv_type;
+	int8_t                 rssi;
+	uint8_t                data_len;
+	uint8_t                data[31];
+} T_LE_SCAN_INFO;
+
+typedef struct {
+	uint16_t               event_type;
+	uint8_t                data_status;
+	T_GAP_REMOTE_ADDR_TYPE addr_type;
+	uint8_t                bd_addr[6];
+	uint8_t                primary_phy;
+	uint8_t                secondary_phy;
+	uint8_t                adv_sid;
+	int8_t                 tx_power;
+	int8_t                 rssi;
+	uint16_t               peri_adv_interval;
+	uint8_t                direct_addr_type;
+	uint8_t                direct_addr[6];
+	uint8_t                data_len;
+	uint8_t*               p_data;
+} T_LE_EXT_ADV_REPORT_INFO;
+
+typedef struct { uint8_t conn_id; uint16_t max_tx_octets; uint16_t max_tx_time; } T_LE_DATA_LEN_CHANGE_INFO;
+typedef struct { uint8_t operation; uint16_t cause; } T_LE_MODIFY_WHITE_LIST_RSP;
+typedef struct { uint8_t conn_id; uint16_t conn_interval_max, conn_interval_min, conn_latency, supervision_timeout; } T_LE_CONN_UPDATE_IND;
+typedef struct { uint8_t conn_id; uint16_t cause; uint8_t rx_phy, tx_phy; } T_LE_PHY_UPDATE_INFO;
+typedef struct { uint8_t conn_id; uint16_t cause; uint8_t remote_feats[8]; } T_LE_REMOTE_FEATS_INFO;
+typedef struct { uint8_t conn_id; int8_t rssi; uint16_t cause; } T_LE_READ_RSSI_RSP;
+
+typedef union {
+	T_LE_EXT_ADV_REPORT_INFO*   p_le_ext_adv_report_info;
+	T_LE_SCAN_INFO*             p_le_scan_info;
+	T_LE_DATA_LEN_CHANGE_INFO*  p_le_data_len_change_info;
+	T_LE_MODIFY_WHITE_LIST_RSP* p_le_modify_white_list_rsp;
+	T_LE_CONN_UPDATE_IND*       p_le_conn_update_ind;
+	T_LE_PHY_UPDATE_INFO*       p_le_phy_update_info;
+	T_LE_REMOTE_FEATS_INFO*     p_le_remote_feats_info;
+	T_LE_READ_RSSI_RSP*         p_le_read_rssi_rsp;
+} T_LE_CB_DATA;
+
+typedef struct {
+	uint16_t type;
+	uint16_t subtype;
+	union {
+		uint32_t param;
+		void*    buf;
+	} u;
+} T_IO_MSG;
+
+typedef struct {
+	union {
+		struct { T_GAP_DEV_STATE new_state; uint16_t cause; } gap_dev_state_change;
+		struct { uint8_t conn_id; uint8_t new_state; uint16_t disc_cause; } gap_conn_state_change;
+		struct { uint8_t conn_id; uint8_t status; uint16_t cause; } gap_conn_param_update;
+		struct { uint8_t conn_id; uint16_t mtu_size; } gap_conn_mtu_info;
+		struct { uint8_t conn_id; uint8_t new_state; uint16_t status; } gap_authen_state;
+		struct { uint8_t conn_id; } gap_bond_just_work_conf;
+		struct { uint8_t conn_id; } gap_bond_passkey_display;
+		struct { uint8_t conn_id; } gap_bond_oob_input;
+		struct { uint8_t conn_id; } gap_bond_user_conf;
+	} msg_data;
+} T_LE_GAP_MSG;
+
+typedef struct {
+	uint16_t scan_interval, scan_window;
+	uint16_t conn_interval_min, conn_interval_max, conn_latency, supv_tout;
+	uint16_t ce_len_min, ce_len_max;
+} T_GAP_LE_CONN_REQ_PARAM;
+
+typedef struct { uint8_t conn_id; } T_APP_LINK;
+
+typedef struct { uint16_t att_handle, end_group_handle, uuid16; } T_GATT_SERVICE_ELEM16;
+typedef struct { uint16_t att_handle, end_group_handle; uint8_t uuid128[16]; } T_GATT_SERVICE_ELEM128;
+typedef struct { uint16_t att_handle, end_group_handle; } T_GATT_SERVICE_BY_UUID_ELEM;
+typedef struct { uint16_t decl_handle, properties, value_handle, uuid16; } T_GATT_CHARACT_ELEM16;
+typedef struct { uint16_t decl_handle, properties, value_handle; uint8_t uuid128[16]; } T_GATT_CHARACT_ELEM128;
+typedef struct { uint16_t handle, uuid16; } T_GATT_CHARACT_DESC_ELEM16;
+typedef struct { uint16_t handle; uint8_t uuid128[16]; } T_GATT_CHARACT_DESC_ELEM128;
+
+typedef struct {
+	uint8_t cb_type;
+	union {
+		struct { T_DISCOVERY_STATE state; } discov_state;
+		struct {
+			T_DISCOVERY_RESULT_TYPE discov_type;
+			union {
+				T_GATT_SERVICE_ELEM16       srv_uuid16_disc_data;
+				T_GATT_SERVICE_ELEM128      srv_uuid128_disc_data;
+				T_GATT_SERVICE_BY_UUID_ELEM srv_disc_data;
+				T_GATT_CHARACT_ELEM16       char_uuid16_disc_data;
+				T_GATT_CHARACT_ELEM128      char_uuid128_disc_data;
+				T_GATT_CHARACT_DESC_ELEM16  char_desc_uuid16_disc_data;
+				T_GATT_CHARACT_DESC_ELEM128 char_desc_uuid128_disc_data;
+			} result;
+		} discov_result;
+		struct { uint16_t value_size; uint8_t* p_value; } read_result;
+		struct { uint16_t handle; uint16_t value_size; uint8_t* p_value; bool notify; } notif_ind;
+	} cb_content;
+} T_BLE_CLIENT_CB_DATA;
+
+typedef struct { uint8_t uuid_length; uint8_t uuid[16]; bool is_primary; } ble_service_t;
+typedef struct { uint8_t uuid_length; uint8_t uuid[16]; uint8_t properties; uint32_t permissions; } ble_char_t;
+typedef struct { uint16_t flags; uint8_t uuid_length; uint8_t uuid[16]; uint8_t* p_value; uint16_t vlaue_length; uint32_t permissions; } ble_desc_t;
+
+typedef struct {
+	uint8_t  event;
+	uint8_t  conn_id;
+	uint16_t attrib_handle;
+	union {
+		struct { uint16_t cccbits; } cccd_update_data;
+		struct { uint16_t offset; uint16_t length; uint8_t* p_value; } read_data;
+		struct { uint16_t length; uint8_t* p_value; } write_data;
+	} cb_data_context;
+} ble_service_cb_data_t;
+
+typedef T_APP_RESULT (*P_FUN_LE_APP_CB)(uint8_t cb_type, void* p_cb_data);
+
+void        le_register_app_cb(P_FUN_LE_APP_CB cb);
+void        le_register_msg_handler(void (*handler)(T_IO_MSG*));
+void        le_register_gattc_cb(T_APP_RESULT (*cb)(uint8_t, uint8_t, void*));
+void        le_register_gatts_cb(T_APP_RESULT (*cb)(uint8_t, void*));
+int         le_scan_set_param(uint16_t type, uint8_t len, void* p_value);
+int         le_scan_timer_start(uint32_t tick);
+int         le_scan_stop();
+int         le_adv_set_param(uint16_t type, uint8_t len, void* p_value);
+int         le_adv_start();
+int         le_adv_stop();
+int         le_adv_update_param();
+int         le_set_gap_param(uint16_t type, uint8_t len, void* p_value);
+int         gap_set_param(uint16_t type, uint8_t len, void* p_value);
+int         gap_get_param(uint16_t type, void* p_value);
+int         gap_config_max_mtu_size(uint16_t mtu);
+int         le_modify_white_list(T_GAP_WHITE_LIST_OP operation, uint8_t* bd_addr, T_GAP_REMOTE_ADDR_TYPE type);
+void        ble_init();
+void        ble_deinit();
+void        ble_start();
+void        ble_server_init(uint8_t num);
+void        ble_client_init(uint8_t num);
+uint8_t     ble_add_client(uint8_t app_id, uint8_t link_num);
+uint8_t     ble_create_service(ble_service_t service);
+void        ble_delete_service(uint8_t service_id);
+uint8_t     ble_service_start(uint8_t service_id);
+uint16_t    ble_create_char(uint8_t service_id, ble_char_t characteristic);
+uint16_t    ble_create_desc(uint8_t service_id, uint16_t char_handle, ble_desc_t descriptor);
+bool        server_send_data(uint8_t conn_id, uint8_t service_id, uint16_t attrib_index, uint8_t* p_data, uint16_t data_len, T_GATT_PDU_TYPE type);
+int         le_bond_just_work_confirm(uint8_t conn_id, int cause);
+int         le_bond_get_display_key(uint8_t conn_id, uint32_t* p_key);
+int         le_bond_passkey_display_confirm(uint8_t conn_id, int cause);
+int         le_bond_set_param(uint16_t type, uint8_t len, void* p_value);
+int         le_bond_oob_input_confirm(uint8_t conn_id, int cause);
+int         le_bond_user_confirm(uint8_t conn_id, int cause);
+int         le_get_conn_param(uint16_t type, void* p_value, uint8_t conn_id);
+int         le_update_conn_param(uint8_t conn_id, uint16_t interval_min, uint16_t interval_max, uint16_t latency, uint16_t timeout, uint16_t ce_min, uint16_t ce_max);
+int         le_set_conn_param(int type, T_GAP_LE_CONN_REQ_PARAM* p_param);
+T_GAP_CAUSE le_connect(uint8_t phys, uint8_t* bd_addr, T_GAP_REMOTE_ADDR_TYPE type, int local_type, uint16_t scan_timeout);
+bool        le_get_conn_id(uint8_t* bd_addr, uint8_t type, uint8_t* p_conn_id);
+int         le_disconnect(uint8_t conn_id);
+int         le_read_rssi(uint8_t conn_id);
+int         client_all_primary_srv_discovery(uint8_t conn_id, uint8_t client_id);
+int         client_all_char_discovery(uint8_t conn_id, uint8_t client_id, uint16_t start, uint16_t end);
+int         client_all_char_descriptor_discovery(uint8_t conn_id, uint8_t client_id, uint16_t start, uint16_t end);
+int         client_attr_read(uint8_t conn_id, uint8_t client_id, uint16_t handle);
+int         client_attr_write(uint8_t conn_id, uint8_t client_id, T_GATT_WRITE_TYPE type, uint16_t handle, uint16_t length, uint8_t* p_data);
+
+#endif /* TESTS_STUBS_RTL_BLE_BLE_UNIFIED_H_ */
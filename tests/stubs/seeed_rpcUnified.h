@@ -0,0 +1,7 @@
+/*
+ * seeed_rpcUnified.h
+ *
+ *  Host stand-in, the stack calls are declared in rtl_ble/ble_unified.h.
+ */
+
+#include <stdint.h>
@@ -0,0 +1,183 @@
+/*
+ * stub_stack.cpp
+ *
+ *  Host stand-ins for the BLE stack, FreeRTOS and Arduino calls made by the library.
+ */
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Arduino.h"
+#include "rtl_ble/ble_unified.h"
+#include "stub_stack.h"
+
+StubStack      g_stubStack;
+T_APP_RESULT   (*g_stubGattsCallback)(uint8_t, void*);
+HardwareSerial Serial;
+
+static std::mutex s_stackLock;   // Calls arrive from the test thread and from tasks.
+static uint16_t   s_nextHandle[256];
+static uint8_t    s_nextService;
+
+void stubStackReset() {
+	std::lock_guard<std::mutex> lock(s_stackLock);
+	g_stubStack.advSetParam    = 0;
+	g_stubStack.advStart       = 0;
+	g_stubStack.advStop        = 0;
+	g_stubStack.advUpdateParam = 0;
+	g_stubStack.gapSetParam    = 0;
+	g_stubStack.scanSetParam   = 0;
+	g_stubStack.scanStart      = 0;
+	g_stubStack.scanStop       = 0;
+	g_stubStack.sends.clear();
+	g_stubStack.sendDelayUs    = 0;
+	g_stubStack.advDelayUs     = 0;
+	g_stubStack.advDataSize    = 0;
+} // stubStackReset
+
+static uint32_t elapsedMs() {
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+} // elapsedMs
+
+unsigned long millis() { return elapsedMs(); }
+unsigned long micros() { return elapsedMs() * 1000UL; }
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// FreeRTOS, tasks run as detached threads.
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+void vTaskDelete(TaskHandle_t) {}   // The task function returns right after deleting itself.
+TickType_t xTaskGetTickCount() { return elapsedMs(); }
+
+BaseType_t xTaskCreate(void (*task)(void*), const char*, uint32_t, void* param, int, TaskHandle_t*) {
+	std::thread(task, param).detach();
+	return pdTRUE;
+} // xTaskCreate
+
+namespace {
+struct BinarySemaphore {
+	std::mutex              lock;
+	std::condition_variable changed;
+	bool                    given = false;
+};
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new BinarySemaphore(); }
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete (BinarySemaphore*)semaphore; }
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+	BinarySemaphore* pSemaphore = (BinarySemaphore*)semaphore;
+	std::lock_guard<std::mutex> lock(pSemaphore->lock);
+	if (pSemaphore->given) {
+		return pdFALSE;
+	}
+	pSemaphore->given = true;
+	pSemaphore->changed.notify_one();
+	return pdTRUE;
+} // xSemaphoreGive
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* pWoken) {
+	*pWoken = pdFALSE;
+	return xSemaphoreGive(semaphore);
+} // xSemaphoreGiveFromISR
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+	BinarySemaphore* pSemaphore = (BinarySemaphore*)semaphore;
+	std::unique_lock<std::mutex> lock(pSemaphore->lock);
+	if (ticks == portMAX_DELAY) {
+		pSemaphore->changed.wait(lock, [pSemaphore] { return pSemaphore->given; });
+	} else if (!pSemaphore->changed.wait_for(lock, std::chrono::milliseconds(ticks), [pSemaphore] { return pSemaphore->given; })) {
+		return pdFALSE;
+	}
+	pSemaphore->given = false;
+	return pdTRUE;
+} // xSemaphoreTake
+
+static std::recursive_mutex s_critical;
+void taskENTER_CRITICAL() { s_critical.lock(); }
+void taskEXIT_CRITICAL() { s_critical.unlock(); }
+
+// BLE stack.
+
+#define COUNT(field) do { std::lock_guard<std::mutex> lock(s_stackLock); g_stubStack.field++; } while (0)
+
+void le_register_app_cb(P_FUN_LE_APP_CB) {}
+void le_register_msg_handler(void (*)(T_IO_MSG*)) {}
+void le_register_gattc_cb(T_APP_RESULT (*)(uint8_t, uint8_t, void*)) {}
+void le_register_gatts_cb(T_APP_RESULT (*cb)(uint8_t, void*)) { g_stubGattsCallback = cb; }
+int le_scan_set_param(uint16_t, uint8_t, void*) { COUNT(scanSetParam); return 0; }
+int le_scan_timer_start(uint32_t) { COUNT(scanStart); return 0; }
+int le_scan_stop() { COUNT(scanStop); return 0; }
+int le_adv_set_param(uint16_t type, uint8_t len, void* pValue) {
+	COUNT(advSetParam);
+	if (type == GAP_PARAM_ADV_DATA && len <= sizeof(g_stubStack.advData)) {
+		std::lock_guard<std::mutex> lock(s_stackLock);
+		memcpy(g_stubStack.advData, pValue, len);
+		g_stubStack.advDataSize = len;
+	}
+	if (g_stubStack.advDelayUs != 0) {
+		std::this_thread::sleep_for(std::chrono::microseconds(g_stubStack.advDelayUs));
+	}
+	return 0;
+}
+int le_adv_start() { COUNT(advStart); return 0; }
+int le_adv_stop() { COUNT(advStop); return 0; }
+int le_adv_update_param() { COUNT(advUpdateParam); return 0; }
+int le_set_gap_param(uint16_t, uint8_t, void*) { COUNT(gapSetParam); return 0; }
+int gap_set_param(uint16_t, uint8_t, void*) { return 0; }
+int gap_get_param(uint16_t, void*) { return 0; }
+int gap_config_max_mtu_size(uint16_t) { return 0; }
+int le_modify_white_list(T_GAP_WHITE_LIST_OP, uint8_t*, T_GAP_REMOTE_ADDR_TYPE) { return 0; }
+void ble_init() {}
+void ble_deinit() {}
+void ble_start() {}
+void ble_server_init(uint8_t) {}
+void ble_client_init(uint8_t) {}
+uint8_t ble_add_client(uint8_t, uint8_t) { return 0; }
+uint8_t ble_create_service(ble_service_t) { return s_nextService++; }
+void ble_delete_service(uint8_t) {}
+uint8_t ble_service_start(uint8_t serviceId) {
+	s_nextHandle[serviceId] = 0;   // Started again, the service is created with the same handles.
+	return serviceId;
+} // ble_service_start
+
+uint16_t ble_create_char(uint8_t serviceId, ble_char_t) {
+	s_nextHandle[serviceId]++;   // The declaration takes a handle of its own.
+	return s_nextHandle[serviceId]++;
+} // ble_create_char
+
+uint16_t ble_create_desc(uint8_t serviceId, uint16_t, ble_desc_t) {
+	return s_nextHandle[serviceId]++;
+} // ble_create_desc
+
+bool server_send_data(uint8_t connId, uint8_t serviceId, uint16_t handle, uint8_t*, uint16_t length, T_GATT_PDU_TYPE type) {
+	if (g_stubStack.sendDelayUs != 0) {
+		std::this_thread::sleep_for(std::chrono::microseconds(g_stubStack.sendDelayUs));
+	}
+	std::lock_guard<std::mutex> lock(s_stackLock);
+	StubSend send = { connId, serviceId, handle, length, (uint8_t)type };
+	g_stubStack.sends.push_back(send);
+	return true;
+} // server_send_data
+
+int le_bond_just_work_confirm(uint8_t, int) { return 0; }
+int le_bond_get_display_key(uint8_t, uint32_t*) { return 0; }
+int le_bond_passkey_display_confirm(uint8_t, int) { return 0; }
+int le_bond_set_param(uint16_t, uint8_t, void*) { return 0; }
+int le_bond_oob_input_confirm(uint8_t, int) { return 0; }
+int le_bond_user_confirm(uint8_t, int) { return 0; }
+int le_get_conn_param(uint16_t, void*, uint8_t) { return 0; }
+int le_update_conn_param(uint8_t, uint16_t, uint16_t, uint16_t, uint16_t, uint16_t, uint16_t) { return 0; }
+int le_set_conn_param(int, T_GAP_LE_CONN_REQ_PARAM*) { return 0; }
+T_GAP_CAUSE le_connect(uint8_t, uint8_t*, T_GAP_REMOTE_ADDR_TYPE, int, uint16_t) { return GAP_CAUSE_SUCCESS; }
+bool le_get_conn_id(uint8_t*, uint8_t, uint8_t*) { return false; }
+int le_disconnect(uint8_t) { return 0; }
+int le_read_rssi(uint8_t) { return 0; }
+int client_all_primary_srv_discovery(uint8_t, uint8_t) { return 0; }
+int client_all_char_discovery(uint8_t, uint8_t, uint16_t, uint16_t) { return 0; }
+int client_all_char_descriptor_discovery(uint8_t, uint8_t, uint16_t, uint16_t) { return 0; }
+int client_attr_read(uint8_t, uint8_t, uint16_t) { return 0; }
+int client_attr_write(uint8_t, uint8_t, T_GATT_WRITE_TYPE, uint16_t, uint16_t, uint8_t*) { return 0; }
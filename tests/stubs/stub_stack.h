@@ -0,0 +1,51 @@
+/*
+ * stub_stack.h
+ *
+ *  Call counters kept by the host stand-in of the BLE stack.
+ */
+
+#ifndef TESTS_STUBS_STUB_STACK_H_
+#define TESTS_STUBS_STUB_STACK_H_
+
+#include <stdint.h>
+#include <vector>
+#include "rtl_ble/ble_unified.h"
+
+/**
+ * @brief A notification or indication handed to server_send_data().
+ */
+typedef struct {
+	uint8_t  connId;
+	uint8_t  serviceId;
+	uint16_t handle;
+	uint16_t length;
+	uint8_t  type;
+} StubSend;
+
+/**
+ * @brief What the library asked of the stack since the last reset().
+ */
+typedef struct {
+	uint32_t advSetParam;
+	uint32_t advStart;
+	uint32_t advStop;
+	uint32_t advUpdateParam;
+	uint32_t gapSetParam;
+	uint32_t scanSetParam;
+	uint32_t scanStart;
+	uint32_t scanStop;
+	std::vector<StubSend> sends;
+	uint32_t sendDelayUs;   // Time server_send_data() takes, to widen race windows.
+	uint32_t advDelayUs;    // Time le_adv_set_param() takes, likewise.
+	uint8_t  advData[31];   // Advertising payload last handed to le_adv_set_param().
+	uint8_t  advDataSize;
+} StubStack;
+
+extern StubStack g_stubStack;
+
+/// The GATT server callback the library registered, called to deliver server events as the stack would.
+extern T_APP_RESULT (*g_stubGattsCallback)(uint8_t serviceId, void* pData);
+
+void stubStackReset();
+
+#endif /* TESTS_STUBS_STUB_STACK_H_ */
@@ -0,0 +1,49 @@
+/*
+ * test.h
+ *
+ *  Checks shared by the host tests.
+ */
+
+#ifndef TESTS_TEST_H_
+#define TESTS_TEST_H_
+
+#include <stdio.h>
+
+static int g_checks   = 0;
+static int g_failures = 0;
+
+/**
+ * @brief Record a failure, with its location, if the condition does not hold.
+ */
+#define CHECK(condition) do { \
+	g_checks++; \
+	if (!(condition)) { \
+		g_failures++; \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+/**
+ * @brief Record a failure, with both values, if they differ.
+ */
+#define CHECK_EQ(actual, expected) do { \
+	g_checks++; \
+	long long a_ = (long long)(actual); \
+	long long e_ = (long long)(expected); \
+	if (a_ != e_) { \
+		g_failures++; \
+		printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, a_, e_); \
+	} \
+} while (0)
+
+/**
+ * @brief Report the outcome of a test program.
+ * @param [in] name The name of the test.
+ * @return The exit code of the program.
+ */
+static inline int testResult(const char* name) {
+	printf("%-28s %5d checks, %d failed\n", name, g_checks, g_failures);
+	return (g_failures == 0) ? 0 : 1;
+} // testResult
+
+#endif /* TESTS_TEST_H_ */
@@ -0,0 +1,112 @@
+/*
+ * test_adv_live.cpp
+ *
+ *  Live advertising fields: in place pushes, changes held back by the interval, and stale handles.
+ */
+
+#include <chrono>
+#include <thread>
+#include "BLEDevice.h"
+#include "BLEAdvertising.h"
+#include "stub_stack.h"
+#include "test.h"
+
+// Flags, the Eddystone UUID and a TLM frame: battery, temperature, advertising and seconds counts.
+static const uint8_t s_tlm[] = {
+	2, 0x01, 0x06,
+	3, 0x03, 0xaa, 0xfe,
+	17, 0x16, 0xaa, 0xfe, 0x20, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+static const uint8_t s_name[] = { 2, 0x01, 0x06, 5, 0x09, 'W', 'i', 'o', 'T' };
+
+static void sleepMs(uint32_t ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+} // sleepMs
+
+/**
+ * @brief A change pushes the payload with the new bytes and applies it, an unchanged value pushes nothing,
+ * and fields that do not fit are refused.
+ */
+static void testPush(BLEAdvertising* pAdvertising) {
+	pAdvertising->setAdvertisementData(s_tlm, sizeof(s_tlm));
+	pAdvertising->setLiveUpdateInterval(0);
+	pAdvertising->start();
+	stubStackReset();
+	BLEAdvLiveField<uint32_t> advCount = pAdvertising->findLiveField<uint32_t>(GAP_ADTYPE_SERVICE_DATA, 8, true);
+	BLEAdvLiveField<uint16_t> battery  = pAdvertising->getLiveField<uint16_t>(13, true);
+	CHECK(advCount.isValid());
+	CHECK(advCount.set(0x01020304));
+	CHECK_EQ(g_stubStack.advSetParam, 1);
+	CHECK_EQ(g_stubStack.advUpdateParam, 1);
+	CHECK_EQ(g_stubStack.advDataSize, sizeof(s_tlm));
+	CHECK_EQ(g_stubStack.advData[17], 0x01);
+	CHECK_EQ(g_stubStack.advData[20], 0x04);
+	CHECK(advCount.set(0x01020304));
+	CHECK_EQ(g_stubStack.advSetParam, 1);
+	CHECK(battery.set(3000));
+	CHECK_EQ(g_stubStack.advData[13], 0x0b);
+	CHECK_EQ(g_stubStack.advData[14], 0xb8);
+	CHECK_EQ(g_stubStack.advSetParam, 2);
+
+	CHECK(!pAdvertising->getLiveField<uint32_t>(sizeof(s_tlm) - 3).isValid());
+	CHECK(!pAdvertising->findLiveField<uint32_t>(GAP_ADTYPE_SERVICE_DATA, 13).isValid());
+	CHECK(!pAdvertising->findLiveField<uint8_t>(GAP_ADTYPE_MANUFACTURER_SPECIFIC, 0).isValid());
+	CHECK(!BLEAdvLiveField<uint8_t>().set(1));
+} // testPush
+
+/**
+ * @brief Changes held back by the interval go out together once it has passed, without another set().
+ */
+static void testHeldBack(BLEAdvertising* pAdvertising) {
+	BLEAdvLiveField<uint32_t> advCount = pAdvertising->findLiveField<uint32_t>(GAP_ADTYPE_SERVICE_DATA, 8, true);
+	pAdvertising->setLiveUpdateInterval(50);
+	sleepMs(60);
+	stubStackReset();
+	advCount.set(1);
+	CHECK_EQ(g_stubStack.advSetParam, 1);
+	advCount.set(2);
+	advCount.set(3);
+	CHECK(!pAdvertising->updateLiveFields());
+	CHECK_EQ(g_stubStack.advSetParam, 1);
+	sleepMs(150);
+	CHECK_EQ(g_stubStack.advSetParam, 2);
+	CHECK_EQ(g_stubStack.advUpdateParam, 2);
+	CHECK_EQ(g_stubStack.advData[20], 3);
+	sleepMs(100);
+	CHECK_EQ(g_stubStack.advSetParam, 2);   // Nothing left to push.
+	advCount.set(4);                        // The interval has passed, pushed at once.
+	CHECK_EQ(g_stubStack.advSetParam, 3);
+} // testHeldBack
+
+/**
+ * @brief A new payload invalidates the handles taken on the old one, and drops a change held back for it.
+ */
+static void testStale(BLEAdvertising* pAdvertising) {
+	BLEAdvLiveField<uint32_t> advCount = pAdvertising->findLiveField<uint32_t>(GAP_ADTYPE_SERVICE_DATA, 8, true);
+	advCount.set(5);
+	advCount.set(6);   // Held back.
+	pAdvertising->setAdvertisementData(s_name, sizeof(s_name));
+	CHECK(!advCount.isValid());
+	sleepMs(100);
+	stubStackReset();
+	CHECK(!advCount.set(7));
+	CHECK_EQ(g_stubStack.advSetParam, 0);
+
+	BLEAdvLiveField<uint8_t> letter = pAdvertising->findLiveField<uint8_t>(GAP_ADTYPE_LOCAL_NAME_COMPLETE, 3);
+	CHECK(letter.isValid());
+	CHECK(letter.set('X'));
+	CHECK_EQ(g_stubStack.advSetParam, 1);
+	CHECK_EQ(g_stubStack.advDataSize, sizeof(s_name));
+	CHECK_EQ(g_stubStack.advData[8], 'X');
+	CHECK_EQ(g_stubStack.advData[5], 'W');
+	pAdvertising->stop();
+} // testStale
+
+int main() {
+	BLEDevice::init("WioT");
+	BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+	testPush(pAdvertising);
+	testHeldBack(pAdvertising);
+	testStale(pAdvertising);
+	return testResult("test_adv_live");
+} // main
@@ -0,0 +1,83 @@
+/*
+ * test_adv_payload.cpp
+ *
+ *  Compile time advertising payloads: the bytes, the length and toArray(), checked by the compiler.
+ *
+ *  Built with TEST_ADV_PAYLOAD_OVERFLOW defined the file must fail to compile, the Makefile checks that
+ *  a payload over 31 bytes is rejected.
+ */
+
+#include <string.h>
+#include "BLEAdvPayload.h"
+#include "test.h"
+
+static constexpr uint8_t kData[]  = { 0x01, 0x02 };
+static constexpr uint8_t kUUID[]  = { 0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0,
+                                      0x93, 0xf3, 0xa3, 0xb5, 0x01, 0x00, 0x40, 0x6e };
+static constexpr uint8_t kFrame[] = { 0x10, 0xeb, 0x03, 'w', 'i', 'o' };
+
+static constexpr auto kAdvert = BLEAdvPayload<>().flags(0x06).name("Sensor").service16(0x180f)
+                                                 .manufacturerData(0x02e5, kData);
+static constexpr uint8_t kAdvertBytes[] = {
+	2, GAP_ADTYPE_FLAGS, 0x06,
+	7, GAP_ADTYPE_LOCAL_NAME_COMPLETE, 'S', 'e', 'n', 's', 'o', 'r',
+	3, GAP_ADTYPE_16BIT_COMPLETE, 0x0f, 0x18,
+	5, GAP_ADTYPE_MANUFACTURER_SPECIFIC, 0xe5, 0x02, 0x01, 0x02
+};
+
+// Exactly 31 bytes: the flags and a 128 bit service UUID take 21, the service data the other 10.
+static constexpr auto kFull = BLEAdvPayload<>().flags(0x06).service128(kUUID).serviceData16(0xfeaa, kFrame);
+
+static constexpr auto kOthers = BLEAdvPayload<>().shortName("Wio").txPower(-4).appearance(0x03c2)
+                                                 .field(GAP_ADTYPE_SERVICE_DATA, kData);
+static constexpr uint8_t kOthersBytes[] = {
+	4, GAP_ADTYPE_LOCAL_NAME_SHORT, 'W', 'i', 'o',
+	2, GAP_ADTYPE_POWER_LEVEL, 0xfc,
+	3, GAP_ADTYPE_APPEARANCE, 0xc2, 0x03,
+	3, GAP_ADTYPE_SERVICE_DATA, 0x01, 0x02
+};
+
+// The const operator[] of std::array is usable in constant expressions, the one of a temporary is not.
+static constexpr uint8_t byteOf(const std::array<uint8_t, BLE_ADV_PAYLOAD_MAX>& bytes, size_t i) {
+	return bytes[i];
+} // byteOf
+
+/**
+ * @brief Whether the first n bytes of a payload equal the expected ones, the rest are zero.
+ */
+template <size_t N>
+static constexpr bool sameBytes(const BLEAdvPayload<N>& payload, const uint8_t* pExpected, size_t n, size_t i = 0) {
+	return i == BLE_ADV_PAYLOAD_MAX ? true :
+		(byteOf(payload.toArray(), i) == (i < n ? pExpected[i] : 0) && payload.getData()[i] == byteOf(payload.toArray(), i) &&
+		 sameBytes(payload, pExpected, n, i + 1));
+} // sameBytes
+
+static_assert(kAdvert.getLength() == sizeof(kAdvertBytes), "Length of the advertisement");
+static_assert(sameBytes(kAdvert, kAdvertBytes, sizeof(kAdvertBytes)), "Bytes of the advertisement");
+static_assert(kOthers.getLength() == sizeof(kOthersBytes), "Length of the other fields");
+static_assert(sameBytes(kOthers, kOthersBytes, sizeof(kOthersBytes)), "Bytes of the other fields");
+static_assert(kFull.getLength() == BLE_ADV_PAYLOAD_MAX, "A payload of exactly 31 bytes");
+static_assert(kFull.getData()[3] == 17 && kFull.getData()[4] == GAP_ADTYPE_128BIT_COMPLETE, "128 bit UUID header");
+static_assert(kFull.getData()[21] == 9 && kFull.getData()[23] == 0xaa && kFull.getData()[24] == 0xfe, "Service data header");
+static_assert(byteOf(kFull.toArray(), 30) == 'o', "Last byte of a full payload");
+static_assert(BLEAdvPayload<>().getLength() == 0 && byteOf(BLEAdvPayload<>().toArray(), 0) == 0, "Empty payload");
+
+#ifdef TEST_ADV_PAYLOAD_OVERFLOW
+static constexpr auto kTooLong = kFull.txPower(0);
+#endif
+
+/**
+ * @brief The same bytes at run time, as setAdvertisementData() takes them.
+ */
+static void testRuntime() {
+	CHECK_EQ(memcmp(kAdvert.getData(), kAdvertBytes, sizeof(kAdvertBytes)), 0);
+	CHECK_EQ(memcmp(kOthers.getData(), kOthersBytes, sizeof(kOthersBytes)), 0);
+	std::array<uint8_t, BLE_ADV_PAYLOAD_MAX> bytes = kFull.toArray();
+	CHECK_EQ(memcmp(bytes.data(), kFull.getData(), BLE_ADV_PAYLOAD_MAX), 0);
+	CHECK_EQ(memcmp(kFull.getData() + 25, kFrame, sizeof(kFrame)), 0);
+} // testRuntime
+
+int main() {
+	testRuntime();
+	return testResult("test_adv_payload");
+} // main
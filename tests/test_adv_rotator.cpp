@@ -0,0 +1,76 @@
+/*
+ * test_adv_rotator.cpp
+ *
+ *  Advertising set rotation: turns, minimal parameter pushes and stopping under a running task.
+ */
+
+#include <chrono>
+#include <thread>
+#include "BLEAdvertisingRotator.h"
+#include "BLEFreeRTOS.h"
+#include "stub_stack.h"
+#include "test.h"
+
+static const uint8_t s_beacon[] = { 2, 0x01, 0x06, 3, 0xff, 0x4c, 0x00 };
+static const uint8_t s_tlm[]    = { 2, 0x01, 0x06, 3, 0x16, 0xaa, 0xfe };
+static const uint8_t s_name[]   = { 5, 0x09, 'W', 'i', 'o', 'T' };
+
+/**
+ * @brief Sets take their turns in order, and a switch only writes what differs.
+ */
+static void testTurns() {
+	BLEAdvertisingRotator rotator;
+	rotator.addSet(s_beacon, sizeof(s_beacon), nullptr, 0, GAP_ADTYPE_ADV_NONCONN_IND, 100, 300);
+	rotator.addSet(s_tlm, sizeof(s_tlm), nullptr, 0, GAP_ADTYPE_ADV_NONCONN_IND, 100, 100);
+	rotator.addSet(s_name, sizeof(s_name), s_name, sizeof(s_name), GAP_ADTYPE_ADV_IND, 200, 600);
+	rotator.begin();
+	CHECK(rotator.isRunning());
+	CHECK_EQ(rotator.getCurrentSet(), 0);
+	uint32_t calls = rotator.getRpcCalls();
+	uint32_t now = BLEFreeRTOS::getTimeSinceStart();
+	CHECK_EQ(rotator.tick(now + 100), 200);
+	CHECK_EQ(rotator.tick(now + 300), 100);
+	CHECK_EQ(rotator.getCurrentSet(), 1);
+	CHECK_EQ(rotator.getRpcCalls() - calls, 2);   // The data and the update, type and interval are shared.
+	rotator.tick(now + 400);
+	CHECK_EQ(rotator.getCurrentSet(), 2);
+	rotator.tick(now + 1000);
+	CHECK_EQ(rotator.getCurrentSet(), 0);
+	CHECK_EQ(rotator.getStats(0).activations, 2);
+	CHECK_EQ(rotator.getStats(2).airtimeMs, 600);
+	rotator.stop();
+	CHECK(!rotator.isRunning());
+	CHECK_EQ(rotator.tick(now + 5000), 0);
+} // testTurns
+
+/**
+ * @brief stop() and clear() while the task rotates: once stop() returns the task leaves the stack and the sets alone.
+ */
+static void testStopUnderTask() {
+	BLEAdvertisingRotator rotator;
+	g_stubStack.advDelayUs = 200;   // The task is mostly in the middle of a switch when stop() comes.
+	bool quiet = true;
+	bool consistent = true;
+	for (int round = 0; round < 200; round++) {
+		rotator.addSet(s_beacon, sizeof(s_beacon), nullptr, 0, GAP_ADTYPE_ADV_NONCONN_IND, 100, 1);
+		rotator.addSet(s_name, sizeof(s_name), nullptr, 0, GAP_ADTYPE_ADV_IND, 200, 1);
+		rotator.start();
+		std::this_thread::sleep_for(std::chrono::microseconds(500 + round * 10));
+		rotator.stop();
+		uint32_t pushes = g_stubStack.advSetParam + g_stubStack.advUpdateParam;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		quiet = quiet && (g_stubStack.advSetParam + g_stubStack.advUpdateParam == pushes);
+		rotator.clear();
+		consistent = consistent && rotator.getSetCount() == 0 && rotator.getCurrentSet() == -1;
+	}
+	g_stubStack.advDelayUs = 0;
+	CHECK(quiet);
+	CHECK(consistent);
+	CHECK(!rotator.isRunning());
+} // testStopUnderTask
+
+int main() {
+	testTurns();
+	testStopUnderTask();
+	return testResult("test_adv_rotator");
+} // main
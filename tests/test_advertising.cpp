@@ -0,0 +1,58 @@
+/*
+ * test_advertising.cpp
+ *
+ *  Advertising parameters pushed only when they differ from what the stack holds.
+ */
+
+#include "BLEDevice.h"
+#include "BLEAdvertising.h"
+#include "stub_stack.h"
+#include "test.h"
+
+static uint32_t pushes() {
+	return g_stubStack.advSetParam + g_stubStack.gapSetParam;
+} // pushes
+
+/**
+ * @brief A restart with nothing changed pushes nothing, a changed parameter pushes just that one.
+ */
+static void testShadow() {
+	BLEDevice::init("WioT");
+	BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+	stubStackReset();
+	pAdvertising->start();
+	uint32_t first = pushes();
+	CHECK(first >= 9);
+	pAdvertising->stop();
+	pAdvertising->start();
+	CHECK_EQ(pushes(), first);
+	pAdvertising->stop();
+	pAdvertising->setMinPreferred(100);
+	pAdvertising->start();
+	CHECK_EQ(pushes(), first + 1);
+	pAdvertising->stop();
+} // testShadow
+
+/**
+ * @brief The stack loses every parameter across deinit() and init(), so the next start() pushes them all.
+ */
+static void testReinit() {
+	BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+	stubStackReset();
+	pAdvertising->start();
+	pAdvertising->stop();
+	CHECK_EQ(pushes(), 0);
+	BLEDevice::deinit();
+	CHECK(!BLEDevice::getInitialized());
+	BLEDevice::init("WioT");
+	pAdvertising->start();
+	CHECK(pushes() >= 9);
+	CHECK_EQ(g_stubStack.advStart, 2);
+	pAdvertising->stop();
+} // testReinit
+
+int main() {
+	testShadow();
+	testReinit();
+	return testResult("test_advertising");
+} // main
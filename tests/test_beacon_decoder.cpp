@@ -0,0 +1,96 @@
+/*
+ * test_beacon_decoder.cpp
+ *
+ *  Beacon frames decoded from raw payloads, and payloads that must not be read past their end.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "BLEBeaconDecoder.h"
+#include "test.h"
+
+static const uint8_t s_iBeacon[] = { 2, 0x01, 0x06, 26, 0xFF, 0x4C, 0x00, 0x02, 0x15,
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 0x00, 0x05, 0x00, 0x07, 0xC5 };
+static const uint8_t s_url[] = { 3, 0x03, 0xAA, 0xFE, 14, 0x16, 0xAA, 0xFE, 0x10, 0xEB, 0x03,
+	'g', 'o', 'o', 'g', 'l', 'e', 0x00, 'x' };
+static const uint8_t s_tlm[] = { 17, 0x16, 0xAA, 0xFE, 0x20, 0x00, 0x0B, 0xB8, 0x17, 0x80,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x01, 0x00 };
+static const uint8_t s_altBeacon[] = { 27, 0xFF, 0x18, 0x01, 0xBE, 0xAC,
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 0xBB, 0x42 };
+
+/**
+ * @brief Decode a copy of the payload in a buffer of its exact size, so a read past the end is caught
+ * by a sanitizer or a heap checker.
+ */
+static bool decodeExact(const uint8_t* pPayload, size_t length, BLEBeaconFrame* pFrame) {
+	uint8_t* pCopy = (uint8_t*)malloc(length != 0 ? length : 1);
+	memcpy(pCopy, pPayload, length);
+	bool found = BLEBeaconDecoder::decode(pCopy, length, pFrame);
+	free(pCopy);
+	return found;
+} // decodeExact
+
+static void testFrames() {
+	BLEBeaconFrame frame;
+	char url[64];
+	CHECK(decodeExact(s_iBeacon, sizeof(s_iBeacon), &frame));
+	CHECK_EQ(frame.type, BLE_BEACON_IBEACON);
+	CHECK_EQ(frame.iBeacon.major, 5);
+	CHECK_EQ(frame.iBeacon.minor, 7);
+	CHECK_EQ(frame.txPower, -59);
+	CHECK_EQ(frame.iBeacon.proximityUUID[15], 16);
+
+	CHECK(decodeExact(s_url, sizeof(s_url), &frame));
+	CHECK_EQ(frame.type, BLE_BEACON_EDDYSTONE_URL);
+	CHECK_EQ(frame.txPower, -21 - 41);
+	CHECK_EQ(BLEBeaconDecoder::expandURL(&frame, url, sizeof(url)), 20);
+	CHECK(strcmp(url, "https://google.com/x") == 0);
+	CHECK_EQ(BLEBeaconDecoder::expandURL(&frame, url, 8), 20);   // Truncated, but the full length is reported.
+	CHECK(strcmp(url, "https:/") == 0);
+
+	CHECK(decodeExact(s_tlm, sizeof(s_tlm), &frame));
+	CHECK_EQ(frame.type, BLE_BEACON_EDDYSTONE_TLM);
+	CHECK_EQ(frame.tlm.voltage, 3000);
+	CHECK_EQ(frame.tlm.temperature, 0x1780);
+	CHECK_EQ(frame.tlm.advCount, 5);
+	CHECK_EQ(frame.tlm.secCount, 256);
+
+	CHECK(decodeExact(s_altBeacon, sizeof(s_altBeacon), &frame));
+	CHECK_EQ(frame.type, BLE_BEACON_ALTBEACON);
+	CHECK_EQ(frame.altBeacon.manufacturerId, 0x0118);
+	CHECK_EQ(frame.txPower, (int8_t)0xBB);
+	CHECK_EQ(frame.altBeacon.reserved, 0x42);
+} // testFrames
+
+/**
+ * @brief Short AD structures at the end of a payload are rejected without reading past it.
+ */
+static void testShortData() {
+	BLEBeaconFrame frame;
+	const uint8_t manufacturer1[] = { 2, 0x01, 0x06, 1, 0xFF };
+	const uint8_t manufacturer2[] = { 2, 0x01, 0x06, 2, 0xFF, 0x4C };
+	const uint8_t manufacturer3[] = { 4, 0xFF, 0x4C, 0x00, 0x02 };
+	const uint8_t service[] = { 3, 0x16, 0xAA, 0xFE };
+	const uint8_t overrun[] = { 2, 0x01, 0x06, 26, 0xFF, 0x4C, 0x00, 0x02, 0x15 };
+	CHECK(!decodeExact(manufacturer1, sizeof(manufacturer1), &frame));
+	CHECK(!decodeExact(manufacturer2, sizeof(manufacturer2), &frame));
+	CHECK(!decodeExact(manufacturer3, sizeof(manufacturer3), &frame));
+	CHECK(!decodeExact(service, sizeof(service), &frame));
+	CHECK(!decodeExact(overrun, sizeof(overrun), &frame));
+	CHECK_EQ(frame.type, BLE_BEACON_NONE);
+
+	bool found = false;   // Every truncation of a valid frame.
+	for (size_t length = 0; length < sizeof(s_iBeacon); length++) {
+		found = found || decodeExact(s_iBeacon, length, &frame);
+	}
+	for (size_t length = 0; length < sizeof(s_tlm); length++) {
+		found = found || decodeExact(s_tlm, length, &frame);
+	}
+	CHECK(!found);
+} // testShortData
+
+int main() {
+	testFrames();
+	testShortData();
+	return testResult("test_beacon_decoder");
+} // main
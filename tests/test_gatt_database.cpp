@@ -0,0 +1,149 @@
+/*
+ * test_gatt_database.cpp
+ *
+ *  Attribute database: declaration order, nested iteration, freezing at start(), restarts and its memory per attribute.
+ */
+
+#include <stdio.h>
+#include "BLEDevice.h"
+#include "BLEServer.h"
+#include "BLEDescriptor.h"
+#include "BLE2902.h"
+#include "stub_stack.h"
+#include "test.h"
+
+#define SERVICES        10
+#define CHARACTERISTICS 8     // Per service.
+#define DESCRIPTORS     1     // Per characteristic.
+
+/**
+ * @brief Characteristics and descriptors come back in the order they were added, and iterations nest
+ * without disturbing each other.
+ */
+static void testOrder() {
+	BLECharacteristicMap characteristics;
+	BLEDescriptorMap     descriptors;
+	for (uint16_t n = 0; n < CHARACTERISTICS; n++) {
+		// Descending UUIDs, so neither the UUID nor, most likely, the address order is the declaration order.
+		characteristics.setByUUID(new BLECharacteristic(BLEUUID((uint16_t)(0x2a10 - n)), 0), BLEUUID((uint16_t)(0x2a10 - n)));
+		BLEDescriptor* pDescriptor = new BLEDescriptor(BLEUUID((uint16_t)(0x2910 - n)), 0, 0, 4);
+		descriptors.setByUUID(pDescriptor->getUUID(), pDescriptor);
+	}
+	uint16_t expected = 0x2a10;
+	bool     ordered  = true;
+	size_t   pairs    = 0;
+	for (BLECharacteristic* pOuter : characteristics) {
+		ordered = ordered && pOuter->getUUID().getNative()->uuid.uuid16 == expected--;
+		for (BLECharacteristic* pInner : characteristics) {
+			pairs += pInner != nullptr;
+		}
+	}
+	CHECK(ordered);
+	CHECK_EQ(pairs, CHARACTERISTICS * CHARACTERISTICS);
+	expected = 0x2910;
+	ordered  = true;
+	for (BLEDescriptor* pDescriptor : descriptors) {
+		ordered = ordered && pDescriptor->getUUID().getNative()->uuid.uuid16 == expected--;
+	}
+	CHECK(ordered);
+	CHECK_EQ(characteristics.getFirst()->getUUID().getNative()->uuid.uuid16, 0x2a10);
+	CHECK_EQ(characteristics.getByUUID(BLEUUID((uint16_t)0x2a0c))->getUUID().getNative()->uuid.uuid16, 0x2a0c);
+
+	characteristics.freeze();
+	CHECK(!characteristics.setByUUID(new BLECharacteristic(BLEUUID((uint16_t)0x2aff), 0), BLEUUID((uint16_t)0x2aff)));
+	CHECK_EQ(characteristics.getCount(), CHARACTERISTICS);
+	for (BLECharacteristic* pCharacteristic : characteristics) {
+		delete pCharacteristic;
+	}
+	for (BLEDescriptor* pDescriptor : descriptors) {
+		delete pDescriptor;
+	}
+} // testOrder
+
+/**
+ * @brief The database costs a few pointers per attribute.  The std::map entries it replaced, a node keyed by
+ * pointer holding the UUID string, that string on the heap and a node in the handle map, came to about 160
+ * bytes per attribute on a 64-bit host.
+ */
+static void testMemory(BLEServer* pServer) {
+	uint16_t count = pServer->getAttributeCount();
+	size_t   bytes = pServer->getAttributeMemoryUsage();
+	CHECK_EQ(count, SERVICES * (1 + CHARACTERISTICS * (1 + DESCRIPTORS)));
+	printf("attribute database: %u attributes, %u bytes, %.1f bytes per attribute\n",
+		(unsigned)count, (unsigned)bytes, (double)bytes / count);
+	CHECK(bytes / count < 112);
+} // testMemory
+
+/**
+ * @brief Deliver a read request and return the length of the response.
+ */
+static uint16_t readLength(BLECharacteristic* pCharacteristic) {
+	ble_service_cb_data_t data = {};
+	data.event         = SERVICE_CALLBACK_TYPE_READ_CHAR_VALUE;
+	data.attrib_handle = pCharacteristic->getHandle();
+	g_stubGattsCallback((uint8_t)pCharacteristic->getService()->getHandle(), &data);
+	return data.cb_data_context.read_data.length;
+} // readLength
+
+/**
+ * @brief Restarting a service replaces its dispatch entries instead of adding more, and events still reach
+ * its attributes and those of the services entered after it.
+ */
+static void testRestart(BLEServer* pServer) {
+	BLEService* pService = pServer->getServiceByUUID(BLEUUID((uint16_t)0x1801));
+	BLEService* pLast    = pServer->getServiceByUUID(BLEUUID((uint16_t)(0x1800 + SERVICES - 1)));
+	size_t      bytes    = pServer->getAttributeMemoryUsage();
+	for (int i = 0; i < 50; i++) {
+		pService->start();
+	}
+	CHECK_EQ(pServer->getAttributeMemoryUsage(), bytes);
+	BLECharacteristic* pCharacteristic = pService->getCharacteristic(BLEUUID((uint16_t)(0x2a00 + CHARACTERISTICS)));
+	pCharacteristic->setValue("restarted");
+	CHECK_EQ(readLength(pCharacteristic), 9);
+	pCharacteristic = pLast->getCharacteristic(BLEUUID((uint16_t)(0x2a00 + (SERVICES - 1) * CHARACTERISTICS)));
+	pCharacteristic->setValue("last");
+	CHECK_EQ(readLength(pCharacteristic), 4);
+} // testRestart
+
+/**
+ * @brief Once its service is started a characteristic takes no more descriptors, and a refused 0x2902 does
+ * not become its CCCD: the characteristic keeps notifying every peer.
+ */
+static void testFrozen(BLEServer* pServer) {
+	BLEService* pService = pServer->getServiceByUUID(BLEUUID((uint16_t)0x1800));
+	uint16_t    count    = pServer->getAttributeCount();
+	BLECharacteristic* pExtra = new BLECharacteristic(BLEUUID((uint16_t)0x2aff), BLECharacteristic::PROPERTY_NOTIFY);
+	CHECK(!pService->addCharacteristic(pExtra));
+	CHECK(pService->getCharacteristic(BLEUUID((uint16_t)0x2aff)) == nullptr);
+
+	BLECharacteristic* pCharacteristic = pService->getCharacteristic(BLEUUID((uint16_t)0x2a00));
+	CHECK(!pCharacteristic->addDescriptor(new BLE2902()));
+	CHECK(pCharacteristic->getDescriptorByUUID(BLEUUID((uint16_t)0x2902)) == nullptr);
+	CHECK_EQ(pServer->getAttributeCount(), count);
+
+	pServer->addPeerDevice(nullptr, false, 0);
+	g_stubStack.sends.clear();
+	pCharacteristic->setValue("on");
+	pCharacteristic->notify();
+	CHECK_EQ(g_stubStack.sends.size(), 1);
+	pServer->removePeerDevice(0, false);
+} // testFrozen
+
+int main() {
+	BLEDevice::init("Database");
+	BLEServer* pServer = BLEDevice::createServer();
+	for (int s = 0; s < SERVICES; s++) {
+		BLEService* pService = pServer->createService(BLEUUID((uint16_t)(0x1800 + s)), 40);
+		for (int c = 0; c < CHARACTERISTICS; c++) {
+			BLECharacteristic* pCharacteristic = pService->createCharacteristic(
+				BLEUUID((uint16_t)(0x2a00 + s * CHARACTERISTICS + c)), BLECharacteristic::PROPERTY_NOTIFY);
+			pCharacteristic->createDescriptor(BLEUUID((uint16_t)0x2901), 0, 0, 4);
+		}
+		pService->start();
+	}
+	testOrder();
+	testMemory(pServer);
+	testRestart(pServer);
+	testFrozen(pServer);
+	return testResult("test_gatt_database");
+} // main
@@ -0,0 +1,107 @@
+/*
+ * test_long_read.cpp
+ *
+ *  Long reads: per connection offsets and MTUs, value snapshots, abandoned reads and exact chunk multiples.
+ */
+
+#include <string>
+#include "BLEDevice.h"
+#include "BLEServer.h"
+#include "stub_stack.h"
+#include "test.h"
+
+/**
+ * @brief Deliver a read request from a peer, as the stack delivers it to the registered callback.
+ * @return The bytes of the response.
+ */
+static std::string read(BLECharacteristic* pCharacteristic, uint8_t connId, uint16_t offset) {
+	ble_service_cb_data_t data = {};
+	data.event         = SERVICE_CALLBACK_TYPE_READ_CHAR_VALUE;
+	data.conn_id       = connId;
+	data.attrib_handle = pCharacteristic->getHandle();
+	data.cb_data_context.read_data.offset = offset;
+	g_stubGattsCallback((uint8_t)pCharacteristic->getService()->getHandle(), &data);
+	return std::string((const char*)data.cb_data_context.read_data.p_value, data.cb_data_context.read_data.length);
+} // read
+
+static std::string makeValue(char first, size_t length) {
+	std::string value;
+	for (size_t i = 0; i < length; i++) {
+		value += (char)(first + i % 26);
+	}
+	return value;
+} // makeValue
+
+/**
+ * @brief Two peers with different MTUs read the value in turns, the value changes half way through.
+ * Each read sees the value it started with, cut to its own MTU, and the next read sees the new value.
+ */
+static void testInterleaved(BLECharacteristic* pCharacteristic) {
+	std::string first  = makeValue('a', 100);
+	std::string second = makeValue('A', 60);
+	pCharacteristic->setValue(first);
+	std::string small = read(pCharacteristic, 1, 0);
+	std::string large = read(pCharacteristic, 2, 0);
+	CHECK_EQ(small.length(), 22);
+	CHECK_EQ(large.length(), 63);
+	pCharacteristic->setValue(second);
+	while (small.length() < first.length()) {
+		std::string part = read(pCharacteristic, 1, small.length());
+		CHECK(part.length() <= 22);
+		small += part;
+		if (large.length() < first.length()) {
+			large += read(pCharacteristic, 2, large.length());
+		}
+	}
+	CHECK(small == first);
+	CHECK(large == first);
+	CHECK(read(pCharacteristic, 1, 0) == second.substr(0, 22));
+	CHECK(read(pCharacteristic, 2, 0) == second);
+} // testInterleaved
+
+/**
+ * @brief A read that does not continue the previous one starts over, wherever that one stopped.
+ */
+static void testAbandoned(BLECharacteristic* pCharacteristic) {
+	std::string first  = makeValue('a', 100);
+	std::string second = makeValue('A', 100);
+	pCharacteristic->setValue(first);
+	read(pCharacteristic, 1, 0);
+	read(pCharacteristic, 1, 22);
+	pCharacteristic->setValue(second);
+	CHECK(read(pCharacteristic, 1, 0) == second.substr(0, 22));
+	CHECK(read(pCharacteristic, 1, 50) == second.substr(50, 22));   // Not where the last response ended.
+	CHECK(read(pCharacteristic, 1, 200).empty());
+} // testAbandoned
+
+/**
+ * @brief A value that is an exact multiple of the chunk size ends the read with its last full chunk,
+ * the empty read that may follow is answered from the same value, and the next read starts over.
+ */
+static void testExactMultiple(BLECharacteristic* pCharacteristic) {
+	std::string first  = makeValue('a', 44);
+	std::string second = makeValue('A', 44);
+	pCharacteristic->setValue(first);
+	CHECK(read(pCharacteristic, 1, 0) == first.substr(0, 22));
+	CHECK(read(pCharacteristic, 1, 22) == first.substr(22));
+	pCharacteristic->setValue(second);
+	CHECK(read(pCharacteristic, 1, 44).empty());
+	CHECK(read(pCharacteristic, 1, 0) == second.substr(0, 22));
+} // testExactMultiple
+
+int main() {
+	BLEDevice::init("LongRead");
+	BLEServer*         pServer  = BLEDevice::createServer();
+	BLEService*        pService = pServer->createService(BLEUUID((uint16_t)0x180a));
+	BLECharacteristic* pCharacteristic = pService->createCharacteristic(BLEUUID((uint16_t)0x2a29),
+		BLECharacteristic::PROPERTY_READ);
+	pService->start();
+	pServer->addPeerDevice(nullptr, false, 1);
+	pServer->addPeerDevice(nullptr, false, 2);
+	pServer->updatePeerMTU(1, 23);
+	pServer->updatePeerMTU(2, 64);
+	testInterleaved(pCharacteristic);
+	testAbandoned(pCharacteristic);
+	testExactMultiple(pCharacteristic);
+	return testResult("test_long_read");
+} // main
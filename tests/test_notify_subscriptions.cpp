@@ -0,0 +1,102 @@
+/*
+ * test_notify_subscriptions.cpp
+ *
+ *  Notifications follow the CCCD each peer wrote, and fan out safely while peers come and go.
+ */
+
+#include <atomic>
+#include <thread>
+#include "BLEDevice.h"
+#include "BLEServer.h"
+#include "BLE2902.h"
+#include "stub_stack.h"
+#include "test.h"
+
+/**
+ * @brief Deliver a CCCD write from a peer, as the stack delivers it to the registered callback.
+ */
+static void writeCCCD(BLECharacteristic* pCharacteristic, BLEDescriptor* pCCCD, uint8_t connId, uint16_t cccBits) {
+	ble_service_cb_data_t data = {};
+	data.event         = SERVICE_CALLBACK_TYPE_INDIFICATION_NOTIFICATION;
+	data.conn_id       = connId;
+	data.attrib_handle = pCCCD->getHandle();
+	data.cb_data_context.cccd_update_data.cccbits = cccBits;
+	g_stubGattsCallback((uint8_t)pCharacteristic->getService()->getHandle(), &data);
+} // writeCCCD
+
+/**
+ * @brief Notify once and report which connections were sent the value, one bit per connection.
+ */
+static uint32_t notifiedPeers(BLECharacteristic* pCharacteristic) {
+	g_stubStack.sends.clear();
+	pCharacteristic->notify();
+	uint32_t peers = 0;
+	for (const StubSend& send : g_stubStack.sends) {
+		peers |= 1 << send.connId;
+	}
+	return peers;
+} // notifiedPeers
+
+/**
+ * @brief One peer subscribing does not subscribe the others, they follow the local default.
+ */
+static void testPerPeer(BLEServer* pServer, BLECharacteristic* pCharacteristic, BLE2902* pCCCD) {
+	pServer->addPeerDevice(nullptr, false, 1);
+	pServer->addPeerDevice(nullptr, false, 2);
+	CHECK_EQ(notifiedPeers(pCharacteristic), 0);
+	writeCCCD(pCharacteristic, pCCCD, 1, 1);
+	CHECK_EQ(notifiedPeers(pCharacteristic), 1 << 1);
+	CHECK(!pCCCD->getNotifications());
+	pCCCD->setNotifications(true);
+	CHECK_EQ(notifiedPeers(pCharacteristic), (1 << 1) | (1 << 2));
+	writeCCCD(pCharacteristic, pCCCD, 1, 0);
+	CHECK_EQ(notifiedPeers(pCharacteristic), 1 << 2);
+	CHECK(pCCCD->getNotifications());
+	pCCCD->setNotifications(false);
+
+	// A peer that reconnects on the same connection starts again from the local default.
+	pServer->removePeerDevice(1, false);
+	writeCCCD(pCharacteristic, pCCCD, 2, 1);
+	pServer->addPeerDevice(nullptr, false, 1);
+	CHECK_EQ(notifiedPeers(pCharacteristic), 1 << 2);
+	pServer->removePeerDevice(1, false);
+	pServer->removePeerDevice(2, false);
+} // testPerPeer
+
+/**
+ * @brief Peers connect, subscribe and disconnect on another task while the application notifies.
+ */
+static void testChurn(BLEServer* pServer, BLECharacteristic* pCharacteristic, BLE2902* pCCCD) {
+	std::atomic<bool> running(true);
+	std::thread peers([&]() {
+		for (uint32_t i = 0; running; i++) {
+			uint8_t connId = (uint8_t)(i % 4);
+			pServer->addPeerDevice(nullptr, false, connId);
+			writeCCCD(pCharacteristic, pCCCD, connId, 1);
+			pServer->removePeerDevice((connId + 2) % 4, false);
+		}
+	});
+	for (int i = 0; i < 20000; i++) {
+		pCharacteristic->notify();
+		if (g_stubStack.sends.size() > 1000) {
+			g_stubStack.sends.clear();
+		}
+	}
+	running = false;
+	peers.join();
+	CHECK(pServer->getPeerDevices(false).size() <= 4);
+} // testChurn
+
+int main() {
+	BLEDevice::init("Subscriptions");
+	BLEServer*         pServer  = BLEDevice::createServer();
+	BLEService*        pService = pServer->createService(BLEUUID((uint16_t)0x180d));
+	BLECharacteristic* pCharacteristic = pService->createCharacteristic(BLEUUID((uint16_t)0x2a37),
+		BLECharacteristic::PROPERTY_NOTIFY);
+	BLE2902* pCCCD = new BLE2902();
+	CHECK(pCharacteristic->addDescriptor(pCCCD));
+	pService->start();
+	testPerPeer(pServer, pCharacteristic, pCCCD);
+	testChurn(pServer, pCharacteristic, pCCCD);
+	return testResult("test_notify_subscriptions");
+} // main
@@ -0,0 +1,130 @@
+/*
+ * test_proximity_tracker.cpp
+ *
+ *  Proximity zones driven by synthetic RSSI traces.
+ */
+
+#include <math.h>
+#include <vector>
+#include "BLEProximityTracker.h"
+#include "test.h"
+
+class ZoneRecorder : public BLEProximityCallbacks {
+public:
+	std::vector<uint8_t> events;
+	float                lastDistance = 0;
+	BLEProximityTracker* pTracker = nullptr;
+	void onZoneEvent(const BLEProximityBeacon& beacon, uint8_t event) {
+		events.push_back(event);
+		lastDistance = pTracker->getDistance(beacon);
+	}
+};
+
+/**
+ * @brief The RSSI received from a beacon at a distance, as the log-distance model predicts it.
+ */
+static int8_t rssiAt(float meters, int8_t txPower, float exponent) {
+	return (int8_t)lroundf(txPower - 10.0f * exponent * log10f(meters));
+} // rssiAt
+
+/**
+ * @brief Hold a beacon at a distance for enough samples to settle the filter.
+ */
+static void holdAt(BLEProximityTracker* pTracker, uint64_t key, float meters, uint32_t* pNow, float exponent = 2.0f) {
+	for (int i = 0; i < 40; i++) {
+		pTracker->update(key, rssiAt(meters, -59, exponent), -59, (*pNow)++);
+	}
+} // holdAt
+
+/**
+ * @brief A beacon walking in and out passes through every zone once, in order.
+ */
+static void testWalk() {
+	BLEProximityTracker tracker;
+	ZoneRecorder recorder;
+	recorder.pTracker = &tracker;
+	tracker.setCallbacks(&recorder);
+	tracker.setZones(1.0f, 5.0f, 20);
+	uint32_t now = 0;
+	holdAt(&tracker, 1, 10.0f, &now);
+	CHECK(recorder.events.empty());
+	holdAt(&tracker, 1, 3.0f, &now);
+	holdAt(&tracker, 1, 0.5f, &now);
+	holdAt(&tracker, 1, 3.0f, &now);
+	holdAt(&tracker, 1, 10.0f, &now);
+	static const uint8_t expected[] = {
+		BLE_PROXIMITY_EVENT_ENTER, BLE_PROXIMITY_EVENT_FAR, BLE_PROXIMITY_EVENT_NEAR,
+		BLE_PROXIMITY_EVENT_FAR, BLE_PROXIMITY_EVENT_EXIT
+	};
+	CHECK(recorder.events == std::vector<uint8_t>(expected, expected + sizeof(expected)));
+	CHECK(fabsf(tracker.getDistance(*tracker.find(1)) - 10.0f) < 1.0f);
+} // testWalk
+
+/**
+ * @brief A beacon sitting just past a boundary stays put, it has to clear the hysteresis margin.
+ */
+static void testHysteresis() {
+	BLEProximityTracker tracker;
+	ZoneRecorder recorder;
+	recorder.pTracker = &tracker;
+	tracker.setCallbacks(&recorder);
+	tracker.setZones(1.0f, 5.0f, 20);
+	uint32_t now = 0;
+	holdAt(&tracker, 2, 3.0f, &now);
+	CHECK_EQ(recorder.events.size(), 2);
+	holdAt(&tracker, 2, 0.9f, &now);   // Inside the near boundary, not past the 0.8 m margin.
+	holdAt(&tracker, 2, 5.5f, &now);   // Outside the far boundary, not past the 6 m margin.
+	CHECK_EQ(recorder.events.size(), 2);
+	CHECK_EQ(tracker.find(2)->zone, BLE_PROXIMITY_ZONE_FAR);
+	holdAt(&tracker, 2, 0.7f, &now);
+	CHECK_EQ(tracker.find(2)->zone, BLE_PROXIMITY_ZONE_NEAR);
+	CHECK(fabsf(recorder.lastDistance - 0.7f) < 0.1f);
+} // testHysteresis
+
+/**
+ * @brief The thresholds follow the path loss exponent, the zones stay in meters.
+ */
+static void testExponent() {
+	BLEProximityTracker tracker;
+	tracker.setZones(1.0f, 5.0f, 20);
+	tracker.setPathLossExponent(3.0f);
+	uint32_t now = 0;
+	holdAt(&tracker, 3, 3.0f, &now, 3.0f);
+	CHECK_EQ(tracker.find(3)->zone, BLE_PROXIMITY_ZONE_FAR);
+	holdAt(&tracker, 4, 7.0f, &now, 3.0f);
+	CHECK_EQ(tracker.find(4)->zone, BLE_PROXIMITY_ZONE_NONE);
+	CHECK(fabsf(tracker.getDistance(*tracker.find(3)) - 3.0f) < 0.3f);
+} // testExponent
+
+/**
+ * @brief Beacons that go quiet exit once, and their entries are reused.
+ */
+static void testExpiry() {
+	BLEProximityTracker tracker;
+	ZoneRecorder recorder;
+	recorder.pTracker = &tracker;
+	tracker.setCallbacks(&recorder);
+	tracker.setTimeout(1000);
+	uint32_t now = 0;
+	for (uint64_t key = 100; key < 100 + BLE_PROXIMITY_MAX_BEACONS; key++) {
+		tracker.update(key, -59, -59, now);
+	}
+	CHECK_EQ(tracker.getCount(), BLE_PROXIMITY_MAX_BEACONS);
+	tracker.update(99, -59, -59, now);
+	CHECK_EQ(tracker.getDroppedCount(), 1);
+	recorder.events.clear();
+	tracker.expire(now + 1000);
+	CHECK_EQ(tracker.getCount(), 0);
+	CHECK_EQ(recorder.events.size(), BLE_PROXIMITY_MAX_BEACONS);
+	tracker.update(99, -59, -59, now + 1000);
+	CHECK(tracker.find(99) != nullptr);
+	CHECK(tracker.find(100) == nullptr);
+} // testExpiry
+
+int main() {
+	testWalk();
+	testHysteresis();
+	testExponent();
+	testExpiry();
+	return testResult("test_proximity_tracker");
+} // main
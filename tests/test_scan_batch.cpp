@@ -0,0 +1,129 @@
+/*
+ * test_scan_batch.cpp
+ *
+ *  Batched delivery: size, delay and stop flushes, and the task they are delivered from.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static const uint8_t s_payload[] = { 2, 0x01, 0x06 };
+
+static void inject(BLEScan* pScan, uint32_t n) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 9, 9, 9, 9 };
+	BLEScanReport report = {};
+	report.address    = address;
+	report.advType    = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+	report.rssi       = -50;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = sizeof(s_payload);
+	report.data       = s_payload;
+	pScan->injectReport(&report);
+} // inject
+
+class BatchCallbacks : public BLEAdvertisedDeviceCallbacks {
+public:
+	std::mutex      mutex;
+	int             batches = 0;
+	int             records = 0;
+	int             results = 0;
+	bool            onCaller = false;   // A batch was delivered from the thread that injected or stopped.
+	std::thread::id caller;
+	void onResults(const BLEScanRecord* /*pRecords*/, size_t count) {
+		std::lock_guard<std::mutex> lock(mutex);
+		batches++;
+		records += count;
+		onCaller = onCaller || (std::this_thread::get_id() == caller);
+	}
+	void onResult(BLEAdvertisedDevice /*advertisedDevice*/) {
+		std::lock_guard<std::mutex> lock(mutex);
+		results++;
+	}
+	int getRecords() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return records;
+	}
+};
+
+static void waitFor(BatchCallbacks* pCallbacks, int records) {
+	for (int i = 0; i < 100 && pCallbacks->getRecords() < records; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+} // waitFor
+
+/**
+ * @brief A full batch is delivered from the scan task, on the report that filled it.
+ */
+static void testSizeFlush(BLEScan* pScan, BatchCallbacks* pCallbacks) {
+	pScan->setBatchDelivery(4, 0);
+	for (uint32_t n = 0; n < 8; n++) {
+		inject(pScan, n);
+	}
+	CHECK_EQ(pCallbacks->batches, 2);
+	CHECK_EQ(pCallbacks->records, 8);
+	CHECK(pCallbacks->onCaller);
+} // testSizeFlush
+
+/**
+ * @brief A partial batch goes out once it is maxDelayMs old, even without further reports.
+ */
+static void testDelayFlush(BLEScan* pScan, BatchCallbacks* pCallbacks) {
+	pCallbacks->onCaller = false;
+	pScan->setBatchDelivery(16, 30);
+	inject(pScan, 100);
+	inject(pScan, 101);
+	inject(pScan, 102);
+	CHECK_EQ(pCallbacks->getRecords(), 8);
+	waitFor(pCallbacks, 11);
+	CHECK_EQ(pCallbacks->getRecords(), 11);
+	CHECK(!pCallbacks->onCaller);
+} // testDelayFlush
+
+/**
+ * @brief stop() hands the buffered records to the batch task instead of calling back itself.
+ */
+static void testStopFlush(BLEScan* pScan, BatchCallbacks* pCallbacks) {
+	pScan->setBatchDelivery(16, 0);
+	waitFor(pCallbacks, 11);
+	for (uint32_t n = 200; n < 205; n++) {
+		inject(pScan, n);
+	}
+	pScan->stop();
+	waitFor(pCallbacks, 16);
+	CHECK_EQ(pCallbacks->getRecords(), 16);
+	CHECK(!pCallbacks->onCaller);
+
+	pScan->setBatchDelivery(0);
+	inject(pScan, 300);
+	std::this_thread::sleep_for(std::chrono::milliseconds(2 * BLE_SCAN_BATCH_TICK));
+	CHECK_EQ(pCallbacks->getRecords(), 16);
+	CHECK_EQ(pCallbacks->results, 1);
+} // testStopFlush
+
+/**
+ * @brief The dedup table, the record stream, the batch buffer and the extended buffers are only allocated
+ * by the features that use them, the scan object itself holds the results.
+ */
+static void testFootprint() {
+	printf("sizeof(BLEScan) = %u bytes\n", (unsigned)sizeof(BLEScan));
+	CHECK(sizeof(BLEScan) < 16 * 1024);
+} // testFootprint
+
+int main() {
+	testFootprint();
+	BLEScan* pScan = BLEDevice::getScan();
+	BatchCallbacks callbacks;
+	callbacks.caller = std::this_thread::get_id();
+	pScan->setAdvertisedDeviceCallbacks(&callbacks, true);
+	testSizeFlush(pScan, &callbacks);
+	testDelayFlush(pScan, &callbacks);
+	testStopFlush(pScan, &callbacks);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	return testResult("test_scan_batch");
+} // main
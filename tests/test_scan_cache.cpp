@@ -0,0 +1,138 @@
+/*
+ * test_scan_cache.cpp
+ *
+ *  Cache mode: least recently seen devices evicted first, and devices that went quiet expiring.
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static const uint8_t s_payload[] = { 2, 0x01, 0x06 };
+
+static void inject(BLEScan* pScan, uint32_t n) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 9, 9, 9, 9 };
+	BLEScanReport report = {};
+	report.address    = address;
+	report.advType    = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+	report.rssi       = -50;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = sizeof(s_payload);
+	report.data       = s_payload;
+	pScan->injectReport(&report);
+} // inject
+
+static uint32_t deviceNumber(const BLEAdvertisedDevice& advertisedDevice) {
+	BLEAddress address = advertisedDevice.getAddress();
+	const uint8_t* pAddress = *address.getNative();
+	return pAddress[0] | (pAddress[1] << 8);
+} // deviceNumber
+
+class CacheCallbacks : public BLEAdvertisedDeviceCallbacks {
+public:
+	std::vector<uint32_t> evicted;   // Device numbers, in the order they were evicted.
+	void onResult(BLEAdvertisedDevice) {}
+	void onEvict(const BLEAdvertisedDevice& advertisedDevice) {
+		evicted.push_back(deviceNumber(advertisedDevice));
+	}
+};
+
+/**
+ * @brief Whether the results hold exactly the given devices, in any order.
+ */
+static bool holds(BLEScan* pScan, std::vector<uint32_t> devices) {
+	BLEScanResults results = pScan->getResults();
+	if ((size_t)results.getCount() != devices.size()) {
+		return false;
+	}
+	for (int i = 0; i < results.getCount(); i++) {
+		bool expected = false;
+		for (uint32_t n : devices) {
+			expected = expected || deviceNumber(results[i]) == n;
+		}
+		if (!expected) {
+			return false;
+		}
+	}
+	return true;
+} // holds
+
+/**
+ * @brief A full cache evicts the device that has not advertised for the longest time, and advertising
+ * again puts a device back at the end of the line.
+ */
+static void testLeastRecent(BLEScan* pScan, CacheCallbacks* pCallbacks) {
+	pScan->setCacheMode(true, 3);
+	uint32_t evictedBefore = pScan->getEvictedCount();
+	inject(pScan, 1);
+	inject(pScan, 2);
+	inject(pScan, 3);
+	CHECK(pCallbacks->evicted.empty());
+	inject(pScan, 1);
+	inject(pScan, 4);
+	CHECK_EQ(pCallbacks->evicted.size(), 1);
+	CHECK_EQ(pCallbacks->evicted[0], 2);
+	inject(pScan, 3);
+	inject(pScan, 5);
+	CHECK_EQ(pCallbacks->evicted.size(), 2);
+	CHECK_EQ(pCallbacks->evicted[1], 1);
+	inject(pScan, 6);
+	CHECK_EQ(pCallbacks->evicted.size(), 3);
+	CHECK_EQ(pCallbacks->evicted[2], 4);
+	CHECK(holds(pScan, { 3, 5, 6 }));
+	CHECK_EQ(pScan->getEvictedCount() - evictedBefore, 3);
+
+	// A byte budget smaller than the entry limit wins.
+	pScan->clearResults();
+	pCallbacks->evicted.clear();
+	pScan->setCacheMode(true, 3, 2 * BLEScanResultStore::getEntrySize());
+	inject(pScan, 7);
+	inject(pScan, 8);
+	inject(pScan, 9);
+	CHECK_EQ(pCallbacks->evicted.size(), 1);
+	CHECK_EQ(pCallbacks->evicted[0], 7);
+	CHECK(holds(pScan, { 8, 9 }));
+	pScan->clearResults();
+	pCallbacks->evicted.clear();
+} // testLeastRecent
+
+/**
+ * @brief Devices silent for longer than the maximum age are evicted by the next report, from anyone,
+ * and a device that advertises in time is kept.
+ */
+static void testStale(BLEScan* pScan, CacheCallbacks* pCallbacks) {
+	pScan->setCacheMode(true, BLE_SCAN_MAX_DEVICES, 0, 60);
+	inject(pScan, 10);
+	inject(pScan, 11);
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	inject(pScan, 11);
+	CHECK(pCallbacks->evicted.empty());
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));   // 10 silent for 80 ms, 11 for 50 ms.
+	inject(pScan, 12);
+	CHECK_EQ(pCallbacks->evicted.size(), 1);
+	CHECK_EQ(pCallbacks->evicted[0], 10);
+	CHECK(holds(pScan, { 11, 12 }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	inject(pScan, 10);                                             // Both expired, 10 is new again.
+	CHECK_EQ(pCallbacks->evicted.size(), 3);
+	CHECK_EQ(pCallbacks->evicted[1], 11);
+	CHECK_EQ(pCallbacks->evicted[2], 12);
+	CHECK(holds(pScan, { 10 }));
+	pScan->clearResults();
+	pCallbacks->evicted.clear();
+} // testStale
+
+int main() {
+	BLEScan* pScan = BLEDevice::getScan();
+	CacheCallbacks callbacks;
+	pScan->setAdvertisedDeviceCallbacks(&callbacks, true);
+	pScan->clearResults();
+	testLeastRecent(pScan, &callbacks);
+	testStale(pScan, &callbacks);
+	pScan->setCacheMode(false);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	return testResult("test_scan_cache");
+} // main
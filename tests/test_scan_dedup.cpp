@@ -0,0 +1,71 @@
+/*
+ * test_scan_dedup.cpp
+ *
+ *  Duplicate filter: what is reported again, and a full population of advertisers.
+ */
+
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static uint64_t makeKey(uint32_t n) {
+	uint8_t address[6] = { (uint8_t)(n * 13), (uint8_t)(n >> 8), 0x5a, 0x11, 0x22, 0x33 };
+	return BLEAddress::toKey(address, GAP_REMOTE_ADDR_LE_PUBLIC);
+} // makeKey
+
+/**
+ * @brief A repeat is reported only for a new payload, an RSSI step or after the refresh interval.
+ */
+static void testRepeats() {
+	static BLEScanDuplicateFilter filter;
+	filter.setThresholds(5, 1000);
+	uint8_t payload[] = { 2, 0x01, 0x06 };
+	uint8_t changed[] = { 2, 0x01, 0x04 };
+	uint64_t key = makeKey(1);
+	CHECK(filter.update(key, false, payload, sizeof(payload), -60, 0));
+	CHECK(!filter.update(key, false, payload, sizeof(payload), -62, 10));
+	CHECK(filter.update(key, true, payload, sizeof(payload), -60, 20));    // First scan response.
+	CHECK(filter.update(key, false, changed, sizeof(changed), -60, 30));
+	CHECK(filter.update(key, false, changed, sizeof(changed), -70, 40));
+	CHECK(!filter.update(key, false, changed, sizeof(changed), -70, 1039));
+	CHECK(filter.update(key, false, changed, sizeof(changed), -70, 1040));
+	CHECK_EQ(filter.getSuppressedCount(), 2);
+} // testRepeats
+
+/**
+ * @brief As many advertisers as the scan records keep their entries, so none of their repeats get through.
+ */
+static void testPopulation() {
+	static BLEScanDuplicateFilter filter;
+	filter.setThresholds(5, 0);
+	uint8_t payload[] = { 2, 0x01, 0x06 };
+	for (int round = 0; round < 3; round++) {
+		for (uint32_t n = 0; n < BLE_SCAN_MAX_DEVICES; n++) {
+			filter.update(makeKey(n), false, payload, sizeof(payload), -60, round * 100 + n);
+		}
+	}
+	CHECK_EQ(filter.getReportedCount(), BLE_SCAN_MAX_DEVICES);
+	CHECK_EQ(filter.getSuppressedCount(), BLE_SCAN_MAX_DEVICES * 2);
+} // testPopulation
+
+/**
+ * @brief The scan only allocates its filter table once the filter is enabled.
+ */
+static void testLazy() {
+	BLEScan* pScan = BLEDevice::getScan();
+	CHECK(pScan->getDuplicateFilter() == nullptr);
+	pScan->setDuplicateFilter(false);
+	CHECK(pScan->getDuplicateFilter() == nullptr);
+	pScan->setDuplicateFilter(true, 3, 500);
+	BLEScanDuplicateFilter* pFilter = pScan->getDuplicateFilter();
+	CHECK(pFilter != nullptr);
+	pScan->setDuplicateFilter(false);
+	CHECK(pScan->getDuplicateFilter() == pFilter);   // Kept, with its counters.
+} // testLazy
+
+int main() {
+	testLazy();
+	testRepeats();
+	testPopulation();
+	return testResult("test_scan_dedup");
+} // main
@@ -0,0 +1,123 @@
+/*
+ * test_scan_extended.cpp
+ *
+ *  Extended advertising payloads: fragment reassembly, the payload pool and its lazy allocation.
+ */
+
+#include <string.h>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static uint8_t s_payload[BLE_SCAN_EXT_MAX_DATA];
+
+static void inject(BLEScan* pScan, uint32_t n, const uint8_t* pData, uint16_t length,
+	uint8_t dataStatus = BLE_SCAN_DATA_COMPLETE, uint8_t sid = 0, uint8_t advType = GAP_ADV_EVT_TYPE_UNDIRECTED) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 5, 5, 5, 5 };
+	BLEScanReport report = {};
+	report.address    = address;
+	report.advType    = advType;
+	report.rssi       = -60;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.extended   = true;
+	report.sid        = sid;
+	report.dataLength = length;
+	report.data       = pData;
+	pScan->injectReport(&report, dataStatus);
+} // inject
+
+static bool samePayload(const BLEAdvertisementView& view, const uint8_t* pData, size_t length) {
+	return view.getLength() == length && memcmp(view.getPayload(), pData, length) == 0;
+} // samePayload
+
+/**
+ * @brief Legacy sized reports leave the extended buffers unallocated.
+ */
+static void testLegacyOnly(BLEScan* pScan) {
+	for (uint32_t n = 0; n < 20; n++) {
+		inject(pScan, n, s_payload, BLE_SCAN_LEGACY_MAX_DATA);
+		inject(pScan, n, s_payload + 1, BLE_SCAN_LEGACY_MAX_DATA, BLE_SCAN_DATA_COMPLETE, 0, GAP_ADV_EVT_TYPE_SCAN_RSP);
+	}
+	CHECK(pScan->getPayloadPool() == nullptr);
+	BLEScanResults results = pScan->getResults();
+	CHECK_EQ(results.getCount(), 20);
+	CHECK(samePayload(results[3].getScanResponsePayload(), s_payload + 1, BLE_SCAN_LEGACY_MAX_DATA));
+	pScan->clearResults();
+} // testLegacyOnly
+
+/**
+ * @brief Chained fragments of two advertising sets, interleaved, come out as two whole payloads.
+ */
+static void testReassembly(BLEScan* pScan) {
+	inject(pScan, 1, s_payload, 100, BLE_SCAN_DATA_MORE, 1);
+	CHECK(pScan->getPayloadPool() != nullptr);
+	inject(pScan, 2, s_payload + 50, 100, BLE_SCAN_DATA_MORE, 1);
+	inject(pScan, 1, s_payload + 100, 100, BLE_SCAN_DATA_MORE, 1);
+	inject(pScan, 2, s_payload + 150, 20, BLE_SCAN_DATA_COMPLETE, 1);
+	CHECK_EQ(pScan->getResults().getCount(), 1);
+	inject(pScan, 1, s_payload + 200, 10, BLE_SCAN_DATA_COMPLETE, 1);   // A short last fragment.
+	{
+		BLEScanResults results = pScan->getResults();
+		CHECK_EQ(results.getCount(), 2);
+		CHECK(samePayload(results[0].getAdvertisementPayload(), s_payload + 50, 120));
+		CHECK(samePayload(results[1].getAdvertisementPayload(), s_payload, 210));
+		CHECK_EQ(pScan->getPayloadPool()->getInUse(), 2);
+	}
+	pScan->clearResults();
+	CHECK_EQ(pScan->getPayloadPool()->getInUse(), 0);
+} // testReassembly
+
+/**
+ * @brief A snapshot keeps the payload block it saw when the scan response is merged into the device.
+ */
+static void testCopyOnWrite(BLEScan* pScan) {
+	inject(pScan, 3, s_payload, 200);
+	{
+		BLEScanResults before = pScan->getResults();
+		CHECK_EQ(pScan->getPayloadPool()->getInUse(), 1);
+		inject(pScan, 3, s_payload + 2, 150, BLE_SCAN_DATA_COMPLETE, 0, GAP_ADV_EVT_TYPE_SCAN_RSP);
+		BLEScanResults after = pScan->getResults();
+		CHECK(samePayload(before[0].getAdvertisementPayload(), s_payload, 200));
+		CHECK(!before[0].haveScanResponse());
+		CHECK(samePayload(after[0].getAdvertisementPayload(), s_payload, 200));
+		CHECK(samePayload(after[0].getScanResponsePayload(), s_payload + 2, 150));
+		CHECK_EQ(pScan->getPayloadPool()->getInUse(), 2);
+	}
+	pScan->clearResults();
+	CHECK_EQ(pScan->getPayloadPool()->getInUse(), 0);
+} // testCopyOnWrite
+
+/**
+ * @brief Once every block is taken, large payloads are truncated to what fits in the record.
+ */
+static void testExhausted(BLEScan* pScan) {
+	for (uint32_t n = 0; n < BLE_SCAN_PAYLOAD_BLOCKS + 2; n++) {
+		inject(pScan, 100 + n, s_payload, 200);
+	}
+	{
+		BLEScanResults results = pScan->getResults();
+		CHECK_EQ(pScan->getPayloadPool()->getInUse(), BLE_SCAN_PAYLOAD_BLOCKS);
+		CHECK_EQ(pScan->getPayloadPool()->getExhaustedCount(), 2);
+		BLEAdvertisementView last = results[BLE_SCAN_PAYLOAD_BLOCKS + 1].getAdvertisementPayload();
+		CHECK(last.getLength() < 200 && samePayload(last, s_payload, last.getLength()));
+	}
+	pScan->clearResults();
+	CHECK_EQ(pScan->getPayloadPool()->getInUse(), 0);
+} // testExhausted
+
+int main() {
+	for (size_t i = 0; i < sizeof(s_payload); i++) {
+		s_payload[i] = (uint8_t)(i * 7 + 1);
+	}
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->setAdvertisedDeviceCallbacks(nullptr, true);
+	pScan->setActiveScan(true);
+	pScan->setScanResponseMerge(true, 500);
+	testLegacyOnly(pScan);
+	testReassembly(pScan);
+	testCopyOnWrite(pScan);
+	testExhausted(pScan);
+	pScan->setScanResponseMerge(false);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	return testResult("test_scan_extended");
+} // main
@@ -0,0 +1,147 @@
+/*
+ * test_scan_filter.cpp
+ *
+ *  Scan filter rules: each condition, rules combined, and invalid rules.
+ */
+
+#include <string.h>
+#include "BLEScanFilter.h"
+#include "test.h"
+
+static uint8_t s_address[6] = { 1, 2, 3, 4, 5, 6 };
+
+static BLEScanReport makeReport(const uint8_t* pData, uint16_t length, int8_t rssi = -60,
+	uint8_t addressType = GAP_REMOTE_ADDR_LE_PUBLIC) {
+	BLEScanReport report = {};
+	report.address     = s_address;
+	report.addressType = addressType;
+	report.advType     = GAP_ADV_EVT_TYPE_UNDIRECTED;
+	report.rssi        = rssi;
+	report.txPower     = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength  = length;
+	report.data        = pData;
+	return report;
+} // makeReport
+
+static bool matches(BLEScanFilter* pFilter, const uint8_t* pData, uint16_t length, int8_t rssi = -60,
+	uint8_t addressType = GAP_REMOTE_ADDR_LE_PUBLIC) {
+	BLEScanReport report = makeReport(pData, length, rssi, addressType);
+	return pFilter->match(&report);
+} // matches
+
+// Heart rate service, an iBeacon and a name.
+static const uint8_t s_heartRate[] = { 3, GAP_ADTYPE_16BIT_COMPLETE, 0x0d, 0x18, 5, GAP_ADTYPE_LOCAL_NAME_COMPLETE, 'W', 'i', 'o', 'T' };
+static const uint8_t s_iBeacon[]   = { 7, GAP_ADTYPE_MANUFACTURER_SPECIFIC, 0x4c, 0x00, 0x02, 0x15, 0xaa, 0xbb };
+static const uint8_t s_eddystone[] = { 5, GAP_ADTYPE_SERVICE_DATA, 0xaa, 0xfe, 0x10, 0x00 };
+
+/**
+ * @brief Each condition on its own, and an empty filter passes everything.
+ */
+static void testConditions() {
+	BLEScanFilter filter;
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+
+	int rule = filter.addRule();
+	CHECK(filter.setServiceUUID(rule, BLEUUID((uint16_t)0x180d)));
+	CHECK(matches(&filter, s_heartRate, sizeof(s_heartRate)));
+	CHECK(!matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+
+	filter.clear();
+	rule = filter.addRule();
+	filter.setServiceUUID(rule, BLEUUID((uint16_t)0xfeaa));   // Found in the service data.
+	CHECK(matches(&filter, s_eddystone, sizeof(s_eddystone)));
+
+	filter.clear();
+	BLEUUID vendor("6e400001-b5a3-f393-e0a9-e50e24dcca9e");
+	uint8_t vendorAd[18] = { 17, GAP_ADTYPE_128BIT_COMPLETE };
+	memcpy(vendorAd + 2, vendor.getNative()->uuid.uuid128, 16);
+	rule = filter.addRule();
+	filter.setServiceUUID(rule, vendor);
+	CHECK(matches(&filter, vendorAd, sizeof(vendorAd)));
+	vendorAd[17] ^= 1;
+	CHECK(!matches(&filter, vendorAd, sizeof(vendorAd)));
+
+	filter.clear();
+	rule = filter.addRule();
+	filter.setManufacturerId(rule, 0x004c);
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+	CHECK(!matches(&filter, s_heartRate, sizeof(s_heartRate)));
+
+	filter.clear();
+	static const uint8_t prefix[] = { 0x02, 0x15, 0xa0 };
+	static const uint8_t mask[]   = { 0xff, 0xff, 0xf0 };
+	rule = filter.addRule();
+	filter.setManufacturerData(rule, 0x004c, prefix, mask, sizeof(prefix));
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+	filter.setManufacturerData(rule, 0x004c, prefix, nullptr, sizeof(prefix));   // 0xaa no longer equals 0xa0.
+	CHECK(!matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+
+	filter.clear();
+	rule = filter.addRule();
+	filter.setNamePrefix(rule, "Wio");
+	CHECK(matches(&filter, s_heartRate, sizeof(s_heartRate)));
+	filter.setNamePrefix(rule, "WioTerm");
+	CHECK(!matches(&filter, s_heartRate, sizeof(s_heartRate)));
+
+	filter.clear();
+	rule = filter.addRule();
+	filter.setMinRSSI(rule, -70);
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon), -70));
+	CHECK(!matches(&filter, s_iBeacon, sizeof(s_iBeacon), -71));
+
+	filter.clear();
+	rule = filter.addRule();
+	filter.setAddressType(rule, GAP_REMOTE_ADDR_LE_RANDOM);
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon), -60, GAP_REMOTE_ADDR_LE_RANDOM));
+	CHECK(!matches(&filter, s_iBeacon, sizeof(s_iBeacon)));
+} // testConditions
+
+/**
+ * @brief The conditions of a rule must all hold, any one rule is enough.
+ */
+static void testRules() {
+	BLEScanFilter filter;
+	int beacons = filter.addRule();
+	filter.setManufacturerId(beacons, 0x004c);
+	filter.setMinRSSI(beacons, -70);
+	int named = filter.addRule();
+	filter.setNamePrefix(named, "Wio");
+	CHECK_EQ(filter.getRuleCount(), 2);
+
+	CHECK(matches(&filter, s_iBeacon, sizeof(s_iBeacon), -60));
+	CHECK(!matches(&filter, s_iBeacon, sizeof(s_iBeacon), -80));   // The company matches, the RSSI does not.
+	CHECK(matches(&filter, s_heartRate, sizeof(s_heartRate), -80));
+	CHECK(!matches(&filter, s_eddystone, sizeof(s_eddystone)));
+	CHECK_EQ(filter.getPassedCount(), 2);
+	CHECK_EQ(filter.getRejectedCount(), 2);
+} // testRules
+
+/**
+ * @brief Invalid rule indices, unset UUIDs and oversized prefixes are refused and leave the filter as it was.
+ */
+static void testInvalid() {
+	BLEScanFilter filter;
+	CHECK(!filter.setMinRSSI(0, -50));
+	CHECK(!filter.setServiceUUID(-1, BLEUUID((uint16_t)0x180d)));
+	int rule = filter.addRule();
+	CHECK(!filter.setManufacturerId(rule + 1, 0x004c));
+	CHECK(!filter.setServiceUUID(rule, BLEUUID()));
+	CHECK(!filter.setServiceUUID(rule + 1, BLEUUID()));
+	CHECK(!filter.setNamePrefix(rule, "ALongerName"));
+	uint8_t prefix[BLE_SCAN_FILTER_MAX_PREFIX + 1] = {};
+	CHECK(!filter.setManufacturerData(rule, 0x004c, prefix, nullptr, sizeof(prefix)));
+	CHECK(matches(&filter, s_eddystone, sizeof(s_eddystone)));   // The rule still has no condition.
+
+	for (int i = 1; i < BLE_SCAN_FILTER_MAX_RULES; i++) {
+		filter.addRule();
+	}
+	CHECK_EQ(filter.addRule(), -1);
+	CHECK_EQ(filter.getRuleCount(), BLE_SCAN_FILTER_MAX_RULES);
+} // testInvalid
+
+int main() {
+	testConditions();
+	testRules();
+	testInvalid();
+	return testResult("test_scan_filter");
+} // main
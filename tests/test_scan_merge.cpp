@@ -0,0 +1,119 @@
+/*
+ * test_scan_merge.cpp
+ *
+ *  Scan response merging: held back devices, the merge timeout and the flush when merging is disabled.
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static const uint8_t s_advertisement[] = { 2, 0x01, 0x06 };
+static const uint8_t s_scanResponse[]  = { 4, 0x09, 'W', 'i', 'o' };
+
+static void inject(BLEScan* pScan, uint32_t n, uint8_t advType = GAP_ADV_EVT_TYPE_UNDIRECTED) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 7, 7, 7, 7 };
+	bool scanResponse = (advType == GAP_ADV_EVT_TYPE_SCAN_RSP);
+	BLEScanReport report = {};
+	report.address    = address;
+	report.advType    = advType;
+	report.rssi       = -50;
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = scanResponse ? sizeof(s_scanResponse) : sizeof(s_advertisement);
+	report.data       = scanResponse ? s_scanResponse : s_advertisement;
+	pScan->injectReport(&report);
+} // inject
+
+class MergeCallbacks : public BLEAdvertisedDeviceCallbacks {
+public:
+	std::vector<uint32_t> devices;            // Device numbers, in the order they were reported.
+	std::vector<bool>     scanResponses;
+	bool                  onOther = false;    // A device was reported from a thread other than the scan's.
+	std::thread::id       scanThread;
+	void onResult(BLEAdvertisedDevice advertisedDevice) {
+		BLEAddress address = advertisedDevice.getAddress();
+		const uint8_t* pAddress = *address.getNative();
+		devices.push_back(pAddress[0] | (pAddress[1] << 8));
+		scanResponses.push_back(advertisedDevice.haveScanResponse());
+		onOther = onOther || (std::this_thread::get_id() != scanThread);
+	}
+	void reset() {
+		devices.clear();
+		scanResponses.clear();
+	}
+};
+
+/**
+ * @brief A scannable device is reported once, when its scan response arrives, with both halves.
+ */
+static void testHold(BLEScan* pScan, MergeCallbacks* pCallbacks) {
+	pScan->setScanResponseMerge(true, 500);
+	inject(pScan, 1);
+	CHECK_EQ(pCallbacks->devices.size(), 0);
+	inject(pScan, 1, GAP_ADV_EVT_TYPE_SCAN_RSP);
+	CHECK_EQ(pCallbacks->devices.size(), 1);
+	CHECK(pCallbacks->scanResponses[0]);
+	inject(pScan, 1);
+	CHECK_EQ(pCallbacks->devices.size(), 1);
+	inject(pScan, 2, GAP_ADV_EVT_TYPE_NON_CONNECTABLE);   // Nothing else is coming, reported at once.
+	CHECK_EQ(pCallbacks->devices.size(), 2);
+	CHECK_EQ(pCallbacks->devices[1], 2);
+	pCallbacks->reset();
+} // testHold
+
+/**
+ * @brief A device whose scan response does not arrive in time is reported without it, on the next report,
+ * and a late scan response does not report it again.
+ */
+static void testTimeout(BLEScan* pScan, MergeCallbacks* pCallbacks) {
+	pScan->setScanResponseMerge(true, 20);
+	inject(pScan, 10);
+	std::this_thread::sleep_for(std::chrono::milliseconds(40));
+	CHECK_EQ(pCallbacks->devices.size(), 0);
+	inject(pScan, 11, GAP_ADV_EVT_TYPE_NON_CONNECTABLE);
+	CHECK_EQ(pCallbacks->devices.size(), 2);
+	CHECK_EQ(pCallbacks->devices[0], 10);
+	CHECK(!pCallbacks->scanResponses[0]);
+	CHECK_EQ(pCallbacks->devices[1], 11);
+	inject(pScan, 10, GAP_ADV_EVT_TYPE_SCAN_RSP);
+	CHECK_EQ(pCallbacks->devices.size(), 2);
+	pCallbacks->reset();
+} // testTimeout
+
+/**
+ * @brief Disabling the merge from the application leaves the held back devices to the scan task, which
+ * reports them ahead of its next report.
+ */
+static void testDisable(BLEScan* pScan, MergeCallbacks* pCallbacks) {
+	pScan->setScanResponseMerge(true, 500);
+	inject(pScan, 20);
+	inject(pScan, 21);
+	std::thread application([pScan]() {
+		pScan->setScanResponseMerge(false);
+	});
+	application.join();
+	CHECK_EQ(pCallbacks->devices.size(), 0);
+	inject(pScan, 22);
+	CHECK_EQ(pCallbacks->devices.size(), 3);
+	CHECK_EQ(pCallbacks->devices[0], 20);
+	CHECK_EQ(pCallbacks->devices[1], 21);
+	CHECK_EQ(pCallbacks->devices[2], 22);
+	CHECK(!pCallbacks->onOther);
+	pCallbacks->reset();
+} // testDisable
+
+int main() {
+	BLEScan* pScan = BLEDevice::getScan();
+	MergeCallbacks callbacks;
+	callbacks.scanThread = std::this_thread::get_id();
+	pScan->setAdvertisedDeviceCallbacks(&callbacks, false);
+	pScan->setActiveScan(true);
+	testHold(pScan, &callbacks);
+	testTimeout(pScan, &callbacks);
+	testDisable(pScan, &callbacks);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	return testResult("test_scan_merge");
+} // main
@@ -0,0 +1,158 @@
+/*
+ * test_scan_record.cpp
+ *
+ *  Binary record frames written by BLEScanRecordWriter and read back by BLEScanRecordReader.
+ */
+
+#include <string.h>
+#include <vector>
+#include "BLEScanRecordWriter.h"
+#include "BLEScanRecordReader.h"
+#include "test.h"
+
+static BLEScanRecord makeRecord(uint32_t n) {
+	BLEScanRecord record = {};
+	record.timestamp   = 1000 + n * 37;
+	record.address[0]  = (uint8_t)n;
+	record.address[5]  = 0xc0;
+	record.addressType = n % 2;
+	record.advType     = n % 5;
+	record.rssi        = -30 - (int8_t)(n % 60);
+	record.dataLength  = n % (BLE_SCAN_RECORD_MAX_DATA + 1);
+	for (uint8_t i = 0; i < record.dataLength; i++) {
+		record.data[i] = (uint8_t)(n + i);
+	}
+	return record;
+} // makeRecord
+
+static bool sameRecord(const BLEScanRecord& a, const BLEScanRecord& b) {
+	return a.timestamp == b.timestamp && memcmp(a.address, b.address, 6) == 0 && a.addressType == b.addressType &&
+		a.advType == b.advType && a.rssi == b.rssi && a.dataLength == b.dataLength && memcmp(a.data, b.data, a.dataLength) == 0;
+} // sameRecord
+
+/**
+ * @brief Write records in frames of batchSize, one buffer per frame.
+ */
+static std::vector<std::vector<uint8_t> > writeFrames(uint32_t first, uint32_t count, uint8_t batchSize) {
+	static uint8_t buffer[BLE_SCAN_EXPORT_MAX_FRAME * 64];
+	std::vector<std::vector<uint8_t> > frames;
+	BLEScanRecordWriter writer(buffer, sizeof(buffer), batchSize);
+	for (uint32_t n = first; n < first + count; n++) {
+		BLEScanRecord record = makeRecord(n);
+		writer.write(&record);
+		if (writer.getBufferLength() != 0) {
+			frames.push_back(std::vector<uint8_t>(buffer, buffer + writer.getBufferLength()));
+			writer.resetBuffer();
+		}
+	}
+	writer.flush();
+	if (writer.getBufferLength() != 0) {
+		frames.push_back(std::vector<uint8_t>(buffer, buffer + writer.getBufferLength()));
+	}
+	return frames;
+} // writeFrames
+
+/**
+ * @brief Feed bytes to the reader and collect the records of every valid frame.
+ */
+static void readBytes(BLEScanRecordReader* pReader, const std::vector<uint8_t>& bytes, std::vector<BLEScanRecord>* pRecords) {
+	for (size_t i = 0; i < bytes.size(); i++) {
+		if (pReader->feed(bytes[i])) {
+			for (uint8_t r = 0; r < pReader->getRecordCount(); r++) {
+				BLEScanRecord record;
+				pReader->getRecord(r, &record);
+				pRecords->push_back(record);
+			}
+		}
+	}
+} // readBytes
+
+static std::vector<uint8_t> join(const std::vector<std::vector<uint8_t> >& frames) {
+	std::vector<uint8_t> bytes;
+	for (size_t i = 0; i < frames.size(); i++) {
+		bytes.insert(bytes.end(), frames[i].begin(), frames[i].end());
+	}
+	return bytes;
+} // join
+
+/**
+ * @brief Every record comes back intact through full and partial frames, with noise in between.
+ */
+static void testRoundTrip() {
+	std::vector<std::vector<uint8_t> > frames = writeFrames(0, 100, 3);
+	CHECK_EQ(frames.size(), 34);
+	std::vector<uint8_t> bytes;
+	for (size_t i = 0; i < frames.size(); i++) {
+		static const uint8_t noise[] = { 0x00, 'B', 0x42, 'B', 'S', 0x07 };
+		bytes.insert(bytes.end(), noise, noise + (i % sizeof(noise)));
+		bytes.insert(bytes.end(), frames[i].begin(), frames[i].end());
+	}
+	BLEScanRecordReader reader;
+	std::vector<BLEScanRecord> records;
+	readBytes(&reader, bytes, &records);
+	CHECK_EQ(records.size(), 100);
+	bool intact = records.size() == 100;
+	for (uint32_t n = 0; intact && n < 100; n++) {
+		intact = sameRecord(records[n], makeRecord(n));
+	}
+	CHECK(intact);
+	CHECK_EQ(reader.getFrameCount(), 34);
+	CHECK_EQ(reader.getLostFrameCount(), 0);
+	CHECK_EQ(reader.getSequence(), 33);
+} // testRoundTrip
+
+/**
+ * @brief Frames that never arrive show up as gaps in the sequence.
+ */
+static void testSequenceGap() {
+	std::vector<std::vector<uint8_t> > frames = writeFrames(0, 40, 4);
+	frames.erase(frames.begin() + 7);
+	frames.erase(frames.begin() + 2, frames.begin() + 5);
+	BLEScanRecordReader reader;
+	std::vector<BLEScanRecord> records;
+	readBytes(&reader, join(frames), &records);
+	CHECK_EQ(records.size(), 24);
+	CHECK_EQ(reader.getFrameCount(), 6);
+	CHECK_EQ(reader.getLostFrameCount(), 4);
+	CHECK_EQ(reader.getErrorCount(), 0);
+} // testSequenceGap
+
+/**
+ * @brief A frame failing its CRC is counted and skipped, the frames around it are read.
+ */
+static void testCrcFailure() {
+	std::vector<std::vector<uint8_t> > frames = writeFrames(10, 12, 4);
+	frames[1][BLE_SCAN_EXPORT_HEADER_SIZE + 3] ^= 0x10;
+	BLEScanRecordReader reader;
+	std::vector<BLEScanRecord> records;
+	readBytes(&reader, join(frames), &records);
+	CHECK_EQ(records.size(), 8);
+	CHECK(records.size() == 8 && sameRecord(records[4], makeRecord(18)));
+	CHECK_EQ(reader.getErrorCount(), 1);
+	CHECK_EQ(reader.getLostFrameCount(), 1);
+} // testCrcFailure
+
+/**
+ * @brief A damaged length field must not take the frames behind it down as well.
+ */
+static void testDamagedLength() {
+	std::vector<std::vector<uint8_t> > frames = writeFrames(0, 12, 4);
+	frames[0][8] += 40;   // The frame now claims bytes of the next one.
+	std::vector<uint8_t> truncated(frames[1].begin(), frames[1].begin() + 9);   // A frame cut off by a reset.
+	frames.insert(frames.begin() + 1, truncated);
+	BLEScanRecordReader reader;
+	std::vector<BLEScanRecord> records;
+	readBytes(&reader, join(frames), &records);
+	CHECK_EQ(reader.getFrameCount(), 2);
+	CHECK_EQ(records.size(), 8);
+	CHECK(records.size() == 8 && sameRecord(records[0], makeRecord(4)) && sameRecord(records[7], makeRecord(11)));
+	CHECK(reader.getErrorCount() >= 1);
+} // testDamagedLength
+
+int main() {
+	testRoundTrip();
+	testSequenceGap();
+	testCrcFailure();
+	testDamagedLength();
+	return testResult("test_scan_record");
+} // main
@@ -0,0 +1,172 @@
+/*
+ * test_scan_results.cpp
+ *
+ *  Address-keyed result table: lookups, removal, running statistics and a full table.
+ */
+
+#include <map>
+#include <stdlib.h>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static uint64_t makeKey(uint32_t n, uint8_t addressType) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 0x33, 0x44, 0x55, 0x66 };
+	return BLEAddress::toKey(address, addressType);
+} // makeKey
+
+/**
+ * @brief Random inserts, lookups and removals checked against std::map.
+ * Removals exercise the backward shift of the probe sequences.
+ */
+static void testAgainstMap() {
+	static BLEScanResultStore store;
+	static BLEAdvertisedDevice devices[400 * 2];
+	std::map<uint64_t, BLEAdvertisedDevice*> expected;
+	bool consistent = true;
+	srand(1);
+	for (int i = 0; i < 200000 && consistent; i++) {
+		uint32_t n = rand() % 400;
+		uint8_t type = rand() % 2;
+		uint64_t key = makeKey(n, type);
+		BLEAdvertisedDevice* pDevice = &devices[n * 2 + type];
+		switch (rand() % 4) {
+			case 0:
+				if (store.find(key) == nullptr && store.insert(key, pDevice, i, -50, false)) {
+					expected[key] = pDevice;
+				}
+				break;
+			case 1: {
+				BLEAdvertisedDevice* pRemoved = store.remove(key);
+				consistent = (pRemoved == (expected.count(key) ? expected[key] : nullptr));
+				expected.erase(key);
+				break;
+			}
+			default: {
+				std::map<uint64_t, BLEAdvertisedDevice*>::iterator it = expected.find(key);
+				consistent = (store.find(key) == ((it == expected.end()) ? nullptr : it->second));
+				break;
+			}
+		}
+		consistent = consistent && (store.getCount() == expected.size());
+	}
+	CHECK(consistent);
+	for (std::map<uint64_t, BLEAdvertisedDevice*>::iterator it = expected.begin(); it != expected.end(); ++it) {
+		CHECK(store.remove(it->first) == it->second);
+	}
+	CHECK_EQ(store.getCount(), 0);
+} // testAgainstMap
+
+/**
+ * @brief removeAddress() matches the address whatever its type, remove() does not.
+ */
+static void testAddressType() {
+	static BLEScanResultStore store;
+	BLEAdvertisedDevice device;
+	CHECK(store.insert(makeKey(7, GAP_REMOTE_ADDR_LE_RANDOM), &device, 0, -40, false));
+	CHECK(store.find(makeKey(7, GAP_REMOTE_ADDR_LE_PUBLIC)) == nullptr);
+	CHECK(store.remove(makeKey(7, GAP_REMOTE_ADDR_LE_PUBLIC)) == nullptr);
+	CHECK(store.removeAddress(makeKey(7, GAP_REMOTE_ADDR_LE_PUBLIC)) == &device);
+	CHECK_EQ(store.getCount(), 0);
+} // testAddressType
+
+/**
+ * @brief Feed a recorded device a steady RSSI every 100 ms, then return the average in 1/16 dBm.
+ */
+static int16_t settle(BLEScanResultStore* pStore, int index, int8_t rssi, uint32_t* pNow, int samples = 60) {
+	for (int i = 0; i < samples; i++) {
+		*pNow += 100;
+		pStore->touch(index, *pNow, rssi, false);
+	}
+	return pStore->getStats()[index].rssiAverage;
+} // settle
+
+/**
+ * @brief The averages take 1/8 of each step, rounded to the nearest 1/16, and settle within 3/16 of a
+ * steady input from either side, so the average rounded to whole units is the input.
+ */
+static void testStats() {
+	static BLEScanResultStore store;
+	BLEAdvertisedDevice device;
+	uint32_t now = 1000;
+	CHECK(store.insert(makeKey(9, GAP_REMOTE_ADDR_LE_PUBLIC), &device, now, -50, false));
+	int index = store.findIndex(makeKey(9, GAP_REMOTE_ADDR_LE_PUBLIC));
+	const BLEScanDeviceStats* pStats = &store.getStats()[index];
+	CHECK_EQ(pStats->rssiAverage, -50 * 16);
+	CHECK_EQ(settle(&store, index, -60, &now, 1), -820);   // -800 + (-160 / 8).
+	CHECK_EQ(settle(&store, index, -60, &now, 1), -838);   // -820 + (-140 / 8 = -17.5, rounded away from zero).
+
+	CHECK_EQ(settle(&store, index, -60, &now), -957);
+	CHECK_EQ(settle(&store, index, -50, &now), -803);
+	CHECK_EQ(settle(&store, index, -53, &now), -845);
+	CHECK_EQ(settle(&store, index, -50, &now), -803);
+	bool rounded = true;
+	for (int rssi = -100; rssi <= -20; rssi += 7) {
+		int16_t average = settle(&store, index, (int8_t)rssi, &now);
+		rounded = rounded && abs(average - rssi * 16) <= 3 && (average - 8) / 16 == rssi;
+	}
+	CHECK(rounded);
+	CHECK_EQ(pStats->rssiMin, -100);
+	CHECK_EQ(pStats->rssiMax, -23);
+	CHECK_EQ(pStats->rssiLast, -23);
+	CHECK_EQ(pStats->firstSeen, 1000);
+	CHECK_EQ(pStats->lastSeen, now);
+
+	// Intervals alternating around 100 ms, scan responses in between do not count.
+	CHECK_EQ(pStats->intervalAverage, 100 * 16);
+	CHECK_EQ(pStats->intervalMin, 100);
+	for (int i = 0; i < 60; i++) {
+		now += (i % 2) ? 90 : 130;
+		store.touch(index, now, -50, false);
+		store.touch(index, now + 5, -50, true);
+	}
+	CHECK(pStats->intervalAverage >= 105 * 16 && pStats->intervalAverage <= 115 * 16);
+	CHECK_EQ(pStats->intervalMin, 90);
+	CHECK_EQ(pStats->lastSeen, now + 5);
+	CHECK_EQ(pStats->count, 1 + 2 + 4 * 60 + 12 * 60 + 120);
+	store.remove(makeKey(9, GAP_REMOTE_ADDR_LE_PUBLIC));
+} // testStats
+
+class CountingCallbacks : public BLEAdvertisedDeviceCallbacks {
+public:
+	int results = 0;
+	void onResult(BLEAdvertisedDevice /*advertisedDevice*/) {
+		results++;
+	}
+};
+
+/**
+ * @brief More advertisers than the table holds are still reported, but only the first ones are recorded.
+ */
+static void testFullTable() {
+	BLEScan* pScan = BLEDevice::getScan();
+	CountingCallbacks callbacks;
+	pScan->setAdvertisedDeviceCallbacks(&callbacks, false);
+	pScan->clearResults();
+	uint8_t payload[] = { 2, 0x01, 0x06 };
+	for (uint32_t n = 0; n < BLE_SCAN_MAX_DEVICES + 44; n++) {
+		uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 1, 2, 3, 4 };
+		BLEScanReport report = {};
+		report.address    = address;
+		report.advType    = GAP_ADV_EVT_TYPE_UNDIRECTED;
+		report.rssi       = -60;
+		report.txPower    = BLE_SCAN_TX_POWER_NONE;
+		report.dataLength = sizeof(payload);
+		report.data       = payload;
+		pScan->injectReport(&report);
+	}
+	CHECK_EQ(callbacks.results, BLE_SCAN_MAX_DEVICES + 44);
+	BLEScanResults results = pScan->getResults();
+	CHECK_EQ(results.getCount(), BLE_SCAN_MAX_DEVICES);
+	CHECK(results[0].getAddress().equals(BLEAddress((uint8_t*)"\x00\x00\x01\x02\x03\x04")));
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	pScan->clearResults();
+} // testFullTable
+
+int main() {
+	testAgainstMap();
+	testAddressType();
+	testStats();
+	testFullTable();
+	return testResult("test_scan_results");
+} // main
@@ -0,0 +1,109 @@
+/*
+ * test_scan_scheduler.cpp
+ *
+ *  Scan scheduler replayed against synthetic traces of scan periods.
+ */
+
+#include "BLEScanScheduler.h"
+#include "test.h"
+
+static uint64_t makeKey(uint32_t n) {
+	return 0xc00000000000ULL | n;
+} // makeKey
+
+/**
+ * @brief Run one period of 10 seconds in which devices first .. first + count - 1 advertise.
+ * Every device advertises several times, as it would during a real period.
+ * @return The number of new devices counted.
+ */
+static uint32_t runPeriod(BLEScanScheduler* pScheduler, uint32_t first, uint32_t count, uint32_t backlog = 0) {
+	BLEScanObservation observation = {};
+	for (uint32_t repeat = 0; repeat < 5; repeat++) {
+		for (uint32_t n = first; n < first + count; n++) {
+			observation.reports++;
+			if (pScheduler->observe(makeKey(n))) {
+				observation.newDevices++;
+			}
+		}
+	}
+	observation.durationMs = 10000;
+	observation.backlog    = backlog;
+	pScheduler->update(&observation);
+	return observation.newDevices;
+} // runPeriod
+
+/**
+ * @brief A crowd that stays put is discovered once, then the scan relaxes step by step.
+ */
+static void testStableCrowd() {
+	BLEScanScheduler scheduler;
+	CHECK_EQ(scheduler.getLevel(), BLE_SCAN_SCHEDULER_LEVELS - 1);
+	CHECK(scheduler.getParams().active);
+	CHECK_EQ(runPeriod(&scheduler, 0, 40), 40);
+	CHECK_EQ(scheduler.getLevel(), BLE_SCAN_SCHEDULER_LEVELS - 1);
+	uint32_t total = 0;
+	for (int period = 0; period < 3 * 3; period++) {   // stablePeriods of 3 per level.
+		total += runPeriod(&scheduler, 0, 40);
+	}
+	CHECK_EQ(total, 0);
+	CHECK_EQ(scheduler.getLevel(), 0);
+	CHECK_EQ(scheduler.getParams().intervalMs, 1280);
+	CHECK_EQ(scheduler.getParams().windowMs, 128);
+	CHECK(!scheduler.getParams().active);
+} // testStableCrowd
+
+/**
+ * @brief Devices walking past keep the scan aggressive, a returning device after a long absence is new.
+ */
+static void testChurn() {
+	BLEScanScheduler scheduler;
+	for (int period = 0; period < 10; period++) {
+		CHECK_EQ(runPeriod(&scheduler, 1000 + period * 5, 5), 5);   // 30 per minute, above busyRate.
+	}
+	CHECK_EQ(scheduler.getLevel(), BLE_SCAN_SCHEDULER_LEVELS - 1);
+
+	BLEScanScheduler quiet;
+	runPeriod(&quiet, 7, 1);
+	for (int period = 0; period < 9; period++) {
+		runPeriod(&quiet, 0, 0);
+	}
+	CHECK_EQ(runPeriod(&quiet, 7, 1), 0);   // Seen in the 10th period back, still remembered.
+	for (int period = 0; period < 11; period++) {
+		runPeriod(&quiet, 0, 0);
+	}
+	CHECK_EQ(runPeriod(&quiet, 7, 1), 1);   // Gone for longer than memoryPeriods.
+} // testChurn
+
+/**
+ * @brief A crowd larger than the table recycles the entries seen longest ago.
+ */
+static void testFullTable() {
+	BLEScanScheduler scheduler;
+	CHECK_EQ(runPeriod(&scheduler, 0, BLE_SCAN_SCHEDULER_SEEN_SIZE / 2), BLE_SCAN_SCHEDULER_SEEN_SIZE / 2);
+	CHECK_EQ(runPeriod(&scheduler, 0, BLE_SCAN_SCHEDULER_SEEN_SIZE / 2), 0);
+	uint32_t flood = runPeriod(&scheduler, 5000, BLE_SCAN_SCHEDULER_SEEN_SIZE * 4);
+	CHECK(flood > BLE_SCAN_SCHEDULER_SEEN_SIZE * 4);   // Devices are evicted again before their repeats.
+	CHECK(runPeriod(&scheduler, 0, BLE_SCAN_SCHEDULER_SEEN_SIZE / 2) > 0);
+} // testFullTable
+
+/**
+ * @brief A consumer falling behind forces a step down and passive scanning, whatever the discovery rate.
+ */
+static void testCongestion() {
+	BLEScanScheduler scheduler;
+	runPeriod(&scheduler, 0, 40, 100);
+	CHECK_EQ(scheduler.getLevel(), BLE_SCAN_SCHEDULER_LEVELS - 2);
+	CHECK(!scheduler.getParams().active);
+	runPeriod(&scheduler, 100, 40, 0);
+	CHECK_EQ(scheduler.getLevel(), BLE_SCAN_SCHEDULER_LEVELS - 1);
+	scheduler.reset();
+	CHECK_EQ(runPeriod(&scheduler, 0, 40), 40);   // reset() forgets the devices.
+} // testCongestion
+
+int main() {
+	testStableCrowd();
+	testChurn();
+	testFullTable();
+	testCongestion();
+	return testResult("test_scan_scheduler");
+} // main
@@ -0,0 +1,217 @@
+/*
+ * test_scan_snapshot.cpp
+ *
+ *  Scan results snapshots outliving the devices the scan updates, removes and clears.
+ */
+
+#include <atomic>
+#include <thread>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+static const uint8_t s_payload[] = { 2, 0x01, 0x06 };
+
+/**
+ * @brief Pass a report of a numbered device to the scan.
+ * The RSSI is derived from the number so readers can check a record belongs to its address.
+ */
+static void inject(BLEScan* pScan, uint32_t n, uint8_t advType = GAP_ADV_EVT_TYPE_UNDIRECTED) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 1, 2, 3, 4 };
+	BLEScanReport report = {};
+	report.address    = address;
+	report.advType    = advType;
+	report.rssi       = -1 - (int8_t)(n % 100);
+	report.txPower    = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength = sizeof(s_payload);
+	report.data       = s_payload;
+	pScan->injectReport(&report);
+} // inject
+
+static bool isDevice(const BLEAdvertisedDevice& device, uint32_t n) {
+	uint8_t address[6] = { (uint8_t)n, (uint8_t)(n >> 8), 1, 2, 3, 4 };
+	return device.getAddress().equals(BLEAddress(address)) && device.getRSSI() == -1 - (int)(n % 100);
+} // isDevice
+
+/**
+ * @brief A snapshot keeps its devices across a clear, and the records come back once it is gone.
+ */
+static void testClear() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	uint16_t baseline = pScan->getDevicePool()->getInUse();
+	for (uint32_t n = 0; n < 20; n++) {
+		inject(pScan, n);
+	}
+	{
+		BLEScanResults results = pScan->getResults();
+		pScan->clearResults();
+		for (uint32_t n = 100; n < 120; n++) {
+			inject(pScan, n);
+		}
+		CHECK(!results.isValid());
+		CHECK_EQ(results.getCount(), 20);
+		bool intact = true;
+		uint32_t n = 0;
+		for (const BLEAdvertisedDevice& device : results) {
+			intact = intact && isDevice(device, n++);
+		}
+		CHECK(intact);
+		CHECK_EQ(pScan->getDevicePool()->getInUse(), baseline + 40);   // The cleared records are held back.
+	}
+	inject(pScan, 100);   // The next report reclaims them.
+	CHECK_EQ(pScan->getDevicePool()->getInUse(), baseline + 20);
+	pScan->clearResults();
+	CHECK_EQ(pScan->getDevicePool()->getInUse(), baseline);
+} // testClear
+
+/**
+ * @brief Erasing a device leaves the snapshot readable, its statistics are looked up by address.
+ * The scan removes the device when it handles its next report.
+ */
+static void testErase() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	for (uint32_t n = 0; n < 3; n++) {
+		inject(pScan, n);
+	}
+	BLEScanResults results = pScan->getResults();
+	CHECK(results.isValid());
+	CHECK_EQ(results.getStats(2).count, 1);
+	pScan->erase(results[0].getAddress());
+	CHECK(results.isValid());
+	inject(pScan, 2);
+	CHECK(!results.isValid());
+	CHECK(isDevice(results[0], 0));
+	CHECK_EQ(results.getStats(0).count, 0);   // No longer recorded.
+	CHECK_EQ(results.getStats(2).count, 2);   // Moved into the hole, found by its address.
+	CHECK_EQ(pScan->getResults().getCount(), 2);
+	pScan->clearResults();
+} // testErase
+
+/**
+ * @brief A merged scan response is a new record, the snapshot keeps the record it saw.
+ */
+static void testMerge() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	pScan->setActiveScan(true);
+	pScan->setScanResponseMerge(true, 500);
+	inject(pScan, 5);
+	BLEScanResults before = pScan->getResults();
+	inject(pScan, 5, GAP_ADV_EVT_TYPE_SCAN_RSP);
+	BLEScanResults after = pScan->getResults();
+	CHECK_EQ(before.getCount(), 1);
+	CHECK(!before[0].haveScanResponse());
+	CHECK(after[0].haveScanResponse());
+	CHECK(&before[0] != &after[0]);
+	CHECK(before.isValid());   // Replacing a record moves nothing.
+
+	BLEScanResults copy(before);
+	before = BLEScanResults();
+	CHECK(!copy[0].haveScanResponse());
+	before = after;
+	CHECK(&before[0] == &after[0]);
+	pScan->setScanResponseMerge(false);
+	pScan->clearResults();
+} // testMerge
+
+/**
+ * @brief A snapshot held while the scan keeps updating its devices costs at most one record per device it
+ * holds, BLE_SCAN_POOL_RETIRED in all, and never keeps the scan from filling the results.
+ */
+static void testHeldSnapshot() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	pScan->clearResults();
+	pScan->setActiveScan(true);
+	pScan->setScanResponseMerge(true, 60000);
+	BLEAdvertisedDevicePool* pPool = pScan->getDevicePool();
+	uint32_t exhausted = pPool->getExhaustedCount();
+	for (uint32_t n = 0; n < 4; n++) {
+		inject(pScan, n);   // Held back for their scan response, every report updates them.
+	}
+	{
+		BLEScanResults held = pScan->getResults();
+		for (int round = 0; round < 100; round++) {
+			for (uint32_t n = 0; n < 4; n++) {
+				inject(pScan, n);
+			}
+		}
+		CHECK_EQ(pPool->getRetiredCount(), 4);
+
+		for (uint32_t n = 4; n < 2 * BLE_SCAN_POOL_RETIRED; n++) {
+			inject(pScan, n);
+		}
+		BLEScanResults more = pScan->getResults();
+		for (uint32_t n = 0; n < 2 * BLE_SCAN_POOL_RETIRED; n++) {
+			inject(pScan, n, GAP_ADV_EVT_TYPE_SCAN_RSP);
+		}
+		CHECK_EQ(pPool->getRetiredCount(), BLE_SCAN_POOL_RETIRED);
+		for (uint32_t n = 1000; pScan->getResults().getCount() < BLE_SCAN_MAX_DEVICES && n < 2000; n++) {
+			inject(pScan, n, GAP_ADV_EVT_TYPE_NON_CONNECTABLE);
+		}
+		CHECK_EQ(pScan->getResults().getCount(), BLE_SCAN_MAX_DEVICES);
+		CHECK_EQ(pPool->getExhaustedCount(), exhausted);
+		CHECK(!held[0].haveScanResponse());
+		CHECK(isDevice(held[3], 3));
+	}
+	inject(pScan, 2 * BLE_SCAN_POOL_RETIRED - 1, GAP_ADV_EVT_TYPE_SCAN_RSP);   // Waited for the snapshots to go.
+	CHECK_EQ(pPool->getRetiredCount(), 0);
+	CHECK(pScan->getResults()[2 * BLE_SCAN_POOL_RETIRED - 1].haveScanResponse());
+	pScan->setScanResponseMerge(false);
+	pScan->clearResults();
+	CHECK_EQ(pPool->getInUse(), 0);
+} // testHeldSnapshot
+
+/**
+ * @brief A reader task iterating snapshots while the scan records, erases and clears devices.
+ */
+static void testConcurrentReader() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->setAdvertisedDeviceCallbacks(nullptr, true);   // Repeats go the full path without pausing the task.
+	pScan->clearResults();
+	std::atomic<bool> done(false);
+	std::atomic<bool> intact(true);
+	std::atomic<uint32_t> snapshots(0);
+	std::thread reader([&]() {
+		while (!done.load()) {
+			BLEScanResults results = pScan->getResults();
+			for (const BLEAdvertisedDevice& device : results) {
+				BLEAddress address = device.getAddress();
+				uint32_t n = (*address.getNative())[0] | ((*address.getNative())[1] << 8);
+				if (!isDevice(device, n)) {
+					intact = false;
+				}
+			}
+			snapshots++;
+		}
+	});
+	for (uint32_t i = 0; i < 200000; i++) {
+		uint32_t n = i % 300;
+		inject(pScan, n);
+		if (i % 7 == 0) {
+			uint8_t address[6] = { (uint8_t)(n / 2), 0, 1, 2, 3, 4 };
+			pScan->erase(BLEAddress(address));
+		}
+		if (i % 5000 == 0) {
+			pScan->clearResults();
+		}
+	}
+	done = true;
+	reader.join();
+	CHECK(intact.load());
+	CHECK(snapshots.load() > 0);
+	pScan->setAdvertisedDeviceCallbacks(nullptr, false);
+	pScan->clearResults();
+	CHECK_EQ(pScan->getDevicePool()->getInUse(), 0);
+} // testConcurrentReader
+
+int main() {
+	testClear();
+	testErase();
+	testMerge();
+	testHeldSnapshot();
+	testConcurrentReader();
+	return testResult("test_scan_snapshot");
+} // main
@@ -0,0 +1,113 @@
+/*
+ * test_scan_stream.cpp
+ *
+ *  Streaming scan mode: the record ring alone, under a synthetic producer thread, and fed by the scan.
+ */
+
+#include <thread>
+#include "BLEDevice.h"
+#include "BLEScan.h"
+#include "test.h"
+
+/**
+ * @brief Records come out in order, and pushes into a full ring are dropped and counted.
+ */
+static void testOverflow() {
+	static BLEScanRecordStream stream;
+	BLEScanRecord record = {};
+	for (uint32_t i = 0; i < BLE_SCAN_STREAM_SIZE + 5; i++) {
+		record.timestamp = i;
+		stream.push(&record);
+	}
+	CHECK_EQ(stream.available(), BLE_SCAN_STREAM_SIZE);
+	CHECK_EQ(stream.getDroppedCount(), 5);
+	CHECK_EQ(stream.getHighWaterMark(), BLE_SCAN_STREAM_SIZE);
+	bool ordered = true;
+	for (uint32_t i = 0; i < BLE_SCAN_STREAM_SIZE; i++) {
+		ordered = ordered && stream.pop(&record) && record.timestamp == i;
+	}
+	CHECK(ordered);
+	CHECK(!stream.pop(&record));
+} // testOverflow
+
+/**
+ * @brief A producer thread pushes as fast as it can while the consumer drains.
+ * Every record is either received intact and in order or counted as dropped.
+ */
+static void testProducerThread() {
+	static BLEScanRecordStream stream;
+	const uint32_t total = 1000000;
+	std::thread producer([&]() {
+		BLEScanRecord record = {};
+		for (uint32_t i = 0; i < total; i++) {
+			record.timestamp  = i;
+			record.dataLength = i % (BLE_SCAN_RECORD_MAX_DATA + 1);
+			memset(record.data, (uint8_t)i, record.dataLength);
+			stream.push(&record);
+			if ((i & 15) == 0) {   // Bursts of 16, so the consumer keeps up with most of them.
+				std::this_thread::yield();
+			}
+		}
+	});
+	uint32_t received = 0;
+	uint32_t last = 0;
+	bool intact = true;
+	BLEScanRecord record;
+	while (received + stream.getDroppedCount() < total) {
+		if (!stream.pop(&record)) {
+			continue;
+		}
+		intact = intact && (received == 0 || record.timestamp > last);
+		intact = intact && record.dataLength == record.timestamp % (BLE_SCAN_RECORD_MAX_DATA + 1);
+		for (uint8_t i = 0; i < record.dataLength; i++) {
+			intact = intact && record.data[i] == (uint8_t)record.timestamp;
+		}
+		last = record.timestamp;
+		received++;
+	}
+	producer.join();
+	CHECK(intact);
+	CHECK_EQ(received + stream.getDroppedCount(), total);
+	CHECK_EQ(stream.getPushedCount(), received);
+	printf("  %u of %u records received, %u dropped\n", received, total, stream.getDroppedCount());
+} // testProducerThread
+
+/**
+ * @brief In streaming mode the scan pushes records instead of recording devices.
+ */
+static void testScanStreaming() {
+	BLEScan* pScan = BLEDevice::getScan();
+	pScan->clearResults();
+	CHECK(pScan->getRecordStream() == nullptr);   // Only allocated for streaming.
+	pScan->setStreaming(true);
+	CHECK(pScan->getRecordStream() != nullptr);
+	uint8_t address[6] = { 1, 2, 3, 4, 5, 6 };
+	uint8_t payload[] = { 2, 0x01, 0x06 };
+	BLEScanReport report = {};
+	report.address     = address;
+	report.addressType = GAP_REMOTE_ADDR_LE_RANDOM;
+	report.advType     = GAP_ADV_EVT_TYPE_NON_CONNECTABLE;
+	report.rssi        = -71;
+	report.txPower     = BLE_SCAN_TX_POWER_NONE;
+	report.dataLength  = sizeof(payload);
+	report.data        = payload;
+	pScan->injectReport(&report);
+	pScan->injectReport(&report);
+	BLEScanRecord record;
+	CHECK_EQ(pScan->getRecordStream()->available(), 2);
+	CHECK(pScan->getRecordStream()->pop(&record));
+	CHECK(memcmp(record.address, address, 6) == 0);
+	CHECK_EQ(record.addressType, GAP_REMOTE_ADDR_LE_RANDOM);
+	CHECK_EQ(record.rssi, -71);
+	CHECK_EQ(record.dataLength, sizeof(payload));
+	CHECK(pScan->getRecordStream()->pop(&record));
+	CHECK_EQ(pScan->getResults().getCount(), 0);
+	pScan->setStreaming(false);
+} // testScanStreaming
+
+int main() {
+	testOverflow();
+	testProducerThread();
+	testScanStreaming();
+	return testResult("test_scan_stream");
+} // main
@@ -0,0 +1,110 @@
+/*
+ * test_uuid_index.cpp
+ *
+ *  UUID index: 16, 32 and 128 bit forms of a UUID, the switch from a list to a hash table, and removal.
+ */
+
+#include <stdio.h>
+#include <vector>
+#include "BLEUUIDIndex.h"
+#include "test.h"
+
+class Attribute {
+public:
+	explicit Attribute(BLEUUID uuid) : m_uuid(uuid) {}
+	BLEUUID getUUID() { return m_uuid; }
+private:
+	BLEUUID m_uuid;
+};
+
+static BLEUUID vendorUUID(uint16_t n) {
+	char uuid[37];
+	snprintf(uuid, sizeof(uuid), "6e40%04x-b5a3-f393-e0a9-e50e24dcca9e", n);
+	return BLEUUID(std::string(uuid));
+} // vendorUUID
+
+/**
+ * @brief The 16, 32 and 128 bit forms of a UUID built on the Bluetooth base UUID are the same key,
+ * vendor UUIDs are keyed on all their bytes.
+ */
+static void testForms() {
+	BLEUUID uuid16((uint16_t)0x180d);
+	BLEUUID uuid32(std::string("0000180d"));
+	BLEUUID uuid128(std::string("0000180d-0000-1000-8000-00805f9b34fb"));
+	CHECK(BLEUUIDKey(uuid16) == BLEUUIDKey(uuid32));
+	CHECK(BLEUUIDKey(uuid16) == BLEUUIDKey(uuid128));
+	CHECK_EQ(BLEUUIDKey(uuid32).hash(), BLEUUIDKey(uuid128).hash());
+	CHECK(!(BLEUUIDKey(uuid16) == BLEUUIDKey(BLEUUID((uint16_t)0x180e))));
+	CHECK(!(BLEUUIDKey(vendorUUID(1)) == BLEUUIDKey(vendorUUID(2))));
+	CHECK(!BLEUUIDKey(BLEUUID()).isValid());
+
+	Attribute heartRate(uuid128);
+	Attribute again(uuid16);
+	Attribute vendor(vendorUUID(1));
+	BLEUUIDIndex<Attribute> index;
+	CHECK(index.insert(uuid128, &heartRate));
+	CHECK(!index.insert(uuid16, &again));   // Already present in another form.
+	CHECK(index.insert(vendorUUID(1), &vendor));
+	CHECK(!index.insert(BLEUUID(), &vendor));
+	CHECK(index.get(uuid16) == &heartRate);
+	CHECK(index.get(uuid32) == &heartRate);
+	CHECK(index.get(uuid128) == &heartRate);
+	CHECK(index.get(vendorUUID(1)) == &vendor);
+	CHECK(index.get(vendorUUID(2)) == nullptr);
+	CHECK(index.get(BLEUUID()) == nullptr);
+	CHECK_EQ(index.getCount(), 2);
+} // testForms
+
+/**
+ * @brief Lookups and removals in a list, through the switch to a hash table, and in the table.
+ */
+static void testGrowth() {
+	const uint16_t count = 4 * BLE_UUID_INDEX_LINEAR + 3;
+	std::vector<Attribute*> attributes;
+	BLEUUIDIndex<Attribute> index;
+	bool found = true;
+	for (uint16_t n = 0; n < count; n++) {
+		BLEUUID uuid = (n % 2) ? vendorUUID(n) : BLEUUID((uint16_t)(0x2a00 + n));
+		attributes.push_back(new Attribute(uuid));
+		CHECK(index.insert(uuid, attributes.back()));
+		CHECK_EQ(index.isHashed(), n >= BLE_UUID_INDEX_LINEAR);
+		for (uint16_t m = 0; m <= n; m++) {
+			found = found && index.get(attributes[m]->getUUID()) == attributes[m];
+		}
+	}
+	CHECK(found);
+
+	// Every other attribute goes, the probe sequences of the ones left stay intact.
+	Attribute other(attributes[1]->getUUID());
+	CHECK(!index.remove(other.getUUID(), &other));
+	for (uint16_t n = 1; n < count; n += 2) {
+		CHECK(index.remove(attributes[n]->getUUID(), attributes[n]));
+	}
+	CHECK(!index.remove(attributes[1]->getUUID(), attributes[1]));
+	found = true;
+	for (uint16_t n = 0; n < count; n++) {
+		found = found && index.get(attributes[n]->getUUID()) == ((n % 2) ? nullptr : attributes[n]);
+	}
+	CHECK(found);
+	CHECK_EQ(index.getCount(), (count + 1) / 2);
+
+	BLEUUIDIndex<Attribute> small;
+	for (uint16_t n = 0; n < 3; n++) {
+		small.insert(attributes[n]->getUUID(), attributes[n]);
+	}
+	CHECK(small.remove(attributes[1]->getUUID(), attributes[1]));
+	CHECK(small.get(attributes[0]->getUUID()) == attributes[0]);
+	CHECK(small.get(attributes[1]->getUUID()) == nullptr);
+	CHECK(small.get(attributes[2]->getUUID()) == attributes[2]);
+	CHECK(small.insert(other.getUUID(), &other));
+	CHECK(small.get(attributes[1]->getUUID()) == &other);
+	for (Attribute* pAttribute : attributes) {
+		delete pAttribute;
+	}
+} // testGrowth
+
+int main() {
+	testForms();
+	testGrowth();
+	return testResult("test_uuid_index");
+} // main